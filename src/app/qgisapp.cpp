@@ -4004,15 +4004,7 @@ void QgisApp::stopRendering()
 {
   if ( mMapCanvas )
   {
-    QgsMapRenderer* mypMapRenderer = mMapCanvas->mapRenderer();
-    if ( mypMapRenderer )
-    {
-      QgsRenderContext* mypRenderContext = mypMapRenderer->rendererContext();
-      if ( mypRenderContext )
-      {
-        mypRenderContext->setRenderingStopped( true );
-      }
-    }
+    mMapCanvas->stopRendering();
   }
 }
 
@@ -39,6 +39,7 @@ QgsCoordinateTransform::QgsCoordinateTransform()
     , mInitialisedFlag( false )
     , mSourceProjection( 0 )
     , mDestinationProjection( 0 )
+    , mProjContext( 0 )
 {
   setFinder();
 }
@@ -48,6 +49,7 @@ QgsCoordinateTransform::QgsCoordinateTransform( const QgsCoordinateReferenceSyst
     , mInitialisedFlag( false )
     , mSourceProjection( 0 )
     , mDestinationProjection( 0 )
+    , mProjContext( 0 )
 {
   setFinder();
   mSourceCRS = source;
@@ -62,6 +64,7 @@ QgsCoordinateTransform::QgsCoordinateTransform( long theSourceSrsId, long theDes
     , mDestCRS( theDestSrsId, QgsCoordinateReferenceSystem::InternalCrsId )
     , mSourceProjection( 0 )
     , mDestinationProjection( 0 )
+    , mProjContext( 0 )
 {
   initialise();
 }
@@ -71,6 +74,7 @@ QgsCoordinateTransform::QgsCoordinateTransform( QString theSourceCRS, QString th
     , mInitialisedFlag( false )
     , mSourceProjection( 0 )
     , mDestinationProjection( 0 )
+    , mProjContext( 0 )
 {
   setFinder();
   mSourceCRS.createFromWkt( theSourceCRS );
@@ -89,6 +93,7 @@ QgsCoordinateTransform::QgsCoordinateTransform( long theSourceSrid,
     , mInitialisedFlag( false )
     , mSourceProjection( 0 )
     , mDestinationProjection( 0 )
+    , mProjContext( 0 )
 {
   setFinder();
 
@@ -112,6 +117,12 @@ QgsCoordinateTransform::~QgsCoordinateTransform()
   {
     pj_free( mDestinationProjection );
   }
+#if defined(PJ_VERSION) && PJ_VERSION >= 480
+  if ( mProjContext )
+  {
+    pj_ctx_free( mProjContext );
+  }
+#endif
 }
 
 void QgsCoordinateTransform::setSourceCrs( const QgsCoordinateReferenceSystem& theCRS )
@@ -155,8 +166,17 @@ void QgsCoordinateTransform::initialise()
   }
 
   // init the projections (destination and source)
+#if defined(PJ_VERSION) && PJ_VERSION >= 480
+  if ( !mProjContext )
+  {
+    mProjContext = pj_ctx_alloc();
+  }
+  mDestinationProjection = pj_init_plus_ctx( mProjContext, mDestCRS.toProj4().toUtf8() );
+  mSourceProjection = pj_init_plus_ctx( mProjContext, mSourceCRS.toProj4().toUtf8() );
+#else
   mDestinationProjection = pj_init_plus( mDestCRS.toProj4().toUtf8() );
   mSourceProjection = pj_init_plus( mSourceCRS.toProj4().toUtf8() );
+#endif
 
 #ifdef COORDINATE_TRANSFORM_VERBOSE
   QgsDebugMsg( "From proj : " + mSourceCRS.toProj4() );
@@ -321,30 +341,31 @@ void QgsCoordinateTransform::transformInPlace( double& x, double& y, double& z,
 
 void QgsCoordinateTransform::transformPolygon( QPolygonF& poly, TransformDirection direction ) const
 {
-  //create x, y arrays
+  if ( mShortCircuit || !mInitialisedFlag || poly.isEmpty() )
+    return;
+
   int nVertices = poly.size();
-  QVector<qreal> x( nVertices );
-  QVector<qreal> y( nVertices );
-  QVector<qreal> z( nVertices );
+
+  if ( sizeof( qreal ) == sizeof( double ) )
+  {
+    // QPointF keeps x and y next to each other, so the vertices are handed to proj without copying
+    double* coords = reinterpret_cast<double*>( poly.data() );
+    transformCoords( nVertices, coords, coords + 1, 0, 2, direction );
+    return;
+  }
+
+  //create x, y arrays
+  QVector<double> x( nVertices );
+  QVector<double> y( nVertices );
 
   for ( int i = 0; i < nVertices; ++i )
   {
     const QPointF& pt = poly.at( i );
     x[i] = pt.x();
     y[i] = pt.y();
-    z[i] = 0;
   }
 
-  try
-  {
-    transformCoords( nVertices, x.data(), y.data(), z.data(), direction );
-  }
-  catch ( QgsCsException &cse )
-  {
-    // rethrow the exception
-    QgsDebugMsg( "rethrowing exception" );
-    throw cse;
-  }
+  transformCoords( nVertices, x.data(), y.data(), 0, 1, direction );
 
   for ( int i = 0; i < nVertices; ++i )
   {
@@ -354,6 +375,15 @@ void QgsCoordinateTransform::transformPolygon( QPolygonF& poly, TransformDirecti
   }
 }
 
+void QgsCoordinateTransform::transformInPlace( double* x, double* y, double* z, int numPoints, int pointOffset,
+    TransformDirection direction ) const
+{
+  if ( mShortCircuit || !mInitialisedFlag || numPoints <= 0 )
+    return;
+
+  transformCoords( numPoints, x, y, z, pointOffset, direction );
+}
+
 void QgsCoordinateTransform::transformInPlace(
   QVector<double>& x, QVector<double>& y, QVector<double>& z,
   TransformDirection direction ) const
@@ -542,6 +572,11 @@ QgsRectangle QgsCoordinateTransform::transformBoundingBox( const QgsRectangle re
 }
 
 void QgsCoordinateTransform::transformCoords( const int& numPoints, double *x, double *y, double *z, TransformDirection direction ) const
+{
+  transformCoords( numPoints, x, y, z, 1, direction );
+}
+
+void QgsCoordinateTransform::transformCoords( int numPoints, double *x, double *y, double *z, int pointOffset, TransformDirection direction ) const
 {
   // Refuse to transform the points if the srs's are invalid
   if ( !mSourceCRS.isValid() )
@@ -571,25 +606,26 @@ void QgsCoordinateTransform::transformCoords( const int& numPoints, double *x, d
   if (( pj_is_latlong( mDestinationProjection ) && ( direction == ReverseTransform ) )
       || ( pj_is_latlong( mSourceProjection ) && ( direction == ForwardTransform ) ) )
   {
-    for ( int i = 0; i < numPoints; ++i )
+    for ( int i = 0; i < numPoints * pointOffset; i += pointOffset )
     {
       x[i] *= DEG_TO_RAD;
       y[i] *= DEG_TO_RAD;
-      z[i] *= DEG_TO_RAD;
+      if ( z )
+        z[i] *= DEG_TO_RAD;
     }
 
   }
   int projResult;
   if ( direction == ReverseTransform )
   {
-    projResult = pj_transform( mDestinationProjection, mSourceProjection, numPoints, 0, x, y, z );
+    projResult = pj_transform( mDestinationProjection, mSourceProjection, numPoints, pointOffset, x, y, z );
     dir = tr( "inverse transform" );
   }
   else
   {
     Q_ASSERT( mSourceProjection != 0 );
     Q_ASSERT( mDestinationProjection != 0 );
-    projResult = pj_transform( mSourceProjection, mDestinationProjection, numPoints, 0, x, y, z );
+    projResult = pj_transform( mSourceProjection, mDestinationProjection, numPoints, pointOffset, x, y, z );
     dir = tr( "forward transform" );
   }
 
@@ -598,7 +634,7 @@ void QgsCoordinateTransform::transformCoords( const int& numPoints, double *x, d
     //something bad happened....
     QString points;
 
-    for ( int i = 0; i < numPoints; ++i )
+    for ( int i = 0; i < numPoints * pointOffset; i += pointOffset )
     {
       if ( direction == ForwardTransform )
       {
@@ -633,11 +669,12 @@ void QgsCoordinateTransform::transformCoords( const int& numPoints, double *x, d
   if (( pj_is_latlong( mDestinationProjection ) && ( direction == ForwardTransform ) )
       || ( pj_is_latlong( mSourceProjection ) && ( direction == ReverseTransform ) ) )
   {
-    for ( int i = 0; i < numPoints; ++i )
+    for ( int i = 0; i < numPoints * pointOffset; i += pointOffset )
     {
       x[i] *= RAD_TO_DEG;
       y[i] *= RAD_TO_DEG;
-      z[i] *= RAD_TO_DEG;
+      if ( z )
+        z[i] *= RAD_TO_DEG;
     }
   }
 #ifdef COORDINATE_TRANSFORM_VERBOSE
@@ -34,6 +34,7 @@ class QPolygonF;
 #include <vector>
 
 typedef void* projPJ;
+typedef void* projCtx;
 class QString;
 
 /** \ingroup core
@@ -161,6 +162,22 @@ class CORE_EXPORT QgsCoordinateTransform : public QObject
 
     void transformPolygon( QPolygonF& poly, TransformDirection direction = ForwardTransform ) const;
 
+    /*! Transform a batch of coordinates in place with a single call to proj.
+     * The coordinates may be stored in separate arrays (x[], y[], z[]) or interleaved
+     * (e.g. the x/y pairs of a QPolygonF or of a WKB line string), consecutive coordinates
+     * being pointOffset doubles apart.
+     * @param x pointer to the first x coordinate
+     * @param y pointer to the first y coordinate
+     * @param z pointer to the first z coordinate, may be NULL if there are no z values
+     * @param numPoints number of points to transform
+     * @param pointOffset distance between two consecutive coordinates in doubles (1 for separate arrays)
+     * @param direction TransformDirection (defaults to ForwardTransform)
+     * @note added in 2.0
+     * @note not available in python bindings
+     */
+    void transformInPlace( double* x, double* y, double* z, int numPoints, int pointOffset = 1,
+                           TransformDirection direction = ForwardTransform ) const;
+
 #ifdef ANDROID
     void transformInPlace( float& x, float& y, float& z, TransformDirection direction = ForwardTransform ) const;
 
@@ -189,6 +206,12 @@ class CORE_EXPORT QgsCoordinateTransform : public QObject
      */
     void transformCoords( const int &numPoint, double *x, double *y, double *z, TransformDirection direction = ForwardTransform ) const;
 
+    /*! Transform coordinates which are pointOffset doubles apart. z may be NULL.
+     * @note added in 2.0
+     * @note not available in python bindings
+     */
+    void transformCoords( int numPoints, double *x, double *y, double *z, int pointOffset, TransformDirection direction ) const;
+
     /*!
      * Flag to indicate whether the coordinate systems have been initialised
      * @return true if initialised, otherwise false
@@ -265,6 +288,12 @@ class CORE_EXPORT QgsCoordinateTransform : public QObject
      */
     projPJ mDestinationProjection;
 
+    /*!
+     * Proj4 context of the projections. Every transform has its own context, so
+     * that transforms used in different threads do not share proj's error state
+     */
+    projCtx mProjContext;
+
     /*!
      * Finder for PROJ grid files.
      */
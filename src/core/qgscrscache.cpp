@@ -18,10 +18,16 @@
 #include "qgscrscache.h"
 #include "qgscoordinatetransform.h"
 
+#include <QMutexLocker>
+
+//! protects creation of the singletons
+static QMutex sInstanceMutex;
+
 QgsCoordinateTransformCache* QgsCoordinateTransformCache::mInstance = 0;
 
 QgsCoordinateTransformCache* QgsCoordinateTransformCache::instance()
 {
+  QMutexLocker locker( &sInstanceMutex );
   if ( !mInstance )
   {
     mInstance = new QgsCoordinateTransformCache();
@@ -31,24 +37,36 @@ QgsCoordinateTransformCache* QgsCoordinateTransformCache::instance()
 
 QgsCoordinateTransformCache::~QgsCoordinateTransformCache()
 {
-  QHash< QPair< QString, QString >, QgsCoordinateTransform* >::const_iterator tIt = mTransforms.constBegin();
-  for ( ; tIt != mTransforms.constEnd(); ++tIt )
+  // transforms of other threads are deleted together with their thread
+  if ( mTransforms.hasLocalData() )
   {
-    delete tIt.value();
+    mTransforms.setLocalData( 0 );
   }
   delete mInstance;
 }
 
+QgsCoordinateTransformCache::ThreadTransforms::~ThreadTransforms()
+{
+  qDeleteAll( transforms );
+}
+
 const QgsCoordinateTransform* QgsCoordinateTransformCache::transform( const QString& srcAuthId, const QString& destAuthId )
 {
+  // no locking required, every thread looks only at its own transforms
+  if ( !mTransforms.hasLocalData() )
+  {
+    mTransforms.setLocalData( new ThreadTransforms );
+  }
+  QHash< QPair< QString, QString >, QgsCoordinateTransform* >& transforms = mTransforms.localData()->transforms;
+
   QHash< QPair< QString, QString >, QgsCoordinateTransform* >::const_iterator ctIt =
-    mTransforms.find( qMakePair( srcAuthId, destAuthId ) );
-  if ( ctIt == mTransforms.constEnd() )
+    transforms.constFind( qMakePair( srcAuthId, destAuthId ) );
+  if ( ctIt == transforms.constEnd() )
   {
     const QgsCoordinateReferenceSystem& srcCrs = QgsCRSCache::instance()->crsByAuthId( srcAuthId );
     const QgsCoordinateReferenceSystem& destCrs = QgsCRSCache::instance()->crsByAuthId( destAuthId );
     QgsCoordinateTransform* ct = new QgsCoordinateTransform( srcCrs, destCrs );
-    mTransforms.insert( qMakePair( srcAuthId, destAuthId ), ct );
+    transforms.insert( qMakePair( srcAuthId, destAuthId ), ct );
     return ct;
   }
   else
@@ -61,6 +79,7 @@ QgsCRSCache* QgsCRSCache::mInstance = 0;
 
 QgsCRSCache* QgsCRSCache::instance()
 {
+  QMutexLocker locker( &sInstanceMutex );
   if ( !mInstance )
   {
     mInstance = new QgsCRSCache();
@@ -69,6 +88,7 @@ QgsCRSCache* QgsCRSCache::instance()
 }
 
 QgsCRSCache::QgsCRSCache()
+    : mMutex( QMutex::Recursive )
 {
 }
 
@@ -79,6 +99,8 @@ QgsCRSCache::~QgsCRSCache()
 
 const QgsCoordinateReferenceSystem& QgsCRSCache::crsByAuthId( const QString& authid )
 {
+  // references to the values stay valid when other CRS are inserted
+  QMutexLocker locker( &mMutex );
   QHash< QString, QgsCoordinateReferenceSystem >::const_iterator crsIt = mCRS.find( authid );
   if ( crsIt == mCRS.constEnd() )
   {
@@ -20,24 +20,37 @@
 
 #include "qgscoordinatereferencesystem.h"
 #include <QHash>
+#include <QMutex>
+#include <QThreadStorage>
 
 class QgsCoordinateTransform;
 
 /**Cache coordinate transform by authid of source/dest transformation to avoid the
-overhead of initialisation for each redraw*/
+overhead of initialisation for each redraw.
+The proj handles of a transform must not be used by several threads at once, therefore
+every thread gets its own set of transforms. They are deleted when the thread finishes.*/
 class CORE_EXPORT QgsCoordinateTransformCache
 {
   public:
     static QgsCoordinateTransformCache* instance();
     ~QgsCoordinateTransformCache();
-    /**Returns coordinate transformation. Cache keeps ownership
+    /**Returns coordinate transformation. Cache keeps ownership.
+        The transform belongs to the calling thread and must not be passed to other threads
         @param srcAuthId auth id string of source crs
         @param destAuthId auth id string of dest crs*/
     const QgsCoordinateTransform* transform( const QString& srcAuthId, const QString& destAuthId );
 
   private:
+    /**Transforms of one thread*/
+    class ThreadTransforms
+    {
+      public:
+        ~ThreadTransforms();
+        QHash< QPair< QString, QString >, QgsCoordinateTransform* > transforms;
+    };
+
     static QgsCoordinateTransformCache* mInstance;
-    QHash< QPair< QString, QString >, QgsCoordinateTransform* > mTransforms;
+    QThreadStorage< ThreadTransforms* > mTransforms;
 };
 
 class CORE_EXPORT QgsCRSCache
@@ -55,6 +68,8 @@ class CORE_EXPORT QgsCRSCache
   private:
     static QgsCRSCache* mInstance;
     QHash< QString, QgsCoordinateReferenceSystem > mCRS;
+    /**Protects mCRS, the cache is used from several threads*/
+    QMutex mMutex;
     /**CRS that is not initialised (returned in case of error)*/
     QgsCoordinateReferenceSystem mInvalidCRS;
 };
@@ -194,6 +194,31 @@ inline bool isNull( const QVariant& v ) { return v.isNull(); }
 #define ENSURE_NO_EVAL_ERROR   {  if (parent->hasEvalError()) return QVariant(); }
 #define SET_EVAL_ERROR(x)   { parent->setEvalErrorString(x); return QVariant(); }
 
+///////////////////////////////////////////////
+// preparation
+
+// replaces a node which does not depend on the feature by a literal with its value,
+// so that it is evaluated just once and not for every feature
+static void foldConstant( QgsExpression* parent, QgsExpression::Node*& node )
+{
+  if ( !node || dynamic_cast<QgsExpression::NodeLiteral*>( node ) || !node->isStatic() )
+    return;
+
+  // errors from the preparation must not get lost
+  QString errorString = parent->evalErrorString();
+  parent->setEvalErrorString( QString() );
+  QVariant value = node->eval( parent, NULL );
+  bool ok = !parent->hasEvalError();
+  parent->setEvalErrorString( errorString );
+
+  // keep nodes which fail, so that the error is reported when evaluated
+  if ( !ok )
+    return;
+
+  delete node;
+  node = new QgsExpression::NodeLiteral( value );
+}
+
 ///////////////////////////////////////////////
 // operators
 
@@ -1223,6 +1248,7 @@ int QgsExpression::functionCount()
 
 QgsExpression::QgsExpression( const QString& expr )
     : mExpression( expr )
+    , mEvalNode( NULL )
     , mRowNumber( 0 )
     , mScale( 0 )
 
@@ -1237,9 +1263,21 @@ QgsExpression::QgsExpression( const QString& expr )
   }
 }
 
+QgsExpression::QgsExpression( const QgsExpression& other )
+    : mExpression( other.mExpression )
+    , mRootNode( other.mRootNode ? other.mRootNode->clone() : NULL )
+    , mEvalNode( NULL )
+    , mParserErrorString( other.mParserErrorString )
+    , mRowNumber( other.mRowNumber )
+    , mScale( other.mScale )
+    , mCalc( other.mCalc )
+{
+}
+
 QgsExpression::~QgsExpression()
 {
   delete mRootNode;
+  delete mEvalNode;
 }
 
 QStringList QgsExpression::referencedColumns()
@@ -1295,7 +1333,15 @@ bool QgsExpression::prepare( const QgsFields& fields )
     return false;
   }
 
-  return mRootNode->prepare( this, fields );
+  // the constant parts are folded in a copy, the tree as written is kept
+  // for dump(), toOgcFilter() and for the callers walking rootNode()
+  delete mEvalNode;
+  mEvalNode = mRootNode->clone();
+
+  bool res = mEvalNode->prepare( this, fields );
+  if ( res )
+    foldConstant( this, mEvalNode );
+  return res;
 }
 
 QVariant QgsExpression::evaluate( QgsFeature* f )
@@ -1307,7 +1353,7 @@ QVariant QgsExpression::evaluate( QgsFeature* f )
     return QVariant();
   }
 
-  return mRootNode->eval( this, f );
+  return mEvalNode ? mEvalNode->eval( this, f ) : mRootNode->eval( this, f );
 }
 
 QVariant QgsExpression::evaluate( QgsFeature* f, const QgsFields& fields )
@@ -1598,6 +1644,14 @@ QgsExpression::Node* QgsExpression::Node::createFromOgcFilter( QDomElement &elem
 ///////////////////////////////////////////////
 // nodes
 
+QgsExpression::NodeList* QgsExpression::NodeList::clone() const
+{
+  NodeList* lst = new NodeList;
+  foreach ( Node* n, mList )
+    lst->mList.append( n->clone() );
+  return lst;
+}
+
 QString QgsExpression::NodeList::dump() const
 {
   QString msg; bool first = true;
@@ -1617,6 +1671,28 @@ void QgsExpression::NodeList::toOgcFilter( QDomDocument &doc, QDomElement &eleme
   }
 }
 
+bool QgsExpression::NodeList::prepare( QgsExpression* parent, const QgsFields& fields )
+{
+  bool res = true;
+  for ( int i = 0; i < mList.count(); ++i )
+  {
+    res = res && mList[i]->prepare( parent, fields );
+    if ( res )
+      foldConstant( parent, mList[i] );
+  }
+  return res;
+}
+
+bool QgsExpression::NodeList::isStatic() const
+{
+  foreach ( Node* n, mList )
+  {
+    if ( !n->isStatic() )
+      return false;
+  }
+  return true;
+}
+
 //
 
 QVariant QgsExpression::NodeUnaryOperator::eval( QgsExpression* parent, QgsFeature* f )
@@ -1649,7 +1725,15 @@ QVariant QgsExpression::NodeUnaryOperator::eval( QgsExpression* parent, QgsFeatu
 
 bool QgsExpression::NodeUnaryOperator::prepare( QgsExpression* parent, const QgsFields& fields )
 {
-  return mOperand->prepare( parent, fields );
+  bool res = mOperand->prepare( parent, fields );
+  if ( res )
+    foldConstant( parent, mOperand );
+  return res;
+}
+
+QgsExpression::Node* QgsExpression::NodeUnaryOperator::clone() const
+{
+  return new NodeUnaryOperator( mOp, mOperand->clone() );
 }
 
 QString QgsExpression::NodeUnaryOperator::dump() const
@@ -1843,18 +1927,23 @@ QVariant QgsExpression::NodeBinaryOperator::eval( QgsExpression* parent, QgsFeat
       else
       {
         QString str    = getStringValue( vL, parent ); ENSURE_NO_EVAL_ERROR;
-        QString regexp = getStringValue( vR, parent ); ENSURE_NO_EVAL_ERROR;
-        // TODO: cache QRegExp in case that regexp is a literal string (i.e. it will stay constant)
         bool matches;
-        if ( mOp == boLike || mOp == boILike || mOp == boNotLike || mOp == boNotILike ) // change from LIKE syntax to regexp
+        if ( mRegExp )
+        {
+          // the pattern is a literal and has been compiled in prepare()
+          if ( mOp == boRegexp )
+            matches = mRegExp->indexIn( str ) != -1;
+          else
+            matches = mRegExp->exactMatch( str );
+        }
+        else if ( mOp == boLike || mOp == boILike || mOp == boNotLike || mOp == boNotILike ) // change from LIKE syntax to regexp
         {
-          // XXX escape % and _  ???
-          regexp.replace( "%", ".*" );
-          regexp.replace( "_", "." );
-          matches = QRegExp( regexp, mOp == boLike || mOp == boNotLike ? Qt::CaseSensitive : Qt::CaseInsensitive ).exactMatch( str );
+          QString regexp = getStringValue( vR, parent ); ENSURE_NO_EVAL_ERROR;
+          matches = likeRegExp( regexp ).exactMatch( str );
         }
         else
         {
+          QString regexp = getStringValue( vR, parent ); ENSURE_NO_EVAL_ERROR;
           matches = QRegExp( regexp ).indexIn( str ) != -1;
         }
 
@@ -1882,6 +1971,14 @@ QVariant QgsExpression::NodeBinaryOperator::eval( QgsExpression* parent, QgsFeat
   return QVariant();
 }
 
+QRegExp QgsExpression::NodeBinaryOperator::likeRegExp( QString pattern ) const
+{
+  // XXX escape % and _  ???
+  pattern.replace( "%", ".*" );
+  pattern.replace( "_", "." );
+  return QRegExp( pattern, mOp == boLike || mOp == boNotLike ? Qt::CaseSensitive : Qt::CaseInsensitive );
+}
+
 bool QgsExpression::NodeBinaryOperator::compare( double diff )
 {
   switch ( mOp )
@@ -1933,11 +2030,51 @@ double QgsExpression::NodeBinaryOperator::computeDouble( double x, double y )
 }
 
 
+QgsExpression::NodeBinaryOperator::~NodeBinaryOperator()
+{
+  delete mOpLeft;
+  delete mOpRight;
+  delete mRegExp;
+}
+
 bool QgsExpression::NodeBinaryOperator::prepare( QgsExpression* parent, const QgsFields& fields )
 {
   bool resL = mOpLeft->prepare( parent, fields );
   bool resR = mOpRight->prepare( parent, fields );
-  return resL && resR;
+  if ( !resL || !resR )
+    return false;
+
+  foldConstant( parent, mOpLeft );
+  foldConstant( parent, mOpRight );
+
+  // compile the pattern just once if it does not change between features
+  delete mRegExp;
+  mRegExp = 0;
+  NodeLiteral* pattern = dynamic_cast<NodeLiteral*>( mOpRight );
+  if ( pattern && !pattern->value().isNull() )
+  {
+    switch ( mOp )
+    {
+      case boRegexp:
+        mRegExp = new QRegExp( getStringValue( pattern->value(), parent ) );
+        break;
+      case boLike:
+      case boNotLike:
+      case boILike:
+      case boNotILike:
+        mRegExp = new QRegExp( likeRegExp( getStringValue( pattern->value(), parent ) ) );
+        break;
+      default:
+        break;
+    }
+  }
+
+  return true;
+}
+
+QgsExpression::Node* QgsExpression::NodeBinaryOperator::clone() const
+{
+  return new NodeBinaryOperator( mOp, mOpLeft->clone(), mOpRight->clone() );
 }
 
 QString QgsExpression::NodeBinaryOperator::dump() const
@@ -2121,6 +2258,29 @@ QVariant QgsExpression::NodeInOperator::eval( QgsExpression* parent, QgsFeature*
   if ( isNull( v1 ) )
     return TVL_Unknown;
 
+  if ( mLiteralList )
+  {
+    // same rules as below: numbers are compared as numbers, anything else as strings
+    bool found;
+    if ( isDoubleSafe( v1 ) )
+    {
+      double f1 = getDoubleValue( v1, parent ); ENSURE_NO_EVAL_ERROR;
+      found = qBinaryFind( mNumericItems, f1 ) != mNumericItems.constEnd()
+              || ( !mTextItems.isEmpty() && mTextItems.contains( getStringValue( v1, parent ) ) );
+    }
+    else
+    {
+      found = mAllItems.contains( getStringValue( v1, parent ) );
+    }
+
+    if ( found )
+      return mNotIn ? TVL_False : TVL_True;
+    else if ( mListHasNull )
+      return TVL_Unknown;
+    else
+      return mNotIn ? TVL_True : TVL_False;
+  }
+
   bool listHasNull = false;
 
   foreach ( Node* n, mList->list() )
@@ -2161,11 +2321,48 @@ QVariant QgsExpression::NodeInOperator::eval( QgsExpression* parent, QgsFeature*
 bool QgsExpression::NodeInOperator::prepare( QgsExpression* parent, const QgsFields& fields )
 {
   bool res = mNode->prepare( parent, fields );
+  res = res && mList->prepare( parent, fields );
+  if ( !res )
+    return false;
+
+  foldConstant( parent, mNode );
+
+  // build lookup tables if the list consists of literals only
+  mLiteralList = true;
+  mListHasNull = false;
+  mNumericItems.clear();
+  mTextItems.clear();
+  mAllItems.clear();
   foreach ( Node* n, mList->list() )
   {
-    res = res && n->prepare( parent, fields );
+    NodeLiteral* literal = dynamic_cast<NodeLiteral*>( n );
+    if ( !literal )
+    {
+      mLiteralList = false;
+      break;
+    }
+
+    QVariant v = literal->value();
+    if ( isNull( v ) )
+    {
+      mListHasNull = true;
+      continue;
+    }
+
+    if ( isDoubleSafe( v ) )
+      mNumericItems.append( getDoubleValue( v, parent ) );
+    else
+      mTextItems.insert( getStringValue( v, parent ) );
+    mAllItems.insert( getStringValue( v, parent ) );
   }
-  return res;
+  qSort( mNumericItems );
+
+  return true;
+}
+
+QgsExpression::Node* QgsExpression::NodeInOperator::clone() const
+{
+  return new NodeInOperator( mNode->clone(), mList->clone(), mNotIn );
 }
 
 QString QgsExpression::NodeInOperator::dump() const
@@ -2208,11 +2405,12 @@ QVariant QgsExpression::NodeFunction::eval( QgsExpression* parent, QgsFeature* f
   QVariantList argValues;
   if ( mArgs )
   {
+    bool nullArgIsNull = fd->name() != "coalesce";
     foreach ( Node* n, mArgs->list() )
     {
       QVariant v = n->eval( parent, f );
       ENSURE_NO_EVAL_ERROR;
-      if ( isNull( v ) && fd->name() != "coalesce" )
+      if ( isNull( v ) && nullArgIsNull )
         return QVariant(); // all "normal" functions return NULL, when any parameter is NULL (so coalesce is abnormal)
       argValues.append( v );
     }
@@ -2231,14 +2429,29 @@ bool QgsExpression::NodeFunction::prepare( QgsExpression* parent, const QgsField
   bool res = true;
   if ( mArgs )
   {
-    foreach ( Node* n, mArgs->list() )
-    {
-      res = res && n->prepare( parent, fields );
-    }
+    res = mArgs->prepare( parent, fields );
   }
   return res;
 }
 
+bool QgsExpression::NodeFunction::isStatic() const
+{
+  Function* fd = Functions()[mFnIndex];
+
+  // functions without parameters ($now, $rownum, $scale, ...) and geometry functions
+  // depend on the feature or on the context. Functions registered from plugins may
+  // have side effects.
+  if ( !dynamic_cast<StaticFunction*>( fd ) || fd->params() == 0 || fd->usesgeometry() || fd->name() == "_specialcol_" )
+    return false;
+
+  return !mArgs || mArgs->isStatic();
+}
+
+QgsExpression::Node* QgsExpression::NodeFunction::clone() const
+{
+  return new NodeFunction( mFnIndex, mArgs ? mArgs->clone() : NULL );
+}
+
 QString QgsExpression::NodeFunction::dump() const
 {
   Function* fd = Functions()[mFnIndex];
@@ -2425,6 +2638,11 @@ bool QgsExpression::NodeLiteral::prepare( QgsExpression* /*parent*/, const QgsFi
 }
 
 
+QgsExpression::Node* QgsExpression::NodeLiteral::clone() const
+{
+  return new NodeLiteral( mValue );
+}
+
 QString QgsExpression::NodeLiteral::dump() const
 {
   if ( mValue.isNull() )
@@ -2559,6 +2777,11 @@ bool QgsExpression::NodeColumnRef::prepare( QgsExpression* parent, const QgsFiel
   return false;
 }
 
+QgsExpression::Node* QgsExpression::NodeColumnRef::clone() const
+{
+  return new NodeColumnRef( mName );
+}
+
 QString QgsExpression::NodeColumnRef::dump() const
 {
   return mName;
@@ -2621,14 +2844,30 @@ bool QgsExpression::NodeCondition::prepare( QgsExpression* parent, const QgsFiel
     res = cond->mWhenExp->prepare( parent, fields )
           & cond->mThenExp->prepare( parent, fields );
     if ( !res ) return false;
+
+    foldConstant( parent, cond->mWhenExp );
+    foldConstant( parent, cond->mThenExp );
   }
 
   if ( mElseExp )
-    return mElseExp->prepare( parent, fields );
+  {
+    res = mElseExp->prepare( parent, fields );
+    if ( res )
+      foldConstant( parent, mElseExp );
+    return res;
+  }
 
   return true;
 }
 
+QgsExpression::Node* QgsExpression::NodeCondition::clone() const
+{
+  WhenThenList* conditions = new WhenThenList;
+  foreach ( WhenThen* cond, mConditions )
+    conditions->append( new WhenThen( cond->mWhenExp->clone(), cond->mThenExp->clone() ) );
+  return new NodeCondition( conditions, mElseExp ? mElseExp->clone() : NULL );
+}
+
 QString QgsExpression::NodeCondition::dump() const
 {
   QString msg = "CONDITION:\n";
@@ -2661,6 +2900,21 @@ QStringList QgsExpression::NodeCondition::referencedColumns() const
   return lst;
 }
 
+bool QgsExpression::NodeCondition::isStatic() const
+{
+  foreach ( WhenThen* cond, mConditions )
+  {
+    if ( !cond->mWhenExp->isStatic() ||
+         !cond->mThenExp->isStatic() )
+      return false;
+  }
+
+  if ( mElseExp && !mElseExp->isStatic() )
+    return false;
+
+  return true;
+}
+
 bool QgsExpression::NodeCondition::needsGeometry() const
 {
   foreach ( WhenThen* cond, mConditions )
@@ -20,6 +20,8 @@
 #include <QStringList>
 #include <QVariant>
 #include <QList>
+#include <QSet>
+#include <QVector>
 #include <QDomDocument>
 
 #include "qgsfield.h"
@@ -30,6 +32,7 @@
 class QgsFeature;
 class QgsGeometry;
 class QDomElement;
+class QRegExp;
 
 /**
 Class for parsing and evaluation of expressions (formerly called "search strings").
@@ -68,6 +71,9 @@ There is no special (three-value) 'boolean' type: true/false is represented as
 
 For better performance with many evaluations you may first call prepare(fields) function
 to find out indices of columns and then repeatedly call evaluate(feature).
+Preparation also evaluates the parts of the expression which do not depend on the feature
+(e.g. literals, arithmetics and function calls on literals) and replaces them by their value,
+so that they are not evaluated again for every feature.
 
 Type conversion: operators and functions that expect arguments to be of particular
 type automatically convert the arguments to that type, e.g. sin('2.1') will convert
@@ -87,6 +93,10 @@ class CORE_EXPORT QgsExpression
 {
   public:
     QgsExpression( const QString& expr );
+    //! Creates a copy of the parsed expression without parsing the text again.
+    //! The copy needs to be prepared before evaluation.
+    //! @note added in 2.0
+    QgsExpression( const QgsExpression& other );
     ~QgsExpression();
 
     //! Returns true if an error occurred when parsing the input expression
@@ -94,7 +104,17 @@ class CORE_EXPORT QgsExpression
     //! Returns parser error
     QString parserErrorString() const { return mParserErrorString; }
 
+    //! Returns the expression string the expression was created from
+    //! @note added in 2.0
+    QString expression() const { return mExpression; }
+
+    //! Returns the root node of the parsed expression (NULL if parsing failed)
+    //! @note added in 2.0
+    Node* rootNode() const { return mRootNode; }
+
     //! Get the expression ready for evaluation - find out column indexes.
+    //! Parts which do not depend on the feature are evaluated just once, in a copy
+    //! of the tree, so rootNode(), dump() and toOgcFilter() are not affected.
     bool prepare( const QgsFields& fields );
 
     //! Get list of columns referenced by the expression
@@ -327,6 +347,14 @@ class CORE_EXPORT QgsExpression
         virtual QStringList referencedColumns() const = 0;
         virtual bool needsGeometry() const = 0;
 
+        // returns true if the node has the same value for all features
+        // (such nodes are replaced by their value when the expression is prepared)
+        virtual bool isStatic() const { return false; }
+
+        // returns a deep copy of the node, without the state built by prepare()
+        // @note added in 2.0
+        virtual Node* clone() const = 0;
+
         // support for visitor pattern
         virtual void accept( Visitor& v ) = 0;
     };
@@ -340,6 +368,13 @@ class CORE_EXPORT QgsExpression
         int count() { return mList.count(); }
         QList<Node*> list() { return mList; }
 
+        //! returns a deep copy of the list
+        NodeList* clone() const;
+
+        // prepares all the nodes of the list and replaces static nodes by their value
+        bool prepare( QgsExpression* parent, const QgsFields& fields );
+        bool isStatic() const;
+
         virtual QString dump() const;
         virtual void toOgcFilter( QDomDocument &doc, QDomElement &element ) const;
 
@@ -395,6 +430,8 @@ class CORE_EXPORT QgsExpression
 
         virtual QStringList referencedColumns() const { return mOperand->referencedColumns(); }
         virtual bool needsGeometry() const { return mOperand->needsGeometry(); }
+        virtual bool isStatic() const { return mOperand->isStatic(); }
+        virtual Node* clone() const;
         virtual void accept( Visitor& v ) { v.visit( this ); }
 
       protected:
@@ -405,8 +442,8 @@ class CORE_EXPORT QgsExpression
     class CORE_EXPORT NodeBinaryOperator : public Node
     {
       public:
-        NodeBinaryOperator( BinaryOperator op, Node* opLeft, Node* opRight ) : mOp( op ), mOpLeft( opLeft ), mOpRight( opRight ) {}
-        ~NodeBinaryOperator() { delete mOpLeft; delete mOpRight; }
+        NodeBinaryOperator( BinaryOperator op, Node* opLeft, Node* opRight ) : mOp( op ), mOpLeft( opLeft ), mOpRight( opRight ), mRegExp( 0 ) {}
+        ~NodeBinaryOperator();
 
         BinaryOperator op() { return mOp; }
         Node* opLeft() { return mOpLeft; }
@@ -421,6 +458,8 @@ class CORE_EXPORT QgsExpression
 
         virtual QStringList referencedColumns() const { return mOpLeft->referencedColumns() + mOpRight->referencedColumns(); }
         virtual bool needsGeometry() const { return mOpLeft->needsGeometry() || mOpRight->needsGeometry(); }
+        virtual bool isStatic() const { return mOpLeft->isStatic() && mOpRight->isStatic(); }
+        virtual Node* clone() const;
         virtual void accept( Visitor& v ) { v.visit( this ); }
 
       protected:
@@ -428,16 +467,21 @@ class CORE_EXPORT QgsExpression
         int computeInt( int x, int y );
         double computeDouble( double x, double y );
         QDateTime computeDateTimeFromInterval( QDateTime d, QgsExpression::Interval *i );
+        //! converts a LIKE pattern to a regular expression
+        QRegExp likeRegExp( QString pattern ) const;
 
         BinaryOperator mOp;
         Node* mOpLeft;
         Node* mOpRight;
+
+        //! pattern of LIKE / ~ operators compiled in prepare() if it is a literal
+        QRegExp* mRegExp;
     };
 
     class CORE_EXPORT NodeInOperator : public Node
     {
       public:
-        NodeInOperator( Node* node, NodeList* list, bool notin = false ) : mNode( node ), mList( list ), mNotIn( notin ) {}
+        NodeInOperator( Node* node, NodeList* list, bool notin = false ) : mNode( node ), mList( list ), mNotIn( notin ), mLiteralList( false ), mListHasNull( false ) {}
         virtual ~NodeInOperator() { delete mNode; delete mList; }
 
         Node* node() { return mNode; }
@@ -452,12 +496,24 @@ class CORE_EXPORT QgsExpression
 
         virtual QStringList referencedColumns() const { QStringList lst( mNode->referencedColumns() ); foreach ( Node* n, mList->list() ) lst.append( n->referencedColumns() ); return lst; }
         virtual bool needsGeometry() const { bool needs = false; foreach ( Node* n, mList->list() ) needs |= n->needsGeometry(); return needs; }
+        virtual bool isStatic() const { return mNode->isStatic() && mList->isStatic(); }
+        virtual Node* clone() const;
         virtual void accept( Visitor& v ) { v.visit( this ); }
 
       protected:
         Node* mNode;
         NodeList* mList;
         bool mNotIn;
+
+        // lookup tables built in prepare() if all the list items are literals
+        bool mLiteralList;
+        bool mListHasNull;
+        //! sorted values of the numeric items
+        QVector<double> mNumericItems;
+        //! items which are not numbers
+        QSet<QString> mTextItems;
+        //! all the items (except of NULL) as strings
+        QSet<QString> mAllItems;
     };
 
     class CORE_EXPORT NodeFunction : public Node
@@ -479,6 +535,8 @@ class CORE_EXPORT QgsExpression
 
         virtual QStringList referencedColumns() const { QStringList lst; if ( !mArgs ) return lst; foreach ( Node* n, mArgs->list() ) lst.append( n->referencedColumns() ); return lst; }
         virtual bool needsGeometry() const { bool needs = Functions()[mFnIndex]->usesgeometry(); if ( mArgs ) { foreach ( Node* n, mArgs->list() ) needs |= n->needsGeometry(); } return needs; }
+        virtual bool isStatic() const;
+        virtual Node* clone() const;
         virtual void accept( Visitor& v ) { v.visit( this ); }
 
       protected:
@@ -503,6 +561,8 @@ class CORE_EXPORT QgsExpression
 
         virtual QStringList referencedColumns() const { return QStringList(); }
         virtual bool needsGeometry() const { return false; }
+        virtual bool isStatic() const { return true; }
+        virtual Node* clone() const;
         virtual void accept( Visitor& v ) { v.visit( this ); }
 
       protected:
@@ -525,6 +585,7 @@ class CORE_EXPORT QgsExpression
 
         virtual QStringList referencedColumns() const { return QStringList( mName ); }
         virtual bool needsGeometry() const { return false; }
+        virtual Node* clone() const;
         virtual void accept( Visitor& v ) { v.visit( this ); }
 
       protected:
@@ -558,6 +619,8 @@ class CORE_EXPORT QgsExpression
 
         virtual QStringList referencedColumns() const;
         virtual bool needsGeometry() const;
+        virtual bool isStatic() const;
+        virtual Node* clone() const;
         virtual void accept( Visitor& v ) { v.visit( this ); }
 
       protected:
@@ -591,12 +654,14 @@ class CORE_EXPORT QgsExpression
 
   protected:
     // internally used to create an empty expression
-    QgsExpression() : mRootNode( NULL ), mRowNumber( 0 ) {}
+    QgsExpression() : mRootNode( NULL ), mEvalNode( NULL ), mRowNumber( 0 ) {}
 
     void initGeomCalculator();
 
     QString mExpression;
     Node* mRootNode;
+    //! copy of the tree with the constant parts folded, built by prepare()
+    Node* mEvalNode;
 
     QString mParserErrorString;
     QString mEvalErrorString;
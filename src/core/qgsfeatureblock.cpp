@@ -0,0 +1,244 @@
+/***************************************************************************
+    qgsfeatureblock.cpp
+    ---------------------
+    begin                : November 2012
+    copyright            : (C) 2012 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsfeatureblock.h"
+
+#include "qgsfield.h"
+#include "qgsgeometry.h"
+
+#include <cstring>
+
+QgsFeatureBlock::QgsFeatureBlock()
+    : mHasGeometry( false )
+{
+}
+
+void QgsFeatureBlock::setColumns( const QgsFields& fields, const QgsAttributeList& attributes, bool hasGeometry )
+{
+  mColumns.clear();
+  mHasGeometry = hasGeometry;
+
+  foreach ( int attrIndex, attributes )
+  {
+    if ( attrIndex < 0 || attrIndex >= fields.count() )
+      continue;
+
+    Column c;
+    c.attrIndex = attrIndex;
+    c.fieldType = fields[attrIndex].type();
+    switch ( c.fieldType )
+    {
+      case QVariant::Int:
+      case QVariant::UInt:
+      case QVariant::LongLong:
+        c.type = IntColumn;
+        break;
+      case QVariant::Double:
+        c.type = DoubleColumn;
+        break;
+      case QVariant::String:
+        c.type = StringColumn;
+        break;
+      default:
+        c.type = VariantColumn;
+        break;
+    }
+    mColumns.append( c );
+  }
+
+  clear();
+}
+
+void QgsFeatureBlock::clear()
+{
+  // resize() keeps the memory of vectors with reserved capacity
+  for ( int i = 0; i < mColumns.count(); ++i )
+  {
+    Column& c = mColumns[i];
+    c.nulls.resize( 0 );
+    c.ints.resize( 0 );
+    c.doubles.resize( 0 );
+    c.strings.resize( 0 );
+    c.variants.resize( 0 );
+  }
+  mIds.resize( 0 );
+  mWkb.resize( 0 );
+  mWkbOffsets.resize( 0 );
+  mWkbSizes.resize( 0 );
+}
+
+void QgsFeatureBlock::reserve( int count )
+{
+  for ( int i = 0; i < mColumns.count(); ++i )
+  {
+    Column& c = mColumns[i];
+    c.nulls.reserve( count );
+    switch ( c.type )
+    {
+      case IntColumn: c.ints.reserve( count ); break;
+      case DoubleColumn: c.doubles.reserve( count ); break;
+      case StringColumn: c.strings.reserve( count ); break;
+      case VariantColumn: c.variants.reserve( count ); break;
+    }
+  }
+  mIds.reserve( count );
+  if ( mHasGeometry )
+  {
+    mWkbOffsets.reserve( count );
+    mWkbSizes.reserve( count );
+  }
+}
+
+int QgsFeatureBlock::columnForAttribute( int attrIndex ) const
+{
+  for ( int i = 0; i < mColumns.count(); ++i )
+  {
+    if ( mColumns[i].attrIndex == attrIndex )
+      return i;
+  }
+  return -1;
+}
+
+QVariant QgsFeatureBlock::value( int column, int row ) const
+{
+  const Column& c = mColumns[column];
+  if ( c.nulls[row] )
+    return QVariant( c.fieldType );
+
+  switch ( c.type )
+  {
+    case IntColumn:
+      if ( c.fieldType == QVariant::LongLong )
+        return QVariant( c.ints[row] );
+      else if ( c.fieldType == QVariant::UInt )
+        return QVariant(( uint ) c.ints[row] );
+      else
+        return QVariant(( int ) c.ints[row] );
+    case DoubleColumn:
+      return QVariant( c.doubles[row] );
+    case StringColumn:
+      return QVariant( c.strings[row] );
+    case VariantColumn:
+      return c.variants[row];
+  }
+  return QVariant();
+}
+
+void QgsFeatureBlock::setValue( int column, int row, const QVariant& value )
+{
+  Column& c = mColumns[column];
+  c.nulls[row] = value.isNull();
+  if ( c.nulls[row] )
+    return;
+
+  switch ( c.type )
+  {
+    case IntColumn: c.ints[row] = value.toLongLong(); break;
+    case DoubleColumn: c.doubles[row] = value.toDouble(); break;
+    case StringColumn: c.strings[row] = value.toString(); break;
+    case VariantColumn: c.variants[row] = value; break;
+  }
+}
+
+const unsigned char* QgsFeatureBlock::wkb( int row ) const
+{
+  if ( !mHasGeometry || mWkbSizes[row] == 0 )
+    return 0;
+  return reinterpret_cast<const unsigned char*>( mWkb.constData() ) + mWkbOffsets[row];
+}
+
+int QgsFeatureBlock::addRow( QgsFeatureId id )
+{
+  int row = mIds.count();
+  mIds.append( id );
+
+  for ( int i = 0; i < mColumns.count(); ++i )
+  {
+    Column& c = mColumns[i];
+    c.nulls.append( true );
+    switch ( c.type )
+    {
+      case IntColumn: c.ints.append( 0 ); break;
+      case DoubleColumn: c.doubles.append( 0 ); break;
+      case StringColumn: c.strings.append( QString() ); break;
+      case VariantColumn: c.variants.append( QVariant() ); break;
+    }
+  }
+
+  if ( mHasGeometry )
+  {
+    mWkbOffsets.append( mWkb.size() );
+    mWkbSizes.append( 0 );
+  }
+  return row;
+}
+
+unsigned char* QgsFeatureBlock::allocateWkb( int row, int size )
+{
+  Q_ASSERT( mHasGeometry && row == mIds.count() - 1 );
+
+  int offset = mWkb.size();
+  mWkb.resize( offset + size );
+  mWkbOffsets[row] = offset;
+  mWkbSizes[row] = size;
+  return reinterpret_cast<unsigned char*>( mWkb.data() ) + offset;
+}
+
+void QgsFeatureBlock::addFeature( const QgsFeature& f )
+{
+  int row = addRow( f.id() );
+
+  const QgsAttributes& attrs = f.attributes();
+  for ( int i = 0; i < mColumns.count(); ++i )
+  {
+    int attrIndex = mColumns[i].attrIndex;
+    if ( attrIndex < attrs.count() )
+      setValue( i, row, attrs[attrIndex] );
+  }
+
+  QgsGeometry* geom = f.geometry();
+  if ( mHasGeometry && geom )
+  {
+    int size = geom->wkbSize();
+    if ( size > 0 )
+      memcpy( allocateWkb( row, size ), geom->asWkb(), size );
+  }
+}
+
+void QgsFeatureBlock::feature( int row, QgsFeature& f ) const
+{
+  f.setFeatureId( mIds[row] );
+
+  int attrCount = 0;
+  for ( int i = 0; i < mColumns.count(); ++i )
+    attrCount = qMax( attrCount, mColumns[i].attrIndex + 1 );
+  if ( f.attributes().count() < attrCount )
+    f.initAttributes( attrCount );
+
+  for ( int i = 0; i < mColumns.count(); ++i )
+    f.setAttribute( mColumns[i].attrIndex, value( i, row ) );
+
+  const unsigned char* data = wkb( row );
+  if ( data )
+  {
+    int size = mWkbSizes[row];
+    unsigned char* copy = new unsigned char[size];
+    memcpy( copy, data, size );
+    f.setGeometryAndOwnership( copy, size );
+  }
+  else
+  {
+    f.setGeometry( 0 );
+  }
+  f.setValid( true );
+}
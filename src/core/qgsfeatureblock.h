@@ -0,0 +1,127 @@
+/***************************************************************************
+    qgsfeatureblock.h
+    ---------------------
+    begin                : November 2012
+    copyright            : (C) 2012 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSFEATUREBLOCK_H
+#define QGSFEATUREBLOCK_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+#include "qgsfeature.h"
+
+class QgsFields;
+typedef QList<int> QgsAttributeList;
+
+/** \ingroup core
+ * Block of features stored by columns: each attribute has an array of values
+ * of a primitive type (for numeric and string fields) and geometries are stored
+ * in one buffer of WKB data. The block is filled by QgsFeatureIterator::nextFeatureBlock()
+ * and can be reused for subsequent blocks without new allocations.
+ *
+ * NULL values are stored as zeros (numeric columns) or null strings, isNull() tells them apart.
+ *
+ * @note added in 2.0
+ * @note not available in python bindings
+ */
+class CORE_EXPORT QgsFeatureBlock
+{
+  public:
+    enum ColumnType
+    {
+      IntColumn,     //!< integer fields - intValues()
+      DoubleColumn,  //!< double fields - doubleValues()
+      StringColumn,  //!< string fields - stringValues()
+      VariantColumn  //!< other fields - value()
+    };
+
+    QgsFeatureBlock();
+
+    //! Set up columns for the attributes (indexes to fields) and remove all features
+    void setColumns( const QgsFields& fields, const QgsAttributeList& attributes, bool hasGeometry = true );
+
+    //! Remove all features, keep the columns
+    void clear();
+    //! Reserve memory for the number of features. Reserved memory is kept by clear().
+    void reserve( int count );
+
+    //! number of features in the block
+    int count() const { return mIds.count(); }
+    //! whether geometries are stored in the block
+    bool hasGeometry() const { return mHasGeometry; }
+
+    int columnCount() const { return mColumns.count(); }
+    //! index of the attribute stored in the column
+    int attributeIndex( int column ) const { return mColumns[column].attrIndex; }
+    //! column with the attribute or -1 if the attribute is not in the block
+    int columnForAttribute( int attrIndex ) const;
+    ColumnType columnType( int column ) const { return mColumns[column].type; }
+
+    QgsFeatureId id( int row ) const { return mIds[row]; }
+    bool isNull( int column, int row ) const { return mColumns[column].nulls[row]; }
+
+    //! values of an IntColumn (one for each feature)
+    const qlonglong* intValues( int column ) const { return mColumns[column].ints.constData(); }
+    //! values of a DoubleColumn (one for each feature)
+    const double* doubleValues( int column ) const { return mColumns[column].doubles.constData(); }
+    //! values of a StringColumn (one for each feature)
+    const QString* stringValues( int column ) const { return mColumns[column].strings.constData(); }
+    //! value of any column converted to the type of the field
+    QVariant value( int column, int row ) const;
+
+    //! WKB of feature's geometry (NULL if the feature has no geometry)
+    const unsigned char* wkb( int row ) const;
+    int wkbSize( int row ) const { return mWkbSizes[row]; }
+
+    //! Append a feature: attributes of the columns and geometry are copied
+    void addFeature( const QgsFeature& f );
+    //! Set id, attributes and geometry of the feature from a row
+    void feature( int row, QgsFeature& f ) const;
+
+    // functions for data providers filling the block directly
+
+    //! Append a feature with NULL values and without geometry, returns its row
+    int addRow( QgsFeatureId id );
+    void setInt( int column, int row, qlonglong value ) { Column& c = mColumns[column]; c.ints[row] = value; c.nulls[row] = false; }
+    void setDouble( int column, int row, double value ) { Column& c = mColumns[column]; c.doubles[row] = value; c.nulls[row] = false; }
+    void setString( int column, int row, const QString& value ) { Column& c = mColumns[column]; c.strings[row] = value; c.nulls[row] = false; }
+    //! Set value of any column (converted to the column type)
+    void setValue( int column, int row, const QVariant& value );
+    //! Reserve space for geometry of the row and return pointer where the WKB has to be written
+    unsigned char* allocateWkb( int row, int size );
+
+  private:
+    struct Column
+    {
+      int attrIndex;
+      QVariant::Type fieldType;
+      ColumnType type;
+      QVector<bool> nulls;
+      QVector<qlonglong> ints;
+      QVector<double> doubles;
+      QVector<QString> strings;
+      QVector<QVariant> variants;
+    };
+
+    QVector<Column> mColumns;
+    bool mHasGeometry;
+
+    QVector<QgsFeatureId> mIds;
+    //! WKB of all geometries
+    QByteArray mWkb;
+    QVector<int> mWkbOffsets;
+    QVector<int> mWkbSizes;
+};
+
+#endif // QGSFEATUREBLOCK_H
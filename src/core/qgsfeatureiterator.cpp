@@ -14,6 +14,8 @@
  ***************************************************************************/
 #include "qgsfeatureiterator.h"
 
+#include "qgsfeatureblock.h"
+
 
 QgsAbstractFeatureIterator::QgsAbstractFeatureIterator( const QgsFeatureRequest& request )
     : mRequest( request ),
@@ -26,6 +28,18 @@ QgsAbstractFeatureIterator::~QgsAbstractFeatureIterator()
 {
 }
 
+int QgsAbstractFeatureIterator::nextFeatureBlock( QgsFeatureBlock& block, int maxFeatures )
+{
+  block.clear();
+  block.reserve( maxFeatures );
+
+  QgsFeature f;
+  while ( block.count() < maxFeatures && nextFeature( f ) )
+    block.addFeature( f );
+
+  return block.count();
+}
+
 void QgsAbstractFeatureIterator::ref()
 {
   refs++;
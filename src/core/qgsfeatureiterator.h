@@ -17,6 +17,7 @@
 
 #include "qgsfeaturerequest.h"
 
+class QgsFeatureBlock;
 
 /** \ingroup core
  * Internal feature iterator to be implemented within data providers
@@ -37,6 +38,12 @@ class CORE_EXPORT QgsAbstractFeatureIterator
     //! end of iterating: free the resources / lock
     virtual bool close() = 0;
 
+    //! fetch up to maxFeatures features into a block with columns set up by the caller,
+    //! return number of fetched features (0 at the end of iteration).
+    //! Default implementation uses nextFeature(), providers may fill the block directly.
+    //! @note added in 2.0
+    virtual int nextFeatureBlock( QgsFeatureBlock& block, int maxFeatures );
+
   protected:
     QgsFeatureRequest mRequest;
 
@@ -72,6 +79,11 @@ class CORE_EXPORT QgsFeatureIterator
     bool rewind();
     bool close();
 
+    //! fetch up to maxFeatures features into a block, return number of fetched features
+    //! @note added in 2.0
+    //! @note not available in python bindings
+    int nextFeatureBlock( QgsFeatureBlock& block, int maxFeatures );
+
     //! find out whether the iterator is still valid or closed already
     bool isClosed();
 
@@ -114,6 +126,11 @@ inline bool QgsFeatureIterator::nextFeature( QgsFeature& f )
   return mIter ? mIter->nextFeature( f ) : false;
 }
 
+inline int QgsFeatureIterator::nextFeatureBlock( QgsFeatureBlock& block, int maxFeatures )
+{
+  return mIter ? mIter->nextFeatureBlock( block, maxFeatures ) : 0;
+}
+
 inline bool QgsFeatureIterator::rewind()
 {
   return mIter ? mIter->rewind() : false;
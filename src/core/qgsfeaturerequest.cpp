@@ -15,15 +15,65 @@
 #include "qgsfeaturerequest.h"
 
 #include "qgsfield.h"
+#include "qgsexpression.h"
 
 #include <QStringList>
 
 QgsFeatureRequest::QgsFeatureRequest()
     : mFilter( FilterNone )
+    , mFilterExpression( 0 )
     , mFlags( 0 )
+    , mGeometryResolution( 0 )
 {
 }
 
+QgsFeatureRequest::QgsFeatureRequest( const QgsFeatureRequest& rh )
+    : mFilterExpression( 0 )
+{
+  operator=( rh );
+}
+
+QgsFeatureRequest& QgsFeatureRequest::operator=( const QgsFeatureRequest& rh )
+{
+  if ( &rh == this )
+    return *this;
+
+  mFilter = rh.mFilter;
+  mFilterRect = rh.mFilterRect;
+  mFilterFid = rh.mFilterFid;
+  mFlags = rh.mFlags;
+  mAttrs = rh.mAttrs;
+  mGeometryResolution = rh.mGeometryResolution;
+
+  // every request has its own expression - it keeps state when prepared and evaluated,
+  // the parsed tree is copied rather than parsed again
+  delete mFilterExpression;
+  mFilterExpression = rh.mFilterExpression ? new QgsExpression( *rh.mFilterExpression ) : 0;
+
+  return *this;
+}
+
+QgsFeatureRequest::~QgsFeatureRequest()
+{
+  delete mFilterExpression;
+}
+
+QgsFeatureRequest& QgsFeatureRequest::setFilterExpression( const QString& expression )
+{
+  delete mFilterExpression;
+  mFilterExpression = 0;
+
+  if ( expression.isEmpty() )
+  {
+    mFilter = FilterNone;
+    return *this;
+  }
+
+  mFilter = FilterExpression;
+  mFilterExpression = new QgsExpression( expression );
+  return *this;
+}
+
 
 QgsFeatureRequest& QgsFeatureRequest::setSubsetOfAttributes( const QStringList& attrNames, const QgsFields& fields )
 {
@@ -23,6 +23,8 @@
 #include <QList>
 typedef QList<int> QgsAttributeList;
 
+class QgsExpression;
+
 /**
  * This class wraps a request for features to a vector layer (or directly its vector data provider).
  * The request may apply a filter to fetch only a particular subset of features. Currently supported filters:
@@ -31,6 +33,10 @@ typedef QList<int> QgsAttributeList;
  * - rectangle - only features that intersect given rectangle should be fetched. For the sake of speed,
  *               the intersection is often done only using feature's bounding box. There is a flag
  *               ExactIntersect that makes sure that only intersecting features will be returned.
+ * - expression - only features for which the expression is true are returned. Database providers
+ *               translate the expression to SQL where possible, so that the other features are not
+ *               fetched at all. Data providers may still return features that do not match
+ *               the expression - vector layer's iterator evaluates it for every feature.
  *
  * For efficiency, it is also possible to tell provider that some data is not required:
  * - NoGeometry flag
@@ -50,6 +56,8 @@ typedef QList<int> QgsAttributeList;
  *     QgsFeatureRequest().setFilterRect(QgsRectangle(0,0,1,1))
  * - fetch only one feature
  *     QgsFeatureRequest().setFilterFid(45)
+ * - fetch only features matching an expression
+ *     QgsFeatureRequest().setFilterExpression("\"population\" > 10000")
  *
  */
 class CORE_EXPORT QgsFeatureRequest
@@ -68,11 +76,16 @@ class CORE_EXPORT QgsFeatureRequest
     {
       FilterNone,   //!< No filter is applied
       FilterRect,   //!< Filter using a rectangle
-      FilterFid     //!< Filter using feature ID
+      FilterFid,    //!< Filter using feature ID
+      FilterExpression //!< Filter using expression
     };
 
     //! construct a default request: for all features get attributes and geometries
     QgsFeatureRequest();
+    //! copy constructor
+    QgsFeatureRequest( const QgsFeatureRequest& rh );
+    QgsFeatureRequest& operator=( const QgsFeatureRequest& rh );
+    ~QgsFeatureRequest();
 
     FilterType filterType() const { return mFilter; }
 
@@ -85,6 +98,13 @@ class CORE_EXPORT QgsFeatureRequest
     QgsFeatureRequest& setFilterFid( QgsFeatureId fid ) { mFilter = FilterFid; mFilterFid = fid; return *this; }
     const QgsFeatureId& filterFid() const { return mFilterFid; }
 
+    //! Set expression which features have to satisfy. Empty expression removes the filter.
+    //! @note added in 2.0
+    QgsFeatureRequest& setFilterExpression( const QString& expression );
+    //! Returns the filter expression (NULL if the request is not filtered by expression)
+    //! @note added in 2.0
+    QgsExpression* filterExpression() const { return mFilterExpression; }
+
     //! Set flags that affect how features will be fetched
     QgsFeatureRequest& setFlags( Flags flags ) { mFlags = flags; return *this; }
     const Flags& flags() const { return mFlags; }
@@ -97,8 +117,14 @@ class CORE_EXPORT QgsFeatureRequest
     //! Set a subset of attributes by names that will be fetched
     QgsFeatureRequest& setSubsetOfAttributes( const QStringList& attrNames, const QgsFields& fields );
 
+    //! Set resolution (in layer units per pixel) the geometries are going to be used at.
+    //! Providers may return geometries simplified to the resolution, e.g. for rendering.
+    //! Zero (the default) means full resolution.
+    //! @note added in 2.0
+    QgsFeatureRequest& setGeometryResolution( double mapUnitsPerPixel ) { mGeometryResolution = mapUnitsPerPixel; return *this; }
+    double geometryResolution() const { return mGeometryResolution; }
+
     // TODO: in future
-    // void setFilterExpression(const QString& expression); // using QgsExpression
     // void setFilterNativeExpression(con QString& expr);   // using provider's SQL (if supported)
     // void setLimit(int limit);
 
@@ -106,8 +132,10 @@ class CORE_EXPORT QgsFeatureRequest
     FilterType mFilter;
     QgsRectangle mFilterRect;
     QgsFeatureId mFilterFid;
+    QgsExpression* mFilterExpression;
     Flags mFlags;
     QgsAttributeList mAttrs;
+    double mGeometryResolution;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS( QgsFeatureRequest::Flags )
@@ -31,6 +31,7 @@ email                : morb at ozemail dot com dot au
 #include "qgsproject.h"
 #include "qgsmessagelog.h"
 #include "qgsgeometryvalidator.h"
+#include "qgscsexception.h"
 
 #ifndef Q_WS_WIN
 #include <netinet/in.h>
@@ -3797,10 +3798,7 @@ int QgsGeometry::transform( const QgsCoordinateTransform& ct )
     {
       int* npoints = ( int* )( &mGeometry[wkbPosition] );
       wkbPosition += sizeof( int );
-      for ( int index = 0; index < *npoints; ++index )
-      {
-        transformVertex( wkbPosition, ct, hasZValue );
-      }
+      transformVertices( wkbPosition, *npoints, ct, hasZValue );
       break;
     }
 
@@ -3816,10 +3814,7 @@ int QgsGeometry::transform( const QgsCoordinateTransform& ct )
       {
         npoints = ( int* )( &( mGeometry[wkbPosition] ) );
         wkbPosition += sizeof( int );
-        for ( int index2 = 0; index2 < *npoints; ++index2 )
-        {
-          transformVertex( wkbPosition, ct, hasZValue );
-        }
+        transformVertices( wkbPosition, *npoints, ct, hasZValue );
       }
       break;
     }
@@ -3850,10 +3845,7 @@ int QgsGeometry::transform( const QgsCoordinateTransform& ct )
         wkbPosition += ( sizeof( int ) + 1 );
         npoints = ( int* )( &( mGeometry[wkbPosition] ) );
         wkbPosition += sizeof( int );
-        for ( int index2 = 0; index2 < *npoints; ++index2 )
-        {
-          transformVertex( wkbPosition, ct, hasZValue );
-        }
+        transformVertices( wkbPosition, *npoints, ct, hasZValue );
       }
       break;
     }
@@ -3875,10 +3867,7 @@ int QgsGeometry::transform( const QgsCoordinateTransform& ct )
         {
           npoints = ( int* )( &( mGeometry[wkbPosition] ) );
           wkbPosition += sizeof( int );
-          for ( int index3 = 0; index3 < *npoints; ++index3 )
-          {
-            transformVertex( wkbPosition, ct, hasZValue );
-          }
+          transformVertices( wkbPosition, *npoints, ct, hasZValue );
         }
       }
     }
@@ -6202,6 +6191,48 @@ void QgsGeometry::transformVertex( int& wkbPosition, const QgsCoordinateTransfor
   }
 }
 
+void QgsGeometry::transformVertices( int& wkbPosition, int numPoints, const QgsCoordinateTransform& ct, bool hasZValue )
+{
+  if ( numPoints <= 0 )
+    return;
+
+  // the vertices of a sequence are stored as consecutive x/y(/z) doubles,
+  // so they can be transformed with a single call
+  int pointOffset = hasZValue ? 3 : 2;
+  size_t size = numPoints * pointOffset * sizeof( double );
+  unsigned char* ptr = mGeometry + wkbPosition;
+
+  if ( reinterpret_cast<size_t>( ptr ) % sizeof( double ) == 0 )
+  {
+    double* x = reinterpret_cast<double*>( ptr );
+    ct.transformInPlace( x, x + 1, 0, numPoints, pointOffset );
+  }
+  else
+  {
+    // WKB doubles follow the byte order and type headers and are usually not aligned,
+    // copy them to an aligned buffer for proj
+    QVector<double> coords( numPoints * pointOffset );
+    memcpy( coords.data(), ptr, size );
+    ct.transformInPlace( coords.data(), coords.data() + 1, 0, numPoints, pointOffset );
+    memcpy( ptr, coords.constData(), size );
+  }
+
+  // with more than one point proj does not fail on points it cannot transform,
+  // but sets them to HUGE_VAL
+  for ( int i = 0; i < numPoints; i++ )
+  {
+    double x, y;
+    memcpy( &x, ptr + i * pointOffset * sizeof( double ), sizeof( double ) );
+    memcpy( &y, ptr + ( i * pointOffset + 1 ) * sizeof( double ), sizeof( double ) );
+    if ( !qIsFinite( x ) || !qIsFinite( y ) )
+    {
+      throw QgsCsException( QObject::tr( "Some vertices could not be transformed" ) );
+    }
+  }
+
+  wkbPosition += size;
+}
+
 int QgsGeometry::splitLinearGeometry( GEOSGeometry *splitLine, QList<QgsGeometry*>& newGeometries )
 {
   if ( !splitLine )
@@ -558,6 +558,13 @@ class CORE_EXPORT QgsGeometry
     @param hasZValue 25D type?*/
     void transformVertex( int& wkbPosition, const QgsCoordinateTransform& ct, bool hasZValue );
 
+    /**Transforms a sequence of vertices (e.g. a line string or a ring) by ct with a single call.
+    @param wkbPosition position of the first vertex in wkb array. Is increased automatically by the function
+    @param numPoints number of vertices in the sequence
+    @param ct the QgsCoordinateTransform
+    @param hasZValue 25D type?*/
+    void transformVertices( int& wkbPosition, int numPoints, const QgsCoordinateTransform& ct, bool hasZValue );
+
     //helper functions for geometry splitting
 
     /**Splits line/multiline geometries
@@ -18,13 +18,18 @@
 #include "qgsgeometry.h"
 #include "qgslogger.h"
 #include "qgsnetworkaccessmanager.h"
+#include <QAbstractNetworkCache>
 #include <QBuffer>
+#include <QDateTime>
+#include <QEventLoop>
 #include <QList>
+#include <QNetworkCacheMetaData>
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QProgressDialog>
 #include <QSet>
 #include <QSettings>
+#include <QTimer>
 #include <QUrl>
 
 #include <limits>
@@ -38,6 +43,11 @@ QgsGml::QgsGml(
   const QgsFields & fields )
     : QObject()
     , mTypeName( typeName )
+    , mParser( 0 )
+    , mReply( 0 )
+    , mError( false )
+    , mEpsg( 0 )
+    , mCacheLoadControl( QNetworkRequest::PreferNetwork )
     , mGeometryAttribute( geometryAttribute )
     , mFinished( false )
     , mFeatureCount( 0 )
@@ -54,26 +64,20 @@ QgsGml::QgsGml(
 
 QgsGml::~QgsGml()
 {
+  if ( mReply )
+  {
+    mReply->abort();
+    delete mReply;
+  }
+  if ( mParser )
+  {
+    XML_ParserFree( mParser );
+  }
 }
 
 int QgsGml::getFeatures( const QString& uri, QGis::WkbType* wkbType, QgsRectangle* extent )
 {
-  mUri = uri;
-  mWkbType = wkbType;
-
-  XML_Parser p = XML_ParserCreateNS( NULL, NS_SEPARATOR );
-  XML_SetUserData( p, this );
-  XML_SetElementHandler( p, QgsGml::start, QgsGml::end );
-  XML_SetCharacterDataHandler( p, QgsGml::chars );
-
-  //start with empty extent
-  mExtent.setMinimal();
-
-  QNetworkRequest request( mUri );
-  QNetworkReply* reply = QgsNetworkAccessManager::instance()->get( request );
-
-  connect( reply, SIGNAL( finished() ), this, SLOT( setFinished() ) );
-  connect( reply, SIGNAL( downloadProgress( qint64, qint64 ) ), this, SLOT( handleProgressEvent( qint64, qint64 ) ) );
+  startGetFeatures( uri );
 
   //find out if there is a QGIS main window. If yes, display a progress dialog
   QProgressDialog* progressDialog = 0;
@@ -88,58 +92,196 @@ int QgsGml::getFeatures( const QString& uri, QGis::WkbType* wkbType, QgsRectangl
     progressDialog->show();
   }
 
-  int atEnd = 0;
-  while ( !atEnd )
+  //the features of each chunk are available (featuresParsed) while the rest is downloading
+  do
   {
-    if ( mFinished )
-    {
-      atEnd = 1;
-    }
-    QByteArray readData = reply->readAll();
-    if ( readData.size() > 0 )
-    {
-      XML_Parse( p, readData.constData(), readData.size(), atEnd );
-    }
     QCoreApplication::processEvents();
   }
+  while ( readData( wkbType, extent, 100 ) );
 
-  delete reply;
   delete progressDialog;
 
-  if ( *mWkbType != QGis::WKBNoGeometry )
+  return mError ? 1 : 0;
+}
+
+void QgsGml::startGetFeatures( const QString& uri )
+{
+  mUri = uri;
+  mFinished = false;
+  mError = false;
+
+  QNetworkRequest request( mUri );
+  if ( mCacheLoadControl != QNetworkRequest::PreferNetwork )
   {
-    if ( mExtent.isEmpty() )
+    QNetworkRequest::CacheLoadControl loadControl = mCacheLoadControl;
+
+    //PreferCache would use the entry forever, once it is expired it is requested again
+    QAbstractNetworkCache *cache = QgsNetworkAccessManager::instance()->cache();
+    if ( cache && loadControl == QNetworkRequest::PreferCache )
     {
-      //reading of bbox from the server failed, so we calculate it less efficiently by evaluating the features
-      calculateExtentFromFeatures();
+      QNetworkCacheMetaData cmd = cache->metaData( request.url() );
+      if ( cmd.isValid() && cmd.expirationDate().isValid() && cmd.expirationDate() < QDateTime::currentDateTime() )
+      {
+        QgsDebugMsg( QString( "cached response expired %1" ).arg( cmd.expirationDate().toString() ) );
+        loadControl = QNetworkRequest::PreferNetwork;
+      }
     }
+
+    request.setAttribute( QNetworkRequest::CacheLoadControlAttribute, loadControl );
+    request.setAttribute( QNetworkRequest::CacheSaveControlAttribute, true );
   }
+  mReply = QgsNetworkAccessManager::instance()->get( request );
 
-  XML_ParserFree( p );
+  connect( mReply, SIGNAL( finished() ), this, SLOT( setFinished() ) );
+  connect( mReply, SIGNAL( downloadProgress( qint64, qint64 ) ), this, SLOT( handleProgressEvent( qint64, qint64 ) ) );
+}
 
-  if ( extent )
-    *extent = mExtent;
+bool QgsGml::readData( QGis::WkbType* wkbType, QgsRectangle* extent, int maxWait )
+{
+  if ( !mReply )
+  {
+    return false;
+  }
 
-  return 0;
+  if ( !mFinished && mReply->bytesAvailable() == 0 )
+  {
+    QEventLoop loop;
+    connect( mReply, SIGNAL( readyRead() ), &loop, SLOT( quit() ) );
+    connect( mReply, SIGNAL( finished() ), &loop, SLOT( quit() ) );
+    QTimer::singleShot( maxWait, &loop, SLOT( quit() ) );
+    loop.exec( QEventLoop::ExcludeUserInputEvents );
+  }
+
+  //the flag is read first, data arriving after it is read with the next call
+  bool atEnd = mFinished;
+  QByteArray data = mReply->readAll();
+  if ( data.size() > 0 || atEnd )
+  {
+    if ( processData( data, atEnd, wkbType, extent ) != 0 )
+    {
+      mError = true;
+    }
+  }
+
+  if ( !atEnd )
+  {
+    return true;
+  }
+
+  if ( !mReply->isFinished() )
+  {
+    //canceled
+    mReply->abort();
+  }
+  else if ( mReply->error() != QNetworkReply::NoError )
+  {
+    QgsDebugMsg( QString( "GML request failed: %1" ).arg( mReply->errorString() ) );
+    mError = true;
+  }
+  else if ( mCacheLoadControl != QNetworkRequest::PreferNetwork &&
+            !mReply->attribute( QNetworkRequest::SourceIsFromCacheAttribute ).toBool() )
+  {
+    setCacheExpiry();
+  }
+  mReply->deleteLater();
+  mReply = 0;
+  return false;
 }
 
 int QgsGml::getFeatures( const QByteArray &data, QGis::WkbType* wkbType, QgsRectangle* extent )
 {
   QgsDebugMsg( "Entered" );
+  processData( data, true, wkbType, extent );
+  return 0;
+}
+
+int QgsGml::processData( const QByteArray &data, bool atEnd, QGis::WkbType* wkbType, QgsRectangle* extent )
+{
   mWkbType = wkbType;
-  mExtent.setMinimal();
 
-  XML_Parser p = XML_ParserCreateNS( NULL, NS_SEPARATOR );
-  XML_SetUserData( p, this );
-  XML_SetElementHandler( p, QgsGml::start, QgsGml::end );
-  XML_SetCharacterDataHandler( p, QgsGml::chars );
-  int atEnd = 1;
-  XML_Parse( p, data.constData(), data.size(), atEnd );
+  if ( !mParser )
+  {
+    mParser = XML_ParserCreateNS( NULL, NS_SEPARATOR );
+    XML_SetUserData( mParser, this );
+    XML_SetElementHandler( mParser, QgsGml::start, QgsGml::end );
+    XML_SetCharacterDataHandler( mParser, QgsGml::chars );
 
-  if ( extent )
-    *extent = mExtent;
+    //start with empty extent
+    mExtent.setMinimal();
+    mFeaturesExtent.setMinimal();
+  }
 
-  return 0;
+  int featureCount = mFeatures.size();
+  int ret = 0;
+  if ( XML_Parse( mParser, data.constData(), data.size(), atEnd ) == XML_STATUS_ERROR )
+  {
+    QgsDebugMsg( QString( "GML parsing failed at line %1: %2" )
+                 .arg( XML_GetCurrentLineNumber( mParser ) )
+                 .arg( XML_ErrorString( XML_GetErrorCode( mParser ) ) ) );
+    ret = 1;
+  }
+
+  if ( mFeatures.size() > featureCount )
+  {
+    emit featuresParsed();
+  }
+
+  if ( atEnd )
+  {
+    XML_ParserFree( mParser );
+    mParser = 0;
+
+    if ( *mWkbType != QGis::WKBNoGeometry && mExtent.isEmpty() )
+    {
+      //reading of bbox from the server failed, so we use the bbox of the features
+      mExtent = mFeaturesExtent;
+    }
+
+    if ( extent )
+      *extent = mExtent;
+  }
+
+  return ret;
+}
+
+QMap<QgsFeatureId, QgsFeature* > QgsGml::takeFeatures()
+{
+  QMap<QgsFeatureId, QgsFeature* > features = mFeatures;
+  mFeatures.clear();
+  return features;
+}
+
+void QgsGml::setCacheExpiry()
+{
+  // there is no network cache if none was set up by the application
+  QAbstractNetworkCache *cache = QgsNetworkAccessManager::instance()->cache();
+  if ( !cache )
+  {
+    return;
+  }
+
+  QNetworkCacheMetaData cmd = cache->metaData( mReply->request().url() );
+  if ( !cmd.isValid() )
+  {
+    return;
+  }
+
+  QNetworkCacheMetaData::RawHeaderList hl;
+  foreach ( const QNetworkCacheMetaData::RawHeader &h, cmd.rawHeaders() )
+  {
+    if ( h.first != "Cache-Control" )
+      hl.append( h );
+  }
+  cmd.setRawHeaders( hl );
+
+  QgsDebugMsg( QString( "expirationDate:%1" ).arg( cmd.expirationDate().toString() ) );
+  if ( cmd.expirationDate().isNull() )
+  {
+    QSettings s;
+    cmd.setExpirationDate( QDateTime::currentDateTime().addSecs( s.value( "/qgis/defaultTileExpiry", "24" ).toInt() * 60 * 60 ) );
+  }
+
+  cache->updateMetaData( cmd );
 }
 
 void QgsGml::setFinished( )
@@ -189,9 +331,12 @@ void QgsGml::startElement( const XML_Char* el, const XML_Char** attr )
   }
   else if ( elementName == GML_NAMESPACE + NS_SEPARATOR + "featureMember" )
   {
+    mParseModeStack.push( QgsGml::featureMember );
   }
-  else if ( localName == mTypeName )
+  else if ( localName == mTypeName || ( mTypeName.isEmpty() && modeStackTop() == QgsGml::featureMember ) )
   {
+    //without type name the first member gives it
+    mTypeName = localName;
     mCurrentFeature = new QgsFeature( mFeatureCount );
     QgsAttributes attributes( mThematicAttributes.size() ); //add empty attributes
     mCurrentFeature->setAttributes( attributes );
@@ -199,7 +344,7 @@ void QgsGml::startElement( const XML_Char* el, const XML_Char** attr )
     mCurrentFeatureId = readAttribute( "fid", attr );
   }
 
-  else if ( elementName == GML_NAMESPACE + NS_SEPARATOR + "Box" && mParseModeStack.top() == QgsGml::boundingBox )
+  else if ( elementName == GML_NAMESPACE + NS_SEPARATOR + "Box" && modeStackTop() == QgsGml::boundingBox )
   {
     //read attribute srsName="EPSG:26910"
     int epsgNr;
@@ -207,6 +352,10 @@ void QgsGml::startElement( const XML_Char* el, const XML_Char** attr )
     {
       QgsDebugMsg( "error, could not get epsg id" );
     }
+    else
+    {
+      mEpsg = epsgNr;
+    }
   }
   else if ( elementName == GML_NAMESPACE + NS_SEPARATOR + "Polygon" )
   {
@@ -237,7 +386,7 @@ void QgsGml::startElement( const XML_Char* el, const XML_Char** attr )
   {
     mParseModeStack.push( QgsGml::multiPolygon );
   }
-  else if ( mParseModeStack.size() == 1 && mParseModeStack.top() == QgsGml::feature && mThematicAttributes.find( localName ) != mThematicAttributes.end() )
+  else if ( modeStackTop() == QgsGml::feature && mThematicAttributes.find( localName ) != mThematicAttributes.end() )
   {
     mParseModeStack.push( QgsGml::attribute );
     mAttributeName = localName;
@@ -285,7 +434,7 @@ void QgsGml::endElement( const XML_Char* el )
           var = QVariant( mStringCash );
           break;
       }
-      mCurrentFeature->setAttribute( att_it.value().first, QVariant( mStringCash ) );
+      mCurrentFeature->setAttribute( att_it.value().first, var );
     }
   }
   else if ( localName == mGeometryAttribute )
@@ -298,17 +447,31 @@ void QgsGml::endElement( const XML_Char* el )
   else if ( elementName == GML_NAMESPACE + NS_SEPARATOR + "boundedBy" )
   {
     //create bounding box from mStringCash
-    if ( createBBoxFromCoordinateString( mCurrentExtent, mStringCash ) != 0 )
+    bool bboxOk = createBBoxFromCoordinateString( mCurrentExtent, mStringCash ) == 0;
+    if ( !bboxOk )
     {
       QgsDebugMsg( "creation of bounding box failed" );
     }
 
-    if ( !mParseModeStack.empty() )
+    //only the bounding box of the collection has its own mode
+    if ( modeStackTop() == QgsGml::boundingBox )
+    {
+      mParseModeStack.pop();
+
+      //the layer extent is known before the features are read
+      if ( bboxOk )
+      {
+        mExtent = mCurrentExtent;
+      }
+    }
+  }
+  else if ( elementName == GML_NAMESPACE + NS_SEPARATOR + "featureMember" )
+  {
+    if ( modeStackTop() == QgsGml::featureMember )
     {
       mParseModeStack.pop();
     }
   }
-  //else if ( elementName == GML_NAMESPACE + NS_SEPARATOR + "featureMember" )
   else if ( localName == mTypeName )
   {
     if ( mCurrentWKBSize > 0 )
@@ -325,6 +488,12 @@ void QgsGml::endElement( const XML_Char* el )
     }
     mCurrentFeature->setValid( true );
 
+    QgsGeometry* geom = mCurrentFeature->geometry();
+    if ( geom )
+    {
+      mFeaturesExtent.unionRect( geom->boundingBox() );
+    }
+
     mFeatures.insert( mCurrentFeature->id(), mCurrentFeature );
     if ( !mCurrentFeatureId.isEmpty() )
     {
@@ -823,37 +992,3 @@ int QgsGml::totalWKBFragmentSize() const
   }
   return result;
 }
-
-void QgsGml::calculateExtentFromFeatures()
-{
-  if ( mFeatures.size() < 1 )
-  {
-    return;
-  }
-
-  QgsFeature* currentFeature = 0;
-  QgsGeometry* currentGeometry = 0;
-  bool bboxInitialised = false; //gets true once bbox has been set to the first geometry
-
-  for ( int i = 0; i < mFeatures.size(); ++i )
-  {
-    currentFeature = mFeatures[i];
-    if ( !currentFeature )
-    {
-      continue;
-    }
-    currentGeometry = currentFeature->geometry();
-    if ( currentGeometry )
-    {
-      if ( !bboxInitialised )
-      {
-        mExtent = currentGeometry->boundingBox();
-        bboxInitialised = true;
-      }
-      else
-      {
-        mExtent.unionRect( currentGeometry->boundingBox() );
-      }
-    }
-  }
-}
@@ -28,11 +28,13 @@
 #include <QPair>
 #include <QByteArray>
 #include <QDomElement>
+#include <QNetworkRequest>
 #include <QStringList>
 #include <QStack>
 
 class QgsRectangle;
 class QgsCoordinateReferenceSystem;
+class QNetworkReply;
 
 /**This class reads data from a WFS server or alternatively from a GML file. It uses the expat XML parser and an event based model to keep performance high. The parsing starts when the first data arrives, it does not wait until the request is finished*/
 class CORE_EXPORT QgsGml: public QObject
@@ -52,12 +54,78 @@ class CORE_EXPORT QgsGml: public QObject
      */
     int getFeatures( const QString& uri, QGis::WkbType* wkbType, QgsRectangle* extent = 0 );
 
+    /** Send the Http GET request to the wfs server without waiting for the response.
+     *  The response is parsed by readData() calls.
+     *  @param uri GML URL
+     *  @note added in 2.0
+     *  @note not available in python bindings
+     */
+    void startGetFeatures( const QString& uri );
+
+    /** Parse the data of the request started by startGetFeatures() which arrived so far,
+     *  featuresParsed() is emitted for completed features. If no data is available,
+     *  waits up to maxWait milliseconds for it (user input is not processed meanwhile).
+     *  @param wkbType geometry type, updated from parsed geometries
+     *  @param extent set to the layer extent when the request is finished
+     *  @param maxWait maximum time to wait for data in milliseconds
+     *  @return true while the request is running, false when it is finished
+     *  @note added in 2.0
+     *  @note not available in python bindings
+     */
+    bool readData( QGis::WkbType* wkbType, QgsRectangle* extent, int maxWait );
+
+    /** True if the request failed or the data could not be parsed
+     *  @note added in 2.0
+     */
+    bool hasError() const { return mError; }
+
     /** Read from GML data. Constructor uri param is ignored */
     int getFeatures( const QByteArray &data, QGis::WkbType* wkbType, QgsRectangle* extent = 0 );
 
+    /** Read a chunk of GML data. The data may be split anywhere, features are parsed
+     *  as soon as their end element arrives and featuresParsed() is emitted for them.
+     *  If the type name given in the constructor is empty, it is taken from the first feature.
+     *  @param data next chunk of the GML document
+     *  @param atEnd true if this is the last chunk, the extent is finished then
+     *  @param wkbType geometry type, updated from parsed geometries
+     *  @param extent set to the layer extent with the last chunk
+     *  @return 0 in case of success
+     *  @note added in 2.0
+     */
+    int processData( const QByteArray &data, bool atEnd, QGis::WkbType* wkbType, QgsRectangle* extent = 0 );
+
     /** Get parsed features for given type name */
     QMap<QgsFeatureId, QgsFeature* > featuresMap() const { return mFeatures; }
 
+    /** Take the features parsed so far, the caller takes ownership of them.
+     *  Used with featuresParsed() to hand features over while the data is still read,
+     *  so that they are not kept twice.
+     *  @note added in 2.0
+     *  @note not available in python bindings
+     */
+    QMap<QgsFeatureId, QgsFeature* > takeFeatures();
+
+    /** Set how getFeatures( uri ) uses the network cache. Responses are saved to the cache
+     *  unless the default QNetworkRequest::PreferNetwork is used. Entries without an expiration
+     *  date of the server expire after /qgis/defaultTileExpiry hours, expired entries are
+     *  loaded from the network again.
+     *  @note added in 2.0
+     *  @note not available in python bindings
+     */
+    void setCacheLoadControl( QNetworkRequest::CacheLoadControl control ) { mCacheLoadControl = control; }
+
+    /** Layer extent: the bounding box of the collection as soon as it was parsed, if the
+     *  server provides it, otherwise the extent of the features once the data is finished.
+     *  Empty until then.
+     *  @note added in 2.0
+     */
+    const QgsRectangle& extent() const { return mExtent; }
+
+    /** EPSG code of the srsName of the collection bounding box or 0 if unknown
+     *  @note added in 2.0
+     */
+    int epsg() const { return mEpsg; }
+
     /** Get feature ids map */
     QMap<QgsFeatureId, QString > idsMap() const { return mIdMap; }
 
@@ -73,14 +141,21 @@ class CORE_EXPORT QgsGml: public QObject
     void totalStepsUpdate( int totalSteps );
     //also emit signal with progress and totalSteps together (this is better for the status message)
     void dataProgressAndSteps( int progress, int totalSteps );
+    /** Emitted when a chunk of data completed new features, see takeFeatures()
+     *  @note added in 2.0
+     */
+    void featuresParsed();
 
   private:
 
+    /**Sets the expiration date of the cached response of mReply if the server did not set one*/
+    void setCacheExpiry();
+
     enum ParseMode
     {
       none,
       boundingBox,
-      //featureMember, // gml:featureMember
+      featureMember, // gml:featureMember
       feature,  // feature element containint attrs and geo (inside gml:featureMember)
       attribute,
       geometry,
@@ -144,11 +219,6 @@ class CORE_EXPORT QgsGml: public QObject
 
     /**Returns pointer to main window or 0 if it does not exist*/
     QWidget* findMainWindow() const;
-    /**This function evaluates the layer bounding box from the features and sets it to mExtent.
-    Less efficient compared to reading the bbox from the provider, so it is only done if the wfs server
-    does not provider extent information.*/
-    void calculateExtentFromFeatures();
-
     /** Get safely (if empty) top from mode stack */
     ParseMode modeStackTop() { return mParseModeStack.isEmpty() ? none : mParseModeStack.top(); }
 
@@ -157,9 +227,21 @@ class CORE_EXPORT QgsGml: public QObject
 
     QString mTypeName;
     QString mUri;
+    /**Reply of the request started by startGetFeatures(), 0 if no request is running*/
+    QNetworkReply* mReply;
+    /**True if the request failed or the data could not be parsed*/
+    bool mError;
+    /**Parser of the data passed to processData(), 0 if no data is being read*/
+    XML_Parser mParser;
     //results are members such that handler routines are able to manipulate them
     /**Bounding box of the layer*/
     QgsRectangle mExtent;
+    /**Bounding box of the parsed features, used if the server does not provide the layer extent*/
+    QgsRectangle mFeaturesExtent;
+    /**EPSG code of the collection bounding box*/
+    int mEpsg;
+    /**Use of the network cache by getFeatures( uri )*/
+    QNetworkRequest::CacheLoadControl mCacheLoadControl;
     /**The features of the layer, map of feature maps for each feature type*/
     //QMap<QgsFeatureId, QgsFeature* > &mFeatures;
     QMap<QgsFeatureId, QgsFeature* > mFeatures;
@@ -29,6 +29,9 @@
 #include "qgscentralpointpositionmanager.h"
 #include "qgsoverlayobjectpositionmanager.h"
 #include "qgspalobjectpositionmanager.h"
+#include "qgsrasterdataprovider.h"
+#include "qgsrasterlayer.h"
+#include "qgsvectordataprovider.h"
 #include "qgsvectorlayer.h"
 #include "qgsvectoroverlay.h"
 
@@ -40,7 +43,10 @@
 #include <QListIterator>
 #include <QSettings>
 #include <QTime>
+#include <QTimer>
 #include <QCoreApplication>
+#include <QFutureWatcher>
+#include <QtConcurrentMap>
 
 QgsMapRenderer::QgsMapRenderer()
 {
@@ -62,6 +68,9 @@ QgsMapRenderer::QgsMapRenderer()
   mOutputUnits = QgsMapRenderer::Millimeters;
 
   mLabelingEngine = NULL;
+
+  mParallelJobs = 0;
+  mParallelFuture = 0;
 }
 
 QgsMapRenderer::~QgsMapRenderer()
@@ -324,12 +333,17 @@ void QgsMapRenderer::render( QPainter* painter, double* forceWidthScale )
   if ( mLabelingEngine )
     mLabelingEngine->init( this );
 
+  // vertices closer than the tolerance (in device pixels) collapse into the same pixel.
+  // Vector output (e.g. print composer) is not simplified as its resolution is not known here
+  QSettings mySettings;
+  double simplifyTolerance = mySettings.value( "/qgis/simplifyDrawingTol", 1.0 ).toDouble() / rasterScaleFactor;
+  mRenderContext.setSimplifyTolerance( mRenderContext.forceVectorOutput() ? 0.0 : simplifyTolerance );
+
   // know we know if this render is just a repeat of the last time, we
   // can clear caches if it has changed
   if ( !mySameAsLastFlag )
   {
     //clear the cache pixmap if we changed resolution / extent
-    QSettings mySettings;
     if ( mySettings.value( "/qgis/enable_render_caching", false ).toBool() )
     {
       QgsMapLayerRegistry::instance()->clearAllLayerCaches();
@@ -345,7 +359,17 @@ void QgsMapRenderer::render( QPainter* painter, double* forceWidthScale )
 
   QgsRectangle r1, r2;
 
-  while ( li.hasPrevious() )
+  // render layers concurrently into separate images if enabled. This is only done
+  // for raster output devices, vector output (e.g. composer prints) keeps the sequential path
+  bool renderInParallel = mySettings.value( "/qgis/parallel_rendering", false ).toBool()
+                          && !mRenderContext.forceVectorOutput()
+                          && ( thePaintDevice->devType() == QInternal::Image || thePaintDevice->devType() == QInternal::Pixmap );
+  if ( renderInParallel )
+  {
+    renderLayersParallel( rasterScaleFactor, mySameAsLastFlag, overlayManager, allOverlayList );
+  }
+
+  while ( !renderInParallel && li.hasPrevious() )
   {
     if ( mRenderContext.renderingStopped() )
     {
@@ -369,7 +393,7 @@ void QgsMapRenderer::render( QPainter* painter, double* forceWidthScale )
     QgsDebugMsg( "If there is a QPaintEngine error here, it is caused by an emit call" );
 
     //emit drawingProgress(myRenderCounter++, mLayerSet.size());
-    QgsMapLayer *ml = QgsMapLayerRegistry::instance()->mapLayer( layerId );
+    QgsMapLayer *ml = mapLayer( layerId );
 
     if ( !ml )
     {
@@ -463,7 +487,6 @@ void QgsMapRenderer::render( QPainter* painter, double* forceWidthScale )
         }
       }
 
-      QSettings mySettings;
       if ( ! split )//render caching does not yet cater for split extents
       {
         if ( mySettings.value( "/qgis/enable_render_caching", false ).toBool() )
@@ -543,6 +566,7 @@ void QgsMapRenderer::render( QPainter* painter, double* forceWidthScale )
         }
       }
       disconnect( ml, SIGNAL( drawingProgress( int, int ) ), this, SLOT( onDrawingProgress( int, int ) ) );
+      emit layerDrawn();
     }
     else // layer not visible due to scale
     {
@@ -568,7 +592,7 @@ void QgsMapRenderer::render( QPainter* painter, double* forceWidthScale )
       QString layerId = li.previous();
 
       // TODO: emit drawingProgress((myRenderCounter++),zOrder.size());
-      QgsMapLayer *ml = QgsMapLayerRegistry::instance()->mapLayer( layerId );
+      QgsMapLayer *ml = mapLayer( layerId );
 
       if ( ml && ( ml->type() != QgsMapLayer::RasterLayer ) )
       {
@@ -635,6 +659,357 @@ void QgsMapRenderer::render( QPainter* painter, double* forceWidthScale )
   mDrawing = false;
 }
 
+/** Forwards all calls to another labeling engine while holding a mutex, so that
+ * layers drawn on worker threads can register their features with the single
+ * labeling engine of the map renderer.
+ */
+class QgsSerializedLabelingEngine : public QgsLabelingEngineInterface
+{
+  public:
+    QgsSerializedLabelingEngine( QgsLabelingEngineInterface* engine ) : mEngine( engine ) {}
+
+    void init( QgsMapRenderer* mp ) { QMutexLocker locker( &mMutex ); mEngine->init( mp ); }
+    bool willUseLayer( QgsVectorLayer* layer ) { QMutexLocker locker( &mMutex ); return mEngine->willUseLayer( layer ); }
+    int prepareLayer( QgsVectorLayer* layer, QSet<int>& attrIndices, QgsRenderContext& ctx )
+    { QMutexLocker locker( &mMutex ); return mEngine->prepareLayer( layer, attrIndices, ctx ); }
+    QgsPalLayerSettings& layer( const QString& layerName ) { QMutexLocker locker( &mMutex ); return mEngine->layer( layerName ); }
+    int addDiagramLayer( QgsVectorLayer* layer, QgsDiagramLayerSettings* s )
+    { QMutexLocker locker( &mMutex ); return mEngine->addDiagramLayer( layer, s ); }
+    void registerFeature( QgsVectorLayer* layer, QgsFeature& feat, const QgsRenderContext& context )
+    { QMutexLocker locker( &mMutex ); mEngine->registerFeature( layer, feat, context ); }
+    void registerDiagramFeature( QgsVectorLayer* layer, QgsFeature& feat, const QgsRenderContext& context )
+    { QMutexLocker locker( &mMutex ); mEngine->registerDiagramFeature( layer, feat, context ); }
+    void drawLabeling( QgsRenderContext& context ) { QMutexLocker locker( &mMutex ); mEngine->drawLabeling( context ); }
+    void exit() { QMutexLocker locker( &mMutex ); mEngine->exit(); }
+    QList<QgsLabelPosition> labelsAtPosition( const QgsPoint& p ) { QMutexLocker locker( &mMutex ); return mEngine->labelsAtPosition( p ); }
+    QList<QgsLabelPosition> labelsWithinRect( const QgsRectangle& r ) { QMutexLocker locker( &mMutex ); return mEngine->labelsWithinRect( r ); }
+    QgsLabelingEngineInterface* clone() { QMutexLocker locker( &mMutex ); return mEngine->clone(); }
+
+  private:
+    QgsLabelingEngineInterface* mEngine;
+    QMutex mMutex;
+};
+
+/** State of one layer rendered by QgsMapRenderer::renderLayersParallel */
+struct QgsLayerRenderJob
+{
+  QgsLayerRenderJob(): layer( 0 ), image( 0 ), split( false ), scaleRaster( false ),
+      rasterScaleFactor( 1.0 ), fromCache( false ), mainThread( false ), drawOk( true ) {}
+
+  QgsMapLayer* layer;
+  //! context of the job, the painter is created by the worker
+  QgsRenderContext context;
+  //! image the layer is drawn into
+  QImage* image;
+  //! auth ids of the layer and destination crs if the layer needs to be transformed
+  QString srcAuthId;
+  QString destAuthId;
+  QPainter::RenderHints renderHints;
+  bool split;
+  //! second extent if the layer extent was split at the +/- 180 degree line
+  QgsRectangle extent2;
+  bool scaleRaster;
+  double rasterScaleFactor;
+  //! image is the cache image of the layer and needs no redraw
+  bool fromCache;
+  //! the provider of the layer may only be used from the main thread
+  bool mainThread;
+  bool drawOk;
+};
+
+//! runs on a worker thread or on the main thread for layers which are not thread safe
+static void renderLayerJob( QgsLayerRenderJob& job )
+{
+  if ( !job.layer || job.fromCache || job.context.renderingStopped() )
+    return;
+
+  if ( !job.srcAuthId.isEmpty() )
+  {
+    // projPJ handles must not be shared between threads, use the transform of this worker
+    job.context.setCoordinateTransform( QgsCoordinateTransformCache::instance()->transform( job.srcAuthId, job.destAuthId ) );
+  }
+
+  QPainter painter( job.image );
+  painter.setRenderHints( job.renderHints );
+  job.context.setPainter( &painter );
+
+  if ( job.scaleRaster )
+  {
+    painter.scale( 1.0 / job.rasterScaleFactor, 1.0 / job.rasterScaleFactor );
+  }
+
+  job.drawOk = job.layer->draw( job.context );
+  if ( job.split && !job.context.renderingStopped() )
+  {
+    job.context.setExtent( job.extent2 );
+    job.drawOk = job.layer->draw( job.context ) && job.drawOk;
+  }
+
+  painter.end();
+  job.context.setPainter( 0 );
+}
+
+//! QtConcurrent::map() entry, the pool works on pointers to the thread safe jobs
+static void renderPooledLayerJob( QgsLayerRenderJob* job )
+{
+  renderLayerJob( *job );
+}
+
+void QgsMapRenderer::renderLayersParallel( double rasterScaleFactor, bool sameAsLast,
+    QgsOverlayObjectPositionManager* overlayManager,
+    QList<QgsVectorOverlay*>& allOverlayList )
+{
+  QPainter* painter = mRenderContext.painter();
+  QSettings mySettings;
+  bool renderCaching = mySettings.value( "/qgis/enable_render_caching", false ).toBool();
+
+  QgsSerializedLabelingEngine* labelingEngine = 0;
+  if ( mLabelingEngine )
+  {
+    labelingEngine = new QgsSerializedLabelingEngine( mLabelingEngine );
+  }
+
+  // 1. prepare the jobs on this thread, starting at the base of the stack
+  QList<QgsLayerRenderJob> jobs;
+  QListIterator<QString> li( mLayerSet );
+  li.toBack();
+  while ( li.hasPrevious() )
+  {
+    QString layerId = li.previous();
+    QgsMapLayer *ml = mapLayer( layerId );
+    if ( !ml )
+    {
+      QgsDebugMsg( "Layer not found in registry!" );
+      continue;
+    }
+
+    if ( ml->hasScaleBasedVisibility() && ( ml->minimumScale() > mScale || mScale >= ml->maximumScale() ) && !mOverview )
+    {
+      QgsDebugMsg( "Layer not rendered because it is not within the defined "
+                   "visibility scale range" );
+      continue;
+    }
+
+    QgsLayerRenderJob job;
+    job.layer = ml;
+    job.mainThread = !isLayerThreadSafe( ml );
+    job.context = mRenderContext;
+    job.context.setPainter( 0 );
+    job.context.setLabelingEngine( labelingEngine );
+    job.renderHints = painter->renderHints();
+
+    if ( hasCrsTransformEnabled() )
+    {
+      QgsRectangle r1 = mExtent;
+      job.split = splitLayersExtent( ml, r1, job.extent2 );
+      if ( !r1.isFinite() || !job.extent2.isFinite() ) //there was a problem transforming the extent. Skip the layer
+      {
+        continue;
+      }
+      job.srcAuthId = ml->crs().authid();
+      job.destAuthId = mDestCRS->authid();
+      job.context.setExtent( r1 );
+      // transform of this thread for the overlays, the workers look up their own
+      job.context.setCoordinateTransform( QgsCoordinateTransformCache::instance()->transform( job.srcAuthId, job.destAuthId ) );
+    }
+    else
+    {
+      job.context.setCoordinateTransform( 0 );
+    }
+
+    if ( ml->type() == QgsMapLayer::RasterLayer && qAbs( rasterScaleFactor - 1.0 ) > 0.000001 )
+    {
+      job.scaleRaster = true;
+      job.rasterScaleFactor = rasterScaleFactor;
+      QgsMapToPixel rasterMapToPixel = mRenderContext.mapToPixel();
+      rasterMapToPixel.setMapUnitsPerPixel( mRenderContext.mapToPixel().mapUnitsPerPixel() / rasterScaleFactor );
+      rasterMapToPixel.setYMaximum( mSize.height() * rasterScaleFactor );
+      job.context.setMapToPixel( rasterMapToPixel );
+    }
+
+    if ( ml->type() == QgsMapLayer::VectorLayer )
+    {
+      QgsVectorLayer* vl = qobject_cast<QgsVectorLayer *>( ml );
+
+      //create overlay objects for features within the view extent
+      if ( overlayManager )
+      {
+        QList<QgsVectorOverlay*> thisLayerOverlayList;
+        vl->vectorOverlays( thisLayerOverlayList );
+
+        QList<QgsVectorOverlay*>::iterator overlayIt = thisLayerOverlayList.begin();
+        for ( ; overlayIt != thisLayerOverlayList.end(); ++overlayIt )
+        {
+          if (( *overlayIt )->displayFlag() )
+          {
+            ( *overlayIt )->createOverlayObjects( job.context );
+            allOverlayList.push_back( *overlayIt );
+          }
+        }
+
+        overlayManager->addLayer( vl, thisLayerOverlayList );
+      }
+
+      // Force render of layers that are being edited
+      // or if there's a labeling engine that needs the layer to register features
+      if ( vl->isEditable() || ( mLabelingEngine && mLabelingEngine->willUseLayer( vl ) ) )
+      {
+        ml->setCacheImage( 0 );
+      }
+    }
+
+    if ( renderCaching && !job.split && sameAsLast && ml->cacheImage() )
+    {
+      QgsDebugMsg( "Caching enabled --- drawing layer from cached image" );
+      job.image = ml->cacheImage();
+      job.fromCache = true;
+    }
+    else
+    {
+      job.image = new QImage( painter->device()->width(), painter->device()->height(), QImage::Format_ARGB32_Premultiplied );
+      job.image->fill( 0 );
+    }
+
+    connect( ml, SIGNAL( drawingProgress( int, int ) ), this, SLOT( onDrawingProgress( int, int ) ) );
+    jobs.append( job );
+  }
+
+  // 2. draw the layers of thread safe providers on the thread pool, the others (e.g. network
+  // providers using the network access manager of the main thread) are drawn here meanwhile.
+  // Events are processed so that the rendering can be stopped - cancellation is passed on
+  // to the contexts of the jobs
+  QList<QgsLayerRenderJob*> pooledJobs;
+  QList<QgsLayerRenderJob*> mainThreadJobs;
+  for ( int i = 0; i < jobs.size(); ++i )
+  {
+    if ( jobs[i].mainThread )
+      mainThreadJobs << &jobs[i];
+    else
+      pooledJobs << &jobs[i];
+  }
+
+  QFuture<void> future = QtConcurrent::map( pooledJobs, renderPooledLayerJob );
+  QFutureWatcher<void> watcher;
+  watcher.setFuture( future );
+
+  // layers must not be deleted while they are drawn by the workers
+  mParallelJobs = &jobs;
+  mParallelFuture = &future;
+  connect( QgsMapLayerRegistry::instance(), SIGNAL( layersWillBeRemoved( QStringList ) ),
+           this, SLOT( layersWillBeRemoved( QStringList ) ), Qt::DirectConnection );
+
+  bool stopPropagated = false;
+  foreach ( QgsLayerRenderJob* job, mainThreadJobs )
+  {
+    if ( !stopPropagated && mRenderContext.renderingStopped() )
+    {
+      for ( int i = 0; i < jobs.size(); ++i )
+      {
+        jobs[i].context.setRenderingStopped( true );
+      }
+      stopPropagated = true;
+    }
+    renderLayerJob( *job );
+  }
+
+  // user input is not processed, it could change the layers (renderer, editing...)
+  // drawn by the workers meanwhile
+  QTimer stopPollTimer;
+  stopPollTimer.start( 100 );
+  while ( !future.isFinished() )
+  {
+    QCoreApplication::processEvents( QEventLoop::WaitForMoreEvents | QEventLoop::ExcludeUserInputEvents );
+    if ( mRenderContext.renderingStopped() && !stopPropagated )
+    {
+      for ( int i = 0; i < jobs.size(); ++i )
+      {
+        jobs[i].context.setRenderingStopped( true );
+      }
+      stopPropagated = true;
+    }
+  }
+  future.waitForFinished();
+
+  disconnect( QgsMapLayerRegistry::instance(), SIGNAL( layersWillBeRemoved( QStringList ) ),
+              this, SLOT( layersWillBeRemoved( QStringList ) ) );
+  mParallelJobs = 0;
+  mParallelFuture = 0;
+
+  // 3. composite the layer images in layer order
+  for ( int i = 0; i < jobs.size(); ++i )
+  {
+    QgsLayerRenderJob& job = jobs[i];
+    if ( !job.layer )
+    {
+      // removed meanwhile, a cache image was deleted with the layer
+      if ( !job.fromCache )
+        delete job.image;
+      continue;
+    }
+
+    disconnect( job.layer, SIGNAL( drawingProgress( int, int ) ), this, SLOT( onDrawingProgress( int, int ) ) );
+
+    if ( !job.drawOk )
+    {
+      emit drawError( job.layer );
+    }
+
+    if ( !mRenderContext.renderingStopped() )
+    {
+      painter->drawImage( 0, 0, *job.image );
+      emit layerDrawn();
+    }
+
+    if ( !job.fromCache )
+    {
+      if ( renderCaching && !job.split && !mRenderContext.renderingStopped() )
+      {
+        job.layer->setCacheImage( job.image ); //map layer takes ownership
+      }
+      else
+      {
+        delete job.image;
+      }
+    }
+  }
+
+  delete labelingEngine;
+}
+
+void QgsMapRenderer::layersWillBeRemoved( QStringList theLayerIds )
+{
+  if ( !mParallelJobs )
+    return;
+
+  QList<QgsLayerRenderJob*> removedJobs;
+  for ( int i = 0; i < mParallelJobs->size(); ++i )
+  {
+    QgsLayerRenderJob& job = ( *mParallelJobs )[i];
+    if ( job.layer && theLayerIds.contains( job.layer->id() ) &&
+         QgsMapLayerRegistry::instance()->mapLayer( job.layer->id() ) == job.layer )
+    {
+      removedJobs << &job;
+    }
+  }
+  if ( removedJobs.isEmpty() )
+    return;
+
+  // stop the rendering and wait until the workers leave the layers
+  QgsDebugMsg( "Layers removed while rendering, stopping" );
+  mRenderContext.setRenderingStopped( true );
+  for ( int i = 0; i < mParallelJobs->size(); ++i )
+  {
+    ( *mParallelJobs )[i].context.setRenderingStopped( true );
+  }
+  mParallelFuture->waitForFinished();
+
+  foreach ( QgsLayerRenderJob* job, removedJobs )
+  {
+    disconnect( job->layer, SIGNAL( drawingProgress( int, int ) ), this, SLOT( onDrawingProgress( int, int ) ) );
+    job->layer = 0;
+  }
+}
+
 void QgsMapRenderer::setMapUnits( QGis::UnitType u )
 {
   mScaleCalculator->setMapUnits( u );
@@ -874,7 +1249,6 @@ QgsRectangle QgsMapRenderer::mapToLayerCoordinates( QgsMapLayer* theLayer, QgsRe
 void QgsMapRenderer::updateFullExtent()
 {
   QgsDebugMsg( "called." );
-  QgsMapLayerRegistry* registry = QgsMapLayerRegistry::instance();
 
   // reset the map canvas extent since the extent may now be smaller
   // We can't use a constructor since QgsRectangle normalizes the rectangle upon construction
@@ -886,7 +1260,7 @@ void QgsMapRenderer::updateFullExtent()
   QgsDebugMsg( QString( "Layer count: %1" ).arg( mLayerSet.count() ) );
   while ( it != mLayerSet.end() )
   {
-    QgsMapLayer * lyr = registry->mapLayer( *it );
+    QgsMapLayer * lyr = mapLayer( *it );
     if ( lyr == NULL )
     {
       QgsDebugMsg( QString( "WARNING: layer '%1' not found in map layer registry!" ).arg( *it ) );
@@ -1135,6 +1509,44 @@ void QgsMapRenderer::setLabelingEngine( QgsLabelingEngineInterface* iface )
   mLabelingEngine = iface;
 }
 
+void QgsMapRenderer::setLayers( const QList<QgsMapLayer*>& layers )
+{
+  mLayers.clear();
+  foreach ( QgsMapLayer* layer, layers )
+  {
+    mLayers.insert( layer->id(), layer );
+  }
+}
+
+QgsMapLayer* QgsMapRenderer::mapLayer( const QString& layerId ) const
+{
+  QgsMapLayer* layer = mLayers.value( layerId );
+  return layer ? layer : QgsMapLayerRegistry::instance()->mapLayer( layerId );
+}
+
+bool QgsMapRenderer::isLayerThreadSafe( QgsMapLayer* layer )
+{
+  if ( layer->type() == QgsMapLayer::VectorLayer )
+  {
+    QgsVectorLayer* vl = qobject_cast<QgsVectorLayer *>( layer );
+    return vl && vl->dataProvider() && ( vl->dataProvider()->capabilities() & QgsVectorDataProvider::ThreadSafe );
+  }
+  if ( layer->type() == QgsMapLayer::RasterLayer )
+  {
+    QgsRasterLayer* rl = qobject_cast<QgsRasterLayer *>( layer );
+    return rl && rl->dataProvider() && ( rl->dataProvider()->capabilities() & QgsRasterDataProvider::ParallelRead );
+  }
+  // plugin layers
+  return false;
+}
+
+QgsLabelingEngineInterface* QgsMapRenderer::takeLabelingEngine()
+{
+  QgsLabelingEngineInterface* engine = mLabelingEngine;
+  mLabelingEngine = NULL;
+  return engine;
+}
+
 const QgsCoordinateTransform* QgsMapRenderer::tr( QgsMapLayer *layer )
 {
   if ( !layer || !mDestCRS )
@@ -1144,4 +1556,3 @@ const QgsCoordinateTransform* QgsMapRenderer::tr( QgsMapLayer *layer )
   return QgsCoordinateTransformCache::instance()->transform( layer->crs().authid(), mDestCRS->authid() );
 }
 
-bool QgsMapRenderer::mDrawing = false;
@@ -16,6 +16,8 @@
 #ifndef QGSMAPRENDER_H
 #define QGSMAPRENDER_H
 
+#include <QFuture>
+#include <QHash>
 #include <QMutex>
 #include <QSize>
 #include <QStringList>
@@ -38,6 +40,8 @@ class QgsCoordinateReferenceSystem;
 class QgsDistanceArea;
 class QgsOverlayObjectPositionManager;
 class QgsVectorLayer;
+class QgsVectorOverlay;
+struct QgsLayerRenderJob;
 
 class QgsPalLayerSettings;
 class QgsDiagramLayerSettings;
@@ -230,6 +234,23 @@ class CORE_EXPORT QgsMapRenderer : public QObject
     //! Added in QGIS v1.4
     void setLabelingEngine( QgsLabelingEngineInterface* iface );
 
+    //! Remove the labeling engine from the renderer without deleting it.
+    //! The caller takes ownership of the returned engine.
+    //! @note added in 2.0
+    QgsLabelingEngineInterface* takeLabelingEngine();
+
+    //! Set layers to be drawn instead of the registry layers with the same ids,
+    //! e.g. copies of the layers rendered on another thread. The renderer does not
+    //! take ownership of the layers.
+    //! @note added in 2.0
+    //! @note not available in python bindings
+    void setLayers( const QList<QgsMapLayer*>& layers );
+
+    //! Whether the layer may be drawn on other than the main thread, i.e. its provider
+    //! supports reading from other threads
+    //! @note added in 2.0
+    static bool isLayerThreadSafe( QgsMapLayer* layer );
+
   signals:
 
     void drawingProgress( int current, int total );
@@ -245,11 +266,20 @@ class CORE_EXPORT QgsMapRenderer : public QObject
     //! emitted when layer's draw() returned false
     void drawError( QgsMapLayer* );
 
+    //! emitted from the rendering thread when a layer has been drawn onto the output
+    //! painter. Connections must be direct, the painter is still active.
+    //! @note added in 2.0
+    void layerDrawn();
+
   public slots:
 
     //! called by signal from layer current being drawn
     void onDrawingProgress( int current, int total );
 
+  private slots:
+    //! waits for the parallel rendering of layers which are going to be deleted
+    void layersWillBeRemoved( QStringList theLayerIds );
+
   protected:
 
     //! adjust extent to fit the pixmap size
@@ -267,8 +297,19 @@ class CORE_EXPORT QgsMapRenderer : public QObject
     @note this method was added in version 1.1*/
     QgsOverlayObjectPositionManager* overlayManagerFromSettings();
 
+    /**Renders the layer set with every layer drawn into its own off-screen image on
+      the global thread pool. The images are composited onto the context painter in
+      layer order once all layers have finished, so the result does not depend on
+      which layer completes first. Layers of providers which may not be read from other
+      threads (see QgsVectorDataProvider::ThreadSafe, QgsRasterInterface::ParallelRead)
+      are drawn on the calling thread meanwhile. Labeling engine calls from the workers are serialized.
+      @note added in 2.0 */
+    void renderLayersParallel( double rasterScaleFactor, bool sameAsLast,
+                               QgsOverlayObjectPositionManager* overlayManager,
+                               QList<QgsVectorOverlay*>& allOverlayList );
+
     //! indicates drawing in progress
-    static bool mDrawing;
+    bool mDrawing;
 
     //! map units per pixel
     double mMapUnitsPerPixel;
@@ -323,6 +364,16 @@ class CORE_EXPORT QgsMapRenderer : public QObject
 
   private:
     const QgsCoordinateTransform* tr( QgsMapLayer *layer );
+
+    //! layer of the id from mLayers or the registry
+    QgsMapLayer* mapLayer( const QString& layerId ) const;
+
+    //! layers replacing the registry layers (by id)
+    QHash<QString, QgsMapLayer*> mLayers;
+
+    //! jobs and workers of renderLayersParallel() while it runs, otherwise 0
+    QList<QgsLayerRenderJob>* mParallelJobs;
+    QFuture<void>* mParallelFuture;
 };
 
 #endif
@@ -0,0 +1,298 @@
+/***************************************************************************
+  qgsmaprendererjob.cpp - background rendering of a map layer set
+  -------------------------------------------------------------------
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsmaprendererjob.h"
+
+#include "qgscoordinatereferencesystem.h"
+#include "qgslogger.h"
+#include "qgsmaplayerregistry.h"
+#include "qgsmaprenderer.h"
+#include "qgsrasterlayer.h"
+#include "qgsvectorlayer.h"
+
+#include <QDomDocument>
+#include <QMutexLocker>
+#include <QPainter>
+
+//! create a copy of the layer with its own data provider, renderer and label settings
+static QgsMapLayer* cloneLayer( QgsMapLayer* ml )
+{
+  QDomDocument doc( "qgis" );
+  QDomElement root = doc.createElement( "projectlayers" );
+  doc.appendChild( root );
+  if ( !ml->writeXML( root, doc ) )
+    return 0;
+
+  QgsMapLayer* clone = 0;
+  if ( ml->type() == QgsMapLayer::VectorLayer )
+  {
+    clone = new QgsVectorLayer();
+  }
+  else if ( ml->type() == QgsMapLayer::RasterLayer )
+  {
+    clone = new QgsRasterLayer();
+  }
+  else
+  {
+    return 0;
+  }
+
+  if ( !clone->readXML( root.firstChildElement( "maplayer" ) ) || !clone->isValid() )
+  {
+    QgsDebugMsg( "Could not clone layer " + ml->id() );
+    delete clone;
+    return 0;
+  }
+
+  // not part of the project file
+  if ( ml->type() == QgsMapLayer::VectorLayer )
+  {
+    QgsVectorLayer* vl = qobject_cast<QgsVectorLayer *>( ml );
+    qobject_cast<QgsVectorLayer *>( clone )->setSelectedFeatures( vl->selectedFeaturesIds() );
+  }
+  return clone;
+}
+
+QgsMapLayerCloneCache* QgsMapLayerCloneCache::mInstance = 0;
+
+QgsMapLayerCloneCache* QgsMapLayerCloneCache::instance()
+{
+  if ( !mInstance )
+  {
+    mInstance = new QgsMapLayerCloneCache();
+  }
+  return mInstance;
+}
+
+QgsMapLayerCloneCache::QgsMapLayerCloneCache()
+    : mGeneration( 0 )
+{
+}
+
+QgsMapLayerCloneCache::~QgsMapLayerCloneCache()
+{
+  foreach ( QgsMapLayer* layer, mEntries.keys() )
+  {
+    drop( layer );
+  }
+}
+
+QgsMapLayer* QgsMapLayerCloneCache::acquire( QgsMapLayer* layer )
+{
+  if ( !mEntries.contains( layer ) )
+  {
+    Entry entry;
+    entry.generation = ++mGeneration;
+    mEntries.insert( layer, entry );
+
+    connect( layer, SIGNAL( repaintRequested() ), this, SLOT( invalidate() ) );
+    connect( layer, SIGNAL( dataChanged() ), this, SLOT( invalidate() ) );
+    connect( layer, SIGNAL( layerCrsChanged() ), this, SLOT( invalidate() ) );
+    connect( layer, SIGNAL( destroyed( QObject* ) ), this, SLOT( layerDestroyed( QObject* ) ) );
+    if ( layer->type() == QgsMapLayer::VectorLayer )
+    {
+      connect( layer, SIGNAL( layerModified() ), this, SLOT( invalidate() ) );
+      connect( layer, SIGNAL( selectionChanged() ), this, SLOT( invalidate() ) );
+    }
+  }
+
+  Entry& entry = mEntries[layer];
+  QgsMapLayer* clone = 0;
+  if ( !entry.freeClones.isEmpty() )
+  {
+    clone = entry.freeClones.takeFirst();
+  }
+  else
+  {
+    clone = cloneLayer( layer );
+    if ( !clone )
+      return 0;
+  }
+
+  mBusyClones.insert( clone, qMakePair( layer, entry.generation ) );
+  return clone;
+}
+
+void QgsMapLayerCloneCache::release( QgsMapLayer* clone )
+{
+  if ( !mBusyClones.contains( clone ) )
+    return;
+
+  QPair<QgsMapLayer*, int> source = mBusyClones.take( clone );
+  if ( mEntries.contains( source.first ) && mEntries[source.first].generation == source.second )
+  {
+    mEntries[source.first].freeClones << clone;
+  }
+  else
+  {
+    delete clone;
+  }
+}
+
+void QgsMapLayerCloneCache::invalidate()
+{
+  QgsMapLayer* layer = qobject_cast<QgsMapLayer *>( sender() );
+  if ( layer )
+  {
+    drop( layer );
+  }
+}
+
+void QgsMapLayerCloneCache::layerDestroyed( QObject* layer )
+{
+  // the layer is not a QgsMapLayer anymore, only the address is used
+  QgsMapLayer* ml = static_cast<QgsMapLayer *>( layer );
+  if ( mEntries.contains( ml ) )
+  {
+    qDeleteAll( mEntries[ml].freeClones );
+    mEntries.remove( ml );
+  }
+}
+
+void QgsMapLayerCloneCache::drop( QgsMapLayer* layer )
+{
+  if ( !mEntries.contains( layer ) )
+    return;
+
+  // clones in use are deleted when they are released
+  qDeleteAll( mEntries[layer].freeClones );
+  mEntries.remove( layer );
+  disconnect( layer, 0, this, 0 );
+}
+
+QgsMapRendererJob::QgsMapRendererJob( QgsMapRenderer* source, const QColor& backgroundColor, bool antiAliasing, QObject* parent )
+    : QThread( parent )
+    , mRenderer( new QgsMapRenderer )
+    , mAntiAliasing( antiAliasing )
+    , mCancelled( 0 )
+{
+  // the destination crs has to be set before the extent, as changing it transforms the extent
+  mRenderer->setMapUnits( source->mapUnits() );
+  mRenderer->setDestinationCrs( source->destinationCrs() );
+  mRenderer->setProjectionsEnabled( source->hasCrsTransformEnabled() );
+  mRenderer->setOutputUnits( source->outputUnits() );
+  mRenderer->setOutputSize( source->outputSizeF(), source->outputDpi() );
+  mRenderer->setExtent( source->extent() );
+  mRenderer->rendererContext()->setDrawEditingInformation( source->rendererContext()->drawEditingInformation() );
+  if ( source->labelingEngine() )
+  {
+    mRenderer->setLabelingEngine( source->labelingEngine()->clone() );
+  }
+
+  // the job must not touch the layers of the registry, they may be changed or removed meanwhile.
+  // Layers which could not be cloned are skipped
+  QStringList layerSet;
+  foreach ( QString layerId, source->layerSet() )
+  {
+    QgsMapLayer* ml = QgsMapLayerRegistry::instance()->mapLayer( layerId );
+    QgsMapLayer* clone = ml ? QgsMapLayerCloneCache::instance()->acquire( ml ) : 0;
+    if ( clone )
+    {
+      mLayers << clone;
+      layerSet << layerId;
+    }
+  }
+  mRenderer->setLayers( mLayers );
+  mRenderer->setLayerSet( layerSet );
+
+  mImage = QImage( source->outputSize(), QImage::Format_ARGB32_Premultiplied );
+  mImage.fill( backgroundColor.rgba() );
+  mRenderedImage = mImage.copy();
+
+  connect( mRenderer, SIGNAL( layerDrawn() ), this, SLOT( publishImage() ), Qt::DirectConnection );
+}
+
+QgsMapRendererJob::~QgsMapRendererJob()
+{
+  stop();
+  wait();
+  delete mRenderer;
+  foreach ( QgsMapLayer* clone, mLayers )
+  {
+    QgsMapLayerCloneCache::instance()->release( clone );
+  }
+}
+
+bool QgsMapRendererJob::canRenderInBackground( QgsMapRenderer* source )
+{
+  foreach ( QString layerId, source->layerSet() )
+  {
+    QgsMapLayer* ml = QgsMapLayerRegistry::instance()->mapLayer( layerId );
+    if ( !ml )
+      continue;
+
+    if ( ml->type() == QgsMapLayer::VectorLayer )
+    {
+      QgsVectorLayer* vl = qobject_cast<QgsVectorLayer *>( ml );
+      // edits, memory features and joined layers are not part of the clone
+      if ( !vl || vl->isEditable() || vl->providerType() == "memory" || !vl->vectorJoins().isEmpty() )
+        return false;
+    }
+    else if ( ml->type() != QgsMapLayer::RasterLayer )
+    {
+      return false;
+    }
+
+    if ( !QgsMapRenderer::isLayerThreadSafe( ml ) )
+      return false;
+  }
+  return true;
+}
+
+void QgsMapRendererJob::run()
+{
+  if ( mCancelled || mImage.isNull() )
+    return;
+
+  QPainter painter( &mImage );
+  painter.setClipRect( mImage.rect() );
+  if ( mAntiAliasing )
+    painter.setRenderHint( QPainter::Antialiasing );
+
+  mRenderer->render( &painter );
+  painter.end();
+
+  publishImage();
+
+  QgsDebugMsg( QString( "Background rendering %1" ).arg( mCancelled ? "cancelled" : "finished" ) );
+}
+
+void QgsMapRendererJob::stop()
+{
+  mCancelled.fetchAndStoreOrdered( 1 );
+  mRenderer->rendererContext()->setRenderingStopped( true );
+}
+
+void QgsMapRendererJob::cancel()
+{
+  stop();
+}
+
+void QgsMapRendererJob::publishImage()
+{
+  if ( mCancelled )
+  {
+    // render() resets the stop flag when it starts
+    mRenderer->rendererContext()->setRenderingStopped( true );
+    return;
+  }
+
+  QImage image = mImage.copy();
+  QMutexLocker locker( &mImageMutex );
+  mRenderedImage = image;
+}
+
+QImage QgsMapRendererJob::renderedImage() const
+{
+  QMutexLocker locker( &mImageMutex );
+  return mRenderedImage;
+}
@@ -0,0 +1,145 @@
+/***************************************************************************
+  qgsmaprendererjob.h - background rendering of a map layer set
+  -------------------------------------------------------------------
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSMAPRENDERERJOB_H
+#define QGSMAPRENDERERJOB_H
+
+#include <QAtomicInt>
+#include <QColor>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QThread>
+
+class QgsMapLayer;
+class QgsMapRenderer;
+
+/** \ingroup core
+ * Renders a map layer set into an image on a background thread.
+ *
+ * The job takes a snapshot of a QgsMapRenderer when it is created: the settings
+ * (extent, output size, layer set and projection) are copied, clones of the layers
+ * (with their renderers, label settings and selection, see QgsMapLayerCloneCache)
+ * and a clone of the labeling engine are used. The source renderer and its layers
+ * may therefore be changed or deleted while the job is running. The image rendered so far can be fetched at any
+ * time with renderedImage() to display the map progressively.
+ *
+ * The job must be created on the main thread. Use canRenderInBackground() to check
+ * whether the layers of a renderer may be rendered by a job.
+ * \note added in 2.0
+ */
+class CORE_EXPORT QgsMapRendererJob : public QThread
+{
+    Q_OBJECT
+
+  public:
+    //! Constructor
+    QgsMapRendererJob( QgsMapRenderer* source, const QColor& backgroundColor, bool antiAliasing, QObject* parent = 0 );
+    ~QgsMapRendererJob();
+
+    //! Whether all layers of the renderer can be cloned and rendered from other than the main thread.
+    //! Layers being edited, memory layers, layers with joins and plugin layers can't.
+    static bool canRenderInBackground( QgsMapRenderer* source );
+
+    void run();
+
+    //! Ask the job to stop rendering as soon as possible. Does not block.
+    void stop();
+
+    //! Stop rendering. Does not block, use wait() to wait for the thread to finish.
+    //! @deprecated use stop()
+    void cancel();
+
+    //! Whether the job has been stopped or cancelled
+    bool isCancelled() const { return mCancelled != 0; }
+
+    //! Copy of the image rendered so far, updated after each layer
+    QImage renderedImage() const;
+
+    //! Renderer used by the job. Must not be modified while the job is running.
+    QgsMapRenderer* mapRenderer() { return mRenderer; }
+
+  private slots:
+    //! Copy the image rendered so far to the image returned by renderedImage().
+    //! Called from the rendering thread.
+    void publishImage();
+
+  private:
+    QgsMapRenderer* mRenderer;
+    //! clones of the layers of the source renderer, taken from QgsMapLayerCloneCache
+    QList<QgsMapLayer*> mLayers;
+    //! image being painted by the rendering thread
+    QImage mImage;
+    //! last published copy of mImage
+    QImage mRenderedImage;
+    //! protects mRenderedImage
+    mutable QMutex mImageMutex;
+    bool mAntiAliasing;
+    QAtomicInt mCancelled;
+};
+
+/** \ingroup core
+ * Clones of registry layers used by QgsMapRendererJob. Cloning a layer opens its data
+ * provider again, so a clone is kept and reused by the following jobs until the layer
+ * requests a repaint, is modified, changes its selection, data source or crs, or is
+ * deleted. Changes of a layer which should be visible in the next background render
+ * must therefore be followed by QgsMapLayer::triggerRepaint(), as with render caching.
+ *
+ * A clone is used by one job at a time, jobs running at once (e.g. a cancelled job
+ * which did not finish yet) get different clones. Must be used on the main thread.
+ * \note added in 2.0
+ * \note not available in python bindings
+ */
+class CORE_EXPORT QgsMapLayerCloneCache : public QObject
+{
+    Q_OBJECT
+
+  public:
+    static QgsMapLayerCloneCache* instance();
+    ~QgsMapLayerCloneCache();
+
+    //! Clone of the layer for the exclusive use of the caller until it is released,
+    //! 0 if the layer could not be cloned
+    QgsMapLayer* acquire( QgsMapLayer* layer );
+
+    //! Give the clone back, it is deleted if its layer was changed or deleted meanwhile
+    void release( QgsMapLayer* clone );
+
+  private slots:
+    //! drops the clones of the sending layer
+    void invalidate();
+    void layerDestroyed( QObject* layer );
+
+  private:
+    QgsMapLayerCloneCache();
+
+    //! delete the unused clones of the layer and forget it
+    void drop( QgsMapLayer* layer );
+
+    static QgsMapLayerCloneCache* mInstance;
+
+    struct Entry
+    {
+      //! identifies the state of the layer the clones were made from
+      int generation;
+      QList<QgsMapLayer*> freeClones;
+    };
+    //! clones by source layer
+    QHash<QgsMapLayer*, Entry> mEntries;
+    //! source layer and generation of the clones in use
+    QHash<QgsMapLayer*, QPair<QgsMapLayer*, int> > mBusyClones;
+    int mGeneration;
+};
+
+#endif
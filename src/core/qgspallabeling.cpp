@@ -2065,5 +2065,19 @@ QgsLabelingEngineInterface* QgsPalLabeling::clone()
   QgsPalLabeling* lbl = new QgsPalLabeling();
   lbl->mShowingAllLabels = mShowingAllLabels;
   lbl->mShowingCandidates = mShowingCandidates;
+  lbl->mCandPoint = mCandPoint;
+  lbl->mCandLine = mCandLine;
+  lbl->mCandPolygon = mCandPolygon;
+  lbl->mSearch = mSearch;
+  lbl->mSavedWithProject = mSavedWithProject;
   return lbl;
 }
+
+void QgsPalLabeling::takeResults( QgsPalLabeling* other )
+{
+  if ( !other || other == this )
+    return;
+
+  qSwap( mLabelSearchTree, other->mLabelSearchTree );
+  mCandidates.swap( other->mCandidates );
+}
@@ -325,6 +325,12 @@ class CORE_EXPORT QgsPalLabeling : public QgsLabelingEngineInterface
     //! called when passing engine among map renderers
     virtual QgsLabelingEngineInterface* clone();
 
+    //! take placed labels and candidates of other engine, e.g. of a clone used by a background job.
+    //! Labels of this engine are passed to the other engine.
+    //! @note added in 2.0
+    //! @note not available in python bindings
+    void takeResults( QgsPalLabeling* other );
+
     //! @note not available in python bindings
     void drawLabelCandidateRect( pal::LabelPosition* lp, QPainter* painter, const QgsMapToPixel* xform );
     //!drawLabel
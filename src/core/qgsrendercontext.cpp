@@ -23,11 +23,12 @@ QgsRenderContext::QgsRenderContext()
     mCoordTransform( 0 ),
     mDrawEditingInformation( true ),
     mForceVectorOutput( false ),
-    mRenderingStopped( false ),
+    mRenderingStopped( 0 ),
     mScaleFactor( 1.0 ),
     mRasterScaleFactor( 1.0 ),
     mRendererScale( 1.0 ),
-    mLabelingEngine( NULL )
+    mLabelingEngine( NULL ),
+    mSimplifyTolerance( 0.0 )
 {
 
 }
@@ -22,6 +22,8 @@
 #include "qgsmaptopixel.h"
 #include "qgsrectangle.h"
 
+#include <QAtomicInt>
+
 class QPainter;
 
 class QgsLabelingEngineInterface;
@@ -53,7 +55,7 @@ class CORE_EXPORT QgsRenderContext
 
     double rasterScaleFactor() const {return mRasterScaleFactor;}
 
-    bool renderingStopped() const {return mRenderingStopped;}
+    bool renderingStopped() const {return mRenderingStopped != 0;}
 
     bool forceVectorOutput() const {return mForceVectorOutput;}
 
@@ -64,6 +66,10 @@ class CORE_EXPORT QgsRenderContext
     //! Added in QGIS v1.4
     QgsLabelingEngineInterface* labelingEngine() const { return mLabelingEngine; }
 
+    //! Distance in painter units below which vertices are dropped when drawing. 0 disables simplification.
+    //! Added in QGIS v2.0
+    double simplifyTolerance() const { return mSimplifyTolerance; }
+
     //setters
 
     /**Sets coordinate transformation. QgsRenderContext does not take ownership*/
@@ -71,7 +77,7 @@ class CORE_EXPORT QgsRenderContext
     void setMapToPixel( const QgsMapToPixel& mtp ) {mMapToPixel = mtp;}
     void setExtent( const QgsRectangle& extent ) {mExtent = extent;}
     void setDrawEditingInformation( bool b ) {mDrawEditingInformation = b;}
-    void setRenderingStopped( bool stopped ) {mRenderingStopped = stopped;}
+    void setRenderingStopped( bool stopped ) {mRenderingStopped.fetchAndStoreOrdered( stopped );}
     void setScaleFactor( double factor ) {mScaleFactor = factor;}
     void setRasterScaleFactor( double factor ) {mRasterScaleFactor = factor;}
     void setRendererScale( double scale ) {mRendererScale = scale;}
@@ -80,6 +86,8 @@ class CORE_EXPORT QgsRenderContext
     void setForceVectorOutput( bool force ) {mForceVectorOutput = force;}
     //! Added in QGIS v1.4
     void setLabelingEngine( QgsLabelingEngineInterface* iface ) { mLabelingEngine = iface; }
+    //! Added in QGIS v2.0
+    void setSimplifyTolerance( double tolerance ) { mSimplifyTolerance = tolerance; }
 
   private:
 
@@ -99,8 +107,8 @@ class CORE_EXPORT QgsRenderContext
 
     QgsMapToPixel mMapToPixel;
 
-    /**True if the rendering has been canceled*/
-    bool mRenderingStopped;
+    /**True if the rendering has been canceled, may be set while layers are drawn in other threads*/
+    QAtomicInt mRenderingStopped;
 
     /**Factor to scale line widths and point marker sizes*/
     double mScaleFactor;
@@ -113,6 +121,9 @@ class CORE_EXPORT QgsRenderContext
 
     /**Labeling engine (can be NULL)*/
     QgsLabelingEngineInterface* mLabelingEngine;
+
+    /**Screen space simplification tolerance in painter units (0 = no simplification)*/
+    double mSimplifyTolerance;
 };
 
 #endif
@@ -0,0 +1,338 @@
+/***************************************************************************
+    qgssqlexpressioncompiler.cpp
+    ---------------------
+    begin                : November 2012
+    copyright            : (C) 2012 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgssqlexpressioncompiler.h"
+
+#include "qgslogger.h"
+
+#include <QRegExp>
+#include <QStringList>
+
+
+QgsSqlExpressionCompiler::QgsSqlExpressionCompiler( const QgsFields& fields, Flags flags )
+    : mFields( fields )
+    , mFlags( flags )
+{
+}
+
+QgsSqlExpressionCompiler::~QgsSqlExpressionCompiler()
+{
+}
+
+QgsSqlExpressionCompiler::Result QgsSqlExpressionCompiler::compile( QgsExpression* exp )
+{
+  mResult.clear();
+
+  if ( !exp || exp->hasParserError() || !exp->rootNode() )
+    return Fail;
+
+  Result res = compileNode( exp->rootNode(), mResult );
+  if ( res == Fail )
+    mResult.clear();
+
+  QgsDebugMsgLevel( QString( "compiled \"%1\" to \"%2\" (result %3)" ).arg( exp->expression() ).arg( mResult ).arg( res ), 3 );
+  return res;
+}
+
+QString QgsSqlExpressionCompiler::quotedIdentifier( const QString& identifier )
+{
+  QString quoted = identifier;
+  quoted.replace( "\"", "\"\"" );
+  return quoted.prepend( "\"" ).append( "\"" );
+}
+
+QString QgsSqlExpressionCompiler::quotedValue( const QVariant& value )
+{
+  if ( value.isNull() )
+    return "NULL";
+
+  switch ( value.type() )
+  {
+    case QVariant::Int:
+    case QVariant::LongLong:
+      return value.toString();
+
+    case QVariant::Double:
+      return QString::number( value.toDouble(), 'g', 17 );
+
+    default:
+    case QVariant::String:
+      QString quoted = value.toString();
+      quoted.replace( "'", "''" );
+      return quoted.prepend( "'" ).append( "'" );
+  }
+}
+
+QgsSqlExpressionCompiler::Result QgsSqlExpressionCompiler::compileNode( QgsExpression::Node* node, QString& result )
+{
+  if ( QgsExpression::NodeUnaryOperator* n = dynamic_cast<QgsExpression::NodeUnaryOperator*>( node ) )
+  {
+    if ( n->op() != QgsExpression::uoNot )
+      return Fail;
+
+    // negation of a superset is not a superset of the negation
+    QString operand;
+    if ( compileNode( n->operand(), operand ) != Complete )
+      return Fail;
+
+    result = "NOT (" + operand + ")";
+    return Complete;
+  }
+
+  if ( QgsExpression::NodeBinaryOperator* n = dynamic_cast<QgsExpression::NodeBinaryOperator*>( node ) )
+  {
+    if ( n->op() != QgsExpression::boAnd && n->op() != QgsExpression::boOr )
+      return compileComparison( n, result );
+
+    QString left, right;
+    Result lr = compileNode( n->opLeft(), left );
+    Result rr = compileNode( n->opRight(), right );
+
+    if ( n->op() == QgsExpression::boAnd )
+    {
+      if ( lr == Fail && rr == Fail )
+        return Fail;
+
+      // one part of AND is enough to restrict the features
+      if ( lr == Fail )
+      {
+        result = right;
+        return Partial;
+      }
+      if ( rr == Fail )
+      {
+        result = left;
+        return Partial;
+      }
+
+      result = "(" + left + ") AND (" + right + ")";
+      return lr == Complete && rr == Complete ? Complete : Partial;
+    }
+    else
+    {
+      if ( lr == Fail || rr == Fail )
+        return Fail;
+
+      result = "(" + left + ") OR (" + right + ")";
+      return lr == Complete && rr == Complete ? Complete : Partial;
+    }
+  }
+
+  if ( QgsExpression::NodeInOperator* n = dynamic_cast<QgsExpression::NodeInOperator*>( node ) )
+  {
+    return compileInList( n, result );
+  }
+
+  return Fail;
+}
+
+QgsSqlExpressionCompiler::Result QgsSqlExpressionCompiler::compileComparison( QgsExpression::NodeBinaryOperator* n, QString& result )
+{
+  QgsExpression::BinaryOperator op = n->op();
+  QgsExpression::Node* column = n->opLeft();
+  QgsExpression::NodeLiteral* literal = dynamic_cast<QgsExpression::NodeLiteral*>( n->opRight() );
+
+  // allow literal on the left side of comparisons
+  if ( !literal && op >= QgsExpression::boEQ && op <= QgsExpression::boGT )
+  {
+    column = n->opRight();
+    literal = dynamic_cast<QgsExpression::NodeLiteral*>( n->opLeft() );
+    switch ( op )
+    {
+      case QgsExpression::boLE: op = QgsExpression::boGE; break;
+      case QgsExpression::boGE: op = QgsExpression::boLE; break;
+      case QgsExpression::boLT: op = QgsExpression::boGT; break;
+      case QgsExpression::boGT: op = QgsExpression::boLT; break;
+      default: break;
+    }
+  }
+
+  int idx = fieldIndex( column );
+  if ( idx < 0 || !literal )
+    return Fail;
+
+  QVariant value = literal->value();
+  QString col = quotedIdentifier( mFields[idx].name() );
+
+  switch ( op )
+  {
+    case QgsExpression::boIs:
+    case QgsExpression::boIsNot:
+      if ( !value.isNull() )
+        return Fail;
+      result = col + ( op == QgsExpression::boIs ? " IS NULL" : " IS NOT NULL" );
+      return Complete;
+
+    case QgsExpression::boEQ:
+    case QgsExpression::boNE:
+    case QgsExpression::boLE:
+    case QgsExpression::boGE:
+    case QgsExpression::boLT:
+    case QgsExpression::boGT:
+    {
+      if ( !isComparable( idx, value ) )
+        return Fail;
+
+      Result res = Complete;
+      if ( isStringField( idx ) )
+      {
+        // ordering of strings depends on database collation
+        if ( op != QgsExpression::boEQ && op != QgsExpression::boNE )
+          return Fail;
+
+        if ( mFlags & CaseInsensitiveStringMatch )
+        {
+          if ( op == QgsExpression::boNE )
+            return Fail;
+          res = Partial;
+        }
+      }
+
+      result = QString( "%1 %2 %3" ).arg( col ).arg( QgsExpression::BinaryOperatorText[op] ).arg( quotedValue( value ) );
+      return res;
+    }
+
+    case QgsExpression::boLike:
+    case QgsExpression::boNotLike:
+    case QgsExpression::boILike:
+    case QgsExpression::boNotILike:
+    {
+      if ( !isStringField( idx ) || value.type() != QVariant::String )
+        return Fail;
+
+      // QgsExpression turns LIKE patterns into regular expressions,
+      // translate only patterns where the meaning is the same
+      QString pattern = value.toString();
+      if ( pattern.contains( QRegExp( "[\\\\^$.|?*+()\\[\\]{}]" ) ) )
+        return Fail;
+
+      bool caseInsensitive = op == QgsExpression::boILike || op == QgsExpression::boNotILike;
+      bool negated = op == QgsExpression::boNotLike || op == QgsExpression::boNotILike;
+
+      if ( !caseInsensitive )
+      {
+        if ( mFlags & LikeIsCaseInsensitive )
+        {
+          if ( negated )
+            return Fail;
+          result = col + " LIKE " + quotedValue( pattern );
+          return Partial;
+        }
+        result = col + ( negated ? " NOT LIKE " : " LIKE " ) + quotedValue( pattern );
+        return Complete;
+      }
+
+      if ( !( mFlags & NoNativeILike ) )
+      {
+        result = col + ( negated ? " NOT ILIKE " : " ILIKE " ) + quotedValue( pattern );
+        return Complete;
+      }
+
+      // case folding of the database may differ from Qt's
+      if ( negated )
+        return Fail;
+
+      if ( mFlags & LikeIsCaseInsensitive )
+        result = col + " LIKE " + quotedValue( pattern );
+      else
+        result = "UPPER(" + col + ") LIKE UPPER(" + quotedValue( pattern ) + ")";
+      return Partial;
+    }
+
+    default:
+      return Fail;
+  }
+}
+
+QgsSqlExpressionCompiler::Result QgsSqlExpressionCompiler::compileInList( QgsExpression::NodeInOperator* n, QString& result )
+{
+  int idx = fieldIndex( n->node() );
+  if ( idx < 0 )
+    return Fail;
+
+  Result res = Complete;
+  if ( isStringField( idx ) && ( mFlags & CaseInsensitiveStringMatch ) )
+  {
+    if ( n->isNotIn() )
+      return Fail;
+    res = Partial;
+  }
+
+  QStringList values;
+  foreach ( QgsExpression::Node* item, n->list()->list() )
+  {
+    QgsExpression::NodeLiteral* literal = dynamic_cast<QgsExpression::NodeLiteral*>( item );
+    if ( !literal || !isComparable( idx, literal->value() ) )
+      return Fail;
+
+    values << quotedValue( literal->value() );
+  }
+
+  if ( values.isEmpty() )
+    return Fail;
+
+  result = QString( "%1 %2 (%3)" ).arg( quotedIdentifier( mFields[idx].name() ) ).arg( n->isNotIn() ? "NOT IN" : "IN" ).arg( values.join( "," ) );
+  return res;
+}
+
+int QgsSqlExpressionCompiler::fieldIndex( QgsExpression::Node* node ) const
+{
+  QgsExpression::NodeColumnRef* ref = dynamic_cast<QgsExpression::NodeColumnRef*>( node );
+  if ( !ref )
+    return -1;
+
+  // same lookup as in NodeColumnRef::prepare()
+  for ( int i = 0; i < mFields.count(); ++i )
+  {
+    if ( QString::compare( mFields[i].name(), ref->name(), Qt::CaseInsensitive ) == 0 )
+      return i;
+  }
+  return -1;
+}
+
+bool QgsSqlExpressionCompiler::isStringField( int fieldIdx ) const
+{
+  return mFields[fieldIdx].type() == QVariant::String;
+}
+
+bool QgsSqlExpressionCompiler::isComparable( int fieldIdx, const QVariant& value ) const
+{
+  if ( value.isNull() )
+    return false;
+
+  switch ( mFields[fieldIdx].type() )
+  {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+    case QVariant::Double:
+      return value.type() == QVariant::Int || value.type() == QVariant::LongLong || value.type() == QVariant::Double;
+
+    case QVariant::String:
+    {
+      if ( !isStringField( fieldIdx ) || value.type() != QVariant::String )
+        return false;
+
+      // QgsExpression compares numerically if both values look like numbers.
+      // Empty strings are NULL in some databases.
+      QString str = value.toString();
+      bool isNumber;
+      str.toDouble( &isNumber );
+      return !isNumber && !str.isEmpty();
+    }
+
+    default:
+      return false;
+  }
+}
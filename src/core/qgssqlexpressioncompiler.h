@@ -0,0 +1,96 @@
+/***************************************************************************
+    qgssqlexpressioncompiler.h
+    ---------------------
+    begin                : November 2012
+    copyright            : (C) 2012 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSSQLEXPRESSIONCOMPILER_H
+#define QGSSQLEXPRESSIONCOMPILER_H
+
+#include <QFlags>
+#include <QString>
+#include <QVariant>
+
+#include "qgsexpression.h"
+#include "qgsfield.h"
+
+/** \ingroup core
+ * Translates QgsExpression to SQL WHERE clause for database providers.
+ *
+ * Only the parts of expression with the same meaning in SQL are translated:
+ * comparisons of columns with literals, IS [NOT] NULL, LIKE with simple patterns,
+ * IN lists and their combinations with AND, OR and NOT. If a part of
+ * an AND expression can't be translated, the result is Partial: the SQL
+ * returns more features than the expression and these have to be filtered
+ * by evaluating the expression on the client.
+ *
+ * Providers subclass the compiler to use their own quoting of identifiers and values.
+ *
+ * @note added in 2.0
+ */
+class CORE_EXPORT QgsSqlExpressionCompiler
+{
+  public:
+    enum Result
+    {
+      None,     //!< Nothing has been compiled yet
+      Complete, //!< Expression has been translated, SQL returns exactly the matching features
+      Partial,  //!< SQL returns a superset of the matching features
+      Fail      //!< Expression can't be translated
+    };
+
+    enum Flag
+    {
+      CaseInsensitiveStringMatch = 0x01, //!< Equality of strings ignores case (e.g. default collation of MSSQL)
+      LikeIsCaseInsensitive      = 0x02, //!< LIKE ignores case (e.g. SQLite)
+      NoNativeILike              = 0x04  //!< Database does not support ILIKE operator
+    };
+    Q_DECLARE_FLAGS( Flags, Flag )
+
+    //! @param fields fields of the provider, the expression has to be prepared with the same fields
+    QgsSqlExpressionCompiler( const QgsFields& fields, Flags flags = 0 );
+    virtual ~QgsSqlExpressionCompiler();
+
+    //! Translate the expression. The SQL is available from result() unless the compilation failed.
+    Result compile( QgsExpression* exp );
+
+    //! Returns the WHERE clause (without WHERE keyword) of the last compile() call
+    QString result() const { return mResult; }
+
+  protected:
+    //! Quote a column name. Default implementation uses double quotes.
+    virtual QString quotedIdentifier( const QString& identifier );
+    //! Quote a literal value. Default implementation uses single quotes for strings.
+    virtual QString quotedValue( const QVariant& value );
+    //! Whether the column is a character string in the database, i.e. it compares and matches
+    //! the same way as strings in QgsExpression. Default implementation checks the variant type,
+    //! providers which map other types (dates, booleans ...) to strings should check the type name.
+    virtual bool isStringField( int fieldIdx ) const;
+
+    Result compileNode( QgsExpression::Node* node, QString& result );
+
+    QgsFields mFields;
+
+  private:
+    Result compileComparison( QgsExpression::NodeBinaryOperator* op, QString& result );
+    Result compileInList( QgsExpression::NodeInOperator* op, QString& result );
+
+    //! index of field referenced by the node or -1 if the node is not a known column
+    int fieldIndex( QgsExpression::Node* node ) const;
+    //! whether the literal can be compared with the field the same way in SQL and in QgsExpression
+    bool isComparable( int fieldIdx, const QVariant& value ) const;
+
+    Flags mFlags;
+    QString mResult;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS( QgsSqlExpressionCompiler::Flags )
+
+#endif // QGSSQLEXPRESSIONCOMPILER_H
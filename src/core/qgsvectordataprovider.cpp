@@ -21,6 +21,7 @@
 
 #include "qgsvectordataprovider.h"
 #include "qgsfeature.h"
+#include "qgsfeatureblock.h"
 #include "qgsfeatureiterator.h"
 #include "qgsfeaturerequest.h"
 #include "qgsfield.h"
@@ -58,6 +59,16 @@ bool QgsVectorDataProvider::addFeatures( QgsFeatureList &flist )
   return false;
 }
 
+bool QgsVectorDataProvider::beginBulkInsert()
+{
+  return false;
+}
+
+bool QgsVectorDataProvider::endBulkInsert()
+{
+  return false;
+}
+
 bool QgsVectorDataProvider::deleteFeatures( const QgsFeatureIds &ids )
 {
   Q_UNUSED( ids );
@@ -195,6 +206,12 @@ QString QgsVectorDataProvider::capabilitiesString() const
     QgsDebugMsg( "Capability: Change Geometries" );
   }
 
+  if ( abilities & QgsVectorDataProvider::ThreadSafe )
+  {
+    abilitiesList += tr( "Thread Safe Reading" );
+    QgsDebugMsg( "Capability: Thread Safe Reading" );
+  }
+
   return abilitiesList.join( ", " );
 
 }
@@ -349,43 +366,65 @@ void QgsVectorDataProvider::fillMinMaxCache()
     }
   }
 
-  QgsFeature f;
   QgsAttributeList keys = mCacheMinValues.keys();
-  QgsFeatureIterator fi = getFeatures( QgsFeatureRequest().setSubsetOfAttributes( keys ) );
+  QgsFeatureIterator fi = getFeatures( QgsFeatureRequest().setFlags( QgsFeatureRequest::NoGeometry ).setSubsetOfAttributes( keys ) );
 
-  while ( fi.nextFeature( f ) )
+  // read the values by blocks and scan each column at once
+  QgsFeatureBlock block;
+  block.setColumns( flds, keys, false );
+
+  while ( fi.nextFeatureBlock( block, 1000 ) > 0 )
   {
-    const QgsAttributes& attrs = f.attributes();
-    for ( QgsAttributeList::const_iterator it = keys.begin(); it != keys.end(); ++it )
+    int count = block.count();
+    for ( int col = 0; col < block.columnCount(); ++col )
     {
-      const QVariant& varValue = attrs[*it];
+      int idx = block.attributeIndex( col );
 
-      if ( flds[*it].type() == QVariant::Int )
+      if ( flds[idx].type() == QVariant::Int )
       {
-        int value = varValue.toInt();
-        if ( value < mCacheMinValues[*it].toInt() )
-          mCacheMinValues[*it] = value;
-        if ( value > mCacheMaxValues[*it].toInt() )
-          mCacheMaxValues[*it] = value;
+        // NULL values are stored as zeros, the same as QVariant::toInt() gives
+        const qlonglong* values = block.intValues( col );
+        int minValue = mCacheMinValues[idx].toInt();
+        int maxValue = mCacheMaxValues[idx].toInt();
+        for ( int i = 0; i < count; ++i )
+        {
+          int value = ( int ) values[i];
+          if ( value < minValue )
+            minValue = value;
+          if ( value > maxValue )
+            maxValue = value;
+        }
+        mCacheMinValues[idx] = minValue;
+        mCacheMaxValues[idx] = maxValue;
       }
-      else if ( flds[*it].type() == QVariant::Double )
+      else if ( flds[idx].type() == QVariant::Double )
       {
-        double value = varValue.toDouble();
-        if ( value < mCacheMinValues[*it].toDouble() )
-          mCacheMinValues[*it] = value;
-        if ( value > mCacheMaxValues[*it].toDouble() )
-          mCacheMaxValues[*it] = value;
+        const double* values = block.doubleValues( col );
+        double minValue = mCacheMinValues[idx].toDouble();
+        double maxValue = mCacheMaxValues[idx].toDouble();
+        for ( int i = 0; i < count; ++i )
+        {
+          if ( values[i] < minValue )
+            minValue = values[i];
+          if ( values[i] > maxValue )
+            maxValue = values[i];
+        }
+        mCacheMinValues[idx] = minValue;
+        mCacheMaxValues[idx] = maxValue;
       }
       else
       {
-        QString value = varValue.toString();
-        if ( mCacheMinValues[*it].isNull() || value < mCacheMinValues[*it].toString() )
-        {
-          mCacheMinValues[*it] = value;
-        }
-        if ( mCacheMaxValues[*it].isNull() || value > mCacheMaxValues[*it].toString() )
+        for ( int i = 0; i < count; ++i )
         {
-          mCacheMaxValues[*it] = value;
+          QString value = block.columnType( col ) == QgsFeatureBlock::StringColumn ? block.stringValues( col )[i] : block.value( col, i ).toString();
+          if ( mCacheMinValues[idx].isNull() || value < mCacheMinValues[idx].toString() )
+          {
+            mCacheMinValues[idx] = value;
+          }
+          if ( mCacheMaxValues[idx].isNull() || value > mCacheMaxValues[idx].toString() )
+          {
+            mCacheMaxValues[idx] = value;
+          }
         }
       }
     }
@@ -86,6 +86,8 @@ class CORE_EXPORT QgsVectorDataProvider : public QgsDataProvider
       CreateAttributeIndex =         1 << 12,
       /** Uses mEncoding for conversion of 8-bit strings to unicode */
       SetEncoding =                  1 << 13,
+      /** features may be fetched from threads other than the main thread, e.g. by parallel rendering */
+      ThreadSafe =                   1 << 14,
     };
 
     /** bitmask of all provider's editing capabilities */
@@ -181,6 +183,23 @@ class CORE_EXPORT QgsVectorDataProvider : public QgsDataProvider
      */
     virtual bool addFeatures( QgsFeatureList &flist );
 
+    /**
+     * Starts loading of many features: following addFeatures() calls may use the fastest
+     * way of loading supported by the data source (e.g. COPY) and share a single transaction,
+     * feature ids of the added features need not be updated.
+     * Each addFeatures() call still succeeds or fails as a whole.
+     * @return true if the bulk insert mode is supported and has been started
+     * @note added in 2.0
+     */
+    virtual bool beginBulkInsert();
+
+    /**
+     * Ends loading started by beginBulkInsert() and commits the added features.
+     * @return true in case of success
+     * @note added in 2.0
+     */
+    virtual bool endBulkInsert();
+
     /**
      * Deletes one or more features
      * @param id list containing feature ids to delete
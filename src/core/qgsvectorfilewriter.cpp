@@ -44,6 +44,9 @@
 #include <cpl_error.h>
 #include <cpl_conv.h>
 
+// committing each feature separately is very slow with SQLite based drivers
+#define DEFAULT_TRANSACTION_SIZE 20000
+
 #if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 1800
 #define TO8(x)   (x).toUtf8().constData()
 #define TO8F(x)  (x).toUtf8().constData()
@@ -68,8 +71,11 @@ QgsVectorFileWriter::QgsVectorFileWriter(
     : mDS( NULL )
     , mLayer( NULL )
     , mGeom( NULL )
+    , mFeature( NULL )
     , mError( NoError )
     , mSymbologyExport( symbologyExport )
+    , mTransactionSize( DEFAULT_TRANSACTION_SIZE )
+    , mTransactionFeatures( 0 )
 {
   QString vectorFileName = theVectorFileName;
   QString fileEncoding = theFileEncoding;
@@ -438,6 +444,8 @@ bool QgsVectorFileWriter::addFeature( QgsFeature& feature, QgsFeatureRendererV2*
 {
   // create the feature
   OGRFeatureH poFeature = createFeature( feature );
+  if ( !poFeature )
+    return false;
 
   //add OGR feature style type
   if ( mSymbologyExport != NoSymbology && renderer )
@@ -494,13 +502,57 @@ bool QgsVectorFileWriter::addFeature( QgsFeature& feature, QgsFeatureRendererV2*
     }
   }
 
-  OGR_F_Destroy( poFeature );
+  return true;
+}
+
+bool QgsVectorFileWriter::addFeatures( QgsFeatureList& features, QgsFeatureRendererV2* renderer, QGis::UnitType outputUnit )
+{
+  bool ok = true;
+  for ( QgsFeatureList::iterator it = features.begin(); it != features.end(); ++it )
+  {
+    if ( !addFeature( *it, renderer, outputUnit ) )
+      ok = false;
+  }
+  return ok;
+}
+
+int QgsVectorFileWriter::transactionSize() const
+{
+  return mTransactionSize;
+}
+
+void QgsVectorFileWriter::setTransactionSize( int features )
+{
+  mTransactionSize = qMax( features, 0 );
+  if ( mTransactionFeatures >= mTransactionSize )
+    flush();
+}
+
+bool QgsVectorFileWriter::flush()
+{
+  if ( mTransactionFeatures == 0 )
+    return true;
+
+  mTransactionFeatures = 0;
+  if ( OGR_L_CommitTransaction( mLayer ) != OGRERR_NONE )
+  {
+    mErrorMessage = QObject::tr( "Commit of features failed (OGR error: %1)" ).arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
+    mError = ErrFeatureWriteFailed;
+    QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
+    return false;
+  }
   return true;
 }
 
 OGRFeatureH QgsVectorFileWriter::createFeature( QgsFeature& feature )
 {
-  OGRFeatureH poFeature = OGR_F_Create( OGR_L_GetLayerDefn( mLayer ) );
+  // the feature is reused: values of the previous feature have to be reset
+  if ( !mFeature )
+    mFeature = OGR_F_Create( OGR_L_GetLayerDefn( mLayer ) );
+
+  OGRFeatureH poFeature = mFeature;
+  OGR_F_SetFID( poFeature, OGRNullFID );
+  OGR_F_SetStyleString( poFeature, NULL );
 
   qint64 fid = FID_TO_NUMBER( feature.id() );
   if ( fid > std::numeric_limits<int>::max() )
@@ -529,7 +581,10 @@ OGRFeatureH QgsVectorFileWriter::createFeature( QgsFeature& feature )
     int ogrField = mAttrIdxToOgrIdx[ fldIdx ];
 
     if ( !attrValue.isValid() || attrValue.isNull() )
+    {
+      OGR_F_UnsetField( poFeature, ogrField );
       continue;
+    }
 
     switch ( attrValue.type() )
     {
@@ -544,6 +599,7 @@ OGRFeatureH QgsVectorFileWriter::createFeature( QgsFeature& feature )
         OGR_F_SetFieldString( poFeature, ogrField, mCodec->fromUnicode( attrValue.toString() ).data() );
         break;
       case QVariant::Invalid:
+        OGR_F_UnsetField( poFeature, ogrField );
         break;
       default:
         mErrorMessage = QObject::tr( "Invalid variant type for field %1[%2]: received %3 with type %4" )
@@ -587,7 +643,6 @@ OGRFeatureH QgsVectorFileWriter::createFeature( QgsFeature& feature )
                         .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
         mError = ErrFeatureWriteFailed;
         QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
-        OGR_F_Destroy( poFeature );
         return 0;
       }
 
@@ -598,7 +653,6 @@ OGRFeatureH QgsVectorFileWriter::createFeature( QgsFeature& feature )
                         .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
         mError = ErrFeatureWriteFailed;
         QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
-        OGR_F_Destroy( poFeature );
         return 0;
       }
 
@@ -614,32 +668,68 @@ OGRFeatureH QgsVectorFileWriter::createFeature( QgsFeature& feature )
                         .arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
         mError = ErrFeatureWriteFailed;
         QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
-        OGR_F_Destroy( poFeature );
         return 0;
       }
 
       // set geometry (ownership is not passed to OGR)
       OGR_F_SetGeometry( poFeature, mGeom );
     }
+    else
+    {
+      OGR_F_SetGeometry( poFeature, NULL );
+    }
   }
   return poFeature;
 }
 
 bool QgsVectorFileWriter::writeFeature( OGRLayerH layer, OGRFeatureH feature )
 {
-  if ( OGR_L_CreateFeature( layer, feature ) != OGRERR_NONE )
+  if ( mTransactionSize > 0 && mTransactionFeatures == 0 )
+  {
+    if ( OGR_L_StartTransaction( layer ) == OGRERR_NONE )
+    {
+      mTransactionFeatures = 1;
+    }
+    else
+    {
+      QgsDebugMsg( QString( "Transactions not supported (OGR error: %1)" ).arg( CPLGetLastErrorMsg() ) );
+      mTransactionSize = 0;
+    }
+  }
+  else if ( mTransactionFeatures > 0 )
+  {
+    mTransactionFeatures++;
+  }
+
+  // OGR sets the id of the created feature
+  long fid = OGR_F_GetFID( feature );
+  OGRErr err = OGR_L_CreateFeature( layer, feature );
+  OGR_F_SetFID( feature, fid );
+
+  // the features of a failed commit are lost
+  bool committed = true;
+  if ( mTransactionFeatures >= mTransactionSize && mTransactionFeatures > 0 )
+    committed = flush();
+
+  if ( err != OGRERR_NONE )
   {
     mErrorMessage = QObject::tr( "Feature creation error (OGR error: %1)" ).arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
     mError = ErrFeatureWriteFailed;
     QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
-    OGR_F_Destroy( feature );
     return false;
   }
-  return true;
+  return committed;
 }
 
 QgsVectorFileWriter::~QgsVectorFileWriter()
 {
+  flush();
+
+  if ( mFeature )
+  {
+    OGR_F_Destroy( mFeature );
+  }
+
   if ( mGeom )
   {
     OGR_G_DestroyGeometry( mGeom );
@@ -831,6 +921,21 @@ QgsVectorFileWriter::writeAsVectorFormat( QgsVectorLayer* layer,
   }
 
   writer->stopRender( layer );
+
+  // commit the remaining features before the writer is deleted, the commit may fail
+  if ( !writer->flush() )
+  {
+    if ( errorMessage )
+    {
+      if ( errorMessage->isEmpty() )
+      {
+        *errorMessage = QObject::tr( "Feature write errors:" );
+      }
+      *errorMessage += "\n" + writer->errorMessage();
+    }
+    errors++;
+  }
+
   delete writer;
 
   if ( shallTransform )
@@ -1343,7 +1448,6 @@ QgsVectorFileWriter::WriterError QgsVectorFileWriter::exportFeaturesSymbolLevels
             ++nErrors;
           }
         }
-        OGR_F_Destroy( ogrFeature );
       }
     }
   }
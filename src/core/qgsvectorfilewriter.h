@@ -138,6 +138,27 @@ class CORE_EXPORT QgsVectorFileWriter
     /** add feature to the currently opened shapefile */
     bool addFeature( QgsFeature& feature, QgsFeatureRendererV2* renderer = 0, QGis::UnitType outputUnit = QGis::Meters );
 
+    /** add features to the currently opened file
+     * @return true if all features were written
+     * @note added in 2.0
+     */
+    bool addFeatures( QgsFeatureList& features, QgsFeatureRendererV2* renderer = 0, QGis::UnitType outputUnit = QGis::Meters );
+
+    /** number of features written in one transaction of the data source (0 = no transactions)
+     * @note added in 2.0
+     */
+    int transactionSize() const;
+    /** set number of features written in one transaction, e.g. to speed up writing to
+     * SQLite based formats (0 disables transactions)
+     * @note added in 2.0
+     */
+    void setTransactionSize( int features );
+
+    /** commit the features written in the current transaction
+     * @note added in 2.0
+     */
+    bool flush();
+
     //! @note not available in python bindings
     QMap<int, int> attrIdxToOgrIdx() { return mAttrIdxToOgrIdx; }
 
@@ -163,6 +184,8 @@ class CORE_EXPORT QgsVectorFileWriter
     OGRDataSourceH mDS;
     OGRLayerH mLayer;
     OGRGeometryH mGeom;
+    /** OGR feature reused for all written features */
+    OGRFeatureH mFeature;
 
     QgsFields mFields;
 
@@ -187,9 +210,15 @@ class CORE_EXPORT QgsVectorFileWriter
     /**Scale for symbology export (e.g. for symbols units in map units)*/
     double mSymbologyScaleDenominator;
 
+    /** number of features in one transaction */
+    int mTransactionSize;
+    /** number of features written in the running transaction (0 if there's none) */
+    int mTransactionFeatures;
+
   private:
     static bool driverMetadata( QString driverName, QString &longName, QString &trLongName, QString &glob, QString &ext );
     void createSymbolLayerTable( QgsVectorLayer* vl,  const QgsCoordinateTransform* ct, OGRDataSourceH ds );
+    /** fill the reused OGR feature (owned by the writer) with the feature, returns 0 on error */
     OGRFeatureH createFeature( QgsFeature& feature );
     bool writeFeature( OGRLayerH layer, OGRFeatureH feature );
 
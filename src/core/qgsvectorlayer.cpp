@@ -30,6 +30,7 @@
 #include <QProgressDialog>
 #include <QSettings>
 #include <QString>
+#include <QThread>
 #include <QDomNode>
 
 #include "qgsvectorlayer.h"
@@ -729,6 +730,8 @@ void QgsVectorLayer::drawRendererV2( QgsFeatureIterator &fit, QgsRenderContext&
 
 #ifndef Q_WS_MAC
   int featureCount = 0;
+  // events and screen updates are only for the main thread, not for parallel rendering
+  bool mainThread = QThread::currentThread() == qApp->thread();
 #endif //Q_WS_MAC
 
   QgsFeature fet;
@@ -748,13 +751,13 @@ void QgsVectorLayer::drawRendererV2( QgsFeatureIterator &fit, QgsRenderContext&
       if ( !mEnableBackbuffer ) // do not handle events, as we're already inside a paint event
       {
 #endif // Q_WS_X11
-        if ( mUpdateThreshold > 0 && 0 == featureCount % mUpdateThreshold )
+        if ( mainThread && mUpdateThreshold > 0 && 0 == featureCount % mUpdateThreshold )
         {
           emit screenUpdateRequested();
           // emit drawingProgress( featureCount, totalFeatures );
           qApp->processEvents();
         }
-        else if ( featureCount % 1000 == 0 )
+        else if ( mainThread && featureCount % 1000 == 0 )
         {
           // emit drawingProgress( featureCount, totalFeatures );
           qApp->processEvents();
@@ -833,6 +836,8 @@ void QgsVectorLayer::drawRendererV2Levels( QgsFeatureIterator &fit, QgsRenderCon
   QgsFeature fet;
 #ifndef Q_WS_MAC
   int featureCount = 0;
+  // events are only processed on the main thread, not for parallel rendering
+  bool mainThread = QThread::currentThread() == qApp->thread();
 #endif //Q_WS_MAC
   while ( fit.nextFeature( fet ) )
   {
@@ -845,7 +850,7 @@ void QgsVectorLayer::drawRendererV2Levels( QgsFeatureIterator &fit, QgsRenderCon
       return;
     }
 #ifndef Q_WS_MAC
-    if ( featureCount % 1000 == 0 )
+    if ( mainThread && featureCount % 1000 == 0 )
     {
       qApp->processEvents();
     }
@@ -929,7 +934,7 @@ void QgsVectorLayer::drawRendererV2Levels( QgsFeatureIterator &fit, QgsRenderCon
           return;
         }
 #ifndef Q_WS_MAC
-        if ( featureCount % 1000 == 0 )
+        if ( mainThread && featureCount % 1000 == 0 )
         {
           qApp->processEvents();
         }
@@ -1007,9 +1012,16 @@ bool QgsVectorLayer::draw( QgsRenderContext& rendererContext )
     //register label and diagram layer to the labeling engine
     prepareLabelingAndDiagrams( rendererContext, attributes, labeling );
 
-    QgsFeatureIterator fit = getFeatures( QgsFeatureRequest()
-                                          .setFilterRect( rendererContext.extent() )
-                                          .setSubsetOfAttributes( attributes ) );
+    QgsFeatureRequest request = QgsFeatureRequest()
+                                .setFilterRect( rendererContext.extent() )
+                                .setSubsetOfAttributes( attributes );
+
+    // let the provider reduce geometries to the output resolution (layer units must be map units).
+    // Not while editing: vertex markers and cached geometries need full geometries.
+    if ( !mEditBuffer && !rendererContext.coordinateTransform() )
+      request.setGeometryResolution( rendererContext.mapToPixel().mapUnitsPerPixel() );
+
+    QgsFeatureIterator fit = getFeatures( request );
 
     if (( mRendererV2->capabilities() & QgsFeatureRendererV2::SymbolLevels )
         && mRendererV2->usingSymbolLevels() )
@@ -1051,6 +1063,10 @@ bool QgsVectorLayer::draw( QgsRenderContext& rendererContext )
 
     // int totalFeatures = pendingFeatureCount();
     int featureCount = 0;
+#ifndef Q_WS_MAC
+    // events and screen updates are only for the main thread, not for parallel rendering
+    bool mainThread = QThread::currentThread() == qApp->thread();
+#endif //Q_WS_MAC
     QgsFeature fet;
     QgsAttributeList attributes = mRenderer->classificationAttributes();
 
@@ -1073,13 +1089,13 @@ bool QgsVectorLayer::draw( QgsRenderContext& rendererContext )
         }
 
 #ifndef Q_WS_MAC //MH: disable this on Mac for now to avoid problems with resizing
-        if ( mUpdateThreshold > 0 && 0 == featureCount % mUpdateThreshold )
+        if ( mainThread && mUpdateThreshold > 0 && 0 == featureCount % mUpdateThreshold )
         {
           emit screenUpdateRequested();
           // emit drawingProgress( featureCount, totalFeatures );
           qApp->processEvents();
         }
-        else if ( featureCount % 1000 == 0 )
+        else if ( mainThread && featureCount % 1000 == 0 )
         {
           // emit drawingProgress( featureCount, totalFeatures );
           qApp->processEvents();
@@ -14,6 +14,8 @@
  ***************************************************************************/
 #include "qgsvectorlayerfeatureiterator.h"
 
+#include "qgsexpression.h"
+#include "qgsfeatureblock.h"
 #include "qgsmaplayerregistry.h"
 #include "qgsvectordataprovider.h"
 #include "qgsvectorlayer.h"
@@ -26,6 +28,9 @@ QgsVectorLayerFeatureIterator::QgsVectorLayerFeatureIterator( QgsVectorLayer* la
 
   QgsVectorLayerJoinBuffer* joinBuffer = L->mJoinBuffer;
 
+  if ( mRequest.filterType() == QgsFeatureRequest::FilterExpression )
+    prepareExpression();
+
   // prepare joins: may add more attributes to fetch (in order to allow join)
   if ( joinBuffer->containsJoins() )
     prepareJoins();
@@ -33,6 +38,14 @@ QgsVectorLayerFeatureIterator::QgsVectorLayerFeatureIterator( QgsVectorLayer* la
   // by default provider's request is the same
   mProviderRequest = mRequest;
 
+  if ( mProviderRequest.filterType() == QgsFeatureRequest::FilterExpression )
+  {
+    // provider would filter by the original attribute values, not the edited ones
+    QgsVectorLayerEditBuffer* editBuffer = L->editBuffer();
+    if ( editBuffer && ( !editBuffer->mChangedAttributeValues.isEmpty() || !editBuffer->mDeletedAttributeIds.isEmpty() ) )
+      mProviderRequest.setFilterExpression( QString() );
+  }
+
   if ( mProviderRequest.flags() & QgsFeatureRequest::SubsetOfAttributes )
   {
     // prepare list of attributes to match provider fields
@@ -50,7 +63,7 @@ QgsVectorLayerFeatureIterator::QgsVectorLayerFeatureIterator( QgsVectorLayer* la
   {
     mFetchedFid = false;
   }
-  else // no filter or filter by rect
+  else // no filter, filter by rect or by expression
   {
     mProviderIterator = L->dataProvider()->getFeatures( mProviderRequest );
 
@@ -67,6 +80,36 @@ QgsVectorLayerFeatureIterator::~QgsVectorLayerFeatureIterator()
 
 
 bool QgsVectorLayerFeatureIterator::nextFeature( QgsFeature& f )
+{
+  QgsExpression* filter = mRequest.filterExpression();
+
+  while ( fetchFeature( f ) )
+  {
+    // providers return only a superset of the matching features (if any filtering is done at all)
+    if ( !filter || filter->evaluate( &f ).toInt() != 0 )
+      return true;
+  }
+
+  return false;
+}
+
+
+int QgsVectorLayerFeatureIterator::nextFeatureBlock( QgsFeatureBlock& block, int maxFeatures )
+{
+  // features of the provider can be used as they are only without edits, joins and filtering done here
+  if ( mClosed || L->editBuffer() || !mFetchJoinInfo.isEmpty() ||
+       mRequest.filterType() == QgsFeatureRequest::FilterFid ||
+       mRequest.filterType() == QgsFeatureRequest::FilterExpression )
+    return QgsAbstractFeatureIterator::nextFeatureBlock( block, maxFeatures );
+
+  int count = mProviderIterator.nextFeatureBlock( block, maxFeatures );
+  if ( count == 0 )
+    close();
+  return count;
+}
+
+
+bool QgsVectorLayerFeatureIterator::fetchFeature( QgsFeature& f )
 {
   f.setValid( false );
 
@@ -284,6 +327,29 @@ void QgsVectorLayerFeatureIterator::rewindEditBuffer()
 
 
 
+void QgsVectorLayerFeatureIterator::prepareExpression()
+{
+  QgsExpression* exp = mRequest.filterExpression();
+  exp->prepare( L->pendingFields() );
+
+  // make sure that all attributes and geometry needed by the expression get fetched
+  if ( mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes )
+  {
+    QgsAttributeList subset = mRequest.subsetOfAttributes();
+    foreach ( const QString& column, exp->referencedColumns() )
+    {
+      int idx = L->fieldNameIndex( column );
+      if ( idx >= 0 && !subset.contains( idx ) )
+        subset << idx;
+    }
+    mRequest.setSubsetOfAttributes( subset );
+  }
+
+  if ( exp->needsGeometry() )
+    mRequest.setFlags( mRequest.flags() & ~QgsFeatureRequest::NoGeometry );
+}
+
+
 void QgsVectorLayerFeatureIterator::prepareJoins()
 {
   QgsAttributeList fetchAttributes = ( mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes ) ? mRequest.subsetOfAttributes() : L->pendingAllAttributesList();
@@ -34,6 +34,9 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
     //! fetch next feature, return true on success
     virtual bool nextFeature( QgsFeature& feature );
 
+    //! fetch a block of features directly from provider if the layer does not modify them
+    virtual int nextFeatureBlock( QgsFeatureBlock& block, int maxFeatures );
+
     //! reset the iterator to the starting position
     virtual bool rewind();
 
@@ -60,7 +63,11 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
 
     bool mFetchedFid; // when iterating by FID: indicator whether it has been fetched yet or not
 
+    //! fetch next feature without testing the filter expression
+    bool fetchFeature( QgsFeature& f );
+
     void rewindEditBuffer();
+    void prepareExpression();
     void prepareJoins();
     bool fetchNextAddedFeature( QgsFeature& f );
     bool fetchNextChangedGeomFeature( QgsFeature& f );
@@ -51,10 +51,21 @@ QgsVectorLayerImport::QgsVectorLayerImport( const QString &uri,
     const QMap<QString, QVariant> *options,
     QProgressDialog *progress )
     : mErrorCount( 0 )
+    , mBatchSize( FEATURE_BUFFER_SIZE )
+    , mBulkInsert( false )
+    , mBulkInsertCount( 0 )
     , mProgress( progress )
 {
   mProvider = NULL;
 
+  if ( options && options->contains( "batchSize" ) )
+  {
+    bool ok;
+    int batchSize = options->value( "batchSize" ).toInt( &ok );
+    if ( ok && batchSize > 0 )
+      mBatchSize = batchSize;
+  }
+
   QgsProviderRegistry * pReg = QgsProviderRegistry::instance();
 
   QLibrary *myLib = pReg->providerLibrary( providerKey );
@@ -111,11 +122,18 @@ QgsVectorLayerImport::QgsVectorLayerImport( const QString &uri,
 
   mProvider = vectorProvider;
   mError = NoError;
+
+  // load all features in a single transaction using the fastest way of the provider
+  mBulkInsert = mProvider->beginBulkInsert();
 }
 
 QgsVectorLayerImport::~QgsVectorLayerImport()
 {
   flushBuffer();
+  if ( !endBulkInsert() )
+  {
+    QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "Vector import" ) );
+  }
 
   if ( mProvider )
     delete mProvider;
@@ -155,7 +173,7 @@ bool QgsVectorLayerImport::addFeature( QgsFeature& feat )
 
   mFeatureBuffer.append( newFeat );
 
-  if ( mFeatureBuffer.count() >= FEATURE_BUFFER_SIZE )
+  if ( mFeatureBuffer.count() >= mBatchSize )
   {
     return flushBuffer();
   }
@@ -186,12 +204,43 @@ bool QgsVectorLayerImport::flushBuffer()
     return false;
   }
 
+  if ( mBulkInsert )
+    mBulkInsertCount += mFeatureBuffer.count();
+
   mFeatureBuffer.clear();
   return true;
 }
 
+bool QgsVectorLayerImport::endBulkInsert()
+{
+  if ( !mBulkInsert )
+    return true;
+
+  mBulkInsert = false;
+  if ( !mProvider->endBulkInsert() )
+  {
+    QStringList errors = mProvider->errors();
+    mProvider->clearErrors();
+
+    mErrorMessage = QObject::tr( "Committing of the imported features failed. Provider errors was: \n%1" )
+                    .arg( errors.join( "\n" ) );
+    mError = ErrFeatureWriteFailed;
+    // none of the features added within the transaction was written
+    mErrorCount += mBulkInsertCount;
+    mBulkInsertCount = 0;
+    QgsDebugMsg( mErrorMessage );
+    return false;
+  }
+
+  return true;
+}
+
 bool QgsVectorLayerImport::createSpatialIndex()
 {
+  // the index is built faster when all features are already committed
+  if ( !endBulkInsert() )
+    return false;
+
   if ( mProvider && ( mProvider->capabilities() & QgsVectorDataProvider::CreateSpatialIndex ) != 0 )
   {
     return mProvider->createSpatialIndex();
@@ -413,6 +462,15 @@ QgsVectorLayerImport::importLayer( QgsVectorLayer* layer,
       *errorMessage += "\n" + writer->errorMessage();
     }
   }
+
+  // commit the features before counting the errors, the commit may fail
+  if ( !writer->endBulkInsert() )
+  {
+    if ( errorMessage )
+    {
+      *errorMessage += "\n" + writer->errorMessage();
+    }
+  }
   int errors = writer->errorCount();
 
   if ( !writer->createSpatialIndex() )
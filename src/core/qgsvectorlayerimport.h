@@ -65,7 +65,10 @@ class CORE_EXPORT QgsVectorLayerImport
                                     QProgressDialog *progress = 0
                                   );
 
-    /** create a empty layer and add fields to it */
+    /** create a empty layer and add fields to it.
+     * Option "batchSize" sets the number of features passed to the provider at once (default 200),
+     * the features are loaded in a single transaction if the provider supports it.
+     */
     QgsVectorLayerImport( const QString &uri,
                           const QString &provider,
                           const QgsFields &fields,
@@ -94,6 +97,9 @@ class CORE_EXPORT QgsVectorLayerImport
     /** flush the buffer writing the features to the new layer */
     bool flushBuffer();
 
+    /** commit features loaded in bulk insert mode of the provider */
+    bool endBulkInsert();
+
     /** create index */
     bool createSpatialIndex();
 
@@ -110,6 +116,12 @@ class CORE_EXPORT QgsVectorLayerImport
     int mAttributeCount;
 
     QgsFeatureList mFeatureBuffer;
+    /** number of features passed to the provider at once */
+    int mBatchSize;
+    /** whether the provider loads the features in bulk insert mode */
+    bool mBulkInsert;
+    /** number of features added to the provider since beginBulkInsert() */
+    int mBulkInsertCount;
     QProgressDialog *mProgress;
 };
 
@@ -18,6 +18,7 @@
 #include "qgsmultibandcolorrenderer.h"
 #include "qgscontrastenhancement.h"
 #include "qgsrastertransparency.h"
+#include "qgsrasterrowconverter.h"
 #include "qgsrasterviewport.h"
 #include <QDomDocument>
 #include <QDomElement>
@@ -132,11 +133,6 @@ QgsRasterBlock* QgsMultiBandColorRenderer::block( int bandNo, QgsRectangle  cons
     return outputBlock;
   }
 
-  //In some (common) cases, we can simplify the drawing loop considerably and save render time
-  bool fastDraw = ( !usesTransparency()
-                    && mRedBand > 0 && mGreenBand > 0 && mBlueBand > 0
-                    && mAlphaBand < 1 && !mRedContrastEnhancement && !mGreenContrastEnhancement && !mBlueContrastEnhancement );
-
   QSet<int> bands;
   if ( mRedBand > 0 )
   {
@@ -183,11 +179,7 @@ QgsRasterBlock* QgsMultiBandColorRenderer::block( int bandNo, QgsRectangle  cons
     {
       // We should free the alloced mem from block().
       QgsDebugMsg( "No input band" );
-      bandIt--;
-      for ( ; bandIt != bands.constBegin(); bandIt-- )
-      {
-        delete bandBlocks[*bandIt];
-      }
+      qDeleteAll( bandBlocks );
       return outputBlock;
     }
   }
@@ -211,108 +203,126 @@ QgsRasterBlock* QgsMultiBandColorRenderer::block( int bandNo, QgsRectangle  cons
 
   if ( !outputBlock->reset( QGis::ARGB32_Premultiplied, width, height ) )
   {
-    for ( int i = 0; i < bandBlocks.size(); i++ )
-    {
-      delete bandBlocks.value( i );
-    }
+    qDeleteAll( bandBlocks );
     return outputBlock;
   }
 
   QRgb myDefaultColor = NODATA_COLOR;
 
-  for ( size_t i = 0; i < ( size_t )width*height; i++ )
-  {
-    if ( fastDraw ) //fast rendering if no transparency, stretching, color inversion, etc.
-    {
-      int redVal = ( int )redBlock->value( i );
-      int greenVal = ( int )greenBlock->value( i );
-      int blueVal = ( int )blueBlock->value( i );
-      if ( redBlock->isNoDataValue( redVal ) ||
-           greenBlock->isNoDataValue( greenVal ) ||
-           blueBlock->isNoDataValue( blueVal ) )
-      {
-        outputBlock->setColor( i, myDefaultColor );
-      }
-      else
-      {
-        outputBlock->setColor( i, qRgba( redVal, greenVal, blueVal, 255 ) );
-      }
-      continue;
-    }
+  // rows are converted by loops specialized for the data type, the contrast
+  // enhancement, displayable range and no data tests are applied there
+  QgsRasterRowConverter* redConverter = redBlock ? new QgsRasterRowConverter( redBlock, width, height, mRedContrastEnhancement ) : 0;
+  QgsRasterRowConverter* greenConverter = greenBlock ? new QgsRasterRowConverter( greenBlock, width, height, mGreenContrastEnhancement ) : 0;
+  QgsRasterRowConverter* blueConverter = blueBlock ? new QgsRasterRowConverter( blueBlock, width, height, mBlueContrastEnhancement ) : 0;
+  QgsRasterRowConverter* alphaConverter = alphaBlock ? new QgsRasterRowConverter( alphaBlock, width, height, 0 ) : 0;
 
-    bool isNoData = false;
-    double redVal = 0;
-    double greenVal = 0;
-    double blueVal = 0;
-    if ( mRedBand > 0 )
-    {
-      redVal = redBlock->value( i );
-      if ( redBlock->isNoDataValue( redVal ) ) isNoData = true;
-    }
-    if ( !isNoData && mGreenBand > 0 )
+  // missing bands have value 0
+  QVector<int> redRow( width, 0 );
+  QVector<int> greenRow( width, 0 );
+  QVector<int> blueRow( width, 0 );
+  QVector<double> alphaRow( alphaConverter ? width : 0 );
+
+  // transparency is tested with stretched values, values of bands without enhancement are used as they are
+  QVector<double> redValues( mRasterTransparency && redConverter && !mRedContrastEnhancement ? width : 0 );
+  QVector<double> greenValues( mRasterTransparency && greenConverter && !mGreenContrastEnhancement ? width : 0 );
+  QVector<double> blueValues( mRasterTransparency && blueConverter && !mBlueContrastEnhancement ? width : 0 );
+
+  //In some (common) cases, we can simplify the drawing loop considerably and save render time
+  bool opaque = !mRasterTransparency && !alphaConverter && doubleNear( mOpacity, 1.0 );
+  QRgb* outputData = ( QRgb* ) outputBlock->bits(( size_t )0 );
+
+  for ( int row = 0; row < height; row++ )
+  {
+    if ( redConverter )
     {
-      greenVal = greenBlock->value( i );
-      if ( greenBlock->isNoDataValue( greenVal ) ) isNoData = true;
+      redConverter->components( row, redRow.data() );
     }
-    if ( !isNoData && mBlueBand > 0 )
+    if ( greenConverter )
     {
-      blueVal = ( int )blueBlock->value( i );
-      if ( blueBlock->isNoDataValue( blueVal ) ) isNoData = true;
+      greenConverter->components( row, greenRow.data() );
     }
-    if ( isNoData )
+    if ( blueConverter )
     {
-      outputBlock->setColor( i, myDefaultColor );
-      continue;
+      blueConverter->components( row, blueRow.data() );
     }
+    QRgb* outputRow = outputData + ( size_t )row * width;
 
-    //apply default color if red, green or blue not in displayable range
-    if (( mRedContrastEnhancement && !mRedContrastEnhancement->isValueInDisplayableRange( redVal ) )
-        || ( mGreenContrastEnhancement && !mGreenContrastEnhancement->isValueInDisplayableRange( redVal ) )
-        || ( mBlueContrastEnhancement && !mBlueContrastEnhancement->isValueInDisplayableRange( redVal ) ) )
+    if ( opaque )
     {
-      outputBlock->setColor( i, myDefaultColor );
+      for ( int col = 0; col < width; col++ )
+      {
+        int redVal = redRow[col];
+        int greenVal = greenRow[col];
+        int blueVal = blueRow[col];
+        if ( redVal == QgsRasterRowConverter::NoData || greenVal == QgsRasterRowConverter::NoData || blueVal == QgsRasterRowConverter::NoData )
+        {
+          outputRow[col] = myDefaultColor;
+        }
+        else
+        {
+          outputRow[col] = qRgba( redVal, greenVal, blueVal, 255 );
+        }
+      }
       continue;
     }
 
-    //stretch color values
-    if ( mRedContrastEnhancement )
-    {
-      redVal = mRedContrastEnhancement->enhanceContrast( redVal );
-    }
-    if ( mGreenContrastEnhancement )
+    if ( !redValues.isEmpty() )
     {
-      greenVal = mGreenContrastEnhancement->enhanceContrast( greenVal );
+      redConverter->values( row, redValues.data() );
     }
-    if ( mBlueContrastEnhancement )
+    if ( !greenValues.isEmpty() )
     {
-      blueVal = mBlueContrastEnhancement->enhanceContrast( blueVal );
+      greenConverter->values( row, greenValues.data() );
     }
-
-    //opacity
-    double currentOpacity = mOpacity;
-    if ( mRasterTransparency )
+    if ( !blueValues.isEmpty() )
     {
-      currentOpacity = mRasterTransparency->alphaValue( redVal, greenVal, blueVal, mOpacity * 255 ) / 255.0;
+      blueConverter->values( row, blueValues.data() );
     }
-    if ( mAlphaBand > 0 )
+    if ( alphaConverter )
     {
-      currentOpacity *= alphaBlock->value( i ) / 255.0;
+      alphaConverter->values( row, alphaRow.data() );
     }
 
-    if ( doubleNear( currentOpacity, 1.0 ) )
+    for ( int col = 0; col < width; col++ )
     {
-      outputBlock->setColor( i, qRgba( redVal, greenVal, blueVal, 255 ) );
-    }
-    else
-    {
-      outputBlock->setColor( i, qRgba( currentOpacity * redVal, currentOpacity * greenVal, currentOpacity * blueVal, currentOpacity * 255 ) );
+      int redVal = redRow[col];
+      int greenVal = greenRow[col];
+      int blueVal = blueRow[col];
+      if ( redVal == QgsRasterRowConverter::NoData || greenVal == QgsRasterRowConverter::NoData || blueVal == QgsRasterRowConverter::NoData )
+      {
+        outputRow[col] = myDefaultColor;
+        continue;
+      }
+
+      //opacity
+      double currentOpacity = mOpacity;
+      if ( mRasterTransparency )
+      {
+        currentOpacity = mRasterTransparency->alphaValue( redValues.isEmpty() ? redVal : redValues[col],
+                         greenValues.isEmpty() ? greenVal : greenValues[col],
+                         blueValues.isEmpty() ? blueVal : blueValues[col], mOpacity * 255 ) / 255.0;
+      }
+      if ( alphaConverter )
+      {
+        currentOpacity *= alphaRow[col] / 255.0;
+      }
+
+      if ( doubleNear( currentOpacity, 1.0 ) )
+      {
+        outputRow[col] = qRgba( redVal, greenVal, blueVal, 255 );
+      }
+      else
+      {
+        outputRow[col] = qRgba( currentOpacity * redVal, currentOpacity * greenVal, currentOpacity * blueVal, currentOpacity * 255 );
+      }
     }
   }
 
-  for ( int i = 0; i < bandBlocks.size(); i++ )
-  {
-    delete bandBlocks.value( i );
-  }
+  delete redConverter;
+  delete greenConverter;
+  delete blueConverter;
+  delete alphaConverter;
+  qDeleteAll( bandBlocks );
 
   return outputBlock;
 }
@@ -0,0 +1,92 @@
+/***************************************************************************
+    qgsrasterblockcache.cpp
+    ---------------------
+    begin                : May 2013
+    copyright            : (C) 2013 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsrasterblockcache.h"
+#include "qgslogger.h"
+
+#include <QMutexLocker>
+#include <QSettings>
+#include <QStringList>
+
+// default maximum size of the cache in kilobytes
+#define RASTER_BLOCK_CACHE_SIZE 131072
+
+//! protects creation of the singleton
+static QMutex sInstanceMutex;
+
+QgsRasterBlockCache* QgsRasterBlockCache::mInstance = 0;
+
+QgsRasterBlockCache* QgsRasterBlockCache::instance()
+{
+  QMutexLocker locker( &sInstanceMutex );
+  if ( !mInstance )
+  {
+    mInstance = new QgsRasterBlockCache();
+  }
+  return mInstance;
+}
+
+QgsRasterBlockCache::QgsRasterBlockCache()
+{
+  QSettings settings;
+  mBlocks.setMaxCost( settings.value( "/Raster/blockCacheSize", RASTER_BLOCK_CACHE_SIZE ).toInt() );
+}
+
+QString QgsRasterBlockCache::key( const QString& source, int bandNo, int dataType, int level, int xBlock, int yBlock )
+{
+  // the source is the last part, it may contain the separator
+  return QString( "%1:%2:%3:%4:%5:" ).arg( bandNo ).arg( dataType ).arg( level ).arg( xBlock ).arg( yBlock ) + source;
+}
+
+bool QgsRasterBlockCache::block( const QString& source, int bandNo, int dataType, int level, int xBlock, int yBlock, QByteArray& data )
+{
+  QMutexLocker locker( &mMutex );
+  QByteArray* cached = mBlocks.object( key( source, bandNo, dataType, level, xBlock, yBlock ) );
+  if ( !cached )
+  {
+    return false;
+  }
+  data = *cached;
+  return true;
+}
+
+void QgsRasterBlockCache::insert( const QString& source, int bandNo, int dataType, int level, int xBlock, int yBlock, const QByteArray& data )
+{
+  QMutexLocker locker( &mMutex );
+  mBlocks.insert( key( source, bandNo, dataType, level, xBlock, yBlock ), new QByteArray( data ), qMax( 1, data.size() / 1024 ) );
+}
+
+void QgsRasterBlockCache::remove( const QString& source )
+{
+  QMutexLocker locker( &mMutex );
+  foreach ( const QString& k, mBlocks.keys() )
+  {
+    if ( k.section( ':', 5 ) == source )
+    {
+      mBlocks.remove( k );
+    }
+  }
+  QgsDebugMsg( QString( "%1 blocks remain in cache" ).arg( mBlocks.count() ) );
+}
+
+void QgsRasterBlockCache::setMaxSize( int kiloBytes )
+{
+  QMutexLocker locker( &mMutex );
+  mBlocks.setMaxCost( kiloBytes );
+}
+
+int QgsRasterBlockCache::maxSize()
+{
+  QMutexLocker locker( &mMutex );
+  return mBlocks.maxCost();
+}
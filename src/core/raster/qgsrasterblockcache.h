@@ -0,0 +1,72 @@
+/***************************************************************************
+    qgsrasterblockcache.h
+    ---------------------
+    begin                : May 2013
+    copyright            : (C) 2013 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSRASTERBLOCKCACHE_H
+#define QGSRASTERBLOCKCACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+#include <QString>
+
+/** \ingroup core
+ * Process wide cache of decoded blocks of raster data sources. Blocks are identified
+ * by the data source, band, data type, overview level and block position (in units
+ * of the block size of the source). Providers reading the same data source, e.g. layers
+ * with the same file or clones of a provider, share the blocks. The size of the cache
+ * is limited, least recently used blocks are removed first.
+ *
+ * The cache may be used from several threads.
+ * @note added in 2.0
+ * @note not available in python bindings
+ */
+class CORE_EXPORT QgsRasterBlockCache
+{
+  public:
+    static QgsRasterBlockCache* instance();
+
+    /** Get a block from the cache
+     *  @param source identification of the data source, it should change if the source is modified
+     *  @param bandNo band number
+     *  @param dataType data type the block was read with
+     *  @param level overview level, 0 for full resolution
+     *  @param xBlock block column
+     *  @param yBlock block row
+     *  @param data set to data of the block if found
+     *  @return true if the block was found */
+    bool block( const QString& source, int bandNo, int dataType, int level, int xBlock, int yBlock, QByteArray& data );
+
+    /** Add a block to the cache, parameters as in block() */
+    void insert( const QString& source, int bandNo, int dataType, int level, int xBlock, int yBlock, const QByteArray& data );
+
+    /** Remove all blocks of a data source, e.g. after it was modified */
+    void remove( const QString& source );
+
+    /** Set maximum size of the cache in kilobytes */
+    void setMaxSize( int kiloBytes );
+    int maxSize();
+
+  private:
+    QgsRasterBlockCache();
+
+    static QString key( const QString& source, int bandNo, int dataType, int level, int xBlock, int yBlock );
+
+    static QgsRasterBlockCache* mInstance;
+
+    /** Blocks with the size in kilobytes as cost */
+    QCache<QString, QByteArray> mBlocks;
+    /** Protects mBlocks, the cache is used from several threads */
+    QMutex mMutex;
+};
+
+#endif // QGSRASTERBLOCKCACHE_H
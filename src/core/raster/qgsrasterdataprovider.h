@@ -279,6 +279,12 @@ class CORE_EXPORT QgsRasterDataProvider : public QgsDataProvider, public QgsRast
     /** Get list of user no data value ranges */
     virtual  QList<QgsRasterBlock::Range> userNoDataValue( int bandNo ) const { return mUserNoDataValue.value( bandNo -1 ); }
 
+    /** Copy settings made on the provider (DPI, use of source no data value and
+     *  user no data values) from another provider of the same data source, e.g. to a clone
+     *  @note added in 2.0
+     *  @note not available in python bindings */
+    void copyBaseSettings( const QgsRasterDataProvider& other );
+
     virtual double minimumValue( int bandNo ) const { Q_UNUSED( bandNo ); return 0; }
     virtual double maximumValue( int bandNo ) const { Q_UNUSED( bandNo ); return 0; }
 
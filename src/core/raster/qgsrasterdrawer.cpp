@@ -18,12 +18,80 @@
 #include "qgslogger.h"
 #include "qgsrasterdrawer.h"
 #include "qgsrasteriterator.h"
+#include "qgsrasterpipe.h"
 #include "qgsrasterviewport.h"
 #include "qgsmaptopixel.h"
 #include <QImage>
 #include <QPainter>
+#include <QThread>
+#include <QtConcurrentMap>
 
-QgsRasterDrawer::QgsRasterDrawer( QgsRasterIterator* iterator ): mIterator( iterator )
+// minimum height of parts read in parallel
+#define PARALLEL_PART_MIN_HEIGHT 64
+
+// part of the raster read by a worker
+struct QgsRasterDrawerPart
+{
+  QgsRectangle extent;
+  int nCols;
+  int nRows;
+  int topLeftCol;
+  int topLeftRow;
+  QImage image;
+};
+
+// clone of the pipe with the parts it reads
+struct QgsRasterDrawerWorker
+{
+  QgsRasterPipe* pipe;
+  QgsRasterDrawerPart* parts;
+  QList<int> partIndexes;
+};
+
+//! runs on a worker thread
+static void readWorkerParts( QgsRasterDrawerWorker& worker )
+{
+  foreach ( int i, worker.partIndexes )
+  {
+    QgsRasterDrawerPart& part = worker.parts[i];
+    // last pipe filter has only 1 band
+    QgsRasterBlock* block = worker.pipe->last()->block( 1, part.extent, part.nCols, part.nRows );
+    if ( !block )
+    {
+      QgsDebugMsg( "Cannot get block" );
+      continue;
+    }
+    part.image = block->image();
+    delete block;
+  }
+}
+
+//! updates a clone of a previous draw to the pipe, returns false if it cannot be reused
+static bool updateClone( QgsRasterPipe* clone, const QgsRasterPipe* pipe )
+{
+  if ( clone->size() != pipe->size() || !clone->provider() || clone->at( 0 ) != clone->provider()
+       || pipe->at( 0 ) != pipe->provider() )
+  {
+    return false;
+  }
+
+  // the provider keeps the opened data source, the other interfaces are cheap to clone again
+  clone->provider()->copyBaseSettings( *pipe->provider() );
+  clone->provider()->setOn( pipe->provider()->on() );
+  for ( int i = 1; i < pipe->size(); i++ )
+  {
+    QgsRasterInterface* interface = pipe->at( i )->clone();
+    interface->setOn( pipe->at( i )->on() );
+    if ( !clone->replace( i, interface ) )
+    {
+      delete interface;
+      return false;
+    }
+  }
+  return true;
+}
+
+QgsRasterDrawer::QgsRasterDrawer( QgsRasterIterator* iterator ): mIterator( iterator ), mPipe( 0 ), mClones( 0 )
 {
 }
 
@@ -39,6 +107,11 @@ void QgsRasterDrawer::draw( QPainter* p, QgsRasterViewPort* viewPort, const QgsM
     return;
   }
 
+  if ( drawParallel( p, viewPort ) )
+  {
+    return;
+  }
+
   // last pipe filter has only 1 band
   int bandNumber = 1;
   mIterator->startRasterRead( bandNumber, viewPort->drawableAreaXDim, viewPort->drawableAreaYDim, viewPort->mDrawnExtent );
@@ -81,6 +154,93 @@ void QgsRasterDrawer::draw( QPainter* p, QgsRasterViewPort* viewPort, const QgsM
   }
 }
 
+bool QgsRasterDrawer::drawParallel( QPainter* p, QgsRasterViewPort* viewPort )
+{
+  int threadCount = QThread::idealThreadCount();
+  if ( !mPipe || mPipe->size() == 0 || mPipe->last() != mIterator->input() || threadCount < 2
+       || !mPipe->provider() || !( mPipe->provider()->capabilities() & QgsRasterInterface::ParallelRead ) )
+  {
+    return false;
+  }
+
+  // split the view into strips so that each thread gets at least two of them
+  int partHeight = qMax( PARALLEL_PART_MIN_HEIGHT, ( viewPort->drawableAreaYDim + 2 * threadCount - 1 ) / ( 2 * threadCount ) );
+  int maximumTileHeight = mIterator->maximumTileHeight();
+  mIterator->setMaximumTileHeight( qMin( maximumTileHeight, partHeight ) );
+
+  int bandNumber = 1;
+  mIterator->startRasterRead( bandNumber, viewPort->drawableAreaXDim, viewPort->drawableAreaYDim, viewPort->mDrawnExtent );
+
+  QVector<QgsRasterDrawerPart> parts;
+  QgsRasterDrawerPart part;
+  while ( mIterator->nextRasterPart( bandNumber, part.nCols, part.nRows, part.extent, part.topLeftCol, part.topLeftRow ) )
+  {
+    parts.append( part );
+  }
+  mIterator->stopRasterRead( bandNumber );
+  mIterator->setMaximumTileHeight( maximumTileHeight );
+
+  if ( parts.isEmpty() )
+  {
+    return true;
+  }
+
+  // each worker reads with its own clone of the pipe, the clones are created or updated
+  // here because the interfaces of the pipe may only be used on this thread
+  QList<QgsRasterPipe*> drawClones;
+  QList<QgsRasterPipe*>* clones = mClones ? mClones : &drawClones;
+  int workerCount = qMin( threadCount, parts.size() );
+  QList<QgsRasterDrawerWorker> workers;
+  for ( int i = 0; i < workerCount; i++ )
+  {
+    QgsRasterPipe* clone = i < clones->size() ? clones->at( i ) : 0;
+    if ( clone && !updateClone( clone, mPipe ) )
+    {
+      QgsDebugMsg( "clone of the pipe cannot be updated" );
+      delete clone;
+      clone = 0;
+    }
+    if ( !clone )
+    {
+      clone = new QgsRasterPipe( *mPipe );
+      if ( i < clones->size() )
+      {
+        ( *clones )[i] = clone;
+      }
+      else
+      {
+        clones->append( clone );
+      }
+    }
+
+    QgsRasterDrawerWorker worker;
+    worker.pipe = clone;
+    worker.parts = parts.data();
+    workers.append( worker );
+  }
+  for ( int i = 0; i < parts.size(); i++ )
+  {
+    workers[i % workerCount].partIndexes.append( i );
+  }
+
+  // blocking map runs also on the calling thread, it cannot wait for a thread pool
+  // occupied by layers rendered in parallel
+  QtConcurrent::blockingMap( workers, readWorkerParts );
+
+  qDeleteAll( drawClones );
+
+  // draw in the order of the iterator
+  for ( int i = 0; i < parts.size(); i++ )
+  {
+    if ( parts[i].image.isNull() )
+    {
+      continue;
+    }
+    drawImage( p, viewPort, parts[i].image, parts[i].topLeftCol, parts[i].topLeftRow );
+  }
+  return true;
+}
+
 void QgsRasterDrawer::drawImage( QPainter* p, QgsRasterViewPort* viewPort, const QImage& img, int topLeftCol, int topLeftRow ) const
 {
   if ( !p || !viewPort )
@@ -19,6 +19,7 @@
 #define QGSRASTERDRAWER_H
 
 #include "qgsrasterinterface.h"
+#include <QList>
 #include <QMap>
 
 class QPainter;
@@ -26,6 +27,7 @@ class QImage;
 class QgsMapToPixel;
 struct QgsRasterViewPort;
 class QgsRasterIterator;
+class QgsRasterPipe;
 
 /** \ingroup core
  * The drawing pipe for raster layers.
@@ -38,6 +40,16 @@ class QgsRasterDrawer
 
     void draw( QPainter* p, QgsRasterViewPort* viewPort, const QgsMapToPixel* theQgsMapToPixel );
 
+    /** Set the pipe which ends with the input of the iterator. If the provider of the pipe
+     *  supports QgsRasterInterface::ParallelRead, the parts of the raster are read from
+     *  clones of the pipe on the thread pool and drawn in order afterwards.
+     *  @param pipe the pipe
+     *  @param clones clones of the pipe kept by the caller between draws, missing ones are
+     *  added and the others are updated to the pipe; the caller deletes them. If 0, the
+     *  clones are only created for the draw
+     *  @note added in 2.0 */
+    void setPipe( const QgsRasterPipe* pipe, QList<QgsRasterPipe*>* clones = 0 ) { mPipe = pipe; mClones = clones; }
+
   protected:
     /**Draws raster part
       @param p the painter to draw to
@@ -47,8 +59,14 @@ class QgsRasterDrawer
       @param topLeftRow Top position relative to top border of viewport*/
     void drawImage( QPainter* p, QgsRasterViewPort* viewPort, const QImage& img, int topLeftCol, int topLeftRow ) const;
 
+    /** Read parts of the raster from clones of the pipe in parallel and draw them in order
+     *  @return false if parallel reading is not possible */
+    bool drawParallel( QPainter* p, QgsRasterViewPort* viewPort );
+
   private:
     QgsRasterIterator* mIterator;
+    const QgsRasterPipe* mPipe;
+    QList<QgsRasterPipe*>* mClones;
 };
 
 #endif // QGSRASTERDRAWER_H
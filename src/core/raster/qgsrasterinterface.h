@@ -55,7 +55,8 @@ class CORE_EXPORT QgsRasterInterface
       IdentifyValue =           1 << 9,
       IdentifyText =            1 << 10,
       IdentifyHtml =            1 << 11,
-      IdentifyFeature =         1 << 12  // WMS GML -> feature
+      IdentifyFeature =         1 << 12, // WMS GML -> feature
+      ParallelRead =            1 << 13  // may be read from other than the main thread, clones also in parallel
     };
 
 
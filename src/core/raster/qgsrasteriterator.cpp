@@ -57,6 +57,25 @@ bool QgsRasterIterator::readNextRasterPart( int bandNumber,
 {
   QgsDebugMsg( "Entered" );
   *block = 0;
+
+  QgsRectangle blockRect;
+  if ( !nextRasterPart( bandNumber, nCols, nRows, blockRect, topLeftCol, topLeftRow ) )
+  {
+    return false;
+  }
+
+  RasterPartInfo& pInfo = mRasterPartInfos[bandNumber];
+  pInfo.block = mInput->block( bandNumber, blockRect, nCols, nRows );
+
+  *block = pInfo.block;
+  return true;
+}
+
+bool QgsRasterIterator::nextRasterPart( int bandNumber,
+                                        int& nCols, int& nRows,
+                                        QgsRectangle& blockExtent,
+                                        int& topLeftCol, int& topLeftRow )
+{
   //get partinfo
   QMap<int, RasterPartInfo>::iterator partIt = mRasterPartInfos.find( bandNumber );
   if ( partIt == mRasterPartInfos.end() )
@@ -96,11 +115,8 @@ bool QgsRasterIterator::readNextRasterPart( int bandNumber,
   double xmax = viewPortExtent.xMinimum() + ( pInfo.currentCol + nCols ) / ( double )pInfo.nCols * viewPortExtent.width();
   double ymin = viewPortExtent.yMaximum() - ( pInfo.currentRow + nRows ) / ( double )pInfo.nRows * viewPortExtent.height();
   double ymax = viewPortExtent.yMaximum() - pInfo.currentRow / ( double )pInfo.nRows * viewPortExtent.height();
-  QgsRectangle blockRect( xmin, ymin, xmax, ymax );
+  blockExtent = QgsRectangle( xmin, ymin, xmax, ymax );
 
-  pInfo.block = mInput->block( bandNumber, blockRect, nCols, nRows );
-
-  *block = pInfo.block;
   topLeftCol = pInfo.currentCol;
   topLeftRow = pInfo.currentRow;
 
@@ -65,6 +65,21 @@ class CORE_EXPORT QgsRasterIterator
                              QgsRasterBlock **block,
                              int& topLeftCol, int& topLeftRow );
 
+    /**Moves to the next part of raster data without reading it. Parts returned by this
+       method are independent, they may be read from clones of the input in parallel.
+       @param bandNumber band to read
+       @param nCols number of columns on output device
+       @param nRows number of rows on output device
+       @param blockExtent extent of the part
+       @param topLeftCol top left column
+       @param topLeftRow top left row
+       @return false if the last part was already returned
+       @note added in 2.0 */
+    bool nextRasterPart( int bandNumber,
+                         int& nCols, int& nRows,
+                         QgsRectangle& blockExtent,
+                         int& topLeftCol, int& topLeftRow );
+
     void stopRasterRead( int bandNumber );
 
     const QgsRasterInterface* input() const { return mInput; }
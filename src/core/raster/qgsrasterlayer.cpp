@@ -194,6 +194,7 @@ QgsRasterLayer::~QgsRasterLayer()
 {
   mValid = false;
   // Note: provider and other interfaces are owned and deleted by pipe
+  clearParallelPipes();
 }
 
 //////////////////////////////////////////////////////////
@@ -631,6 +632,8 @@ void QgsRasterLayer::reload()
   {
     mDataProvider->reloadData();
   }
+  // the clones read the data source as it was when they were created
+  clearParallelPipes();
 }
 
 bool QgsRasterLayer::draw( QgsRenderContext& rendererContext )
@@ -826,6 +829,11 @@ void QgsRasterLayer::draw( QPainter * theQPainter,
   // Drawer to pipe?
   QgsRasterIterator iterator( mPipe.last() );
   QgsRasterDrawer drawer( &iterator );
+  QSettings settings;
+  if ( settings.value( "/qgis/parallel_rendering", false ).toBool() )
+  {
+    drawer.setPipe( &mPipe, &mParallelPipes );
+  }
   drawer.draw( theQPainter, theRasterViewPort, theQgsMapToPixel );
 
   QgsDebugMsg( QString( "total raster draw time (ms):     %1" ).arg( time.elapsed(), 5 ) );
@@ -1521,6 +1529,7 @@ void QgsRasterLayer::setDataProvider( QString const & provider )
 
   mPipe.remove( mDataProvider ); // deletes if exists
   mDataProvider = 0;
+  clearParallelPipes();
 
   // XXX should I check for and possibly delete any pre-existing providers?
   // XXX How often will that scenario occur?
@@ -1756,6 +1765,13 @@ void QgsRasterLayer::closeDataProvider()
   mPipe.remove( mDataProvider );
   mDataProvider = 0;
   mContrastEnhancementList.clear();
+  clearParallelPipes();
+}
+
+void QgsRasterLayer::clearParallelPipes()
+{
+  qDeleteAll( mParallelPipes );
+  mParallelPipes.clear();
 }
 
 void QgsRasterLayer::setContrastEnhancementAlgorithm( QgsContrastEnhancement::ContrastEnhancementAlgorithm theAlgorithm, bool theGenerateLookupTableFlag )
@@ -617,6 +617,9 @@ class CORE_EXPORT QgsRasterLayer : public QgsMapLayer
     //
     // Private methods
     //
+    /** Delete the clones of the pipe read in parallel, e.g. when the data source changes */
+    void clearParallelPipes();
+
     /** \brief Drawing routine for color type data  */
     void drawSingleBandColorData( QPainter * theQPainter,
                                   QgsRasterViewPort * theRasterViewPort,
@@ -796,6 +799,10 @@ class CORE_EXPORT QgsRasterLayer : public QgsMapLayer
     //QgsRasterRenderer* mRenderer;
     //QgsRasterResampleFilter *mResampleFilter;
     QgsRasterPipe mPipe;
+
+    /** Clones of mPipe read by the threads of QgsRasterDrawer, they are kept between
+     *  draws so that the data source is not opened again for each draw */
+    QList<QgsRasterPipe*> mParallelPipes;
 };
 
 #endif
@@ -32,6 +32,7 @@ QgsRasterPipe::QgsRasterPipe( const QgsRasterPipe& thePipe )
   {
     QgsRasterInterface* interface = thePipe.at( i );
     QgsRasterInterface* clone = interface->clone();
+    clone->setOn( interface->on() );
 
     Role role = interfaceRole( clone );
     QgsDebugMsg( QString( "cloned inerface with role %1" ).arg( role ) );
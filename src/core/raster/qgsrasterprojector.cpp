@@ -20,6 +20,20 @@
 #include "qgsrasterprojector.h"
 #include "qgscoordinatetransform.h"
 
+#include <limits>
+
+// copy pixels of a type to destination from source pixel indexes
+template <typename T>
+static void copyPixels( const char *theSrc, char *theDest, const int *theSrcIndexes, size_t theCount )
+{
+  const T *mySrc = ( const T * )theSrc;
+  T *myDest = ( T * )theDest;
+  for ( size_t i = 0; i < theCount; ++i )
+  {
+    myDest[i] = mySrc[theSrcIndexes[i]];
+  }
+}
+
 QgsRasterProjector::QgsRasterProjector(
   QgsCoordinateReferenceSystem theSrcCRS,
   QgsCoordinateReferenceSystem theDestCRS,
@@ -36,6 +50,7 @@ QgsRasterProjector::QgsRasterProjector(
     , mDestRows( theDestRows ), mDestCols( theDestCols )
     , pHelperTop( 0 ), pHelperBottom( 0 )
     , mMaxSrcXRes( theMaxSrcXRes ), mMaxSrcYRes( theMaxSrcYRes )
+    , mSrcIndexesDestRows( 0 ), mSrcIndexesDestCols( 0 ), mSrcIndexesInput( 0 )
 {
   QgsDebugMsg( "Entered" );
   QgsDebugMsg( "theDestExtent = " + theDestExtent.toString() );
@@ -55,6 +70,7 @@ QgsRasterProjector::QgsRasterProjector(
     , mExtent( theExtent )
     , pHelperTop( 0 ), pHelperBottom( 0 )
     , mMaxSrcXRes( theMaxSrcXRes ), mMaxSrcYRes( theMaxSrcYRes )
+    , mSrcIndexesDestRows( 0 ), mSrcIndexesDestCols( 0 ), mSrcIndexesInput( 0 )
 {
   QgsDebugMsg( "Entered" );
 }
@@ -62,12 +78,15 @@ QgsRasterProjector::QgsRasterProjector(
 QgsRasterProjector::QgsRasterProjector()
     : QgsRasterInterface( 0 )
     , pHelperTop( 0 ), pHelperBottom( 0 )
+    , mSrcIndexesDestRows( 0 ), mSrcIndexesDestCols( 0 ), mSrcIndexesInput( 0 )
 {
   QgsDebugMsg( "Entered" );
 }
 
 QgsRasterProjector::QgsRasterProjector( const QgsRasterProjector &projector )
     : QgsRasterInterface( 0 )
+    , pHelperTop( 0 ), pHelperBottom( 0 )
+    , mSrcIndexesDestRows( 0 ), mSrcIndexesDestCols( 0 ), mSrcIndexesInput( 0 )
 {
   mSrcCRS = projector.mSrcCRS;
   mDestCRS = projector.mDestCRS;
@@ -89,6 +108,8 @@ QgsRasterProjector & QgsRasterProjector::operator=( const QgsRasterProjector & p
     mExtent = projector.mExtent;
     mCoordinateTransform.setSourceCrs( mSrcCRS );
     mCoordinateTransform.setDestCRS( mDestCRS );
+    mSrcIndexes.clear();
+    mNoSrcPixels.clear();
   }
   return *this;
 }
@@ -238,14 +259,23 @@ void QgsRasterProjector::calcSrcExtent()
   // the maximum y may be in the middle of destination extent
   // TODO: How to find extent exactly and quickly?
   // For now, we runt through all matrix
-  QgsPoint myPoint = mCPMatrix[0][0];
-  mSrcExtent = QgsRectangle( myPoint.x(), myPoint.y(), myPoint.x(), myPoint.y() );
+  // Points which could not be transformed must not be used, not even the first one
+  bool myFirst = true;
+  mSrcExtent = QgsRectangle();
   for ( int i = 0; i < mCPRows; i++ )
   {
     for ( int j = 0; j < mCPCols ; j++ )
     {
-      myPoint = mCPMatrix[i][j];
-      if ( mCPLegalMatrix[i][j] )
+      QgsPoint myPoint = mCPMatrix[i][j];
+      if ( !mCPLegalMatrix[i][j] )
+        continue;
+
+      if ( myFirst )
+      {
+        mSrcExtent = QgsRectangle( myPoint.x(), myPoint.y(), myPoint.x(), myPoint.y() );
+        myFirst = false;
+      }
+      else
       {
         mSrcExtent.combineExtentWith( myPoint.x(), myPoint.y() );
       }
@@ -532,6 +562,155 @@ void QgsRasterProjector::approximateSrcRowCol( int theDestRow, int theDestCol, i
   Q_ASSERT( *theSrcCol < mSrcCols );
 }
 
+inline int QgsRasterProjector::srcIndex( int theSrcRow, int theSrcCol ) const
+{
+  // For now silently correct limits to avoid crashes, see preciseSrcRowCol()
+  if ( theSrcRow >= mSrcRows )
+    theSrcRow = mSrcRows - 1;
+  if ( theSrcRow < 0 )
+    theSrcRow = 0;
+  if ( theSrcCol >= mSrcCols )
+    theSrcCol = mSrcCols - 1;
+  if ( theSrcCol < 0 )
+    theSrcCol = 0;
+  return theSrcRow * mSrcCols + theSrcCol;
+}
+
+void QgsRasterProjector::preciseRowSrcIndexes( int theDestRow, int *theSrcIndexes )
+{
+  QVector<double> x( mDestCols );
+  QVector<double> y( mDestCols );
+  double myDestY = mDestExtent.yMaximum() - ( theDestRow + 0.5 ) * mDestYRes;
+  for ( int myDestCol = 0; myDestCol < mDestCols; myDestCol++ )
+  {
+    x[myDestCol] = mDestExtent.xMinimum() + ( myDestCol + 0.5 ) * mDestXRes;
+    y[myDestCol] = myDestY;
+  }
+
+  try
+  {
+    mCoordinateTransform.transformInPlace( x.data(), y.data(), 0, mDestCols );
+  }
+  catch ( QgsCsException &e )
+  {
+    Q_UNUSED( e );
+    // transform the points one by one, the failing ones are marked below
+    for ( int myDestCol = 0; myDestCol < mDestCols; myDestCol++ )
+    {
+      double myX = mDestExtent.xMinimum() + ( myDestCol + 0.5 ) * mDestXRes;
+      double myY = myDestY;
+      double myZ = 0;
+      try
+      {
+        mCoordinateTransform.transformInPlace( myX, myY, myZ );
+      }
+      catch ( QgsCsException &cse )
+      {
+        Q_UNUSED( cse );
+        myX = myY = std::numeric_limits<double>::quiet_NaN();
+      }
+      x[myDestCol] = myX;
+      y[myDestCol] = myY;
+    }
+  }
+
+  double mySrcYMax = mSrcExtent.yMaximum();
+  double mySrcXMin = mSrcExtent.xMinimum();
+  for ( int myDestCol = 0; myDestCol < mDestCols; myDestCol++ )
+  {
+    // with more than one point proj does not fail on points it cannot transform,
+    // but sets them to HUGE_VAL
+    if ( !qIsFinite( x[myDestCol] ) || !qIsFinite( y[myDestCol] ) )
+    {
+      theSrcIndexes[myDestCol] = 0;
+      mNoSrcPixels.append( theDestRow * mDestCols + myDestCol );
+      continue;
+    }
+
+    int mySrcRow = ( int ) floor(( mySrcYMax - y[myDestCol] ) / mSrcYRes );
+    int mySrcCol = ( int ) floor(( x[myDestCol] - mySrcXMin ) / mSrcXRes );
+    theSrcIndexes[myDestCol] = srcIndex( mySrcRow, mySrcCol );
+  }
+}
+
+void QgsRasterProjector::approximateRowSrcIndexes( int theDestRow, int *theSrcIndexes )
+{
+  int myMatrixRow = matrixRow( theDestRow );
+
+  if ( myMatrixRow > mHelperTopRow )
+  {
+    nextHelper();
+  }
+
+  // the interpolation factor between the helper rows is the same for the whole row
+  double myDestY = mDestExtent.yMaximum() - ( theDestRow + 0.5 ) * mDestYRes;
+  double myDestXMin, myDestYMin, myDestXMax, myDestYMax;
+  destPointOnCPMatrix( myMatrixRow + 1, 0, &myDestXMin, &myDestYMin );
+  destPointOnCPMatrix( myMatrixRow, 1, &myDestXMax, &myDestYMax );
+  double yfrac = ( myDestY - myDestYMin ) / ( myDestYMax - myDestYMin );
+
+  double mySrcYMax = mSrcExtent.yMaximum();
+  double mySrcXMin = mSrcExtent.xMinimum();
+  const QgsPoint *myTop = pHelperTop;
+  const QgsPoint *myBot = pHelperBottom;
+  for ( int myDestCol = 0; myDestCol < mDestCols; myDestCol++ )
+  {
+    double tx = myTop[myDestCol].x();
+    double ty = myTop[myDestCol].y();
+    double bx = myBot[myDestCol].x();
+    double by = myBot[myDestCol].y();
+    double mySrcX = bx + ( tx - bx ) * yfrac;
+    double mySrcY = by + ( ty - by ) * yfrac;
+
+    int mySrcRow = ( int ) floor(( mySrcYMax - mySrcY ) / mSrcYRes );
+    int mySrcCol = ( int ) floor(( mySrcX - mySrcXMin ) / mSrcXRes );
+    theSrcIndexes[myDestCol] = srcIndex( mySrcRow, mySrcCol );
+  }
+}
+
+void QgsRasterProjector::calcSrcIndexes( const QgsRectangle & theDestExtent, int theDestRows, int theDestCols )
+{
+  if ( !mSrcIndexes.isEmpty()
+       && mSrcIndexesInput == srcInput()
+       && mSrcIndexesDestRows == theDestRows && mSrcIndexesDestCols == theDestCols
+       && mSrcIndexesDestExtent == theDestExtent
+       && mSrcIndexesSrcCRS == mSrcCRS && mSrcIndexesDestCRS == mDestCRS )
+  {
+    QgsDebugMsg( "Using source indexes of previous block" );
+    return;
+  }
+
+  mSrcIndexes.clear();
+  mNoSrcPixels.clear();
+  mDestExtent = theDestExtent;
+  mDestRows = theDestRows;
+  mDestCols = theDestCols;
+  calc();
+
+  // If we zoom out too much, projector srcRows / srcCols maybe 0, which can cause problems in providers
+  if ( mSrcRows <= 0 || mSrcCols <= 0 )
+  {
+    return;
+  }
+
+  mSrcIndexes.resize( mDestRows * mDestCols );
+  for ( int myDestRow = 0; myDestRow < mDestRows; myDestRow++ )
+  {
+    int *myRowIndexes = mSrcIndexes.data() + myDestRow * mDestCols;
+    if ( mApproximate )
+      approximateRowSrcIndexes( myDestRow, myRowIndexes );
+    else
+      preciseRowSrcIndexes( myDestRow, myRowIndexes );
+  }
+
+  mSrcIndexesInput = srcInput();
+  mSrcIndexesDestExtent = theDestExtent;
+  mSrcIndexesDestRows = theDestRows;
+  mSrcIndexesDestCols = theDestCols;
+  mSrcIndexesSrcCRS = mSrcCRS;
+  mSrcIndexesDestCRS = mDestCRS;
+}
+
 void QgsRasterProjector::insertRows()
 {
   for ( int r = 0; r < mCPRows - 1; r++ )
@@ -588,16 +767,42 @@ void QgsRasterProjector::calcCP( int theRow, int theCol )
   {
     Q_UNUSED( e );
     // Caught an error in transform
-    mCPLegalMatrix[theRow][theCol] = true;
+    mCPLegalMatrix[theRow][theCol] = false;
   }
 }
 
 bool QgsRasterProjector::calcRow( int theRow )
 {
   QgsDebugMsgLevel( QString( "theRow = %1" ).arg( theRow ), 3 );
+
+  // transform the whole row with a single call, fall back to single points
+  // only if proj reports an error. With more than one point proj does not
+  // report points it cannot transform, but sets them to HUGE_VAL
+  QVector<double> x( mCPCols );
+  QVector<double> y( mCPCols );
+  for ( int i = 0; i < mCPCols; i++ )
+  {
+    destPointOnCPMatrix( theRow, i, &x[i], &y[i] );
+  }
+
+  try
+  {
+    mCoordinateTransform.transformInPlace( x.data(), y.data(), 0, mCPCols );
+  }
+  catch ( QgsCsException &e )
+  {
+    Q_UNUSED( e );
+    for ( int i = 0; i < mCPCols; i++ )
+    {
+      calcCP( theRow, i );
+    }
+    return true;
+  }
+
   for ( int i = 0; i < mCPCols; i++ )
   {
-    calcCP( theRow, i );
+    mCPMatrix[theRow][i] = QgsPoint( x[i], y[i] );
+    mCPLegalMatrix[theRow][i] = qIsFinite( x[i] ) && qIsFinite( y[i] );
   }
 
   return true;
@@ -606,9 +811,32 @@ bool QgsRasterProjector::calcRow( int theRow )
 bool QgsRasterProjector::calcCol( int theCol )
 {
   QgsDebugMsgLevel( QString( "theCol = %1" ).arg( theCol ), 3 );
+
+  QVector<double> x( mCPRows );
+  QVector<double> y( mCPRows );
+  for ( int i = 0; i < mCPRows; i++ )
+  {
+    destPointOnCPMatrix( i, theCol, &x[i], &y[i] );
+  }
+
+  try
+  {
+    mCoordinateTransform.transformInPlace( x.data(), y.data(), 0, mCPRows );
+  }
+  catch ( QgsCsException &e )
+  {
+    Q_UNUSED( e );
+    for ( int i = 0; i < mCPRows; i++ )
+    {
+      calcCP( i, theCol );
+    }
+    return true;
+  }
+
   for ( int i = 0; i < mCPRows; i++ )
   {
-    calcCP( i, theCol );
+    mCPMatrix[i][theCol] = QgsPoint( x[i], y[i] );
+    mCPLegalMatrix[i][theCol] = qIsFinite( x[i] ) && qIsFinite( y[i] );
   }
 
   return true;
@@ -712,16 +940,14 @@ QgsRasterBlock * QgsRasterProjector::block( int bandNo, QgsRectangle  const & ex
     return mInput->block( bandNo, extent, width, height );
   }
 
-  mDestExtent = extent;
-  mDestRows = height;
-  mDestCols = width;
-  calc();
+  // the matrix and the source indexes are calculated only once for all bands
+  calcSrcIndexes( extent, height, width );
 
   QgsDebugMsg( QString( "srcExtent:\n%1" ).arg( srcExtent().toString() ) );
   QgsDebugMsg( QString( "srcCols = %1 srcRows = %2" ).arg( srcCols() ).arg( srcRows() ) );
 
   // If we zoom out too much, projector srcRows / srcCols maybe 0, which can cause problems in providers
-  if ( srcRows() <= 0 || srcCols() <= 0 )
+  if ( mSrcIndexes.isEmpty() )
   {
     QgsDebugMsg( "Zero srcRows or srcCols" );
     return outputBlock;
@@ -748,30 +974,43 @@ QgsRasterBlock * QgsRasterProjector::block( int bandNo, QgsRectangle  const & ex
 
   // TODO: fill by no data or transparent
 
-  int srcRow, srcCol;
-  for ( int i = 0; i < height; ++i )
+  const char *srcBits = inputBlock->bits(( size_t )0 );
+  char *destBits = outputBlock->bits(( size_t )0 );
+  if ( !srcBits || !destBits )
   {
-    for ( int j = 0; j < width; ++j )
-    {
-      srcRowCol( i, j, &srcRow, &srcCol );
-      QgsDebugMsgLevel( QString( "row = %1 col = %2 srcRow = %3 srcCol = %4" ).arg( i ).arg( j ).arg( srcRow ).arg( srcCol ), 5 );
-      size_t srcIndex = srcRow * mSrcCols + srcCol;
-      size_t destIndex = i * width + j;
-
-      char *srcBits = inputBlock->bits( srcIndex );
-      char *destBits = outputBlock->bits( destIndex );
-      if ( !srcBits )
-      {
-        QgsDebugMsg( "Cannot get input block data." );
-        continue;
-      }
-      if ( !destBits )
+    QgsDebugMsg( "Cannot get block data." );
+    delete inputBlock;
+    return outputBlock;
+  }
+
+  size_t myCount = ( size_t )width * height;
+  const int *mySrcIndexes = mSrcIndexes.constData();
+  switch ( pixelSize )
+  {
+    case 1:
+      copyPixels<quint8>( srcBits, destBits, mySrcIndexes, myCount );
+      break;
+    case 2:
+      copyPixels<quint16>( srcBits, destBits, mySrcIndexes, myCount );
+      break;
+    case 4:
+      copyPixels<quint32>( srcBits, destBits, mySrcIndexes, myCount );
+      break;
+    case 8:
+      copyPixels<quint64>( srcBits, destBits, mySrcIndexes, myCount );
+      break;
+    default:
+      for ( size_t i = 0; i < myCount; ++i )
       {
-        QgsDebugMsg( "Cannot set output block data." );
-        continue;
+        memcpy( destBits + i * pixelSize, srcBits + ( size_t )mySrcIndexes[i] * pixelSize, pixelSize );
       }
-      memcpy( destBits, srcBits, pixelSize );
-    }
+      break;
+  }
+
+  // destination pixels outside of the domain of the transformation
+  foreach ( int myPixel, mNoSrcPixels )
+  {
+    outputBlock->setIsNoData(( size_t )myPixel );
   }
 
   delete inputBlock;
@@ -121,6 +121,22 @@ class CORE_EXPORT QgsRasterProjector : public QgsRasterInterface
     /** \brief Get approximate source row and column indexes for current source extent and resolution */
     inline void approximateSrcRowCol( int theDestRow, int theDestCol, int *theSrcRow, int *theSrcCol );
 
+    /** \brief Calculate source pixel indexes of all destination pixels of a row
+     * by transforming the whole row in one call. Pixels whose coordinates cannot be
+     * transformed get index 0 and are added to mNoSrcPixels */
+    void preciseRowSrcIndexes( int theDestRow, int *theSrcIndexes );
+
+    /** \brief Calculate source pixel indexes of all destination pixels of a row
+     * by interpolation of the helper points */
+    void approximateRowSrcIndexes( int theDestRow, int *theSrcIndexes );
+
+    /** \brief Calculate matrix and source pixel indexes for the destination block
+     * if they are not already calculated for the same block */
+    void calcSrcIndexes( const QgsRectangle & theDestExtent, int theDestRows, int theDestCols );
+
+    /** \brief Clamp source row and column and return source pixel index */
+    inline int srcIndex( int theSrcRow, int theSrcCol ) const;
+
     /** \brief Calculate matrix */
     void calc();
 
@@ -242,6 +258,23 @@ class CORE_EXPORT QgsRasterProjector : public QgsRasterInterface
 
     /** Use approximation */
     bool mApproximate;
+
+    /** Source pixel index for each destination pixel. It is calculated once for
+     *  all bands of the same destination block. Only the indexes of the last block
+     *  are kept, they are used until CRS, extent, size or source input change */
+    QVector<int> mSrcIndexes;
+
+    /** Destination pixels of mSrcIndexes without source pixel, because their
+     *  coordinates are outside of the domain of the transformation */
+    QVector<int> mNoSrcPixels;
+
+    /** CRSs, destination extent, size and source input used to calculate mSrcIndexes */
+    QgsCoordinateReferenceSystem mSrcIndexesSrcCRS;
+    QgsCoordinateReferenceSystem mSrcIndexesDestCRS;
+    QgsRectangle mSrcIndexesDestExtent;
+    int mSrcIndexesDestRows;
+    int mSrcIndexesDestCols;
+    QgsRasterInterface* mSrcIndexesInput;
 };
 
 #endif
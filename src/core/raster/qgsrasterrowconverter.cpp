@@ -0,0 +1,252 @@
+/***************************************************************************
+    qgsrasterrowconverter.cpp
+    ---------------------
+    begin                : May 2013
+    copyright            : (C) 2013 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsrasterrowconverter.h"
+
+#include "qgscontrastenhancement.h"
+#include "qgsrasterblock.h"
+
+#include <limits>
+
+// same test as QgsRasterBlock::isNoDataValue(), inlined into the loops
+static inline int component( double value, double noDataValue, QgsContrastEnhancement* enhancement )
+{
+  if ( qIsNaN( value ) || doubleNear( value, noDataValue ) )
+  {
+    return QgsRasterRowConverter::NoData;
+  }
+  if ( !enhancement )
+  {
+    return ( int ) value;
+  }
+  if ( !enhancement->isValueInDisplayableRange( value ) )
+  {
+    return QgsRasterRowConverter::NoData;
+  }
+  return enhancement->enhanceContrast( value );
+}
+
+// an integer value is no data only if the no data value is a whole number within the range of the type
+template <typename T>
+static bool integerNoDataValue( double noDataValue, T& value )
+{
+  if ( qIsNaN( noDataValue ) || noDataValue < std::numeric_limits<T>::min() || noDataValue > std::numeric_limits<T>::max() )
+  {
+    return false;
+  }
+  value = ( T ) qRound( noDataValue );
+  return doubleNear( value, noDataValue );
+}
+
+template <typename T>
+static void integerComponents( const T* src, int count, double noDataValue, int* out )
+{
+  T noData;
+  if ( integerNoDataValue( noDataValue, noData ) )
+  {
+    for ( int i = 0; i < count; i++ )
+    {
+      out[i] = src[i] == noData ? QgsRasterRowConverter::NoData : src[i];
+    }
+  }
+  else
+  {
+    for ( int i = 0; i < count; i++ )
+    {
+      out[i] = src[i];
+    }
+  }
+}
+
+template <typename T>
+static void lookupComponents( const T* src, int count, const int* table, int minimum, int* out )
+{
+  for ( int i = 0; i < count; i++ )
+  {
+    out[i] = table[src[i] - minimum];
+  }
+}
+
+template <typename T>
+static void typedComponents( const T* src, int count, double noDataValue, QgsContrastEnhancement* enhancement, int* out )
+{
+  for ( int i = 0; i < count; i++ )
+  {
+    out[i] = component( src[i], noDataValue, enhancement );
+  }
+}
+
+template <typename T>
+static void typedValues( const T* src, int count, double* out )
+{
+  for ( int i = 0; i < count; i++ )
+  {
+    out[i] = src[i];
+  }
+}
+
+QgsRasterRowConverter::QgsRasterRowConverter( QgsRasterBlock* block, int width, int height, QgsContrastEnhancement* enhancement )
+    : mBlock( block )
+    , mDataType( block->dataType() )
+    , mWidth( width )
+    , mEnhancement( enhancement )
+    , mLookupTableMinimum( 0 )
+{
+  if ( !mEnhancement )
+  {
+    return;
+  }
+
+  // the table pays off only if there are more pixels than table items
+  size_t size = ( size_t )width * height;
+  switch ( mDataType )
+  {
+    case QGis::Byte:
+      if ( size > 256 )
+        createLookupTable( 0, 255 );
+      break;
+    case QGis::UInt16:
+      if ( size > 65536 )
+        createLookupTable( 0, 65535 );
+      break;
+    case QGis::Int16:
+      if ( size > 65536 )
+        createLookupTable( -32768, 32767 );
+      break;
+    default:
+      break;
+  }
+}
+
+void QgsRasterRowConverter::createLookupTable( int minimum, int maximum )
+{
+  mLookupTableMinimum = minimum;
+  mLookupTable.resize( maximum - minimum + 1 );
+  double noDataValue = mBlock->noDataValue();
+  for ( int value = minimum; value <= maximum; value++ )
+  {
+    mLookupTable[value - minimum] = component( value, noDataValue, mEnhancement );
+  }
+}
+
+void QgsRasterRowConverter::components( int row, int* out ) const
+{
+  const char* data = mBlock->bits( row, 0 );
+  if ( !data )
+  {
+    for ( int i = 0; i < mWidth; i++ )
+    {
+      out[i] = NoData;
+    }
+    return;
+  }
+  double noDataValue = mBlock->noDataValue();
+
+  if ( !mLookupTable.isEmpty() )
+  {
+    switch ( mDataType )
+    {
+      case QGis::Byte:
+        lookupComponents(( const quint8* )data, mWidth, mLookupTable.constData(), mLookupTableMinimum, out );
+        return;
+      case QGis::UInt16:
+        lookupComponents(( const quint16* )data, mWidth, mLookupTable.constData(), mLookupTableMinimum, out );
+        return;
+      case QGis::Int16:
+        lookupComponents(( const qint16* )data, mWidth, mLookupTable.constData(), mLookupTableMinimum, out );
+        return;
+      default:
+        break;
+    }
+  }
+
+  switch ( mDataType )
+  {
+    case QGis::Byte:
+      if ( mEnhancement )
+        typedComponents(( const quint8* )data, mWidth, noDataValue, mEnhancement, out );
+      else
+        integerComponents(( const quint8* )data, mWidth, noDataValue, out );
+      break;
+    case QGis::UInt16:
+      if ( mEnhancement )
+        typedComponents(( const quint16* )data, mWidth, noDataValue, mEnhancement, out );
+      else
+        integerComponents(( const quint16* )data, mWidth, noDataValue, out );
+      break;
+    case QGis::Int16:
+      if ( mEnhancement )
+        typedComponents(( const qint16* )data, mWidth, noDataValue, mEnhancement, out );
+      else
+        integerComponents(( const qint16* )data, mWidth, noDataValue, out );
+      break;
+    case QGis::Float32:
+      typedComponents(( const float* )data, mWidth, noDataValue, mEnhancement, out );
+      break;
+    case QGis::Float64:
+      typedComponents(( const double* )data, mWidth, noDataValue, mEnhancement, out );
+      break;
+    default:
+    {
+      void* blockData = mBlock->data();
+      size_t index = ( size_t )row * mWidth;
+      for ( int i = 0; i < mWidth; i++ )
+      {
+        out[i] = component( QgsRasterBlock::readValue( blockData, mDataType, index + i ), noDataValue, mEnhancement );
+      }
+      break;
+    }
+  }
+}
+
+void QgsRasterRowConverter::values( int row, double* out ) const
+{
+  const char* data = mBlock->bits( row, 0 );
+  if ( !data )
+  {
+    for ( int i = 0; i < mWidth; i++ )
+    {
+      out[i] = std::numeric_limits<double>::quiet_NaN();
+    }
+    return;
+  }
+
+  switch ( mDataType )
+  {
+    case QGis::Byte:
+      typedValues(( const quint8* )data, mWidth, out );
+      break;
+    case QGis::UInt16:
+      typedValues(( const quint16* )data, mWidth, out );
+      break;
+    case QGis::Int16:
+      typedValues(( const qint16* )data, mWidth, out );
+      break;
+    case QGis::Float32:
+      typedValues(( const float* )data, mWidth, out );
+      break;
+    case QGis::Float64:
+      typedValues(( const double* )data, mWidth, out );
+      break;
+    default:
+    {
+      void* blockData = mBlock->data();
+      size_t index = ( size_t )row * mWidth;
+      for ( int i = 0; i < mWidth; i++ )
+      {
+        out[i] = QgsRasterBlock::readValue( blockData, mDataType, index + i );
+      }
+      break;
+    }
+  }
+}
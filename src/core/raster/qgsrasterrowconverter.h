@@ -0,0 +1,71 @@
+/***************************************************************************
+    qgsrasterrowconverter.h
+    ---------------------
+    begin                : May 2013
+    copyright            : (C) 2013 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSRASTERROWCONVERTER_H
+#define QGSRASTERROWCONVERTER_H
+
+#include "qgis.h"
+
+#include <QVector>
+
+#include <climits>
+
+class QgsContrastEnhancement;
+class QgsRasterBlock;
+
+/** \ingroup core
+ * Converts rows of a numerical raster block to 8 bit color components for the renderers.
+ * The loops are specialized for the data type of the block, so that the data type is not
+ * tested for each pixel as with QgsRasterBlock::value(). With a contrast enhancement
+ * the 8 and 16 bit integer types are converted through a lookup table covering the whole
+ * range of the type if the block is larger than the table.
+ * @note added in 2.0
+ * @note not available in python bindings
+ */
+class CORE_EXPORT QgsRasterRowConverter
+{
+  public:
+    //! component set for no data values and values out of displayable range
+    static const int NoData = INT_MIN;
+
+    /** Constructor
+     *  @param block block of numerical data, it must exist while the converter is used
+     *  @param width width of the block
+     *  @param height height of the block
+     *  @param enhancement contrast enhancement applied to the values, may be 0
+     */
+    QgsRasterRowConverter( QgsRasterBlock* block, int width, int height, QgsContrastEnhancement* enhancement );
+
+    /** Write color components of a row to out (width values). Without contrast enhancement
+     *  the values are truncated to integers. No data values and values out of displayable
+     *  range of the enhancement are set to NoData */
+    void components( int row, int* out ) const;
+
+    //! Write values of a row to out (width values)
+    void values( int row, double* out ) const;
+
+  private:
+    QgsRasterBlock* mBlock;
+    QGis::DataType mDataType;
+    int mWidth;
+    QgsContrastEnhancement* mEnhancement;
+
+    //! components for all values of 8 and 16 bit types, empty if not used
+    QVector<int> mLookupTable;
+    //! value of the first item in the lookup table
+    int mLookupTableMinimum;
+
+    void createLookupTable( int minimum, int maximum );
+};
+
+#endif // QGSRASTERROWCONVERTER_H
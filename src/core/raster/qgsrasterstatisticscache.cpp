@@ -0,0 +1,385 @@
+/***************************************************************************
+    qgsrasterstatisticscache.cpp
+    ---------------------
+    begin                : May 2013
+    copyright            : (C) 2013 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsrasterstatisticscache.h"
+#include "qgsapplication.h"
+#include "qgslogger.h"
+#include "qgsrasterbandstats.h"
+#include "qgsrasterdataprovider.h"
+#include "qgsrasterhistogram.h"
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSettings>
+
+#include <sqlite3.h>
+
+// time to wait for other processes writing to the database (ms)
+#define RASTER_STATISTICS_BUSY_TIMEOUT 5000
+// default maximum number of statistics and of histograms in the database
+#define RASTER_STATISTICS_MAX_ENTRIES 10000
+// version of the tables, older tables are dropped
+#define RASTER_STATISTICS_SCHEMA_VERSION 1
+
+//! protects the database path and the maximum number of entries
+static QMutex sSettingsMutex;
+
+bool QgsRasterStatisticsCache::sPathSet = false;
+QString QgsRasterStatisticsCache::sPath;
+int QgsRasterStatisticsCache::sMaxEntries = -1;
+
+void QgsRasterStatisticsCache::setDatabasePath( const QString& thePath )
+{
+  QMutexLocker locker( &sSettingsMutex );
+  sPath = thePath;
+  sPathSet = true;
+}
+
+QString QgsRasterStatisticsCache::databasePath()
+{
+  QMutexLocker locker( &sSettingsMutex );
+  if ( !sPathSet )
+  {
+    QSettings settings;
+    sPath = settings.value( "/Raster/statisticsCachePath", QgsApplication::qgisSettingsDirPath() + "rasterstatistics.db" ).toString();
+    sPathSet = true;
+  }
+  return sPath;
+}
+
+void QgsRasterStatisticsCache::setMaxEntries( int theMaxEntries )
+{
+  QMutexLocker locker( &sSettingsMutex );
+  sMaxEntries = qMax( 0, theMaxEntries );
+}
+
+int QgsRasterStatisticsCache::maxEntries()
+{
+  QMutexLocker locker( &sSettingsMutex );
+  if ( sMaxEntries < 0 )
+  {
+    QSettings settings;
+    sMaxEntries = qMax( 0, settings.value( "/Raster/statisticsCacheEntries", RASTER_STATISTICS_MAX_ENTRIES ).toInt() );
+  }
+  return sMaxEntries;
+}
+
+QString QgsRasterStatisticsCache::noDataKey( const QgsRasterDataProvider* theProvider, int theBandNo )
+{
+  QString key;
+  if ( theProvider->srcHasNoDataValue( theBandNo ) && theProvider->useSrcNoDataValue( theBandNo ) )
+  {
+    key = QString::number( theProvider->srcNoDataValue( theBandNo ), 'g', 17 );
+  }
+  foreach ( QgsRasterBlock::Range range, theProvider->userNoDataValue( theBandNo ) )
+  {
+    key += QString( ";%1:%2" ).arg( range.min, 0, 'g', 17 ).arg( range.max, 0, 'g', 17 );
+  }
+  return key;
+}
+
+sqlite3* QgsRasterStatisticsCache::openDb()
+{
+  QString path = databasePath();
+  if ( path.isEmpty() )
+  {
+    return 0;
+  }
+
+  sqlite3 *db;
+  if ( sqlite3_open( path.toUtf8().constData(), &db ) != SQLITE_OK )
+  {
+    QgsDebugMsg( QString( "Cannot open raster statistics database %1: %2" ).arg( path ).arg( QString::fromUtf8( sqlite3_errmsg( db ) ) ) );
+    sqlite3_close( db );
+    return 0;
+  }
+  sqlite3_busy_timeout( db, RASTER_STATISTICS_BUSY_TIMEOUT );
+
+  int version = 0;
+  sqlite3_stmt *stmt;
+  if ( sqlite3_prepare_v2( db, "PRAGMA user_version", -1, &stmt, 0 ) == SQLITE_OK )
+  {
+    if ( sqlite3_step( stmt ) == SQLITE_ROW )
+    {
+      version = sqlite3_column_int( stmt, 0 );
+    }
+    sqlite3_finalize( stmt );
+  }
+  if ( version == RASTER_STATISTICS_SCHEMA_VERSION )
+  {
+    return db;
+  }
+
+  // entries are identified by source, no-data settings and the parameters of statistics / histogram,
+  // used is increased whenever an entry is found or stored
+  QString sql = QString(
+                  "BEGIN;"
+                  "DROP TABLE IF EXISTS statistics;"
+                  "DROP TABLE IF EXISTS histograms;"
+                  "CREATE TABLE statistics ("
+                  "source TEXT, nodata TEXT, band INTEGER, xmin REAL, ymin REAL, xmax REAL, ymax REAL, width INTEGER, height INTEGER,"
+                  "gathered INTEGER, minimum REAL, maximum REAL, range REAL, sum REAL, mean REAL, stddev REAL, sumofsquares REAL, count INTEGER,"
+                  "used INTEGER,"
+                  "UNIQUE(source, nodata, band, xmin, ymin, xmax, ymax, width, height));"
+                  "CREATE INDEX statistics_used ON statistics(used);"
+                  "CREATE TABLE histograms ("
+                  "source TEXT, nodata TEXT, band INTEGER, xmin REAL, ymin REAL, xmax REAL, ymax REAL, width INTEGER, height INTEGER,"
+                  "bincount INTEGER, minimum REAL, maximum REAL, outofrange INTEGER, nonnullcount INTEGER, bins BLOB,"
+                  "used INTEGER,"
+                  "UNIQUE(source, nodata, band, xmin, ymin, xmax, ymax, width, height, bincount, minimum, maximum, outofrange));"
+                  "CREATE INDEX histograms_used ON histograms(used);"
+                  "PRAGMA user_version = %1;"
+                  "COMMIT;" ).arg( RASTER_STATISTICS_SCHEMA_VERSION );
+  char *errMsg = 0;
+  if ( sqlite3_exec( db, sql.toUtf8().constData(), 0, 0, &errMsg ) != SQLITE_OK )
+  {
+    QgsDebugMsg( QString( "Cannot create raster statistics tables: %1" ).arg( QString::fromUtf8( errMsg ) ) );
+    sqlite3_free( errMsg );
+    sqlite3_close( db );
+    return 0;
+  }
+  return db;
+}
+
+void QgsRasterStatisticsCache::touch( sqlite3* db, const char* table, qint64 rowId )
+{
+  QString sql = QString( "UPDATE %1 SET used = (SELECT IFNULL(MAX(used), 0) + 1 FROM %1) WHERE rowid = ?" ).arg( table );
+  sqlite3_stmt *stmt;
+  if ( sqlite3_prepare_v2( db, sql.toUtf8().constData(), -1, &stmt, 0 ) == SQLITE_OK )
+  {
+    sqlite3_bind_int64( stmt, 1, rowId );
+    sqlite3_step( stmt );
+    sqlite3_finalize( stmt );
+  }
+}
+
+void QgsRasterStatisticsCache::evict( sqlite3* db, const char* table )
+{
+  QString sql = QString( "DELETE FROM %1 WHERE rowid IN (SELECT rowid FROM %1 ORDER BY used DESC LIMIT -1 OFFSET ?)" ).arg( table );
+  sqlite3_stmt *stmt;
+  if ( sqlite3_prepare_v2( db, sql.toUtf8().constData(), -1, &stmt, 0 ) == SQLITE_OK )
+  {
+    sqlite3_bind_int( stmt, 1, maxEntries() );
+    sqlite3_step( stmt );
+    sqlite3_finalize( stmt );
+  }
+}
+
+// binds source, no-data settings, band, extent and size, the first 9 parameters of all statements
+static void bindKey( sqlite3_stmt *stmt, const QByteArray& source, const QByteArray& noData, int band, const QgsRectangle& extent, int width, int height )
+{
+  sqlite3_bind_text( stmt, 1, source.constData(), source.size(), SQLITE_TRANSIENT );
+  sqlite3_bind_text( stmt, 2, noData.constData(), noData.size(), SQLITE_TRANSIENT );
+  sqlite3_bind_int( stmt, 3, band );
+  sqlite3_bind_double( stmt, 4, extent.xMinimum() );
+  sqlite3_bind_double( stmt, 5, extent.yMinimum() );
+  sqlite3_bind_double( stmt, 6, extent.xMaximum() );
+  sqlite3_bind_double( stmt, 7, extent.yMaximum() );
+  sqlite3_bind_int( stmt, 8, width );
+  sqlite3_bind_int( stmt, 9, height );
+}
+
+bool QgsRasterStatisticsCache::statistics( const QString& theSource, const QString& theNoData, QgsRasterBandStats& theStatistics )
+{
+  sqlite3 *db = openDb();
+  if ( !db )
+  {
+    return false;
+  }
+
+  const char *sql = "SELECT rowid, gathered, minimum, maximum, range, sum, mean, stddev, sumofsquares, count FROM statistics "
+                    "WHERE source = ? AND nodata = ? AND band = ? AND xmin = ? AND ymin = ? AND xmax = ? AND ymax = ? AND width = ? AND height = ?";
+  sqlite3_stmt *stmt;
+  bool found = false;
+  if ( sqlite3_prepare_v2( db, sql, -1, &stmt, 0 ) == SQLITE_OK )
+  {
+    bindKey( stmt, theSource.toUtf8(), theNoData.toUtf8(), theStatistics.bandNumber, theStatistics.extent, theStatistics.width, theStatistics.height );
+    if ( sqlite3_step( stmt ) == SQLITE_ROW )
+    {
+      int gathered = sqlite3_column_int( stmt, 1 );
+      if (( gathered & theStatistics.statsGathered ) == theStatistics.statsGathered )
+      {
+        qint64 rowId = sqlite3_column_int64( stmt, 0 );
+        theStatistics.statsGathered = gathered;
+        theStatistics.minimumValue = sqlite3_column_double( stmt, 2 );
+        theStatistics.maximumValue = sqlite3_column_double( stmt, 3 );
+        theStatistics.range = sqlite3_column_double( stmt, 4 );
+        theStatistics.sum = sqlite3_column_double( stmt, 5 );
+        theStatistics.mean = sqlite3_column_double( stmt, 6 );
+        theStatistics.stdDev = sqlite3_column_double( stmt, 7 );
+        theStatistics.sumOfSquares = sqlite3_column_double( stmt, 8 );
+        theStatistics.elementCount = sqlite3_column_int64( stmt, 9 );
+        found = true;
+        sqlite3_finalize( stmt );
+        touch( db, "statistics", rowId );
+        stmt = 0;
+      }
+    }
+    sqlite3_finalize( stmt );
+  }
+  sqlite3_close( db );
+
+  QgsDebugMsgLevel( QString( "statistics found = %1" ).arg( found ), 3 );
+  return found;
+}
+
+void QgsRasterStatisticsCache::insertStatistics( const QString& theSource, const QString& theNoData, const QgsRasterBandStats& theStatistics )
+{
+  if ( theStatistics.statsGathered == QgsRasterBandStats::None )
+  {
+    return;
+  }
+  sqlite3 *db = openDb();
+  if ( !db )
+  {
+    return;
+  }
+
+  // stored statistics are kept if they include more than the new ones
+  const char *sql = "INSERT OR REPLACE INTO statistics "
+                    "SELECT ?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12, ?13, ?14, ?15, ?16, ?17, ?18, "
+                    "(SELECT IFNULL(MAX(used), 0) + 1 FROM statistics) "
+                    "WHERE NOT EXISTS (SELECT 1 FROM statistics "
+                    "WHERE source = ?1 AND nodata = ?2 AND band = ?3 AND xmin = ?4 AND ymin = ?5 AND xmax = ?6 AND ymax = ?7 AND width = ?8 AND height = ?9 "
+                    "AND ( gathered & ?10 ) = ?10 AND gathered != ?10)";
+  sqlite3_stmt *stmt;
+  if ( sqlite3_prepare_v2( db, sql, -1, &stmt, 0 ) == SQLITE_OK )
+  {
+    bindKey( stmt, theSource.toUtf8(), theNoData.toUtf8(), theStatistics.bandNumber, theStatistics.extent, theStatistics.width, theStatistics.height );
+    sqlite3_bind_int( stmt, 10, theStatistics.statsGathered );
+    sqlite3_bind_double( stmt, 11, theStatistics.minimumValue );
+    sqlite3_bind_double( stmt, 12, theStatistics.maximumValue );
+    sqlite3_bind_double( stmt, 13, theStatistics.range );
+    sqlite3_bind_double( stmt, 14, theStatistics.sum );
+    sqlite3_bind_double( stmt, 15, theStatistics.mean );
+    sqlite3_bind_double( stmt, 16, theStatistics.stdDev );
+    sqlite3_bind_double( stmt, 17, theStatistics.sumOfSquares );
+    sqlite3_bind_int64( stmt, 18, theStatistics.elementCount );
+    if ( sqlite3_step( stmt ) != SQLITE_DONE )
+    {
+      QgsDebugMsg( QString( "Cannot store statistics: %1" ).arg( QString::fromUtf8( sqlite3_errmsg( db ) ) ) );
+    }
+    sqlite3_finalize( stmt );
+    evict( db, "statistics" );
+  }
+  sqlite3_close( db );
+}
+
+bool QgsRasterStatisticsCache::histogram( const QString& theSource, const QString& theNoData, QgsRasterHistogram& theHistogram )
+{
+  sqlite3 *db = openDb();
+  if ( !db )
+  {
+    return false;
+  }
+
+  const char *sql = "SELECT rowid, nonnullcount, bins FROM histograms "
+                    "WHERE source = ? AND nodata = ? AND band = ? AND xmin = ? AND ymin = ? AND xmax = ? AND ymax = ? AND width = ? AND height = ? "
+                    "AND bincount = ? AND minimum = ? AND maximum = ? AND outofrange = ?";
+  sqlite3_stmt *stmt;
+  bool found = false;
+  if ( sqlite3_prepare_v2( db, sql, -1, &stmt, 0 ) == SQLITE_OK )
+  {
+    bindKey( stmt, theSource.toUtf8(), theNoData.toUtf8(), theHistogram.bandNumber, theHistogram.extent, theHistogram.width, theHistogram.height );
+    sqlite3_bind_int( stmt, 10, theHistogram.binCount );
+    sqlite3_bind_double( stmt, 11, theHistogram.minimum );
+    sqlite3_bind_double( stmt, 12, theHistogram.maximum );
+    sqlite3_bind_int( stmt, 13, theHistogram.includeOutOfRange );
+    if ( sqlite3_step( stmt ) == SQLITE_ROW )
+    {
+      QByteArray bins(( const char * ) sqlite3_column_blob( stmt, 2 ), sqlite3_column_bytes( stmt, 2 ) );
+      QDataStream stream( bins );
+      QgsRasterHistogram::HistogramVector histogramVector;
+      stream >> histogramVector;
+      if ( stream.status() == QDataStream::Ok && histogramVector.size() == theHistogram.binCount )
+      {
+        qint64 rowId = sqlite3_column_int64( stmt, 0 );
+        theHistogram.nonNullCount = sqlite3_column_int64( stmt, 1 );
+        theHistogram.histogramVector = histogramVector;
+        theHistogram.valid = true;
+        found = true;
+        sqlite3_finalize( stmt );
+        touch( db, "histograms", rowId );
+        stmt = 0;
+      }
+    }
+    sqlite3_finalize( stmt );
+  }
+  sqlite3_close( db );
+
+  QgsDebugMsgLevel( QString( "histogram found = %1" ).arg( found ), 3 );
+  return found;
+}
+
+void QgsRasterStatisticsCache::insertHistogram( const QString& theSource, const QString& theNoData, const QgsRasterHistogram& theHistogram )
+{
+  if ( !theHistogram.valid )
+  {
+    return;
+  }
+  sqlite3 *db = openDb();
+  if ( !db )
+  {
+    return;
+  }
+
+  QByteArray bins;
+  QDataStream stream( &bins, QIODevice::WriteOnly );
+  stream << theHistogram.histogramVector;
+
+  const char *sql = "INSERT OR REPLACE INTO histograms "
+                    "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, (SELECT IFNULL(MAX(used), 0) + 1 FROM histograms))";
+  sqlite3_stmt *stmt;
+  if ( sqlite3_prepare_v2( db, sql, -1, &stmt, 0 ) == SQLITE_OK )
+  {
+    bindKey( stmt, theSource.toUtf8(), theNoData.toUtf8(), theHistogram.bandNumber, theHistogram.extent, theHistogram.width, theHistogram.height );
+    sqlite3_bind_int( stmt, 10, theHistogram.binCount );
+    sqlite3_bind_double( stmt, 11, theHistogram.minimum );
+    sqlite3_bind_double( stmt, 12, theHistogram.maximum );
+    sqlite3_bind_int( stmt, 13, theHistogram.includeOutOfRange );
+    sqlite3_bind_int64( stmt, 14, theHistogram.nonNullCount );
+    sqlite3_bind_blob( stmt, 15, bins.constData(), bins.size(), SQLITE_TRANSIENT );
+    if ( sqlite3_step( stmt ) != SQLITE_DONE )
+    {
+      QgsDebugMsg( QString( "Cannot store histogram: %1" ).arg( QString::fromUtf8( sqlite3_errmsg( db ) ) ) );
+    }
+    sqlite3_finalize( stmt );
+    evict( db, "histograms" );
+  }
+  sqlite3_close( db );
+}
+
+void QgsRasterStatisticsCache::remove( const QString& theSource )
+{
+  sqlite3 *db = openDb();
+  if ( !db )
+  {
+    return;
+  }
+
+  QByteArray source = theSource.toUtf8();
+  const char *sqls[] = { "DELETE FROM statistics WHERE source = ?", "DELETE FROM histograms WHERE source = ?" };
+  for ( int i = 0; i < 2; i++ )
+  {
+    sqlite3_stmt *stmt;
+    if ( sqlite3_prepare_v2( db, sqls[i], -1, &stmt, 0 ) == SQLITE_OK )
+    {
+      sqlite3_bind_text( stmt, 1, source.constData(), source.size(), SQLITE_TRANSIENT );
+      sqlite3_step( stmt );
+      sqlite3_finalize( stmt );
+    }
+  }
+  sqlite3_close( db );
+}
@@ -0,0 +1,93 @@
+/***************************************************************************
+    qgsrasterstatisticscache.h
+    ---------------------
+    begin                : May 2013
+    copyright            : (C) 2013 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSRASTERSTATISTICSCACHE_H
+#define QGSRASTERSTATISTICSCACHE_H
+
+#include <QString>
+
+class QgsRasterBandStats;
+class QgsRasterDataProvider;
+class QgsRasterHistogram;
+
+struct sqlite3;
+
+/** \ingroup core
+ * Persistent store of computed raster band statistics and histograms, so that they
+ * are reused by other sessions and processes. Statistics and histograms are kept in
+ * a SQLite database and identified by the data source, the no-data settings of the
+ * band and the parameters which are compared by QgsRasterBandStats::contains() and
+ * QgsRasterHistogram::operator== (band, extent, size of the sample, bins ...).
+ * Least recently used entries are removed when there are more than maxEntries().
+ *
+ * The source identification should change when the data source is modified,
+ * e.g. by including modification time of the file.
+ * @note added in 2.0
+ * @note not available in python bindings
+ */
+class CORE_EXPORT QgsRasterStatisticsCache
+{
+  public:
+    /** Find stored statistics matching no-data settings, band, extent and size of theStatistics
+     *  which include at least the statistics in theStatistics.statsGathered.
+     *  @param theSource identification of the data source
+     *  @param theNoData no-data settings of the band, see noDataKey()
+     *  @param theStatistics band, extent, size and statistics to be found
+     *  @return true if found, collected values are copied to theStatistics */
+    static bool statistics( const QString& theSource, const QString& theNoData, QgsRasterBandStats& theStatistics );
+
+    /** Store statistics, nothing is done if no statistics were collected.
+     *  Stored statistics with the same key are replaced unless they include more statistics. */
+    static void insertStatistics( const QString& theSource, const QString& theNoData, const QgsRasterBandStats& theStatistics );
+
+    /** Find stored histogram with the same no-data settings and parameters as theHistogram
+     *  @return true if found, histogram values are copied to theHistogram */
+    static bool histogram( const QString& theSource, const QString& theNoData, QgsRasterHistogram& theHistogram );
+
+    /** Store histogram, nothing is done if it is not valid */
+    static void insertHistogram( const QString& theSource, const QString& theNoData, const QgsRasterHistogram& theHistogram );
+
+    /** Remove all statistics and histograms of the data source */
+    static void remove( const QString& theSource );
+
+    /** Identification of the no-data settings of a band of the provider (use of the source
+     *  no-data value and user no-data ranges), which change the statistics and histograms */
+    static QString noDataKey( const QgsRasterDataProvider* theProvider, int theBandNo );
+
+    /** Set path to the database, by default rasterstatistics.db in the settings directory
+     *  is used, may be overridden by /Raster/statisticsCachePath setting. Empty path
+     *  switches the persistent cache off. */
+    static void setDatabasePath( const QString& thePath );
+    static QString databasePath();
+
+    /** Set maximum number of statistics and of histograms kept in the database, by default
+     *  10000, may be overridden by /Raster/statisticsCacheEntries setting. */
+    static void setMaxEntries( int theMaxEntries );
+    static int maxEntries();
+
+  private:
+    /** Open the database and create the tables if necessary, returns 0 on error */
+    static sqlite3* openDb();
+
+    /** Mark an entry as used now, e.g. after it was found or stored */
+    static void touch( sqlite3* db, const char* table, qint64 rowId );
+
+    /** Remove least recently used entries over maxEntries() from the table */
+    static void evict( sqlite3* db, const char* table );
+
+    static bool sPathSet;
+    static QString sPath;
+    static int sMaxEntries;
+};
+
+#endif // QGSRASTERSTATISTICSCACHE_H
@@ -18,6 +18,7 @@
 #include "qgssinglebandgrayrenderer.h"
 #include "qgscontrastenhancement.h"
 #include "qgsrastertransparency.h"
+#include "qgsrasterrowconverter.h"
 #include <QDomDocument>
 #include <QDomElement>
 #include <QImage>
@@ -124,51 +125,87 @@ QgsRasterBlock* QgsSingleBandGrayRenderer::block( int bandNo, QgsRectangle  cons
   }
 
   QRgb myDefaultColor = NODATA_COLOR;
-  for ( size_t i = 0; i < ( size_t )width*height; i++ )
+
+  // rows are converted by loops specialized for the data type, the contrast
+  // enhancement and the no data test are applied there
+  QgsRasterRowConverter grayConverter( inputBlock, width, height, mContrastEnhancement );
+  QgsRasterRowConverter* alphaConverter = alphaBlock ? new QgsRasterRowConverter( alphaBlock, width, height, 0 ) : 0;
+  QVector<int> grayRow( width );
+  QVector<double> valueRow( mRasterTransparency ? width : 0 );
+  QVector<double> alphaRow( alphaConverter ? width : 0 );
+  bool opaque = !mRasterTransparency && !alphaConverter && doubleNear( mOpacity, 1.0 );
+  bool invert = mGradient == WhiteToBlack;
+  QRgb* outputData = ( QRgb* ) outputBlock->bits(( size_t )0 );
+
+  for ( int row = 0; row < height; row++ )
   {
-    double grayVal = inputBlock->value( i );
+    grayConverter.components( row, grayRow.data() );
+    QRgb* outputRow = outputData + ( size_t )row * width;
 
-    if ( inputBlock->isNoDataValue( grayVal ) )
+    if ( opaque )
     {
-      outputBlock->setColor( i, myDefaultColor );
+      for ( int col = 0; col < width; col++ )
+      {
+        int grayVal = grayRow[col];
+        if ( grayVal == QgsRasterRowConverter::NoData )
+        {
+          outputRow[col] = myDefaultColor;
+          continue;
+        }
+        if ( invert )
+        {
+          grayVal = 255 - grayVal;
+        }
+        outputRow[col] = qRgba( grayVal, grayVal, grayVal, 255 );
+      }
       continue;
     }
 
-    double currentAlpha = mOpacity;
     if ( mRasterTransparency )
     {
-      currentAlpha = mRasterTransparency->alphaValue( grayVal, mOpacity * 255 ) / 255.0;
+      grayConverter.values( row, valueRow.data() );
     }
-    if ( mAlphaBand > 0 )
+    if ( alphaConverter )
     {
-      currentAlpha *= alphaBlock->value( i ) / 255.0;
+      alphaConverter->values( row, alphaRow.data() );
     }
 
-    if ( mContrastEnhancement )
+    for ( int col = 0; col < width; col++ )
     {
-      if ( !mContrastEnhancement->isValueInDisplayableRange( grayVal ) )
+      int grayVal = grayRow[col];
+      if ( grayVal == QgsRasterRowConverter::NoData )
       {
-        outputBlock->setColor( i, myDefaultColor );
+        outputRow[col] = myDefaultColor;
         continue;
       }
-      grayVal = mContrastEnhancement->enhanceContrast( grayVal );
-    }
 
-    if ( mGradient == WhiteToBlack )
-    {
-      grayVal = 255 - grayVal;
-    }
+      double currentAlpha = mOpacity;
+      if ( mRasterTransparency )
+      {
+        currentAlpha = mRasterTransparency->alphaValue( valueRow[col], mOpacity * 255 ) / 255.0;
+      }
+      if ( alphaConverter )
+      {
+        currentAlpha *= alphaRow[col] / 255.0;
+      }
 
-    if ( doubleNear( currentAlpha, 1.0 ) )
-    {
-      outputBlock->setColor( i, qRgba( grayVal, grayVal, grayVal, 255 ) );
-    }
-    else
-    {
-      outputBlock->setColor( i, qRgba( currentAlpha * grayVal, currentAlpha * grayVal, currentAlpha * grayVal, currentAlpha * 255 ) );
+      if ( invert )
+      {
+        grayVal = 255 - grayVal;
+      }
+
+      if ( doubleNear( currentAlpha, 1.0 ) )
+      {
+        outputRow[col] = qRgba( grayVal, grayVal, grayVal, 255 );
+      }
+      else
+      {
+        outputRow[col] = qRgba( currentAlpha * grayVal, currentAlpha * grayVal, currentAlpha * grayVal, currentAlpha * 255 );
+      }
     }
   }
 
+  delete alphaConverter;
   delete inputBlock;
   if ( mAlphaBand > 0 && mGrayBand != mAlphaBand )
   {
@@ -28,6 +28,9 @@
 #include <QDomElement>
 #include <QSettings> // for legend
 
+#include <cmath>
+#include <limits>
+
 QgsRendererCategoryV2::QgsRendererCategoryV2()
     : mValue(), mSymbol( 0 ), mLabel()
 {
@@ -144,7 +147,8 @@ QgsCategorizedSymbolRendererV2::QgsCategorizedSymbolRendererV2( QString attrName
     mSourceColorRamp( NULL ),
     mScaleMethod( QgsSymbolV2::ScaleArea ),
     mRotationFieldIdx( -1 ),
-    mSizeScaleFieldIdx( -1 )
+    mSizeScaleFieldIdx( -1 ),
+    mIntSymbolsMin( 0 )
 {
   for ( int i = 0; i < mCategories.count(); ++i )
   {
@@ -168,17 +172,95 @@ QgsCategorizedSymbolRendererV2::~QgsCategorizedSymbolRendererV2()
 void QgsCategorizedSymbolRendererV2::rebuildHash()
 {
   mSymbolHash.clear();
+  mIntSymbolHash.clear();
+  mIntSymbols.clear();
+  mIntSymbolsMin = 0;
 
+  qlonglong intMax = 0;
   for ( int i = 0; i < mCategories.count(); ++i )
   {
     QgsRendererCategoryV2& cat = mCategories[i];
-    mSymbolHash.insert( cat.value().toString(), cat.symbol() );
+    QString str = cat.value().toString();
+    mSymbolHash.insert( str, cat.symbol() );
+
+    // categories are matched by string - integer values can be used
+    // only if the category value is written the same way
+    bool ok;
+    qlonglong intValue = str.toLongLong( &ok );
+    if ( !ok || QString::number( intValue ) != str )
+      continue;
+
+    if ( mIntSymbolHash.isEmpty() || intValue < mIntSymbolsMin )
+      mIntSymbolsMin = intValue;
+    if ( mIntSymbolHash.isEmpty() || intValue > intMax )
+      intMax = intValue;
+    mIntSymbolHash.insert( intValue, cat.symbol() );
+  }
+
+  // index directly if there are no big gaps between the values (usual for codes of classes)
+  if ( !mIntSymbolHash.isEmpty() && double( intMax ) - double( mIntSymbolsMin ) < 4.0 * mIntSymbolHash.count() + 64 )
+  {
+    mIntSymbols.fill( 0, intMax - mIntSymbolsMin + 1 );
+    QHash<qlonglong, QgsSymbolV2*>::const_iterator it = mIntSymbolHash.constBegin();
+    for ( ; it != mIntSymbolHash.constEnd(); ++it )
+      mIntSymbols[ it.key() - mIntSymbolsMin ] = it.value();
+  }
+}
+
+bool QgsCategorizedSymbolRendererV2::intSymbolForValue( const QVariant& value, QgsSymbolV2*& symbol ) const
+{
+  // NULL values are converted to strings like "0"
+  if ( value.isNull() )
+    return false;
+
+  qlonglong intValue;
+  switch ( value.type() )
+  {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+      intValue = value.toLongLong();
+      break;
+
+    case QVariant::ULongLong:
+      if ( value.toULongLong() > ( qulonglong ) std::numeric_limits<qlonglong>::max() )
+        return false;
+      intValue = value.toLongLong();
+      break;
+
+    case QVariant::Double:
+    {
+      // whole numbers are converted to strings without decimal part ("-0" for negative zero)
+      double d = value.toDouble();
+      if ( d == 0 || d != floor( d ) || qAbs( d ) >= 1e15 )
+        return false;
+      intValue = ( qlonglong ) d;
+      break;
+    }
+
+    default:
+      return false;
   }
+
+  if ( !mIntSymbols.isEmpty() )
+  {
+    qlonglong idx = intValue - mIntSymbolsMin;
+    symbol = idx >= 0 && idx < mIntSymbols.count() ? mIntSymbols[idx] : 0;
+  }
+  else
+  {
+    symbol = mIntSymbolHash.value( intValue, 0 );
+  }
+  return true;
 }
 
 QgsSymbolV2* QgsCategorizedSymbolRendererV2::symbolForValue( QVariant value )
 {
-  // TODO: special case for int, double
+  // numeric values are looked up without conversion to string
+  QgsSymbolV2* symbol;
+  if ( intSymbolForValue( value, symbol ) )
+    return symbol;
+
   QHash<QString, QgsSymbolV2*>::iterator it = mSymbolHash.find( value.toString() );
   if ( it == mSymbolHash.end() )
   {
@@ -230,7 +312,7 @@ QgsSymbolV2* QgsCategorizedSymbolRendererV2::symbolForFeature( QgsFeature& featu
     sizeScale = attrs[mSizeScaleFieldIdx].toDouble();
 
   // take a temporary symbol (or create it if doesn't exist)
-  QgsSymbolV2* tempSymbol = mTempSymbols[attrs[mAttrNum].toString()];
+  QgsSymbolV2* tempSymbol = mTempSymbols[symbol];
 
   // modify the temporary symbol and return it
   if ( tempSymbol->type() == QgsSymbolV2::Marker )
@@ -383,7 +465,7 @@ void QgsCategorizedSymbolRendererV2::startRender( QgsRenderContext& context, con
       tempSymbol->setRenderHints(( mRotationFieldIdx != -1 ? QgsSymbolV2::DataDefinedRotation : 0 ) |
                                  ( mSizeScaleFieldIdx != -1 ? QgsSymbolV2::DataDefinedSizeScale : 0 ) );
       tempSymbol->startRender( context, vlayer );
-      mTempSymbols[ it->value().toString()] = tempSymbol;
+      mTempSymbols[ it->symbol()] = tempSymbol;
     }
   }
 
@@ -396,7 +478,11 @@ void QgsCategorizedSymbolRendererV2::stopRender( QgsRenderContext& context )
     it->symbol()->stopRender( context );
 
   // cleanup mTempSymbols
-  QHash<QString, QgsSymbolV2*>::iterator it2 = mTempSymbols.begin();
+#if QT_VERSION < 0x40600
+  QMap<QgsSymbolV2*, QgsSymbolV2*>::iterator it2 = mTempSymbols.begin();
+#else
+  QHash<QgsSymbolV2*, QgsSymbolV2*>::iterator it2 = mTempSymbols.begin();
+#endif
   for ( ; it2 != mTempSymbols.end(); ++it2 )
   {
     it2.value()->stopRender( context );
@@ -19,6 +19,7 @@
 #include "qgsrendererv2.h"
 
 #include <QHash>
+#include <QVector>
 
 class QgsVectorColorRampV2;
 class QgsVectorLayer;
@@ -164,12 +165,25 @@ class CORE_EXPORT QgsCategorizedSymbolRendererV2 : public QgsFeatureRendererV2
     //! hashtable for faster access to symbols
     QHash<QString, QgsSymbolV2*> mSymbolHash;
 
+    //! symbols of categories with integer values - for lookup of numeric attribute values without conversion to string
+    QHash<qlonglong, QgsSymbolV2*> mIntSymbolHash;
+    //! the same as mIntSymbolHash indexed by (value - mIntSymbolsMin) if the values are dense enough (empty otherwise)
+    QVector<QgsSymbolV2*> mIntSymbols;
+    qlonglong mIntSymbolsMin;
+
     //! temporary symbols, used for data-defined rotation and scaling
-    QHash<QString, QgsSymbolV2*> mTempSymbols;
+#if QT_VERSION < 0x40600
+    QMap<QgsSymbolV2*, QgsSymbolV2*> mTempSymbols;
+#else
+    QHash<QgsSymbolV2*, QgsSymbolV2*> mTempSymbols;
+#endif
 
     void rebuildHash();
 
     QgsSymbolV2* symbolForValue( QVariant value );
+
+    //! look up symbol of category with integer value, returns false if the value can't be looked up as integer
+    bool intSymbolForValue( const QVariant& value, QgsSymbolV2*& symbol ) const;
 };
 
 
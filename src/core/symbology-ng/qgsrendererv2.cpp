@@ -15,6 +15,7 @@
 
 #include "qgsrendererv2.h"
 #include "qgssymbolv2.h"
+#include "qgslinesymbollayerv2.h"
 #include "qgssymbollayerv2utils.h"
 
 #include "qgssinglesymbolrendererv2.h" // for default renderer
@@ -27,6 +28,7 @@
 #include "qgsfeature.h"
 #include "qgslogger.h"
 #include "qgsvectorlayer.h"
+#include "qgscsexception.h"
 
 #include <QDomElement>
 #include <QDomDocument>
@@ -34,6 +36,18 @@
 
 
 
+// With more than one point proj does not fail on points it cannot transform,
+// but sets them to HUGE_VAL. Report them the same way a single point would be.
+static void checkTransformedPoints( const QPolygonF& pts )
+{
+  const QPointF* ptr = pts.constData();
+  for ( int i = 0; i < pts.size(); ++i, ++ptr )
+  {
+    if ( !qIsFinite( ptr->x() ) || !qIsFinite( ptr->y() ) )
+      throw QgsCsException( QObject::tr( "Some points could not be transformed" ) );
+  }
+}
+
 unsigned char* QgsFeatureRendererV2::_getPoint( QPointF& pt, QgsRenderContext& context, unsigned char* wkb )
 {
   wkb++; // jump over endian info
@@ -43,7 +57,7 @@ unsigned char* QgsFeatureRendererV2::_getPoint( QPointF& pt, QgsRenderContext& c
   double x = *(( double * ) wkb ); wkb += sizeof( double );
   double y = *(( double * ) wkb ); wkb += sizeof( double );
 
-  if ( wkbType == QGis::WKBPolygon25D )
+  if ( wkbType == QGis::WKBPoint25D )
     wkb += sizeof( double );
 
   if ( context.coordinateTransform() )
@@ -58,6 +72,46 @@ unsigned char* QgsFeatureRendererV2::_getPoint( QPointF& pt, QgsRenderContext& c
   return wkb;
 }
 
+unsigned char* QgsFeatureRendererV2::_getMultiPoint( QPolygonF& pts, QgsRenderContext& context, unsigned char* wkb )
+{
+  wkb++; // jump over endian info
+  wkb += sizeof( unsigned int ); // jump over wkb type
+  unsigned int nPoints = *(( int* ) wkb );
+  wkb += sizeof( unsigned int );
+
+  pts.resize( nPoints );
+
+  QPointF* ptr = pts.data();
+  for ( unsigned int i = 0; i < nPoints; ++i, ++ptr )
+  {
+    wkb++; // jump over endian info
+    unsigned int wkbType = *(( int* ) wkb );
+    wkb += sizeof( unsigned int );
+
+    ptr->rx() = *(( double * ) wkb ); wkb += sizeof( double );
+    ptr->ry() = *(( double * ) wkb ); wkb += sizeof( double );
+
+    if ( wkbType == QGis::WKBPoint25D )
+      wkb += sizeof( double );
+  }
+
+  // transform all the points with a single call rather than one per point
+  if ( context.coordinateTransform() )
+  {
+    context.coordinateTransform()->transformPolygon( pts );
+    checkTransformedPoints( pts );
+  }
+
+  const QgsMapToPixel& mtp = context.mapToPixel();
+  ptr = pts.data();
+  for ( unsigned int i = 0; i < nPoints; ++i, ++ptr )
+  {
+    mtp.transformInPlace( ptr->rx(), ptr->ry() );
+  }
+
+  return wkb;
+}
+
 unsigned char* QgsFeatureRendererV2::_getLineString( QPolygonF& pts, QgsRenderContext& context, unsigned char* wkb )
 {
   wkb++; // jump over endian info
@@ -102,6 +156,7 @@ unsigned char* QgsFeatureRendererV2::_getLineString( QPolygonF& pts, QgsRenderCo
   if ( ct )
   {
     ct->transformPolygon( pts );
+    checkTransformedPoints( pts );
   }
 
   QPointF* ptr = pts.data();
@@ -110,6 +165,8 @@ unsigned char* QgsFeatureRendererV2::_getLineString( QPolygonF& pts, QgsRenderCo
     mtp.transformInPlace( ptr->rx(), ptr->ry() );
   }
 
+  // drop vertices which would be drawn on the same pixel
+  QgsSymbolLayerV2Utils::simplifyPolyline( pts, context.simplifyTolerance(), 2 );
 
   return wkb;
 }
@@ -165,6 +222,7 @@ unsigned char* QgsFeatureRendererV2::_getPolygon( QPolygonF& pts, QList<QPolygon
     if ( ct )
     {
       ct->transformPolygon( poly );
+      checkTransformedPoints( poly );
     }
 
 
@@ -174,6 +232,9 @@ unsigned char* QgsFeatureRendererV2::_getPolygon( QPolygonF& pts, QList<QPolygon
       mtp.transformInPlace( ptr->rx(), ptr->ry() );
     }
 
+    // drop vertices which would be drawn on the same pixel, keeping at least a closed triangle
+    QgsSymbolLayerV2Utils::simplifyPolyline( poly, context.simplifyTolerance(), 4 );
+
     if ( idx == 0 )
       pts = poly;
     else
@@ -207,10 +268,41 @@ bool QgsFeatureRendererV2::renderFeature( QgsFeature& feature, QgsRenderContext&
   return true;
 }
 
+//! whether the symbol places markers on the vertices of lines or polygon outlines
+static bool symbolUsesVertices( QgsSymbolV2* symbol )
+{
+  for ( int i = 0; i < symbol->symbolLayerCount(); ++i )
+  {
+    QgsMarkerLineSymbolLayerV2* markerLine = dynamic_cast<QgsMarkerLineSymbolLayerV2*>( symbol->symbolLayer( i ) );
+    if ( markerLine && markerLine->placement() == QgsMarkerLineSymbolLayerV2::Vertex )
+      return true;
+  }
+  return false;
+}
+
+//! restores the simplification tolerance of the context when leaving the scope, also on exceptions
+class QgsSimplifyToleranceRestorer
+{
+  public:
+    QgsSimplifyToleranceRestorer( QgsRenderContext& context )
+        : mContext( context ), mTolerance( context.simplifyTolerance() ) {}
+    ~QgsSimplifyToleranceRestorer() { mContext.setSimplifyTolerance( mTolerance ); }
+
+  private:
+    QgsRenderContext& mContext;
+    double mTolerance;
+};
+
 void QgsFeatureRendererV2::renderFeatureWithSymbol( QgsFeature& feature, QgsSymbolV2* symbol, QgsRenderContext& context, int layer, bool selected, bool drawVertexMarker )
 {
   QgsSymbolV2::SymbolType symbolType = symbol->type();
 
+  // markers on vertices and vertex markers of edited layers need all the vertices,
+  // _getLineString() and _getPolygon() may throw QgsCsException
+  QgsSimplifyToleranceRestorer toleranceRestorer( context );
+  if ( context.simplifyTolerance() > 0 && ( drawVertexMarker || symbolUsesVertices( symbol ) ) )
+    context.setSimplifyTolerance( 0 );
+
   QgsGeometry* geom = feature.geometry();
   switch ( geom->wkbType() )
   {
@@ -275,15 +367,12 @@ void QgsFeatureRendererV2::renderFeatureWithSymbol( QgsFeature& feature, QgsSymb
         break;
       }
 
-      unsigned char* wkb = geom->asWkb();
-      unsigned int num = *(( int* )( wkb + 5 ) );
-      unsigned char* ptr = wkb + 9;
-      QPointF pt;
+      QPolygonF pts;
+      _getMultiPoint( pts, context, geom->asWkb() );
 
-      for ( unsigned int i = 0; i < num; ++i )
+      for ( int i = 0; i < pts.size(); ++i )
       {
-        ptr = _getPoint( pt, context, ptr );
-        (( QgsMarkerSymbolV2* )symbol )->renderPoint( pt, &feature, context, layer, selected );
+        (( QgsMarkerSymbolV2* )symbol )->renderPoint( pts[i], &feature, context, layer, selected );
 
         //if ( drawVertexMarker )
         //  renderVertexMarker( pt, context );
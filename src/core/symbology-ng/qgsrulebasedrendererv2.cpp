@@ -32,7 +32,7 @@ QgsRuleBasedRendererV2::Rule::Rule( QgsSymbolV2* symbol, int scaleMinDenom, int
     : mParent( NULL ), mSymbol( symbol ),
     mScaleMinDenom( scaleMinDenom ), mScaleMaxDenom( scaleMaxDenom ),
     mFilterExp( filterExp ), mLabel( label ), mDescription( description ),
-    mFilter( NULL )
+    mFilter( NULL ), mHitCount( 0 ), mLookupAttrIndex( -1 )
 {
   initFilter();
 }
@@ -286,6 +286,7 @@ void QgsRuleBasedRendererV2::Rule::toSld( QDomDocument& doc, QDomElement &elemen
 bool QgsRuleBasedRendererV2::Rule::startRender( QgsRenderContext& context, const QgsVectorLayer *vlayer )
 {
   mActiveChildren.clear();
+  mHitCount = 0;
 
   // filter out rules which are not compatible with this scale
   if ( !isScaleOK( context.rendererScale() ) )
@@ -308,9 +309,180 @@ bool QgsRuleBasedRendererV2::Rule::startRender( QgsRenderContext& context, const
       mActiveChildren.append( rule );
     }
   }
+
+  initChildrenLookup( vlayer );
   return true;
 }
 
+// QgsExpression compares values as numbers if both can be converted to numbers, as strings otherwise
+static bool lookupNumber( const QVariant& value, double& number )
+{
+  if ( value.type() == QVariant::Double || value.type() == QVariant::Int )
+  {
+    number = value.toDouble();
+    return true;
+  }
+  if ( value.type() == QVariant::String )
+  {
+    bool ok;
+    number = value.toString().toDouble( &ok );
+    return ok;
+  }
+  return false;
+}
+
+// find out whether the filter tests a field for equality with literal values:
+// "field = value", "field IN (values)" or such a test combined with other conditions by AND
+static QgsExpression::NodeColumnRef* lookupValues( QgsExpression::Node* node, QList<QVariant>& values, bool& exact )
+{
+  if ( QgsExpression::NodeBinaryOperator* op = dynamic_cast<QgsExpression::NodeBinaryOperator*>( node ) )
+  {
+    if ( op->op() == QgsExpression::boEQ )
+    {
+      QgsExpression::NodeColumnRef* column = dynamic_cast<QgsExpression::NodeColumnRef*>( op->opLeft() );
+      QgsExpression::NodeLiteral* literal = dynamic_cast<QgsExpression::NodeLiteral*>( op->opRight() );
+      if ( !column || !literal )
+      {
+        column = dynamic_cast<QgsExpression::NodeColumnRef*>( op->opRight() );
+        literal = dynamic_cast<QgsExpression::NodeLiteral*>( op->opLeft() );
+      }
+      if ( !column || !literal )
+        return 0;
+
+      values << literal->value();
+      exact = true;
+      return column;
+    }
+    else if ( op->op() == QgsExpression::boAnd )
+    {
+      // the other operand will be evaluated only for features found in the lookup
+      QgsExpression::NodeColumnRef* column = lookupValues( op->opLeft(), values, exact );
+      if ( !column )
+        column = lookupValues( op->opRight(), values, exact );
+      exact = false;
+      return column;
+    }
+  }
+  else if ( QgsExpression::NodeInOperator* op = dynamic_cast<QgsExpression::NodeInOperator*>( node ) )
+  {
+    QgsExpression::NodeColumnRef* column = dynamic_cast<QgsExpression::NodeColumnRef*>( op->node() );
+    if ( !column || op->isNotIn() )
+      return 0;
+
+    QList<QVariant> items;
+    foreach ( QgsExpression::Node* item, op->list()->list() )
+    {
+      QgsExpression::NodeLiteral* literal = dynamic_cast<QgsExpression::NodeLiteral*>( item );
+      if ( !literal )
+        return 0;
+      items << literal->value();
+    }
+
+    values << items;
+    exact = true;
+    return column;
+  }
+  return 0;
+}
+
+void QgsRuleBasedRendererV2::Rule::initChildrenLookup( const QgsVectorLayer* vlayer )
+{
+  int count = mActiveChildren.count();
+
+  mLookupAttrIndex = -1;
+  mLookupModes.fill( NotInLookup, count );
+  mLookupNumeric.clear();
+  mLookupString.clear();
+
+  if ( count < 2 || !vlayer )
+    return;
+
+  // find out which field is tested by most of the children
+  QVector<int> childAttrs( count, -1 );
+  QVector< QList<QVariant> > childValues( count );
+  QVector<bool> childExact( count, false );
+  QMap<int, int> attrCounts;
+  for ( int i = 0; i < count; ++i )
+  {
+    QgsExpression* filter = mActiveChildren[i]->mFilter;
+    if ( !filter || !filter->rootNode() )
+      continue;
+
+    bool exact = false;
+    QgsExpression::NodeColumnRef* column = lookupValues( filter->rootNode(), childValues[i], exact );
+    if ( !column )
+      continue;
+
+    int attrIndex = vlayer->fieldNameIndex( column->name() );
+    if ( attrIndex < 0 )
+      continue;
+
+    childAttrs[i] = attrIndex;
+    childExact[i] = exact;
+    attrCounts[attrIndex]++;
+  }
+
+  int bestCount = 1;
+  for ( QMap<int, int>::const_iterator it = attrCounts.constBegin(); it != attrCounts.constEnd(); ++it )
+  {
+    if ( it.value() > bestCount )
+    {
+      mLookupAttrIndex = it.key();
+      bestCount = it.value();
+    }
+  }
+
+  // a single rule is not worth a lookup
+  if ( mLookupAttrIndex < 0 )
+    return;
+
+  for ( int i = 0; i < count; ++i )
+  {
+    if ( childAttrs[i] != mLookupAttrIndex )
+      continue;
+
+    mLookupModes[i] = childExact[i] ? LookupExact : LookupAndFilter;
+
+    foreach ( const QVariant& value, childValues[i] )
+    {
+      if ( value.isNull() ) // never equal
+        continue;
+
+      // values which are not compared as numbers (e.g. 64 bit integers) are compared with the string of the literal
+      QList<int>& lst = mLookupString[value.toString()];
+      if ( lst.isEmpty() || lst.last() != i )
+        lst.append( i );
+
+      double number;
+      if ( lookupNumber( value, number ) )
+      {
+        QList<int>& numLst = mLookupNumeric[number];
+        if ( numLst.isEmpty() || numLst.last() != i )
+          numLst.append( i );
+      }
+    }
+  }
+
+  QgsDebugMsgLevel( QString( "rule %1: lookup by attribute %2 for %3 of %4 rules" ).arg( mLabel ).arg( mLookupAttrIndex ).arg( bestCount ).arg( count ), 3 );
+}
+
+const QList<int>* QgsRuleBasedRendererV2::Rule::lookupChildren( const QgsFeature& feat ) const
+{
+  QVariant value = feat.attribute( mLookupAttrIndex );
+  if ( value.isNull() )
+    return 0;
+
+  double number;
+  if ( lookupNumber( value, number ) )
+  {
+    QMap<double, QList<int> >::const_iterator it = mLookupNumeric.constFind( number );
+    return it != mLookupNumeric.constEnd() ? &it.value() : 0;
+  }
+
+  QHash<QString, QList<int> >::const_iterator it = mLookupString.constFind( value.toString() );
+  return it != mLookupString.constEnd() ? &it.value() : 0;
+}
+
 QSet<int> QgsRuleBasedRendererV2::Rule::collectZLevels()
 {
   QSet<int> symbolZLevelsSet;
@@ -360,6 +532,13 @@ bool QgsRuleBasedRendererV2::Rule::renderFeature( QgsRuleBasedRendererV2::Featur
   if ( !isFilterOK( featToRender.feat ) )
     return false;
 
+  return renderMatchedFeature( featToRender, context, renderQueue );
+}
+
+bool QgsRuleBasedRendererV2::Rule::renderMatchedFeature( QgsRuleBasedRendererV2::FeatureToRender& featToRender, QgsRenderContext& context, QgsRuleBasedRendererV2::RenderQueue& renderQueue )
+{
+  mHitCount++;
+
   bool rendered = false;
 
   // create job for this feature and this symbol, add to list of jobs
@@ -375,10 +554,26 @@ bool QgsRuleBasedRendererV2::Rule::renderFeature( QgsRuleBasedRendererV2::Featur
   }
 
   // process children
-  for ( QList<Rule*>::iterator it = mActiveChildren.begin(); it != mActiveChildren.end(); ++it )
+  const QList<int>* hits = mLookupAttrIndex >= 0 ? lookupChildren( featToRender.feat ) : 0;
+  int nextHit = 0;
+  for ( int i = 0; i < mActiveChildren.count(); ++i )
   {
-    Rule* rule = *it;
-    rendered |= rule->renderFeature( featToRender, context, renderQueue );
+    Rule* rule = mActiveChildren[i];
+    if ( mLookupAttrIndex < 0 || mLookupModes[i] == NotInLookup )
+    {
+      rendered |= rule->renderFeature( featToRender, context, renderQueue );
+      continue;
+    }
+
+    // rules in the lookup are skipped unless the feature's value has been found for them
+    if ( !hits || nextHit >= hits->count() || hits->at( nextHit ) != i )
+      continue;
+    ++nextHit;
+
+    if ( mLookupModes[i] == LookupExact )
+      rendered |= rule->renderMatchedFeature( featToRender, context, renderQueue );
+    else
+      rendered |= rule->renderFeature( featToRender, context, renderQueue );
   }
   return rendered;
 }
@@ -445,6 +640,10 @@ void QgsRuleBasedRendererV2::Rule::stopRender( QgsRenderContext& context )
 
   mActiveChildren.clear();
   mSymbolNormZLevels.clear();
+  mLookupAttrIndex = -1;
+  mLookupModes.clear();
+  mLookupNumeric.clear();
+  mLookupString.clear();
 }
 
 QgsRuleBasedRendererV2::Rule* QgsRuleBasedRendererV2::Rule::create( QDomElement& ruleElem, QgsSymbolV2Map& symbolMap )
@@ -20,6 +20,10 @@
 #include "qgsfeature.h"
 #include "qgis.h"
 
+#include <QHash>
+#include <QMap>
+#include <QVector>
+
 #include "qgsrendererv2.h"
 
 class QgsExpression;
@@ -80,6 +84,10 @@ class CORE_EXPORT QgsRuleBasedRendererV2 : public QgsFeatureRendererV2
       If scale range has both values zero, it matches all scales.
       If one of the min/max scale denominators is zero, there is no lower/upper bound for scales.
       A rule matches if both filter and scale range match.
+
+      When rendering, filters of sibling rules of the form "field = value" or "field IN (values)"
+      (possibly combined with other conditions using AND) that test the same field are not
+      evaluated one by one: the feature's value is looked up in a table built in startRender().
      */
     class CORE_EXPORT Rule
     {
@@ -106,6 +114,10 @@ class CORE_EXPORT QgsRuleBasedRendererV2 : public QgsFeatureRendererV2
         QString filterExpression() const { return mFilterExp; }
         QString description() const { return mDescription; }
 
+        //! number of features matched by the rule in the last rendering (reset in startRender())
+        //! @note added in 2.0
+        int hitCount() const { return mHitCount; }
+
         //! set a new symbol (or NULL). Deletes old symbol.
         void setSymbol( QgsSymbolV2* sym );
         void setLabel( QString label ) { mLabel = label; }
@@ -167,6 +179,22 @@ class CORE_EXPORT QgsRuleBasedRendererV2 : public QgsFeatureRendererV2
       protected:
         void initFilter();
 
+        //! render feature for which the filter of this rule is known to be true
+        bool renderMatchedFeature( FeatureToRender& featToRender, QgsRenderContext& context, RenderQueue& renderQueue );
+
+        //! build lookup of active children by attribute value
+        void initChildrenLookup( const QgsVectorLayer* vlayer );
+        //! indexes (ascending) of active children whose lookup value matches the feature (NULL if none)
+        const QList<int>* lookupChildren( const QgsFeature& feat ) const;
+
+        //! how an active child is handled by the lookup
+        enum LookupMode
+        {
+          NotInLookup,     //!< filter is evaluated for each feature
+          LookupExact,     //!< filter is true exactly when the value is found in the lookup
+          LookupAndFilter  //!< filter is evaluated only when the value is found in the lookup
+        };
+
         Rule* mParent; // parent rule (NULL only for root rule)
         QgsSymbolV2* mSymbol;
         int mScaleMinDenom, mScaleMaxDenom;
@@ -179,6 +207,13 @@ class CORE_EXPORT QgsRuleBasedRendererV2 : public QgsFeatureRendererV2
         // temporary while rendering
         QList<int> mSymbolNormZLevels;
         RuleList mActiveChildren;
+        int mHitCount;
+
+        // temporary while rendering: lookup of active children by attribute value
+        int mLookupAttrIndex; // -1 if there is no lookup
+        QVector<LookupMode> mLookupModes; // one entry for each active child
+        QMap<double, QList<int> > mLookupNumeric;
+        QHash<QString, QList<int> > mLookupString;
     };
 
     /////
@@ -27,6 +27,7 @@
 #include <QDomElement>
 #include <QFile>
 #include <QImage>
+#include <QMutexLocker>
 #include <QPainter>
 #include <QPicture>
 #include <QSvgRenderer>
@@ -92,6 +93,7 @@ QgsSvgCache* QgsSvgCache::instance()
 
 QgsSvgCache::QgsSvgCache( QObject *parent )
     : QObject( parent )
+    , mMutex( QMutex::Recursive ) // remote svgs are downloaded while processing events
     , mTotalSize( 0 )
     , mLeastRecentEntry( 0 )
     , mMostRecentEntry( 0 )
@@ -111,6 +113,8 @@ QgsSvgCache::~QgsSvgCache()
 const QImage& QgsSvgCache::svgAsImage( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
                                        double widthScaleFactor, double rasterScaleFactor, bool& fitsInCache )
 {
+  QMutexLocker locker( &mMutex );
+
   fitsInCache = true;
   QgsSvgCacheEntry* currentEntry = cacheEntry( file, size, fill, outline, outlineWidth, widthScaleFactor, rasterScaleFactor );
 
@@ -145,12 +149,22 @@ const QImage& QgsSvgCache::svgAsImage( const QString& file, double size, const Q
     trimToMaximumSize();
   }
 
-  return *( currentEntry->image );
+  // the entry may be trimmed by another thread while the caller uses the image,
+  // a (shallow) copy of this thread is returned
+  if ( !mThreadImage.hasLocalData() )
+  {
+    mThreadImage.setLocalData( new QImage() );
+  }
+  QImage* image = mThreadImage.localData();
+  *image = currentEntry->image ? *( currentEntry->image ) : QImage();
+  return *image;
 }
 
 const QPicture& QgsSvgCache::svgAsPicture( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
     double widthScaleFactor, double rasterScaleFactor )
 {
+  QMutexLocker locker( &mMutex );
+
   QgsSvgCacheEntry* currentEntry = cacheEntry( file, size, fill, outline, outlineWidth, widthScaleFactor, rasterScaleFactor );
 
   //if current entry picture is 0: cache picture for entry
@@ -161,7 +175,13 @@ const QPicture& QgsSvgCache::svgAsPicture( const QString& file, double size, con
     trimToMaximumSize();
   }
 
-  return *( currentEntry->picture );
+  if ( !mThreadPicture.hasLocalData() )
+  {
+    mThreadPicture.setLocalData( new QPicture() );
+  }
+  QPicture* picture = mThreadPicture.localData();
+  *picture = *( currentEntry->picture );
+  return *picture;
 }
 
 QgsSvgCacheEntry* QgsSvgCache::insertSVG( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
@@ -19,14 +19,16 @@
 #define QGSSVGCACHE_H
 
 #include <QColor>
+#include <QImage>
 #include <QMap>
 #include <QMultiHash>
+#include <QMutex>
+#include <QPicture>
 #include <QString>
+#include <QThreadStorage>
 #include <QUrl>
 
 class QDomElement;
-class QImage;
-class QPicture;
 
 class CORE_EXPORT QgsSvgCacheEntry
 {
@@ -69,8 +71,11 @@ class CORE_EXPORT QgsSvgCache : public QObject
     static QgsSvgCache* instance();
     ~QgsSvgCache();
 
+    /**Returns the rendered svg. The reference is valid until the next call from the same thread,
+      it refers to a copy of the thread, so that the cache may be trimmed by other threads meanwhile*/
     const QImage& svgAsImage( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
                               double widthScaleFactor, double rasterScaleFactor, bool& fitsInCache );
+    /**Returns the svg as picture, the reference is valid until the next call from the same thread*/
     const QPicture& svgAsPicture( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
                                   double widthScaleFactor, double rasterScaleFactor );
 
@@ -115,6 +120,11 @@ class CORE_EXPORT QgsSvgCache : public QObject
 
     /**Entry pointers accessible by file name*/
     QMultiHash< QString, QgsSvgCacheEntry* > mEntryLookup;
+    /**Guards the cache, symbols may be rendered from several threads at once*/
+    QMutex mMutex;
+    /**Image / picture last returned to each thread*/
+    QThreadStorage<QImage*> mThreadImage;
+    QThreadStorage<QPicture*> mThreadPicture;
     /**Estimated total size of all images, pictures and svgContent*/
     long mTotalSize;
 
@@ -2682,6 +2682,48 @@ QPointF QgsSymbolLayerV2Utils::pointOnLineWithDistance( const QPointF& startPoin
   return QPointF( startPoint.x() + dx * scaleFactor, startPoint.y() + dy * scaleFactor );
 }
 
+void QgsSymbolLayerV2Utils::simplifyPolyline( QPolygonF& points, double tolerance, int minPoints )
+{
+  int n = points.size();
+  if ( tolerance <= 0 || n < 3 || n <= minPoints )
+    return;
+
+  double tolerance2 = tolerance * tolerance;
+
+  // first pass: count the vertices to keep
+  const QPointF* src = points.constData();
+  QPointF last = src[0];
+  int count = 2; // first and last vertex
+  for ( int i = 1; i < n - 1; ++i )
+  {
+    double dx = src[i].x() - last.x();
+    double dy = src[i].y() - last.y();
+    if ( dx * dx + dy * dy >= tolerance2 )
+    {
+      last = src[i];
+      ++count;
+    }
+  }
+
+  if ( count == n || count < minPoints )
+    return;
+
+  // second pass: compact in place
+  QPointF* dst = points.data();
+  int kept = 1;
+  for ( int i = 1; i < n - 1; ++i )
+  {
+    double dx = dst[i].x() - dst[kept - 1].x();
+    double dy = dst[i].y() - dst[kept - 1].y();
+    if ( dx * dx + dy * dy >= tolerance2 )
+    {
+      dst[kept++] = dst[i];
+    }
+  }
+  dst[kept++] = dst[n - 1];
+  points.resize( kept );
+}
+
 
 QStringList QgsSymbolLayerV2Utils::listSvgFiles()
 {
@@ -227,6 +227,12 @@ class CORE_EXPORT QgsSymbolLayerV2Utils
     /**Returns a point on the line from startPoint to directionPoint that is a certain distance away from the starting point*/
     static QPointF pointOnLineWithDistance( const QPointF& startPoint, const QPointF& directionPoint, double distance );
 
+    /**Drops the vertices of a polyline (in painter coordinates) that are closer than tolerance to the
+      previously kept vertex. The first and the last vertex are always kept, so rings stay closed.
+      The polyline is left untouched if less than minPoints vertices would remain.
+      @note added in 2.0 */
+    static void simplifyPolyline( QPolygonF& points, double tolerance, int minPoints = 2 );
+
     //! Return a list of all available svg files
     static QStringList listSvgFiles();
 
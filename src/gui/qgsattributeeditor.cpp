@@ -214,42 +214,24 @@ QWidget *QgsAttributeEditor::createAttributeEditor( QWidget *parent, QWidget *ed
         int ki = layer->fieldNameIndex( data.mOrderByValue ? data.mValue : data.mKey );
         int vi = layer->fieldNameIndex( data.mOrderByValue ? data.mKey : data.mValue );
 
-        QgsExpression *e = 0;
+        QgsFeatureRequest request;
+        request.setFlags( QgsFeatureRequest::NoGeometry ).setSubsetOfAttributes( QgsAttributeList() << ki << vi );
+
+        // the layer fetches the attributes and geometry the filter needs and
+        // database providers apply it in their query
         if ( !data.mFilterExpression.isEmpty() )
         {
-          e = new QgsExpression( data.mFilterExpression );
-          if ( e->hasParserError() || !e->prepare( layer->pendingFields() ) )
+          request.setFilterExpression( data.mFilterExpression );
+          if ( request.filterExpression()->hasParserError() || !request.filterExpression()->prepare( layer->pendingFields() ) )
             ki = -1;
         }
 
         if ( ki >= 0 && vi >= 0 )
         {
-          QSet<int> attributes;
-          attributes << ki << vi;
-
-          QgsFeatureRequest::Flag flags = QgsFeatureRequest::NoGeometry;
-
-          if ( e )
-          {
-            if ( e->needsGeometry() )
-              flags = QgsFeatureRequest::NoFlags;
-
-            foreach ( const QString &field, e->referencedColumns() )
-            {
-              int idx = layer->fieldNameIndex( field );
-              if ( idx < 0 )
-                continue;
-              attributes << idx;
-            }
-          }
-
-          QgsFeatureIterator fit = layer->getFeatures( QgsFeatureRequest().setFlags( flags ).setSubsetOfAttributes( attributes.toList() ) );
+          QgsFeatureIterator fit = layer->getFeatures( request );
           QgsFeature f;
           while ( fit.nextFeature( f ) )
           {
-            if ( e && !e->evaluate( &f ).toBool() )
-              continue;
-
             map.insert( f.attribute( ki ).toString(), f.attribute( vi ).toString() );
           }
         }
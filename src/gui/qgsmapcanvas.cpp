@@ -47,8 +47,10 @@ email                : sherman at mrcc.com
 #include "qgsmaptopixel.h"
 #include "qgsmapoverviewcanvas.h"
 #include "qgsmaprenderer.h"
+#include "qgsmaprendererjob.h"
 #include "qgsmessagelog.h"
 #include "qgsmessageviewer.h"
+#include "qgspallabeling.h"
 #include "qgsproject.h"
 #include "qgsrubberband.h"
 #include "qgsvectorlayer.h"
@@ -83,6 +85,7 @@ QgsMapCanvas::QgsMapCanvas( QWidget * parent, const char *name )
     , mNewSize( QSize() )
     , mPainting( false )
     , mAntiAliasing( false )
+    , mRenderJob( 0 )
 {
   setObjectName( name );
   mScene = new QGraphicsScene();
@@ -117,6 +120,7 @@ QgsMapCanvas::QgsMapCanvas( QWidget * parent, const char *name )
 
   moveCanvasContents( true );
 
+  connect( &mRenderJobUpdateTimer, SIGNAL( timeout() ), this, SLOT( renderJobUpdate() ) );
   connect( mMapRenderer, SIGNAL( drawError( QgsMapLayer* ) ), this, SLOT( showError( QgsMapLayer* ) ) );
   connect( mMapRenderer, SIGNAL( hasCrsTransformEnabled( bool ) ), this, SLOT( crsTransformEnabled( bool ) ) );
 
@@ -133,6 +137,15 @@ QgsMapCanvas::QgsMapCanvas( QWidget * parent, const char *name )
 
 QgsMapCanvas::~QgsMapCanvas()
 {
+  if ( mRenderJob )
+  {
+    mRenderJobUpdateTimer.stop();
+    mRenderJob->stop();
+    mRenderJob->wait();
+    delete mRenderJob;
+    mRenderJob = 0;
+  }
+
   if ( mMapTool )
   {
     mMapTool->deactivate();
@@ -402,6 +415,15 @@ void QgsMapCanvas::refresh()
 #endif // ANDROID
 #endif // Q_WS_X11
 
+  if ( settings.value( "/Map/renderInBackground", false ).toBool() && QgsMapRendererJob::canRenderInBackground( mMapRenderer ) )
+  {
+    if ( mRenderFlag && !mFrozen )
+    {
+      startRenderJob();
+    }
+    return;
+  }
+
   mDrawing = true;
 
   if ( mRenderFlag && !mFrozen )
@@ -451,12 +473,106 @@ void QgsMapCanvas::refresh()
 
 void QgsMapCanvas::updateMap()
 {
+  if ( mRenderJob )
+  {
+    renderJobUpdate();
+    return;
+  }
+
   if ( mMap )
   {
     mMap->updateContents();
   }
 }
 
+void QgsMapCanvas::stopRendering()
+{
+  if ( mRenderJob )
+  {
+    mRenderJob->stop();
+  }
+
+  mMapRenderer->rendererContext()->setRenderingStopped( true );
+}
+
+void QgsMapCanvas::startRenderJob()
+{
+  cancelRenderJob();
+  clear();
+
+  emit renderStarting();
+
+  mRenderJob = new QgsMapRendererJob( mMapRenderer, canvasColor(), mAntiAliasing );
+  connect( mRenderJob, SIGNAL( finished() ), this, SLOT( renderJobFinished() ) );
+  mRenderJob->start();
+
+  QSettings settings;
+  mRenderJobUpdateTimer.start( settings.value( "/Map/backgroundUpdateInterval", 250 ).toInt() );
+}
+
+void QgsMapCanvas::cancelRenderJob()
+{
+  if ( !mRenderJob )
+    return;
+
+  mRenderJobUpdateTimer.stop();
+  disconnect( mRenderJob, SIGNAL( finished() ), this, SLOT( renderJobFinished() ) );
+  // the job works on its own copies of the layers, let it finish on its own and delete itself
+  connect( mRenderJob, SIGNAL( finished() ), mRenderJob, SLOT( deleteLater() ) );
+  mRenderJob->stop();
+  if ( mRenderJob->isFinished() )
+  {
+    mRenderJob->deleteLater();
+  }
+  mRenderJob = 0;
+}
+
+void QgsMapCanvas::renderJobUpdate()
+{
+  if ( mRenderJob )
+  {
+    mMap->setContents( mRenderJob->renderedImage() );
+  }
+}
+
+void QgsMapCanvas::renderJobFinished()
+{
+  QgsMapRendererJob* job = qobject_cast<QgsMapRendererJob*>( sender() );
+  if ( !job || job != mRenderJob )
+  {
+    // finished notification of a job that has been cancelled meanwhile
+    return;
+  }
+
+  mRenderJobUpdateTimer.stop();
+  mRenderJob = 0;
+
+  // labels placed by the job are queried through the labeling engine of the canvas
+  QgsPalLabeling* jobLabeling = dynamic_cast<QgsPalLabeling*>( job->mapRenderer()->labelingEngine() );
+  QgsPalLabeling* labeling = dynamic_cast<QgsPalLabeling*>( mMapRenderer->labelingEngine() );
+  if ( jobLabeling && labeling )
+  {
+    labeling->takeResults( jobLabeling );
+  }
+
+  mMap->setContents( job->renderedImage() );
+  mDirty = false;
+
+  // notify any listeners that rendering is complete
+  QPainter p;
+  p.begin( &mMap->paintDevice() );
+  emit renderComplete( &p );
+  p.end();
+
+  // notifies current map tool
+  if ( mMapTool )
+    mMapTool->renderComplete();
+
+  job->deleteLater();
+
+  emit mapCanvasRefreshed();
+}
+
 //the format defaults to "PNG" if not specified
 void QgsMapCanvas::saveAsImage( QString theFileName, QPixmap * theQPixmap, QString theFormat )
 {
@@ -540,6 +656,12 @@ void QgsMapCanvas::setExtent( QgsRectangle const & r )
     return;
   }
 
+  // the background job renders the old extent, stop it right away
+  if ( mRenderJob )
+  {
+    mRenderJob->stop();
+  }
+
   QgsRectangle current = extent();
 
   if ( r.isEmpty() )
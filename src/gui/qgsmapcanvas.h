@@ -57,6 +57,7 @@ class QgsHighlight;
 class QgsVectorLayer;
 
 class QgsMapRenderer;
+class QgsMapRendererJob;
 class QgsMapCanvasMap;
 class QgsMapOverviewCanvas;
 class QgsMapTool;
@@ -294,6 +295,10 @@ class GUI_EXPORT QgsMapCanvas : public QGraphicsView
     /** updates pixmap on render progress */
     void updateMap();
 
+    /** Stops the rendering in progress
+      \note added in 2.0 */
+    void stopRendering();
+
     //! show whatever error is exposed by the QgsMapLayer.
     void showError( QgsMapLayer * mapLayer );
 
@@ -413,6 +418,12 @@ class GUI_EXPORT QgsMapCanvas : public QGraphicsView
   private slots:
     void crsTransformEnabled( bool );
 
+    //! shows the partial image of the background render job
+    void renderJobUpdate();
+
+    //! called when the background render job has finished
+    void renderJobFinished();
+
   private:
     /// this class is non-copyable
     /**
@@ -494,6 +505,18 @@ class GUI_EXPORT QgsMapCanvas : public QGraphicsView
 
     //! indicates whether antialiasing will be used for rendering
     bool mAntiAliasing;
+
+    //! starts rendering on a background thread, cancelling any job in progress
+    void startRenderJob();
+
+    //! cancels the background render job (if any), the job deletes itself when it has stopped
+    void cancelRenderJob();
+
+    //! background render job (NULL if not rendering in background)
+    QgsMapRendererJob* mRenderJob;
+
+    //! periodically pushes partial images of the render job to the map
+    QTimer mRenderJobUpdateTimer;
 }; // class QgsMapCanvas
 
 
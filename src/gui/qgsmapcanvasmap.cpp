@@ -119,3 +119,14 @@ void QgsMapCanvasMap::updateContents()
   // trigger update of this item
   update();
 }
+
+void QgsMapCanvasMap::setContents( const QImage& image )
+{
+  if ( image.size() != mPixmap.size() )
+    return;
+
+  if ( mUseQImageToRender )
+    mImage = image;
+  mPixmap = QPixmap::fromImage( image );
+  update();
+}
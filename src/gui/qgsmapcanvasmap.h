@@ -58,6 +58,10 @@ class GUI_EXPORT QgsMapCanvasMap : public QGraphicsRectItem
     //! Added in version 1.2
     void updateContents();
 
+    //! Replace contents with an image rendered elsewhere (e.g. on a background thread)
+    //! Added in version 2.0
+    void setContents( const QImage& image );
+
   private:
 
     //! indicates whether antialiasing will be used for rendering
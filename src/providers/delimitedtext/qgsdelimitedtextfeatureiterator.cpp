@@ -17,8 +17,9 @@
 #include "qgsdelimitedtextprovider.h"
 
 #include "qgsgeometry.h"
+#include "qgsspatialindex.h"
 
-#include <QTextStream>
+#include <QtAlgorithms>
 
 QgsDelimitedTextFeatureIterator::QgsDelimitedTextFeatureIterator( QgsDelimitedTextProvider* p, const QgsFeatureRequest& request )
     : QgsAbstractFeatureIterator( request ), P( p )
@@ -45,9 +46,27 @@ bool QgsDelimitedTextFeatureIterator::nextFeature( QgsFeature& feature )
   if ( mClosed )
     return false;
 
-  while ( !P->mStream->atEnd() )
+  while ( true )
   {
-    QString line = P->readLine( P->mStream ); // Default local 8 bit encoding
+    QString line;
+    if ( mUseFeatureIds )
+    {
+      // seek directly to the record of the next feature
+      if ( mNextFeatureId >= mFeatureIds.size() )
+        break;
+
+      mFid = mFeatureIds[ mNextFeatureId++ ];
+      qint64 pos = P->mFeatureOffsets[ mFid - 1 ];
+      line = P->readRecord( pos );
+    }
+    else
+    {
+      if ( mPos >= P->mFileSize )
+        break;
+
+      line = P->readRecord( mPos );
+    }
+
     if ( line.isEmpty() )
       continue;
 
@@ -70,11 +89,20 @@ bool QgsDelimitedTextFeatureIterator::nextFeature( QgsFeature& feature )
 
     if ( !geom && P->mWkbType != QGis::WKBNoGeometry )
     {
-      P->mInvalidLines << line;
+      if ( !mUseFeatureIds )
+        P->mInvalidLines << line;
       continue;
     }
 
-    mFid++;
+    // feature ids are numbers of valid records in the file, independent of the filter
+    if ( !mUseFeatureIds )
+      mFid++;
+
+    if ( geom && !boundsCheck( geom ) )
+    {
+      delete geom;
+      continue;
+    }
 
     // At this point the current feature values are valid
 
@@ -106,7 +134,7 @@ bool QgsDelimitedTextFeatureIterator::nextFeature( QgsFeature& feature )
     // We have a good line, so return
     return true;
 
-  } // !mStream->atEnd()
+  }
 
   // End of the file. If there are any lines that couldn't be
   // loaded, display them now.
@@ -124,10 +152,27 @@ bool QgsDelimitedTextFeatureIterator::rewind()
   // Reset feature id to 0
   mFid = 0;
   // Skip to first data record
-  P->mStream->seek( 0 );
-  int n = P->mFirstDataLine - 1;
-  while ( n-- > 0 )
-    P->readLine( P->mStream );
+  mPos = P->mFirstDataOffset;
+
+  mUseFeatureIds = false;
+  mFeatureIds.clear();
+  mNextFeatureId = 0;
+
+  if ( mRequest.filterType() == QgsFeatureRequest::FilterFid )
+  {
+    mUseFeatureIds = true;
+    QgsFeatureId fid = mRequest.filterFid();
+    if ( fid >= 1 && fid <= P->mFeatureOffsets.size() )
+      mFeatureIds << fid;
+  }
+  else if ( mRequest.filterType() == QgsFeatureRequest::FilterRect && P->mSpatialIndex &&
+            !( mRequest.flags() & QgsFeatureRequest::NoGeometry ) )
+  {
+    // candidates from the spatial index, read in file order
+    mUseFeatureIds = true;
+    mFeatureIds = P->mSpatialIndex->intersects( mRequest.filterRect() );
+    qSort( mFeatureIds );
+  }
 
   return true;
 }
@@ -170,11 +215,6 @@ QgsGeometry* QgsDelimitedTextFeatureIterator::loadGeometryWkt( const QStringList
     delete geom;
     geom = 0;
   }
-  if ( geom && !boundsCheck( geom ) )
-  {
-    delete geom;
-    geom = 0;
-  }
   return geom;
 }
 
@@ -195,10 +235,7 @@ QgsGeometry* QgsDelimitedTextFeatureIterator::loadGeometryXY( const QStringList&
   double y = sY.toDouble( &yOk );
   if ( xOk && yOk )
   {
-    if ( boundsCheck( x, y ) )
-    {
-      return QgsGeometry::fromPoint( QgsPoint( x, y ) );
-    }
+    return QgsGeometry::fromPoint( QgsPoint( x, y ) );
   }
   return 0;
 }
@@ -226,6 +263,9 @@ bool QgsDelimitedTextFeatureIterator::boundsCheck( QgsGeometry *geom )
   if ( mRequest.filterType() != QgsFeatureRequest::FilterRect || ( mRequest.flags() & QgsFeatureRequest::NoGeometry ) )
     return true;
 
+  if ( geom->wkbType() == QGis::WKBPoint )
+    return boundsCheck( geom->asPoint().x(), geom->asPoint().y() );
+
   if ( mRequest.flags() & QgsFeatureRequest::ExactIntersect )
     return geom->intersects( mRequest.filterRect() );
   else
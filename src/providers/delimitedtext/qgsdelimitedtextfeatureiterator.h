@@ -41,6 +41,16 @@ class QgsDelimitedTextFeatureIterator : public QgsAbstractFeatureIterator
     //! Feature id
     long mFid;
 
+    //! Offset of the next record when reading the file sequentially
+    qint64 mPos;
+
+    //! Whether only the features in mFeatureIds are read (fid request or rectangle with spatial index)
+    bool mUseFeatureIds;
+    //! Ids of the features to read in file order
+    QList<QgsFeatureId> mFeatureIds;
+    //! Index of the next feature in mFeatureIds
+    int mNextFeatureId;
+
     QgsGeometry* loadGeometryWkt( const QStringList& tokens );
     QgsGeometry* loadGeometryXY( const QStringList& tokens );
 
@@ -25,6 +25,7 @@
 #include <QMessageBox>
 #include <QSettings>
 #include <QRegExp>
+#include <QTextCodec>
 #include <QUrl>
 
 #include "qgsapplication.h"
@@ -35,6 +36,7 @@
 #include "qgslogger.h"
 #include "qgsmessageoutput.h"
 #include "qgsrectangle.h"
+#include "qgsspatialindex.h"
 #include "qgis.h"
 
 #include "qgsdelimitedtextsourceselect.h"
@@ -142,9 +144,12 @@ QgsDelimitedTextProvider::QgsDelimitedTextProvider( QString uri )
     , mWktZMRegexp( "\\s+(?:z|m|zm)(?=\\s*\\()", Qt::CaseInsensitive )
     , mWktCrdRegexp( "(\\-?\\d+(?:\\.\\d*)?\\s+\\-?\\d+(?:\\.\\d*)?)\\s[\\s\\d\\.\\-]+" )
     , mFile( 0 )
-    , mStream( 0 )
+    , mFileSize( 0 )
+    , mMappedData( 0 )
+    , mCodec( QTextCodec::codecForLocale() )
     , mSkipLines( 0 )
-    , mFirstDataLine( 0 )
+    , mFirstDataOffset( 0 )
+    , mSpatialIndex( 0 )
     , mShowInvalidLines( false )
     , mCrs()
     , mWkbType( QGis::WKBUnknown )
@@ -217,7 +222,35 @@ QgsDelimitedTextProvider::QgsDelimitedTextProvider( QString uri )
     return;
   }
 
-  // now we have the file opened and ready for parsing
+  // now we have the file opened and ready for parsing.
+  // Records are read at their offsets, directly from memory if the file can be mapped
+  mFileSize = mFile->size();
+
+  qint64 pos = 0;
+  QTextCodec *bomCodec = QTextCodec::codecForUtfText( mFile->peek( 4 ), 0 );
+  if ( bomCodec && bomCodec->mibEnum() != 106 )
+  {
+    // UTF-16 / UTF-32 byte order mark: line breaks are not single bytes,
+    // records are read from a UTF-8 copy of the text
+    QgsDebugMsg( QString( "Converting %1 text to UTF-8" ).arg( QString( bomCodec->name() ) ) );
+    mConvertedData = bomCodec->toUnicode( mFile->readAll() ).toUtf8();
+    mMappedData = reinterpret_cast<uchar *>( mConvertedData.data() );
+    mFileSize = mConvertedData.size();
+    mCodec = QTextCodec::codecForName( "UTF-8" );
+  }
+  else
+  {
+    mMappedData = mFile->map( 0, mFileSize );
+    if ( !mMappedData )
+      QgsDebugMsg( "File could not be mapped, reading through the device" );
+
+    if ( bomCodec )
+    {
+      // skip UTF-8 byte order mark
+      mCodec = bomCodec;
+      pos = 3;
+    }
+  }
 
   // set the initial extent
   mExtent = QgsRectangle();
@@ -225,15 +258,16 @@ QgsDelimitedTextProvider::QgsDelimitedTextProvider( QString uri )
   QMap<int, bool> couldBeInt;
   QMap<int, bool> couldBeDouble;
 
-  mStream = new QTextStream( mFile );
   QString line;
   mNumberFeatures = 0;
+  mFirstDataOffset = mFileSize;
   int lineNumber = 0;
   bool hasFields = false;
-  while ( !mStream->atEnd() )
+  while ( pos < mFileSize )
   {
     lineNumber++;
-    line = readLine( mStream ); // line of text excluding '\n', default local 8 bit encoding.
+    qint64 recordOffset = pos;
+    line = readRecord( pos ); // line of text excluding '\n', default local 8 bit encoding.
 
     if ( lineNumber < mSkipLines + 1 )
       continue;
@@ -308,8 +342,8 @@ QgsDelimitedTextProvider::QgsDelimitedTextProvider( QString uri )
     }
     else // hasFields == true - field names already read
     {
-      if ( mFirstDataLine == 0 )
-        mFirstDataLine = lineNumber;
+      if ( mFirstDataOffset == mFileSize )
+        mFirstDataOffset = recordOffset;
 
       // split the line on the delimiter
       QStringList parts = splitLine( line );
@@ -345,22 +379,39 @@ QgsDelimitedTextProvider::QgsDelimitedTextProvider( QString uri )
         if ( geom )
         {
           QGis::WkbType type = geom->wkbType();
+          bool valid = false;
           if ( type != QGis::WKBNoGeometry )
           {
             if ( mNumberFeatures == 0 )
             {
-              mNumberFeatures++;
+              valid = true;
               mWkbType = type;
               mExtent = geom->boundingBox();
             }
             else if ( type == mWkbType )
             {
-              mNumberFeatures++;
+              valid = true;
               QgsRectangle bbox( geom->boundingBox() );
               mExtent.combineExtentWith( &bbox );
             }
           }
-          delete geom;
+
+          if ( valid )
+          {
+            mNumberFeatures++;
+            mFeatureOffsets.append( recordOffset );
+
+            // index takes the bounding box of the feature
+            QgsFeature f( mNumberFeatures );
+            f.setGeometry( geom );
+            if ( !mSpatialIndex )
+              mSpatialIndex = new QgsSpatialIndex();
+            mSpatialIndex->insertFeature( f );
+          }
+          else
+          {
+            delete geom;
+          }
         }
       }
       else if ( mWktFieldIndex == -1 && mXFieldIndex >= 0 && mYFieldIndex >= 0 )
@@ -396,6 +447,13 @@ QgsDelimitedTextProvider::QgsDelimitedTextProvider( QString uri )
             mWkbType = QGis::WKBPoint;
           }
           mNumberFeatures++;
+          mFeatureOffsets.append( recordOffset );
+
+          QgsFeature f( mNumberFeatures );
+          f.setGeometry( QgsGeometry::fromPoint( QgsPoint( x, y ) ) );
+          if ( !mSpatialIndex )
+            mSpatialIndex = new QgsSpatialIndex();
+          mSpatialIndex->insertFeature( f );
         }
         else
         {
@@ -406,6 +464,7 @@ QgsDelimitedTextProvider::QgsDelimitedTextProvider( QString uri )
       {
         mWkbType = QGis::WKBNoGeometry;
         mNumberFeatures++;
+        mFeatureOffsets.append( recordOffset );
       }
 
       for ( int i = 0; i < attributeFields.size(); i++ )
@@ -454,9 +513,13 @@ QgsDelimitedTextProvider::~QgsDelimitedTextProvider()
     mActiveIterator->close();
 
   if ( mFile )
+  {
+    if ( mMappedData && mConvertedData.isEmpty() )
+      mFile->unmap( mMappedData );
     mFile->close();
+  }
   delete mFile;
-  delete mStream;
+  delete mSpatialIndex;
 }
 
 
@@ -472,6 +535,48 @@ QgsFeatureIterator QgsDelimitedTextProvider::getFeatures( const QgsFeatureReques
 }
 
 
+QString QgsDelimitedTextProvider::readRecord( qint64 &pos )
+{
+  if ( mMappedData )
+  {
+    const char *data = reinterpret_cast<const char *>( mMappedData );
+
+    // skip leading CR / LF
+    while ( pos < mFileSize && ( data[pos] == '\r' || data[pos] == '\n' ) )
+      pos++;
+
+    qint64 start = pos;
+    while ( pos < mFileSize && data[pos] != '\r' && data[pos] != '\n' )
+      pos++;
+
+    return mCodec->toUnicode( data + start, pos - start );
+  }
+
+  if ( mFile->pos() != pos )
+    mFile->seek( pos );
+
+  QByteArray buffer;
+  char c;
+  while ( mFile->getChar( &c ) )
+  {
+    if ( c == '\r' || c == '\n' )
+    {
+      if ( buffer.isEmpty() )
+      {
+        // skip leading CR / LF
+        continue;
+      }
+
+      break;
+    }
+
+    buffer.append( c );
+  }
+
+  pos = mFile->pos();
+  return mCodec->toUnicode( buffer );
+}
+
 void QgsDelimitedTextProvider::handleInvalidLines()
 {
   if ( mShowInvalidLines && !mInvalidLines.isEmpty() )
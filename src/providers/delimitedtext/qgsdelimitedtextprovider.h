@@ -19,11 +19,15 @@
 #include "qgsvectordataprovider.h"
 #include "qgscoordinatereferencesystem.h"
 
+#include <QByteArray>
 #include <QStringList>
+#include <QVector>
 
 class QgsFeature;
 class QgsField;
+class QgsSpatialIndex;
 class QFile;
+class QTextCodec;
 class QTextStream;
 
 class QgsDelimitedTextFeatureIterator;
@@ -157,6 +161,12 @@ class QgsDelimitedTextProvider : public QgsVectorDataProvider
 
     void handleInvalidLines();
 
+    /**
+     * Read the record starting at byte offset pos (leading line breaks are skipped)
+     * and move pos after it. Returns an empty string at the end of the file.
+     */
+    QString readRecord( qint64 &pos );
+
     //! Fields
     QList<int> attributeColumns;
     QgsFields attributeFields;
@@ -185,8 +195,16 @@ class QgsDelimitedTextProvider : public QgsVectorDataProvider
 
     //! Text file
     QFile *mFile;
+    qint64 mFileSize;
+
+    //! Contents of the memory mapped file or of mConvertedData (0 if the file is read through mFile)
+    uchar *mMappedData;
 
-    QTextStream *mStream;
+    //! UTF-8 copy of UTF-16 and UTF-32 files, offsets of records refer to it
+    QByteArray mConvertedData;
+
+    //! Codec of the file
+    QTextCodec *mCodec;
 
     bool mValid;
 
@@ -194,7 +212,13 @@ class QgsDelimitedTextProvider : public QgsVectorDataProvider
 
     long mNumberFeatures;
     int mSkipLines;
-    int mFirstDataLine; // Actual first line of data (accounting for blank lines)
+    qint64 mFirstDataOffset; // Offset of the first data line in the file
+
+    //! Offsets of records of the features in the file (index is feature id - 1)
+    QVector<qint64> mFeatureOffsets;
+
+    //! Spatial index of the features (0 for layers without geometry)
+    QgsSpatialIndex *mSpatialIndex;
     QString mDecimalPoint;
 
     //! Storage for any lines in the file that couldn't be loaded
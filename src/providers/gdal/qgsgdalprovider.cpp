@@ -29,6 +29,8 @@
 #include "qgsrectangle.h"
 #include "qgscoordinatereferencesystem.h"
 #include "qgsrasterbandstats.h"
+#include "qgsrasterblockcache.h"
+#include "qgsrasterstatisticscache.h"
 #include "qgsrasterlayer.h"
 #include "qgsrasterpyramid.h"
 
@@ -154,6 +156,7 @@ QgsRasterInterface * QgsGdalProvider::clone() const
 {
   QgsDebugMsg( "Entered" );
   QgsGdalProvider * provider = new QgsGdalProvider( dataSourceUri() );
+  provider->copyBaseSettings( *this );
   return provider;
 }
 
@@ -551,14 +554,23 @@ void QgsGdalProvider::readBlock( int theBandNo, QgsRectangle  const & theExtent,
     QgsDebugMsg( QString( "Coudn't allocate temporary buffer of %1 bytes" ).arg( dataSize * tmpWidth * tmpHeight ) );
     return;
   }
-  GDALRasterBandH gdalBand = GDALGetRasterBand( mGdalDataset, theBandNo );
-  GDALDataType type = ( GDALDataType )mGdalDataType[theBandNo-1];
   CPLErrorReset();
-  CPLErr err = GDALRasterIO( gdalBand, GF_Read,
-                             srcLeft, srcTop, srcWidth, srcHeight,
-                             ( void * )tmpBlock,
-                             tmpWidth, tmpHeight, type,
-                             0, 0 );
+  CPLErr err;
+  if ( QgsRasterBlockCache::instance()->maxSize() > 0 )
+  {
+    err = readCachedWindow( theBandNo, srcLeft, srcTop, srcWidth, srcHeight,
+                            ( void * )tmpBlock, tmpWidth, tmpHeight );
+  }
+  else
+  {
+    GDALRasterBandH gdalBand = GDALGetRasterBand( mGdalDataset, theBandNo );
+    GDALDataType type = ( GDALDataType )mGdalDataType[theBandNo-1];
+    err = GDALRasterIO( gdalBand, GF_Read,
+                        srcLeft, srcTop, srcWidth, srcHeight,
+                        ( void * )tmpBlock,
+                        tmpWidth, tmpHeight, type,
+                        0, 0 );
+  }
 
   if ( err != CPLE_None )
   {
@@ -603,6 +615,166 @@ void QgsGdalProvider::readBlock( int theBandNo, QgsRectangle  const & theExtent,
   return;
 }
 
+CPLErr QgsGdalProvider::readCachedWindow( int bandNo, int xOff, int yOff, int xSize, int ySize, void *buffer, int bufXSize, int bufYSize )
+{
+  GDALRasterBandH gdalBand = GDALGetRasterBand( mGdalDataset, bandNo );
+  GDALDataType type = ( GDALDataType )mGdalDataType[bandNo-1];
+  int dataSize = GDALGetDataTypeSize( type ) / 8;
+  int bandXSize = GDALGetRasterBandXSize( gdalBand );
+  int bandYSize = GDALGetRasterBandYSize( gdalBand );
+
+  // Select the overview and the window in it as GDALBandGetBestOverviewLevel()
+  // does for GDALRasterIO(), i.e. the one with the largest reduction below
+  // the requested one, so that the same cells are sampled
+  int level = 0;
+  GDALRasterBandH levelBand = gdalBand;
+  int winXOff = xOff;
+  int winYOff = yOff;
+  int winXSize = xSize;
+  int winYSize = ySize;
+  if ( bufXSize < xSize || bufYSize < ySize )
+  {
+    double reduction = ( double )ySize / bufYSize;
+    if (( double )xSize / bufXSize < reduction || bufYSize == 1 )
+    {
+      reduction = ( double )xSize / bufXSize;
+    }
+    double levelReduction = 1.;
+    for ( int i = 0; i < GDALGetOverviewCount( gdalBand ); i++ )
+    {
+      GDALRasterBandH overview = GDALGetOverview( gdalBand, i );
+      if ( !overview )
+        continue;
+      double overviewReduction = qMin(( double )bandXSize / GDALGetRasterBandXSize( overview ),
+                                      ( double )bandYSize / GDALGetRasterBandYSize( overview ) );
+      if ( overviewReduction < reduction * 1.2 && overviewReduction > levelReduction )
+      {
+        level = i + 1;
+        levelBand = overview;
+        levelReduction = overviewReduction;
+      }
+    }
+  }
+  int levelXSize = GDALGetRasterBandXSize( levelBand );
+  int levelYSize = GDALGetRasterBandYSize( levelBand );
+  if ( level > 0 )
+  {
+    double xRes = ( double )bandXSize / levelXSize;
+    double yRes = ( double )bandYSize / levelYSize;
+    winXOff = qMin( levelXSize - 1, static_cast<int>( xOff / xRes + 0.5 ) );
+    winYOff = qMin( levelYSize - 1, static_cast<int>( yOff / yRes + 0.5 ) );
+    winXSize = qMin( qMax( 1, static_cast<int>( xSize / xRes + 0.5 ) ), levelXSize - winXOff );
+    winYSize = qMin( qMax( 1, static_cast<int>( ySize / yRes + 0.5 ) ), levelYSize - winYOff );
+  }
+
+  int blockXSize, blockYSize;
+  GDALGetBlockSize( levelBand, &blockXSize, &blockYSize );
+
+  // Column / row in the level for centers of buffer cells, both are increasing,
+  // computed the same way as by GDALRasterBand::IRasterIO()
+  double xInc = ( double )winXSize / bufXSize;
+  double yInc = ( double )winYSize / bufYSize;
+  QVector<int> levelCols( bufXSize );
+  for ( int col = 0; col < bufXSize; col++ )
+  {
+    levelCols[col] = qMin( winXOff + static_cast<int>(( col + 0.5 ) * xInc ), levelXSize - 1 );
+  }
+  QVector<int> levelRows( bufYSize );
+  for ( int row = 0; row < bufYSize; row++ )
+  {
+    levelRows[row] = qMin( winYOff + static_cast<int>(( row + 0.5 ) * yInc ), levelYSize - 1 );
+  }
+
+  // Only the blocks containing sampled columns and rows are needed, e.g. with
+  // one line blocks of a strip organized file every n-th line only. For each
+  // of them the first buffer column / row in it is kept, the last one is the
+  // first of the next block.
+  QVector<int> xBlocks, bufCols;
+  for ( int col = 0; col < bufXSize; col++ )
+  {
+    int xBlock = levelCols[col] / blockXSize;
+    if ( xBlocks.isEmpty() || xBlocks.last() != xBlock )
+    {
+      xBlocks << xBlock;
+      bufCols << col;
+    }
+  }
+  bufCols << bufXSize;
+  QVector<int> yBlocks, bufRows;
+  for ( int row = 0; row < bufYSize; row++ )
+  {
+    int yBlock = levelRows[row] / blockYSize;
+    if ( yBlocks.isEmpty() || yBlocks.last() != yBlock )
+    {
+      yBlocks << yBlock;
+      bufRows << row;
+    }
+  }
+  bufRows << bufYSize;
+
+  // Blocks of a window larger than the cache would only push each other out
+  // of it, the window is read directly
+  QgsRasterBlockCache *cache = QgsRasterBlockCache::instance();
+  qint64 blockBytes = ( qint64 )dataSize * blockXSize * blockYSize;
+  if ( blockBytes * xBlocks.size() * yBlocks.size() > ( qint64 )cache->maxSize() * 1024 )
+  {
+    return GDALRasterIO( gdalBand, GF_Read, xOff, yOff, xSize, ySize,
+                         buffer, bufXSize, bufYSize, type, 0, 0 );
+  }
+
+  // Get the blocks one by one from the cache or from the dataset and copy
+  // their sampled cells to the buffer, blocks are stored with full block size,
+  // edge blocks are only partly filled
+  char *dst = ( char * )buffer;
+  QByteArray data;
+  for ( int j = 0; j < yBlocks.size(); j++ )
+  {
+    int yBlock = yBlocks[j];
+    for ( int i = 0; i < xBlocks.size(); i++ )
+    {
+      int xBlock = xBlocks[i];
+      if ( !cache->block( mBlockCacheKey, bandNo, type, level, xBlock, yBlock, data ) )
+      {
+        data.resize( blockBytes );
+        int width = qMin( blockXSize, levelXSize - xBlock * blockXSize );
+        int height = qMin( blockYSize, levelYSize - yBlock * blockYSize );
+        CPLErr err = GDALRasterIO( levelBand, GF_Read,
+                                   xBlock * blockXSize, yBlock * blockYSize, width, height,
+                                   data.data(), width, height, type,
+                                   dataSize, dataSize * blockXSize );
+        if ( err != CE_None )
+          return err;
+
+        cache->insert( mBlockCacheKey, bandNo, type, level, xBlock, yBlock, data );
+      }
+
+      const char *src = data.constData();
+      for ( int row = bufRows[j]; row < bufRows[j+1]; row++ )
+      {
+        size_t blockRowOffset = ( size_t )( levelRows[row] - yBlock * blockYSize ) * blockXSize;
+        char *dstCell = dst + dataSize * (( size_t )row * bufXSize + bufCols[i] );
+        for ( int col = bufCols[i]; col < bufCols[i+1]; col++ )
+        {
+          memcpy( dstCell, src + dataSize * ( blockRowOffset + levelCols[col] - xBlock * blockXSize ), dataSize );
+          dstCell += dataSize;
+        }
+      }
+    }
+  }
+  return CE_None;
+}
+
+void QgsGdalProvider::updateBlockCacheKey()
+{
+  // the file may be rewritten by other applications, blocks read before are not valid
+  QFileInfo fileInfo( dataSourceUri() );
+  mBlockCacheKey = dataSourceUri();
+  if ( fileInfo.exists() )
+  {
+    mBlockCacheKey += ":" + QString::number( fileInfo.lastModified().toTime_t() );
+  }
+}
+
 //void * QgsGdalProvider::readBlock( int bandNo, QgsRectangle  const & extent, int width, int height )
 //{
 //  return 0;
@@ -954,7 +1126,8 @@ int QgsGdalProvider::capabilities() const
                    | QgsRasterDataProvider::BuildPyramids
                    | QgsRasterDataProvider::Histogram
                    | QgsRasterDataProvider::Create
-                   | QgsRasterDataProvider::Remove;
+                   | QgsRasterDataProvider::Remove
+                   | QgsRasterDataProvider::ParallelRead;
   GDALDriverH myDriver = GDALGetDatasetDriver( mGdalDataset );
   QString name = GDALGetDriverShortName( myDriver );
   QgsDebugMsg( "driver short name = " + name );
@@ -1115,6 +1288,13 @@ bool QgsGdalProvider::hasHistogram( int theBandNo,
   QgsRasterHistogram myHistogram;
   initHistogram( myHistogram, theBandNo, theBinCount, theMinimum, theMaximum, theExtent, theSampleSize, theIncludeOutOfRange );
 
+  // Then check if stored by another session
+  if ( QgsRasterStatisticsCache::histogram( mBlockCacheKey, QgsRasterStatisticsCache::noDataKey( this, theBandNo ), myHistogram ) )
+  {
+    mHistograms.append( myHistogram );
+    return true;
+  }
+
   // If not cached, check if supported by GDAL
   if ( myHistogram.extent != extent() )
   {
@@ -1197,10 +1377,19 @@ QgsRasterHistogram QgsGdalProvider::histogram( int theBandNo,
     }
   }
 
+  if ( QgsRasterStatisticsCache::histogram( mBlockCacheKey, QgsRasterStatisticsCache::noDataKey( this, theBandNo ), myHistogram ) )
+  {
+    QgsDebugMsg( "Using stored histogram." );
+    mHistograms.append( myHistogram );
+    return myHistogram;
+  }
+
   if ( myHistogram.extent != extent() )
   {
     QgsDebugMsg( "Using generic histogram." );
-    return QgsRasterDataProvider::histogram( theBandNo, theBinCount, theMinimum, theMaximum, theExtent, theSampleSize, theIncludeOutOfRange );
+    myHistogram = QgsRasterDataProvider::histogram( theBandNo, theBinCount, theMinimum, theMaximum, theExtent, theSampleSize, theIncludeOutOfRange );
+    QgsRasterStatisticsCache::insertHistogram( mBlockCacheKey, QgsRasterStatisticsCache::noDataKey( this, theBandNo ), myHistogram );
+    return myHistogram;
   }
 
   QgsDebugMsg( "Computing GDAL histogram" );
@@ -1308,6 +1497,7 @@ QgsRasterHistogram QgsGdalProvider::histogram( int theBandNo,
   QgsDebugMsg( ">>>>> Histogram vector now contains " + QString::number( myHistogram.histogramVector.size() ) + " elements" );
 
   mHistograms.append( myHistogram );
+  QgsRasterStatisticsCache::insertHistogram( mBlockCacheKey, QgsRasterStatisticsCache::noDataKey( this, theBandNo ), myHistogram );
   return myHistogram;
 }
 
@@ -1538,6 +1728,10 @@ QString QgsGdalProvider::buildPyramids( const QList<QgsRasterPyramid> & theRaste
     mGdalDataset = mGdalBaseDataset;
   }
 
+  // overviews were replaced, internal ones also change the file
+  QgsRasterBlockCache::instance()->remove( mBlockCacheKey );
+  updateBlockCacheKey();
+
   //emit drawingProgress( 0, 0 );
   return NULL; // returning null on success
 }
@@ -2024,6 +2218,13 @@ bool QgsGdalProvider::hasStatistics( int theBandNo,
   QgsRasterBandStats myRasterBandStats;
   initStatistics( myRasterBandStats, theBandNo, theStats, theExtent, theSampleSize );
 
+  // Then check if stored by another session
+  if ( QgsRasterStatisticsCache::statistics( mBlockCacheKey, QgsRasterStatisticsCache::noDataKey( this, theBandNo ), myRasterBandStats ) )
+  {
+    mStatistics.append( myRasterBandStats );
+    return true;
+  }
+
   // If not cached, check if supported by GDAL
   int supportedStats = QgsRasterBandStats::Min | QgsRasterBandStats::Max
                        | QgsRasterBandStats::Range | QgsRasterBandStats::Mean
@@ -2109,6 +2310,13 @@ QgsRasterBandStats QgsGdalProvider::bandStatistics( int theBandNo, int theStats,
     }
   }
 
+  if ( QgsRasterStatisticsCache::statistics( mBlockCacheKey, QgsRasterStatisticsCache::noDataKey( this, theBandNo ), myRasterBandStats ) )
+  {
+    QgsDebugMsg( "Using stored statistics." );
+    mStatistics.append( myRasterBandStats );
+    return myRasterBandStats;
+  }
+
   int supportedStats = QgsRasterBandStats::Min | QgsRasterBandStats::Max
                        | QgsRasterBandStats::Range | QgsRasterBandStats::Mean
                        | QgsRasterBandStats::StdDev;
@@ -2119,7 +2327,9 @@ QgsRasterBandStats QgsGdalProvider::bandStatistics( int theBandNo, int theStats,
        ( theStats & ( ~supportedStats ) ) )
   {
     QgsDebugMsg( "Using generic statistics." );
-    return QgsRasterDataProvider::bandStatistics( theBandNo, theStats, theExtent, theSampleSize );
+    myRasterBandStats = QgsRasterDataProvider::bandStatistics( theBandNo, theStats, theExtent, theSampleSize );
+    QgsRasterStatisticsCache::insertStatistics( mBlockCacheKey, QgsRasterStatisticsCache::noDataKey( this, theBandNo ), myRasterBandStats );
+    return myRasterBandStats;
   }
 
   QgsDebugMsg( "Using GDAL statistics." );
@@ -2200,6 +2410,7 @@ QgsRasterBandStats QgsGdalProvider::bandStatistics( int theBandNo, int theStats,
     QgsDebugMsg( QString( "MEAN %1" ).arg( myRasterBandStats.mean ) );
     QgsDebugMsg( QString( "STDDEV %1" ).arg( myRasterBandStats.stdDev ) );
 #endif
+    QgsRasterStatisticsCache::insertStatistics( mBlockCacheKey, QgsRasterStatisticsCache::noDataKey( this, theBandNo ), myRasterBandStats );
   }
 
   mStatistics.append( myRasterBandStats );
@@ -2293,6 +2504,8 @@ void QgsGdalProvider::initBaseDataset()
   // check if this file has pyramids
   mHasPyramids = GDALGetOverviewCount( myGDALBand ) > 0;
 
+  updateBlockCacheKey();
+
   // Get the layer's projection info and set up the
   // QgsCoordinateTransform for this layer
   // NOTE: we must do this before metadata is called
@@ -2467,6 +2680,7 @@ bool QgsGdalProvider::write( void* data, int band, int width, int height, int xO
   {
     return false;
   }
+  QgsRasterBlockCache::instance()->remove( mBlockCacheKey );
   return GDALRasterIO( rasterBand, GF_Write, xOffset, yOffset, width, height, data, width, height, GDALGetRasterDataType( rasterBand ), 0, 0 ) == CE_None;
 }
 
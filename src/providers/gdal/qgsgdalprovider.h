@@ -274,6 +274,16 @@ class QgsGdalProvider : public QgsRasterDataProvider, QgsGdalProviderBase
     /**Do some initialisation on the dataset (e.g. handling of south-up datasets)*/
     void initBaseDataset();
 
+    /** Read a window of a band resampled to buffer (nearest neighbour) through the shared
+     *  block cache. Only the blocks containing sampled cells are read, from the overview
+     *  with the largest resolution not smaller than the buffer resolution. Windows with
+     *  more blocks than fit in the cache are read directly by GDALRasterIO() */
+    CPLErr readCachedWindow( int bandNo, int xOff, int yOff, int xSize, int ySize, void *buffer, int bufXSize, int bufYSize );
+
+    /** Identification of the data source in the raster block and statistics caches,
+     *  set from the uri and the modification time of the file */
+    void updateBlockCacheKey();
+
     /**
     * Flag indicating if the layer data source is a valid layer
     */
@@ -318,6 +328,9 @@ class QgsGdalProvider : public QgsRasterDataProvider, QgsGdalProviderBase
     /** \brief sublayers list saved for subsequent access */
     QStringList mSubLayers;
 
+    /** \brief data source identification in QgsRasterBlockCache and QgsRasterStatisticsCache */
+    QString mBlockCacheKey;
+
 };
 
 #endif
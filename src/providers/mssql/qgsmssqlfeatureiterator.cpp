@@ -18,11 +18,45 @@
 #include "qgsmssqlfeatureiterator.h"
 #include "qgsmssqlprovider.h"
 #include "qgslogger.h"
+#include "qgssqlexpressioncompiler.h"
 
 #include <QObject>
 #include <QTextStream>
 
 
+class QgsMssqlExpressionCompiler : public QgsSqlExpressionCompiler
+{
+  public:
+    // default collations ignore case, there is no ILIKE
+    QgsMssqlExpressionCompiler( const QgsFields& fields )
+        : QgsSqlExpressionCompiler( fields, CaseInsensitiveStringMatch | LikeIsCaseInsensitive | NoNativeILike ) {}
+
+  protected:
+    virtual QString quotedIdentifier( const QString& identifier )
+    {
+      QString quoted = identifier;
+      quoted.replace( "]", "]]" );
+      return "[" + quoted + "]";
+    }
+    virtual QString quotedValue( const QVariant& value )
+    {
+      // unicode string literal
+      if ( value.type() == QVariant::String )
+        return "N" + QgsSqlExpressionCompiler::quotedValue( value );
+      return QgsSqlExpressionCompiler::quotedValue( value );
+    }
+    virtual bool isStringField( int fieldIdx ) const
+    {
+      // dates and times are read as strings too
+      QString typeName = mFields[fieldIdx].typeName();
+      return mFields[fieldIdx].type() == QVariant::String &&
+             ( typeName.startsWith( "char", Qt::CaseInsensitive ) || typeName.startsWith( "nchar", Qt::CaseInsensitive ) ||
+               typeName.startsWith( "varchar", Qt::CaseInsensitive ) || typeName.startsWith( "nvarchar", Qt::CaseInsensitive ) ||
+               typeName.startsWith( "text", Qt::CaseInsensitive ) || typeName.startsWith( "ntext", Qt::CaseInsensitive ) );
+    }
+};
+
+
 QgsMssqlFeatureIterator::QgsMssqlFeatureIterator( QgsMssqlProvider* provider, const QgsFeatureRequest& request )
     : QgsAbstractFeatureIterator( request ), mProvider( provider )
 {
@@ -139,7 +173,7 @@ void QgsMssqlFeatureIterator::BuildStatement( const QgsFeatureRequest& request )
 
   bool filterAdded = false;
   // set spatial filter
-  if ( request.filterType() & QgsFeatureRequest::FilterRect )
+  if ( request.filterType() == QgsFeatureRequest::FilterRect )
   {
     // polygons should be CCW for SqlGeography
     QString r;
@@ -159,7 +193,7 @@ void QgsMssqlFeatureIterator::BuildStatement( const QgsFeatureRequest& request )
   }
 
   // set fid filter
-  if (( request.filterType() & QgsFeatureRequest::FilterFid ) && !mProvider->mFidColName.isEmpty() )
+  if ( request.filterType() == QgsFeatureRequest::FilterFid && !mProvider->mFidColName.isEmpty() )
   {
     // set attribute filter
     if ( !filterAdded )
@@ -169,6 +203,22 @@ void QgsMssqlFeatureIterator::BuildStatement( const QgsFeatureRequest& request )
     filterAdded = true;
   }
 
+  // set expression filter
+  if ( request.filterType() == QgsFeatureRequest::FilterExpression )
+  {
+    // columns unknown to the provider are not translated,
+    // features not matched by a partially translated expression get filtered out by the caller
+    QgsExpression* exp = mRequest.filterExpression();
+    exp->prepare( mProvider->mAttributeFields );
+
+    QgsMssqlExpressionCompiler compiler( mProvider->mAttributeFields );
+    if ( compiler.compile( exp ) != QgsSqlExpressionCompiler::Fail )
+    {
+      mStatement += ( filterAdded ? " and (" : " where (" ) + compiler.result() + ")";
+      filterAdded = true;
+    }
+  }
+
   if ( !mProvider->mSqlWhereClause.isEmpty() )
   {
     if ( !filterAdded )
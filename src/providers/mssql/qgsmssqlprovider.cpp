@@ -70,6 +70,7 @@ QgsMssqlProvider::QgsMssqlProvider( QString uri )
 
   mUseWkb = false;
   mSkipFailures = false;
+  mBulkInsert = false;
 
   mUseEstimatedMetadata = anUri.useEstimatedMetadata();
 
@@ -164,6 +165,8 @@ QgsMssqlProvider::QgsMssqlProvider( QString uri )
 
 QgsMssqlProvider::~QgsMssqlProvider()
 {
+  if ( mBulkInsert )
+    endBulkInsert();
 }
 
 QgsFeatureIterator QgsMssqlProvider::getFeatures( const QgsFeatureRequest& request )
@@ -692,6 +695,20 @@ bool QgsMssqlProvider::isValid()
 
 bool QgsMssqlProvider::addFeatures( QgsFeatureList & flist )
 {
+  // in bulk insert mode the transaction is already running,
+  // a savepoint is used to add all or none of the features
+  if ( mBulkInsert )
+  {
+    QSqlQuery query = QSqlQuery( mDatabase );
+    if ( !query.exec( "SAVE TRANSACTION addfeatures" ) )
+    {
+      QString msg = query.lastError().text();
+      QgsDebugMsg( msg );
+      pushError( msg );
+      return false;
+    }
+  }
+
   for ( QgsFeatureList::iterator it = flist.begin(); it != flist.end(); ++it )
   {
     QString statement;
@@ -774,6 +791,7 @@ bool QgsMssqlProvider::addFeatures( QgsFeatureList & flist )
         QString msg = query.lastError().text();
         QgsDebugMsg( msg );
         pushError( msg );
+        rollbackAddFeatures();
         return false;
       }
       else
@@ -845,6 +863,7 @@ bool QgsMssqlProvider::addFeatures( QgsFeatureList & flist )
       if ( !mSkipFailures )
       {
         pushError( msg );
+        rollbackAddFeatures();
         return false;
       }
     }
@@ -853,6 +872,45 @@ bool QgsMssqlProvider::addFeatures( QgsFeatureList & flist )
   return true;
 }
 
+void QgsMssqlProvider::rollbackAddFeatures()
+{
+  if ( !mBulkInsert )
+    return;
+
+  QSqlQuery query = QSqlQuery( mDatabase );
+  if ( !query.exec( "ROLLBACK TRANSACTION addfeatures" ) )
+  {
+    QgsDebugMsg( query.lastError().text() );
+  }
+}
+
+bool QgsMssqlProvider::beginBulkInsert()
+{
+  if ( mBulkInsert )
+    return false;
+
+  mBulkInsert = mDatabase.transaction();
+  return mBulkInsert;
+}
+
+bool QgsMssqlProvider::endBulkInsert()
+{
+  if ( !mBulkInsert )
+    return false;
+
+  mBulkInsert = false;
+
+  if ( !mDatabase.commit() )
+  {
+    QString msg = mDatabase.lastError().text();
+    QgsDebugMsg( msg );
+    pushError( msg );
+    return false;
+  }
+
+  return true;
+}
+
 bool QgsMssqlProvider::addAttributes( const QList<QgsField> &attributes )
 {
   QString statement;
@@ -240,6 +240,14 @@ class QgsMssqlProvider : public QgsVectorDataProvider
     /**Writes a list of features to the database*/
     virtual bool addFeatures( QgsFeatureList & flist );
 
+    /**Starts a transaction for all following addFeatures() calls
+      @note added in 2.0 */
+    virtual bool beginBulkInsert();
+
+    /**Commits the features added since beginBulkInsert()
+      @note added in 2.0 */
+    virtual bool endBulkInsert();
+
     /**Deletes a feature*/
     virtual bool deleteFeatures( const QgsFeatureIds & id );
 
@@ -314,6 +322,8 @@ class QgsMssqlProvider : public QgsVectorDataProvider
     bool mUseWkb;
     bool mUseEstimatedMetadata;
     bool mSkipFailures;
+    // features are added within a transaction started by beginBulkInsert()
+    bool mBulkInsert;
 
     int mGeomType;
 
@@ -349,6 +359,9 @@ class QgsMssqlProvider : public QgsVectorDataProvider
     // SQL statement used to limit the features retrieved
     QString mSqlWhereClause;
 
+    // Rolls back the features of a failed addFeatures() call in bulk insert mode
+    void rollbackAddFeatures();
+
     // Sets the error messages
     void setLastError( QString error )
     {
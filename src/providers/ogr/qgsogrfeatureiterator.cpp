@@ -17,14 +17,16 @@
 #include "qgsogrprovider.h"
 
 #include "qgsapplication.h"
+#include "qgsfeatureblock.h"
 #include "qgslogger.h"
 #include "qgsgeometry.h"
 
 #include <QTextCodec>
+#include <QThread>
 
 // using from provider:
 // - setRelevantFields(), mRelevantFieldsForNextFeature
-// - ogrLayer
+// - ogrLayer, openDataSource(), closeDataSource()
 // - mFetchFeaturesWithoutGeom
 // - mAttributeFields
 // - mEncoding
@@ -32,14 +34,30 @@
 
 QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrProvider* p, const QgsFeatureRequest& request )
     : QgsAbstractFeatureIterator( request ), P( p )
+    , ogrDataSource( 0 )
+    , ogrLayer( 0 )
+    , ogrOrigLayer( 0 )
 {
-  // make sure that only one iterator is active
-  if ( P->mActiveIterator )
-    P->mActiveIterator->close();
-  P->mActiveIterator = this;
-
   mFeatureFetched = false;
 
+  // the first iterator reads provider's layer, iterators running at the same time
+  // or in another thread (OGR handles are not thread-safe) open their own data source
+  {
+    QMutexLocker locker( &P->mIteratorsMutex );
+    bool useProviderLayer = !P->mLayerInUse && QThread::currentThread() == P->thread();
+    if ( useProviderLayer )
+    {
+      P->mLayerInUse = true;
+    }
+    else if ( !P->openDataSource( ogrDataSource, ogrLayer, ogrOrigLayer ) )
+    {
+      QgsDebugMsg( "Failed to open data source for iterator" );
+      mClosed = true;
+      return;
+    }
+    P->mActiveIterators.insert( this );
+  }
+
   ensureRelevantFields();
 
   // spatial query to select features
@@ -52,12 +70,12 @@ QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrProvider* p, const QgsFeatur
 
     OGR_G_CreateFromWkt(( char ** )&wktText, NULL, &filter );
     QgsDebugMsg( "Setting spatial filter using " + wktExtent );
-    OGR_L_SetSpatialFilter( P->ogrLayer, filter );
+    OGR_L_SetSpatialFilter( layer(), filter );
     OGR_G_DestroyGeometry( filter );
   }
   else
   {
-    OGR_L_SetSpatialFilter( P->ogrLayer, 0 );
+    OGR_L_SetSpatialFilter( layer(), 0 );
   }
 
   //start with first feature
@@ -69,10 +87,21 @@ QgsOgrFeatureIterator::~QgsOgrFeatureIterator()
   close();
 }
 
+OGRLayerH QgsOgrFeatureIterator::layer() const
+{
+  return ogrDataSource ? ogrLayer : P->ogrLayer;
+}
+
 void QgsOgrFeatureIterator::ensureRelevantFields()
 {
   bool needGeom = ( mRequest.filterType() == QgsFeatureRequest::FilterRect ) || !( mRequest.flags() & QgsFeatureRequest::NoGeometry );
   QgsAttributeList attrs = ( mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes ) ? mRequest.subsetOfAttributes() : P->attributeIndexes();
+  if ( ogrDataSource )
+  {
+    // nobody else uses our layer
+    P->setRelevantFields( ogrLayer, needGeom, attrs );
+    return;
+  }
   P->setRelevantFields( needGeom, attrs );
   P->mRelevantFieldsForNextFeature = true;
 }
@@ -85,12 +114,12 @@ bool QgsOgrFeatureIterator::nextFeature( QgsFeature& feature )
   if ( mClosed )
     return false;
 
-  if ( !P->mRelevantFieldsForNextFeature )
+  if ( !ogrDataSource && !P->mRelevantFieldsForNextFeature )
     ensureRelevantFields();
 
   if ( mRequest.filterType() == QgsFeatureRequest::FilterFid )
   {
-    OGRFeatureH fet = OGR_L_GetFeature( P->ogrLayer, FID_TO_NUMBER( mRequest.filterFid() ) );
+    OGRFeatureH fet = OGR_L_GetFeature( layer(), FID_TO_NUMBER( mRequest.filterFid() ) );
     if ( !fet )
     {
       close();
@@ -114,7 +143,7 @@ bool QgsOgrFeatureIterator::nextFeature( QgsFeature& feature )
 
   OGRFeatureH fet;
 
-  while (( fet = OGR_L_GetNextFeature( P->ogrLayer ) ) )
+  while (( fet = OGR_L_GetNextFeature( layer() ) ) )
   {
     // skip features without geometry
     if ( !P->mFetchFeaturesWithoutGeom && !OGR_F_GetGeometryRef( fet ) )
@@ -140,12 +169,42 @@ bool QgsOgrFeatureIterator::nextFeature( QgsFeature& feature )
 }
 
 
+int QgsOgrFeatureIterator::nextFeatureBlock( QgsFeatureBlock& block, int maxFeatures )
+{
+  // exact intersection needs QgsGeometry for each feature anyway
+  if ( mClosed || mRequest.filterType() == QgsFeatureRequest::FilterFid ||
+       ( mRequest.flags() & QgsFeatureRequest::ExactIntersect ) )
+    return QgsAbstractFeatureIterator::nextFeatureBlock( block, maxFeatures );
+
+  if ( !ogrDataSource && !P->mRelevantFieldsForNextFeature )
+    ensureRelevantFields();
+
+  block.clear();
+  block.reserve( maxFeatures );
+
+  OGRFeatureH fet;
+  while ( block.count() < maxFeatures && ( fet = OGR_L_GetNextFeature( layer() ) ) )
+  {
+    // skip features without geometry
+    if ( P->mFetchFeaturesWithoutGeom || OGR_F_GetGeometryRef( fet ) )
+      readFeatureToBlock( fet, block );
+
+    OGR_F_Destroy( fet );
+  }
+
+  if ( block.count() == 0 )
+    close();
+
+  return block.count();
+}
+
+
 bool QgsOgrFeatureIterator::rewind()
 {
   if ( mClosed )
     return false;
 
-  OGR_L_ResetReading( P->ogrLayer );
+  OGR_L_ResetReading( layer() );
 
   return true;
 }
@@ -157,7 +216,19 @@ bool QgsOgrFeatureIterator::close()
     return false;
 
   // tell provider that this iterator is not active anymore
-  P->mActiveIterator = 0;
+  QMutexLocker locker( &P->mIteratorsMutex );
+  if ( ogrDataSource )
+  {
+    P->closeDataSource( ogrDataSource, ogrLayer, ogrOrigLayer );
+    ogrDataSource = 0;
+    ogrLayer = 0;
+    ogrOrigLayer = 0;
+  }
+  else
+  {
+    P->mLayerInUse = false;
+  }
+  P->mActiveIterators.remove( this );
 
   mClosed = true;
   return true;
@@ -249,3 +320,35 @@ bool QgsOgrFeatureIterator::readFeature( OGRFeatureH fet, QgsFeature& feature )
 
   return true;
 }
+
+
+void QgsOgrFeatureIterator::readFeatureToBlock( OGRFeatureH fet, QgsFeatureBlock& block )
+{
+  int row = block.addRow( OGR_F_GetFID( fet ) );
+
+  if ( block.hasGeometry() && !( mRequest.flags() & QgsFeatureRequest::NoGeometry ) )
+  {
+    OGRGeometryH geom = OGR_F_GetGeometryRef( fet );
+    if ( geom )
+    {
+      // export WKB directly to the buffer of the block
+      int size = OGR_G_WkbSize( geom );
+      OGR_G_ExportToWkb( geom, ( OGRwkbByteOrder ) QgsApplication::endian(), block.allocateWkb( row, size ) );
+    }
+  }
+
+  for ( int col = 0; col < block.columnCount(); ++col )
+  {
+    int attindex = block.attributeIndex( col );
+    if ( attindex >= P->mAttributeFields.count() || !OGR_F_IsFieldSet( fet, attindex ) )
+      continue; // stays NULL
+
+    switch ( P->mAttributeFields[attindex].type() )
+    {
+      case QVariant::String: block.setString( col, row, P->mEncoding->toUnicode( OGR_F_GetFieldAsString( fet, attindex ) ) ); break;
+      case QVariant::Int: block.setInt( col, row, OGR_F_GetFieldAsInteger( fet, attindex ) ); break;
+      case QVariant::Double: block.setDouble( col, row, OGR_F_GetFieldAsDouble( fet, attindex ) ); break;
+      default: assert( NULL && "unsupported field type" );
+    }
+  }
+}
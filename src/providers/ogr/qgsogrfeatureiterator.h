@@ -31,6 +31,9 @@ class QgsOgrFeatureIterator : public QgsAbstractFeatureIterator
     //! fetch next feature, return true on success
     virtual bool nextFeature( QgsFeature& feature );
 
+    //! fetch a block of features reading values of OGR fields directly into the columns
+    virtual int nextFeatureBlock( QgsFeatureBlock& block, int maxFeatures );
+
     //! reset the iterator to the starting position
     virtual bool rewind();
 
@@ -42,12 +45,23 @@ class QgsOgrFeatureIterator : public QgsAbstractFeatureIterator
 
     void ensureRelevantFields();
 
+    //! OGR layer to read features from
+    OGRLayerH layer() const;
+
     bool readFeature( OGRFeatureH fet, QgsFeature& feature );
 
     //! Get an attribute associated with a feature
     void getFeatureAttribute( OGRFeatureH ogrFet, QgsFeature & f, int attindex );
 
+    //! Append a feature to the block
+    void readFeatureToBlock( OGRFeatureH fet, QgsFeatureBlock& block );
+
     bool mFeatureFetched;
+
+    //! data source opened by the iterator (0 if reading from provider's layer)
+    OGRDataSourceH ogrDataSource;
+    OGRLayerH ogrLayer;
+    OGRLayerH ogrOrigLayer;
 };
 
 
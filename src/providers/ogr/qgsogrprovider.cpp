@@ -201,7 +201,7 @@ QgsOgrProvider::QgsOgrProvider( QString const & uri )
     , ogrDriver( 0 )
     , valid( false )
     , featuresCounted( -1 )
-    , mActiveIterator( 0 )
+    , mLayerInUse( false )
 {
   QgsCPLErrorHandler handler;
 
@@ -346,8 +346,9 @@ QgsOgrProvider::QgsOgrProvider( QString const & uri )
 
 QgsOgrProvider::~QgsOgrProvider()
 {
-  if ( mActiveIterator )
-    mActiveIterator->close();
+  // closing removes the iterator from the set
+  foreach ( QgsOgrFeatureIterator* it, mActiveIterators )
+    it->close();
 
   if ( ogrLayer != ogrOrigLayer )
   {
@@ -593,6 +594,14 @@ QString QgsOgrProvider::storageType() const
 }
 
 void QgsOgrProvider::setRelevantFields( bool fetchGeometry, const QgsAttributeList &fetchAttributes )
+{
+  setRelevantFields( ogrLayer, fetchGeometry, fetchAttributes );
+
+  // mark that relevant fields may not be set appropriately for nextFeature() calls
+  mRelevantFieldsForNextFeature = false;
+}
+
+void QgsOgrProvider::setRelevantFields( OGRLayerH ogrLayer, bool fetchGeometry, const QgsAttributeList &fetchAttributes )
 {
 #if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 1800
   if ( OGR_L_TestCapability( ogrLayer, OLCIgnoreFields ) )
@@ -615,16 +624,54 @@ void QgsOgrProvider::setRelevantFields( bool fetchGeometry, const QgsAttributeLi
 
     OGR_L_SetIgnoredFields( ogrLayer, ignoredFields.data() );
   }
-
-  // mark that relevant fields may not be set appropriately for nextFeature() calls
-  mRelevantFieldsForNextFeature = false;
-
 #else
+  Q_UNUSED( ogrLayer );
   Q_UNUSED( fetchGeometry );
   Q_UNUSED( fetchAttributes );
 #endif
 }
 
+bool QgsOgrProvider::openDataSource( OGRDataSourceH& dataSource, OGRLayerH& layer, OGRLayerH& origLayer )
+{
+  QgsCPLErrorHandler handler;
+
+  // read-only access is enough for iterating
+  dataSource = OGROpen( TO8F( mFilePath ), false, NULL );
+  if ( !dataSource )
+    return false;
+
+  if ( mLayerName.isNull() )
+    origLayer = OGR_DS_GetLayer( dataSource, mLayerIndex );
+  else
+    origLayer = OGR_DS_GetLayerByName( dataSource, TO8( mLayerName ) );
+
+  layer = origLayer;
+  if ( origLayer && !mSubsetString.isEmpty() )
+  {
+    QString sql = QString( "SELECT * FROM %1 WHERE %2" )
+                  .arg( quotedIdentifier( FROM8( OGR_FD_GetName( OGR_L_GetLayerDefn( origLayer ) ) ) ) )
+                  .arg( mSubsetString );
+    layer = OGR_DS_ExecuteSQL( dataSource, mEncoding->fromUnicode( sql ).constData(), NULL, NULL );
+  }
+
+  if ( !layer )
+  {
+    OGR_DS_Destroy( dataSource );
+    dataSource = 0;
+    return false;
+  }
+
+  return true;
+}
+
+void QgsOgrProvider::closeDataSource( OGRDataSourceH dataSource, OGRLayerH layer, OGRLayerH origLayer )
+{
+  if ( layer != origLayer )
+    OGR_DS_ReleaseResultSet( dataSource, layer );
+
+  OGR_DS_Destroy( dataSource );
+}
+
 QgsFeatureIterator QgsOgrProvider::getFeatures( const QgsFeatureRequest& request )
 {
   return QgsFeatureIterator( new QgsOgrFeatureIterator( this, request ) );
@@ -1145,7 +1192,7 @@ bool QgsOgrProvider::deleteFeature( QgsFeatureId id )
 
 int QgsOgrProvider::capabilities() const
 {
-  int ability = SetEncoding;
+  int ability = SetEncoding | ThreadSafe;
 
   // collect abilities reported by OGR
   if ( ogrLayer )
@@ -27,6 +27,9 @@ class QgsOgrFeatureIterator;
 
 #include <ogr_api.h>
 
+#include <QMutex>
+#include <QSet>
+
 #if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 1800
 #define TO8(x)   (x).toUtf8().constData()
 #define TO8F(x)  (x).toUtf8().constData()
@@ -257,6 +260,14 @@ class QgsOgrProvider : public QgsVectorDataProvider
     /** tell OGR, which fields to fetch in nextFeature/featureAtId (ie. which not to ignore) */
     void setRelevantFields( bool fetchGeometry, const QgsAttributeList& fetchAttributes );
 
+    /** set fields to fetch for an OGR layer of the provider's data source (opened by the provider or an iterator) */
+    void setRelevantFields( OGRLayerH ogrLayer, bool fetchGeometry, const QgsAttributeList& fetchAttributes );
+
+    /** open another handle of the data source and the layer (with subset string applied) for an iterator,
+        return false on failure. The layer has to be released with closeDataSource() */
+    bool openDataSource( OGRDataSourceH& dataSource, OGRLayerH& layer, OGRLayerH& origLayer );
+    void closeDataSource( OGRDataSourceH dataSource, OGRLayerH layer, OGRLayerH origLayer );
+
     /** convert a QgsField to work with OGR */
     static bool convertField( QgsField &field, const QTextCodec &encoding );
 
@@ -319,5 +330,7 @@ class QgsOgrProvider : public QgsVectorDataProvider
     bool syncToDisc();
 
     friend class QgsOgrFeatureIterator;
-    QgsOgrFeatureIterator* mActiveIterator; //!< pointer to currently active iterator (0 if none)
+    QSet<QgsOgrFeatureIterator*> mActiveIterators; //!< open iterators
+    bool mLayerInUse; //!< whether an iterator reads from ogrLayer (others open their own data source)
+    QMutex mIteratorsMutex; //!< protects the iterator list (iterators may be used in other threads)
 };
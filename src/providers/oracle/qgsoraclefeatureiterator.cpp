@@ -19,9 +19,26 @@
 #include "qgslogger.h"
 #include "qgsmessagelog.h"
 #include "qgsgeometry.h"
+#include "qgssqlexpressioncompiler.h"
 
 #include <QObject>
 
+class QgsOracleExpressionCompiler : public QgsSqlExpressionCompiler
+{
+  public:
+    // there is no ILIKE in Oracle
+    QgsOracleExpressionCompiler( const QgsFields& fields )
+        : QgsSqlExpressionCompiler( fields, NoNativeILike ) {}
+
+  protected:
+    virtual QString quotedIdentifier( const QString& identifier ) { return QgsOracleConn::quotedIdentifier( identifier ); }
+    virtual QString quotedValue( const QVariant& value )
+    {
+      return value.type() == QVariant::String ? QgsOracleConn::quotedValue( value ) : QgsSqlExpressionCompiler::quotedValue( value );
+    }
+};
+
+
 QgsOracleFeatureIterator::QgsOracleFeatureIterator( QgsOracleProvider *p, const QgsFeatureRequest &request )
     : QgsAbstractFeatureIterator( request )
     , P( p )
@@ -75,6 +92,19 @@ QgsOracleFeatureIterator::QgsOracleFeatureIterator( QgsOracleProvider *p, const
       whereClause = P->whereClause( request.filterFid() );
       break;
 
+    case QgsFeatureRequest::FilterExpression:
+    {
+      // columns unknown to the provider are not translated,
+      // features not matched by a partially translated expression get filtered out by the caller
+      QgsExpression* exp = mRequest.filterExpression();
+      exp->prepare( P->mAttributeFields );
+
+      QgsOracleExpressionCompiler compiler( P->mAttributeFields );
+      if ( compiler.compile( exp ) != QgsSqlExpressionCompiler::Fail )
+        whereClause = compiler.result();
+    }
+    break;
+
     case QgsFeatureRequest::FilterNone:
       break;
   }
@@ -251,10 +281,27 @@ bool QgsOracleFeatureIterator::openQuery( QString whereClause )
   try
   {
     QString query = "SELECT ", delim = "";
+    QList<QVariant> args;
 
     if (( mRequest.flags() & QgsFeatureRequest::NoGeometry ) == 0 )
     {
-      query += P->quotedIdentifier( P->mGeometryColumn );
+      // reduce geometries to the requested resolution (SDO_UTIL.SIMPLIFY needs Oracle Spatial).
+      // The original geometry is returned if the simplified one is NULL or collapsed to a lower
+      // dimension (e.g. a polygon to a line); mod(gtype,4) is 1 for points, 2 for lines, 3 for polygons.
+      // The threshold is bound, so that the statement is the same at all scales.
+      QGis::WkbType geomType = P->mRequestedGeomType != QGis::WKBUnknown ? P->mRequestedGeomType : P->mDetectedGeomType;
+      if ( mRequest.geometryResolution() > 0 && P->mHasSpatial &&
+           QGis::flatType( QGis::singleType( geomType ) ) != QGis::WKBPoint )
+      {
+        QString geom = "\"featureRequest\"." + P->quotedIdentifier( P->mGeometryColumn );
+        query += QString( "CASE WHEN mod(mod((sdo_util.simplify(%1,?)).sdo_gtype,100),4)=mod(mod(%1.sdo_gtype,100),4)"
+                          " THEN sdo_util.simplify(%1,?) ELSE %1 END" ).arg( geom );
+        args << mRequest.geometryResolution() / 2 << mRequest.geometryResolution() / 2;
+      }
+      else
+      {
+        query += P->quotedIdentifier( P->mGeometryColumn );
+      }
       delim = ",";
     }
 
@@ -298,7 +345,7 @@ bool QgsOracleFeatureIterator::openQuery( QString whereClause )
       query += QString( " WHERE %1" ).arg( whereClause );
 
     QgsDebugMsg( QString( "Fetch features: %1" ).arg( query ) );
-    if ( !P->exec( mQry, query ) )
+    if ( !P->exec( mQry, query, args ) )
     {
       QgsMessageLog::logMessage( QObject::tr( "Fetching features failed.\nSQL:%1\nError: %2" )
                                  .arg( mQry.lastQuery() )
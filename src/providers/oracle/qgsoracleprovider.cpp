@@ -50,6 +50,7 @@ QgsOracleProvider::QgsOracleProvider( QString const & uri )
     , mRequestedGeomType( QGis::WKBUnknown )
     , mFidCounter( 0 )
     , mSpatialIndex( QString::null )
+    , mBulkInsert( false )
 {
   static int geomMetaType = -1;
   if ( geomMetaType < 0 )
@@ -196,6 +197,8 @@ QgsOracleProvider::QgsOracleProvider( QString const & uri )
 QgsOracleProvider::~QgsOracleProvider()
 {
   QgsDebugMsg( "deconstructing." );
+  if ( mBulkInsert )
+    endBulkInsert();
   disconnectDb();
 }
 
@@ -223,6 +226,35 @@ bool QgsOracleProvider::exec( QSqlQuery &qry, QString sql )
   return res;
 }
 
+bool QgsOracleProvider::exec( QSqlQuery &qry, QString sql, const QList<QVariant> &args )
+{
+  if ( args.isEmpty() )
+    return exec( qry, sql );
+
+  QgsDebugMsgLevel( QString( "SQL: %1" ).arg( sql ), 4 );
+
+  qry.setForwardOnly( true );
+
+  bool res = qry.prepare( sql );
+  if ( res )
+  {
+    foreach ( const QVariant &arg, args )
+    {
+      qry.addBindValue( arg );
+    }
+    res = qry.exec();
+  }
+
+  if ( !res )
+  {
+    QgsDebugMsg( QString( "SQL: %1\nERROR: %2" )
+                 .arg( qry.lastQuery() )
+                 .arg( qry.lastError().text() ) );
+  }
+
+  return res;
+}
+
 QString QgsOracleProvider::storageType() const
 {
   return "Oracle database with locator/spatial extension";
@@ -1176,7 +1208,14 @@ bool QgsOracleProvider::addFeatures( QgsFeatureList &flist )
   {
     QSqlQuery qry( db );
 
-    if ( !db.transaction() )
+    // in bulk insert mode the transaction is already running,
+    // a savepoint is used to add all or none of the features
+    if ( mBulkInsert )
+    {
+      if ( !exec( qry, "SAVEPOINT addfeatures" ) )
+        throw OracleException( tr( "Could not set savepoint" ), qry );
+    }
+    else if ( !db.transaction() )
     {
       throw OracleException( tr( "Could not start transaction" ), db );
     }
@@ -1336,13 +1375,13 @@ bool QgsOracleProvider::addFeatures( QgsFeatureList &flist )
 
     qry.finish();
 
-    if ( !db.commit() )
+    if ( !mBulkInsert && !db.commit() )
     {
       throw OracleException( tr( "Could not commit transaction" ), db );
     }
 
-    // update feature ids
-    if ( mPrimaryKeyType == pktInt || mPrimaryKeyType == pktFidMap )
+    // update feature ids (not needed when loading in bulk)
+    if ( !mBulkInsert && ( mPrimaryKeyType == pktInt || mPrimaryKeyType == pktFidMap ) )
     {
       for ( QgsFeatureList::iterator features = flist.begin(); features != flist.end(); features++ )
       {
@@ -1373,7 +1412,15 @@ bool QgsOracleProvider::addFeatures( QgsFeatureList &flist )
   {
     QgsDebugMsg( QString( "Oracle error: %1" ).arg( e.errorMessage() ) );
     pushError( tr( "Oracle error while adding features: %1" ).arg( e.errorMessage() ) );
-    if ( !db.rollback() )
+    if ( mBulkInsert )
+    {
+      QSqlQuery qry( db );
+      if ( !exec( qry, "ROLLBACK TO SAVEPOINT addfeatures" ) )
+      {
+        QgsMessageLog::logMessage( tr( "Could not rollback to savepoint" ), tr( "Oracle" ) );
+      }
+    }
+    else if ( !db.rollback() )
     {
       QgsMessageLog::logMessage( tr( "Could not rollback transaction" ), tr( "Oracle" ) );
     }
@@ -1383,6 +1430,33 @@ bool QgsOracleProvider::addFeatures( QgsFeatureList &flist )
   return returnvalue;
 }
 
+bool QgsOracleProvider::beginBulkInsert()
+{
+  if ( mIsQuery || mBulkInsert )
+    return false;
+
+  QSqlDatabase db( *mConnection );
+  mBulkInsert = db.transaction();
+  return mBulkInsert;
+}
+
+bool QgsOracleProvider::endBulkInsert()
+{
+  if ( !mBulkInsert )
+    return false;
+
+  mBulkInsert = false;
+
+  QSqlDatabase db( *mConnection );
+  if ( !db.commit() )
+  {
+    pushError( tr( "Oracle error while committing added features: %1" ).arg( db.lastError().text() ) );
+    return false;
+  }
+
+  return true;
+}
+
 bool QgsOracleProvider::deleteFeatures( const QgsFeatureIds & id )
 {
   bool returnvalue = true;
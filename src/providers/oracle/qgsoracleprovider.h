@@ -177,6 +177,14 @@ class QgsOracleProvider : public QgsVectorDataProvider
       @return true in case of success and false in case of failure*/
     bool addFeatures( QgsFeatureList & flist );
 
+    /**Starts a transaction for all following addFeatures() calls
+      @note added in 2.0 */
+    bool beginBulkInsert();
+
+    /**Commits the features added since beginBulkInsert()
+      @note added in 2.0 */
+    bool endBulkInsert();
+
     /**Deletes a list of features
       @param id list of feature ids
       @return true in case of success and false in case of failure*/
@@ -259,6 +267,8 @@ class QgsOracleProvider : public QgsVectorDataProvider
     virtual QgsFeatureIterator getFeatures( const QgsFeatureRequest& request = QgsFeatureRequest() );
 
     static bool exec( QSqlQuery &qry, QString sql );
+    //! execute the statement with the values bound to its placeholders
+    static bool exec( QSqlQuery &qry, QString sql, const QList<QVariant> &args );
 
   private:
     QString whereClause( QgsFeatureId featureId ) const;
@@ -390,6 +400,7 @@ class QgsOracleProvider : public QgsVectorDataProvider
 
     QString mSpatialIndex;                   //! name of spatial index of geometry column
     bool mHasSpatial;                        //! Oracle Spatial is installed
+    bool mBulkInsert;                        //! features are added within a transaction started by beginBulkInsert()
 
     friend QgsOracleFeatureIterator;
 };
@@ -24,6 +24,7 @@
 #include "qgspgtablemodel.h"
 
 #include <QSettings>
+#include <QThreadStorage>
 
 // for htonl
 #ifdef Q_OS_WIN
@@ -123,21 +124,36 @@ Oid QgsPostgresResult::PQoidValue()
 
 QMap<QString, QgsPostgresConn *> QgsPostgresConn::sConnectionsRO;
 QMap<QString, QgsPostgresConn *> QgsPostgresConn::sConnectionsRW;
+
+//! read-only connections of a thread, closed when the thread finishes
+class QgsPostgresThreadConnections
+{
+  public:
+    ~QgsPostgresThreadConnections()
+    {
+      foreach ( QgsPostgresConn* conn, connections )
+        conn->disconnect();
+    }
+
+    QMap<QString, QgsPostgresConn *> connections;
+};
+
+static QThreadStorage<QgsPostgresThreadConnections *> sThreadConnections;
 const int QgsPostgresConn::sGeomTypeSelectLimit = 100;
 
-QgsPostgresConn *QgsPostgresConn::connectDb( QString conninfo, bool readonly )
+QgsPostgresConn *QgsPostgresConn::connectDb( QString conninfo, bool readonly, bool shared )
 {
   QMap<QString, QgsPostgresConn *> &connections =
     readonly ? QgsPostgresConn::sConnectionsRO : QgsPostgresConn::sConnectionsRW;
 
-  if ( connections.contains( conninfo ) )
+  if ( shared && connections.contains( conninfo ) )
   {
     QgsDebugMsg( QString( "Using cached connection for %1" ).arg( conninfo ) );
     connections[conninfo]->mRef++;
     return connections[conninfo];
   }
 
-  QgsPostgresConn *conn = new QgsPostgresConn( conninfo, readonly );
+  QgsPostgresConn *conn = new QgsPostgresConn( conninfo, readonly, shared );
 
   if ( conn->mRef == 0 )
   {
@@ -145,17 +161,42 @@ QgsPostgresConn *QgsPostgresConn::connectDb( QString conninfo, bool readonly )
     return 0;
   }
 
-  connections.insert( conninfo, conn );
+  if ( shared )
+    connections.insert( conninfo, conn );
+
+  return conn;
+}
+
+QgsPostgresConn *QgsPostgresConn::connectDbForThread( QString conninfo )
+{
+  if ( !sThreadConnections.hasLocalData() )
+    sThreadConnections.setLocalData( new QgsPostgresThreadConnections );
+
+  QMap<QString, QgsPostgresConn *> &connections = sThreadConnections.localData()->connections;
+  if ( connections.contains( conninfo ) )
+  {
+    connections[conninfo]->mRef++;
+    return connections[conninfo];
+  }
+
+  // not shared, it must not be used by other threads
+  QgsPostgresConn *conn = connectDb( conninfo, true, false );
+  if ( !conn )
+    return 0;
 
+  // the reference of the thread keeps the connection open for the next caller
+  conn->mRef++;
+  connections.insert( conninfo, conn );
   return conn;
 }
 
-QgsPostgresConn::QgsPostgresConn( QString conninfo, bool readOnly )
+QgsPostgresConn::QgsPostgresConn( QString conninfo, bool readOnly, bool shared )
     : mRef( 1 )
     , mOpenCursors( 0 )
     , mConnInfo( conninfo )
     , mGotPostgisVersion( false )
     , mReadOnly( readOnly )
+    , mShared( shared )
 {
   QgsDebugMsg( QString( "New PostgreSQL connection for " ) + conninfo );
 
@@ -259,6 +300,13 @@ void QgsPostgresConn::disconnect()
   if ( --mRef > 0 )
     return;
 
+  if ( !mShared )
+  {
+    // not shared connections may be used in threads without event loop
+    delete this;
+    return;
+  }
+
   QMap<QString, QgsPostgresConn *>& connections = mReadOnly ? sConnectionsRO : sConnectionsRW;
 
   QString key = connections.key( this, QString::null );
@@ -910,6 +958,16 @@ PGresult *QgsPostgresConn::PQexecPrepared( QString stmtName, const QStringList &
   return res;
 }
 
+int QgsPostgresConn::PQputCopyData( const QByteArray &data )
+{
+  return ::PQputCopyData( mConn, data.constData(), data.size() );
+}
+
+int QgsPostgresConn::PQputCopyEnd( QString errorMessage )
+{
+  return ::PQputCopyEnd( mConn, errorMessage.isNull() ? 0 : errorMessage.toUtf8().constData() );
+}
+
 void QgsPostgresConn::PQfinish()
 {
   Q_ASSERT( mConn );
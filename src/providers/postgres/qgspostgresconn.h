@@ -89,7 +89,17 @@ class QgsPostgresConn : public QObject
 {
     Q_OBJECT;
   public:
-    static QgsPostgresConn *connectDb( QString connInfo, bool readOnly );
+    /** Get a connection to the database. Shared connections are reused by all
+     * callers with the same connection info, a connection that is not shared
+     * is owned by the caller (e.g. for use in another thread).
+     */
+    static QgsPostgresConn *connectDb( QString connInfo, bool readOnly, bool shared = true );
+
+    /** Get a read-only connection to the database for the current thread. The connection
+     * is reused by all callers in the thread with the same connection info and stays open
+     * until the thread finishes. Release it with disconnect().
+     */
+    static QgsPostgresConn *connectDbForThread( QString connInfo );
     void disconnect();
 
     //! get postgis version string
@@ -143,6 +153,8 @@ class QgsPostgresConn : public QObject
     PGresult *PQgetResult();
     PGresult *PQprepare( QString stmtName, QString query, int nParams, const Oid *paramTypes );
     PGresult *PQexecPrepared( QString stmtName, const QStringList &params );
+    int PQputCopyData( const QByteArray &data );
+    int PQputCopyEnd( QString errorMessage = QString::null );
 
     // cancel running query
     bool cancel();
@@ -199,7 +211,7 @@ class QgsPostgresConn : public QObject
     static void deleteConnection( QString theConnName );
 
   private:
-    QgsPostgresConn( QString conninfo, bool readOnly );
+    QgsPostgresConn( QString conninfo, bool readOnly, bool shared );
     ~QgsPostgresConn();
 
     int mRef;
@@ -239,6 +251,9 @@ class QgsPostgresConn : public QObject
 
     bool mReadOnly;
 
+    //! whether the connection is in the connection cache
+    bool mShared;
+
     static QMap<QString, QgsPostgresConn *> sConnectionsRW;
     static QMap<QString, QgsPostgresConn *> sConnectionsRO;
 
@@ -17,8 +17,12 @@
 
 #include "qgslogger.h"
 #include "qgsmessagelog.h"
+#include "qgssqlexpressioncompiler.h"
 
 #include <QObject>
+#include <QThread>
+#include <QTime>
+#include <QtEndian>
 
 // provider:
 // - mProviderId
@@ -40,18 +44,83 @@
 // - endianString()
 
 
-const int QgsPostgresFeatureIterator::sFeatureQueueSize = 2000;
+const int QgsPostgresFeatureIterator::sFeatureQueueSize = 200;
+const int QgsPostgresFeatureIterator::sFeatureQueueSizeMin = 100;
+const int QgsPostgresFeatureIterator::sFeatureQueueSizeMax = 20000;
+
+
+// field types that are fetched in binary format and decoded directly
+enum BinaryFieldType
+{
+  BinaryNone,
+  BinaryInt2,
+  BinaryInt4,
+  BinaryInt8,
+  BinaryFloat8
+};
+
+static BinaryFieldType binaryFieldType( const QgsField& fld )
+{
+  // float4 and numeric are fetched as text: their text representation differs from the binary value
+  const QString& type = fld.typeName();
+  if ( type == "int2" )
+    return BinaryInt2;
+  else if ( type == "int4" )
+    return BinaryInt4;
+  else if ( type == "int8" )
+    return BinaryInt8;
+  else if ( type == "float8" )
+    return BinaryFloat8;
+  return BinaryNone;
+}
+
+
+class QgsPostgresExpressionCompiler : public QgsSqlExpressionCompiler
+{
+  public:
+    QgsPostgresExpressionCompiler( const QgsFields& fields )
+        : QgsSqlExpressionCompiler( fields ) {}
+
+  protected:
+    virtual QString quotedIdentifier( const QString& identifier ) { return QgsPostgresConn::quotedIdentifier( identifier ); }
+    virtual QString quotedValue( const QVariant& value )
+    {
+      return value.type() == QVariant::String ? QgsPostgresConn::quotedValue( value ) : QgsSqlExpressionCompiler::quotedValue( value );
+    }
+    virtual bool isStringField( int fieldIdx ) const
+    {
+      // bool, uuid, date/time, money, enums, arrays ... are read as strings too
+      QString typeName = mFields[fieldIdx].typeName();
+      return mFields[fieldIdx].type() == QVariant::String &&
+             ( typeName == "text" || typeName == "varchar" || typeName == "bpchar" || typeName == "char" );
+    }
+};
 
 
 QgsPostgresFeatureIterator::QgsPostgresFeatureIterator( QgsPostgresProvider* p, const QgsFeatureRequest& request )
     : QgsAbstractFeatureIterator( request ), P( p )
+    , mConn( P->mConnectionRO )
+    , mOwnConnection( false )
     , mFeatureQueueSize( sFeatureQueueSize )
 {
-  // make sure that only one iterator is active
-  if ( P->mActiveIterator )
-    P->mActiveIterator->close();
+  // several iterators can be active at once: each has its own cursor.
+  // A connection must not be used from more threads, so iterators
+  // created outside of provider's thread use a connection of their thread.
+  if ( QThread::currentThread() != P->thread() )
+  {
+    mConn = QgsPostgresConn::connectDbForThread( P->mConnectionRO->connInfo() );
+    if ( !mConn )
+    {
+      mClosed = true;
+      return;
+    }
+    mOwnConnection = true;
+  }
 
-  mCursorName = QString( "qgisf%1" ).arg( P->mProviderId );
+  {
+    QMutexLocker locker( &P->mIteratorsMutex );
+    mCursorName = QString( "qgisf%1_%2" ).arg( P->mProviderId ).arg( P->mIteratorCounter++ );
+  }
 
   QString whereClause;
 
@@ -63,6 +132,10 @@ QgsPostgresFeatureIterator::QgsPostgresFeatureIterator( QgsPostgresProvider* p,
   {
     whereClause = P->whereClause( request.filterFid() );
   }
+  else if ( request.filterType() == QgsFeatureRequest::FilterExpression )
+  {
+    whereClause = whereClauseExpression();
+  }
 
   if ( !P->mSqlWhereClause.isEmpty() )
   {
@@ -74,11 +147,20 @@ QgsPostgresFeatureIterator::QgsPostgresFeatureIterator( QgsPostgresProvider* p,
 
   if ( !declareCursor( whereClause ) )
   {
+    if ( mOwnConnection )
+      mConn->disconnect();
+    mConn = 0;
     mClosed = true;
     return;
   }
 
-  P->mActiveIterator = this;
+  // the provider closes the cursors on its connection when it is deleted,
+  // iterators of other threads close their cursors themselves
+  if ( !mOwnConnection )
+  {
+    QMutexLocker locker( &P->mIteratorsMutex );
+    P->mActiveIterators.insert( this );
+  }
 
   mFetched = 0;
 }
@@ -101,13 +183,13 @@ bool QgsPostgresFeatureIterator::nextFeature( QgsFeature& feature )
   // featureAtId used to have some special checks - necessary?
   if ( !mUseQueue )
   {
-    QgsPostgresResult queryResult = P->mConnectionRO->PQexec( QString( "FETCH FORWARD 1 FROM %1" ).arg( mCursorName ) );
+    QgsPostgresResult queryResult = mConn->PQexec( QString( "FETCH FORWARD 1 FROM %1" ).arg( mCursorName ) );
 
     int rows = queryResult.PQntuples();
     if ( rows == 0 )
     {
       QgsMessageLog::logMessage( tr( "feature %1 not found" ).arg( featureId ), tr( "PostGIS" ) );
-      P->mConnectionRO->closeCursor( cursorName );
+      mConn->closeCursor( cursorName );
       return false;
     }
     else if ( rows != 1 )
@@ -125,23 +207,26 @@ bool QgsPostgresFeatureIterator::nextFeature( QgsFeature& feature )
 
   if ( mFeatureQueue.empty() )
   {
+    QTime fetchTime;
+    fetchTime.start();
+
     QString fetch = QString( "FETCH FORWARD %1 FROM %2" ).arg( mFeatureQueueSize ).arg( mCursorName );
     QgsDebugMsgLevel( QString( "fetching %1 features." ).arg( mFeatureQueueSize ), 4 );
-    if ( P->mConnectionRO->PQsendQuery( fetch ) == 0 ) // fetch features asynchronously
+    if ( mConn->PQsendQuery( fetch ) == 0 ) // fetch features asynchronously
     {
-      QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName ).arg( P->mConnectionRO->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
+      QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName ).arg( mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
     }
 
     QgsPostgresResult queryResult;
     for ( ;; )
     {
-      queryResult = P->mConnectionRO->PQgetResult();
+      queryResult = mConn->PQgetResult();
       if ( !queryResult.result() )
         break;
 
       if ( queryResult.PQresultStatus() != PGRES_TUPLES_OK )
       {
-        QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName ).arg( P->mConnectionRO->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
+        QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName ).arg( mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
         break;
       }
 
@@ -155,6 +240,14 @@ bool QgsPostgresFeatureIterator::nextFeature( QgsFeature& feature )
         getFeature( queryResult, row, mFeatureQueue.back() );
       } // for each row in queue
     }
+
+    // small fetches give the first features quickly, bigger ones reduce round trips
+    // on long iterations. Aim at fetches taking tens to hundreds of milliseconds.
+    int elapsed = fetchTime.elapsed();
+    if ( mFeatureQueue.size() == mFeatureQueueSize && elapsed < 100 )
+      mFeatureQueueSize = qMin( mFeatureQueueSize * 2, sFeatureQueueSizeMax );
+    else if ( elapsed > 1000 )
+      mFeatureQueueSize = qMax( mFeatureQueueSize / 2, sFeatureQueueSizeMin );
   }
 
   if ( mFeatureQueue.empty() )
@@ -198,7 +291,7 @@ bool QgsPostgresFeatureIterator::rewind()
     return false;
 
   // move cursor to first record
-  P->mConnectionRO->PQexecNR( QString( "move absolute 0 in %1" ).arg( mCursorName ) );
+  mConn->PQexecNR( QString( "move absolute 0 in %1" ).arg( mCursorName ) );
   mFeatureQueue.empty();
   mFetched = 0;
 
@@ -210,7 +303,11 @@ bool QgsPostgresFeatureIterator::close()
   if ( mClosed )
     return false;
 
-  P->mConnectionRO->closeCursor( mCursorName );
+  mConn->closeCursor( mCursorName );
+
+  if ( mOwnConnection )
+    mConn->disconnect();
+  mConn = 0;
 
   while ( !mFeatureQueue.empty() )
   {
@@ -218,7 +315,11 @@ bool QgsPostgresFeatureIterator::close()
   }
 
   // tell provider that this iterator is not active anymore
-  P->mActiveIterator = 0;
+  if ( !mOwnConnection )
+  {
+    QMutexLocker locker( &P->mIteratorsMutex );
+    P->mActiveIterators.remove( this );
+  }
 
   mClosed = true;
   return true;
@@ -226,6 +327,21 @@ bool QgsPostgresFeatureIterator::close()
 
 ///////////////
 
+QString QgsPostgresFeatureIterator::whereClauseExpression()
+{
+  // columns unknown to the provider (e.g. joined fields) are not translated,
+  // features not matched by a partially translated expression get filtered out by the caller
+  QgsExpression* exp = mRequest.filterExpression();
+  exp->prepare( P->mAttributeFields );
+
+  QgsPostgresExpressionCompiler compiler( P->mAttributeFields );
+  if ( compiler.compile( exp ) == QgsSqlExpressionCompiler::Fail )
+    return QString();
+
+  return compiler.result();
+}
+
+
 QString QgsPostgresFeatureIterator::whereClauseRect()
 {
   QgsRectangle rect = mRequest.filterRect();
@@ -240,7 +356,7 @@ QString QgsPostgresFeatureIterator::whereClauseRect()
   if ( whereClause.isEmpty() )
   {
     QString qBox;
-    if ( P->mConnectionRO->majorVersion() < 2 )
+    if ( mConn->majorVersion() < 2 )
     {
       qBox = QString( "setsrid('BOX3D(%1)'::box3d,%2)" )
              .arg( rect.asWktCoordinates() )
@@ -262,7 +378,7 @@ QString QgsPostgresFeatureIterator::whereClauseRect()
     if ( mRequest.flags() & QgsFeatureRequest::ExactIntersect )
     {
       whereClause += QString( " AND %1(%2%3,%4)" )
-                     .arg( P->mConnectionRO->majorVersion() < 2 ? "intersects" : "st_intersects" )
+                     .arg( mConn->majorVersion() < 2 ? "intersects" : "st_intersects" )
                      .arg( P->quotedIdentifier( P->mGeometryColumn ) )
                      .arg( P->mSpatialColType == sctGeography ? "::geometry" : "" )
                      .arg( qBox );
@@ -272,7 +388,7 @@ QString QgsPostgresFeatureIterator::whereClauseRect()
   if ( !P->mRequestedSrid.isEmpty() && P->mRequestedSrid != P->mDetectedSrid )
   {
     whereClause += QString( " AND %1(%2%3)=%4" )
-                   .arg( P->mConnectionRO->majorVersion() < 2 ? "srid" : "st_srid" )
+                   .arg( mConn->majorVersion() < 2 ? "srid" : "st_srid" )
                    .arg( P->quotedIdentifier( P->mGeometryColumn ) )
                    .arg( P->mSpatialColType == sctGeography ? "::geography" : "" )
                    .arg( P->mRequestedSrid );
@@ -302,11 +418,25 @@ bool QgsPostgresFeatureIterator::declareCursor( const QString& whereClause )
 
     if ( fetchGeometry )
     {
-      query += QString( "%1(%2(%3%4),'%5')" )
-               .arg( P->mConnectionRO->majorVersion() < 2 ? "asbinary" : "st_asbinary" )
-               .arg( P->mConnectionRO->majorVersion() < 2 ? "force_2d" : "st_force_2d" )
-               .arg( P->quotedIdentifier( P->mGeometryColumn ) )
-               .arg( P->mSpatialColType == sctGeography ? "::geometry" : "" )
+      QString geom = QString( "%1%2" )
+                     .arg( P->quotedIdentifier( P->mGeometryColumn ) )
+                     .arg( P->mSpatialColType == sctGeography ? "::geometry" : "" );
+
+      // reduce geometries to the requested resolution: snapping to a grid of half a pixel
+      // drops vertices that would not be visible. Collapsed geometries are returned unchanged.
+      QGis::WkbType geomType = P->mRequestedGeomType != QGis::WKBUnknown ? P->mRequestedGeomType : P->mDetectedGeomType;
+      if ( mRequest.geometryResolution() > 0 && QGis::flatType( QGis::singleType( geomType ) ) != QGis::WKBPoint )
+      {
+        geom = QString( "coalesce(%1(%2,%3),%2)" )
+               .arg( mConn->majorVersion() < 2 ? "snaptogrid" : "st_snaptogrid" )
+               .arg( geom )
+               .arg( mRequest.geometryResolution() / 2, 0, 'g', 17 );
+      }
+
+      query += QString( "%1(%2(%3),'%4')" )
+               .arg( mConn->majorVersion() < 2 ? "asbinary" : "st_asbinary" )
+               .arg( mConn->majorVersion() < 2 ? "force_2d" : "st_force_2d" )
+               .arg( geom )
                .arg( P->endianString() );
       delim = ",";
     }
@@ -331,7 +461,7 @@ bool QgsPostgresFeatureIterator::declareCursor( const QString& whereClause )
       case QgsPostgresProvider::pktFidMap:
         foreach ( int idx, P->mPrimaryKeyAttrs )
         {
-          query += delim + P->mConnectionRO->fieldExpression( P->field( idx ) );
+          query += delim + mConn->fieldExpression( P->field( idx ) );
           delim = ",";
         }
         break;
@@ -348,7 +478,7 @@ bool QgsPostgresFeatureIterator::declareCursor( const QString& whereClause )
       if ( P->mPrimaryKeyAttrs.contains( idx ) )
         continue;
 
-      query += delim + P->mConnectionRO->fieldExpression( P->field( idx ) );
+      query += delim + fieldExpression( P->field( idx ) );
     }
 
     query += " FROM " + P->mQuery;
@@ -356,7 +486,7 @@ bool QgsPostgresFeatureIterator::declareCursor( const QString& whereClause )
     if ( !whereClause.isEmpty() )
       query += QString( " WHERE %1" ).arg( whereClause );
 
-    if ( !P->mConnectionRO->openCursor( mCursorName, query ) )
+    if ( !mConn->openCursor( mCursorName, query ) )
     {
       // reloading the fields might help next time around
       rewind();
@@ -409,7 +539,7 @@ bool QgsPostgresFeatureIterator::getFeature( QgsPostgresResult &queryResult, int
       case QgsPostgresProvider::pktOid:
       case QgsPostgresProvider::pktTid:
       case QgsPostgresProvider::pktInt:
-        fid = P->mConnectionRO->getBinaryInt( queryResult, row, col++ );
+        fid = mConn->getBinaryInt( queryResult, row, col++ );
         if ( P->mPrimaryKeyType == QgsPostgresProvider::pktInt &&
              ( !subsetOfAttributes || fetchAttributes.contains( P->mPrimaryKeyAttrs[0] ) ) )
           feature.setAttribute( P->mPrimaryKeyAttrs[0], fid );
@@ -469,8 +599,57 @@ void QgsPostgresFeatureIterator::getFeatureAttribute( int idx, QgsPostgresResult
   if ( P->mPrimaryKeyAttrs.contains( idx ) )
     return;
 
-  QVariant v = P->convertValue( P->mAttributeFields[idx].type(), queryResult.PQgetvalue( row, col ) );
+  const QgsField& fld = P->mAttributeFields[idx];
+  BinaryFieldType binaryType = binaryFieldType( fld );
+
+  QVariant v;
+  if ( binaryType == BinaryNone )
+  {
+    v = P->convertValue( fld.type(), queryResult.PQgetvalue( row, col ) );
+  }
+  else if ( queryResult.PQgetisnull( row, col ) )
+  {
+    // the same as convertValue() gives for NULL
+    v = QVariant( QString::null );
+  }
+  else
+  {
+    // binary values are in network byte order
+    const uchar* data = reinterpret_cast<const uchar*>( ::PQgetvalue( queryResult.result(), row, col ) );
+    switch ( binaryType )
+    {
+      case BinaryInt2:
+        v = QVariant(( int ) qFromBigEndian<qint16>( data ) );
+        break;
+      case BinaryInt4:
+        v = QVariant(( int ) qFromBigEndian<qint32>( data ) );
+        break;
+      case BinaryInt8:
+        v = QVariant(( qlonglong ) qFromBigEndian<qint64>( data ) );
+        break;
+      case BinaryFloat8:
+      {
+        quint64 bits = qFromBigEndian<quint64>( data );
+        double d;
+        memcpy( &d, &bits, sizeof( d ) );
+        v = QVariant( d );
+        break;
+      }
+      case BinaryNone:
+        break;
+    }
+  }
+
   feature.setAttribute( idx, v );
 
   col++;
 }
+
+QString QgsPostgresFeatureIterator::fieldExpression( const QgsField& fld ) const
+{
+  // the cursor is binary: plain columns come in binary representation
+  if ( binaryFieldType( fld ) != BinaryNone )
+    return P->quotedIdentifier( fld.name() );
+
+  return mConn->fieldExpression( fld );
+}
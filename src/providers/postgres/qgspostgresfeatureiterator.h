@@ -20,6 +20,8 @@
 #include <QQueue>
 
 
+class QgsField;
+class QgsPostgresConn;
 class QgsPostgresProvider;
 class QgsPostgresResult;
 
@@ -43,10 +45,18 @@ class QgsPostgresFeatureIterator : public QgsAbstractFeatureIterator
     QgsPostgresProvider* P;
 
     QString whereClauseRect();
+    QString whereClauseExpression();
     bool getFeature( QgsPostgresResult &queryResult, int row, QgsFeature &feature );
     void getFeatureAttribute( int idx, QgsPostgresResult& queryResult, int row, int& col, QgsFeature& feature );
+    //! expression to select the field, numeric types are fetched in binary format
+    QString fieldExpression( const QgsField& fld ) const;
     bool declareCursor( const QString& whereClause );
 
+    //! connection of the cursor: provider's read-only connection or connection of another thread
+    QgsPostgresConn* mConn;
+    //! whether mConn is a connection of another thread than the provider's
+    bool mOwnConnection;
+
     QString mCursorName;
 
     /**
@@ -55,13 +65,15 @@ class QgsPostgresFeatureIterator : public QgsAbstractFeatureIterator
      */
     QQueue<QgsFeature> mFeatureQueue;
 
-    //! Maximal size of the feature queue
+    //! Number of features fetched at once, adapted to time the fetches take
     int mFeatureQueueSize;
 
     //!< Number of retrieved features
     int mFetched;
 
     static const int sFeatureQueueSize;
+    static const int sFeatureQueueSizeMin;
+    static const int sFeatureQueueSizeMax;
 
 };
 
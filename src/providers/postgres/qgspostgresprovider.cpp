@@ -24,6 +24,8 @@
 #include <qgsrectangle.h>
 #include <qgscoordinatereferencesystem.h>
 
+#include <QtEndian>
+
 #include "qgsvectorlayerimport.h"
 #include "qgsprovidercountcalcevent.h"
 #include "qgsproviderextentcalcevent.h"
@@ -51,7 +53,8 @@ QgsPostgresProvider::QgsPostgresProvider( QString const & uri )
     , mConnectionRO( 0 )
     , mConnectionRW( 0 )
     , mFidCounter( 0 )
-    , mActiveIterator( 0 )
+    , mIteratorCounter( 0 )
+    , mBulkInsert( false )
 {
   mProviderId = sProviderIds++;
 
@@ -212,8 +215,13 @@ QgsPostgresProvider::QgsPostgresProvider( QString const & uri )
 
 QgsPostgresProvider::~QgsPostgresProvider()
 {
-  if ( mActiveIterator )
-    mActiveIterator->close();
+  // closing removes the iterator from the set. Only iterators using the
+  // connections of the provider are in the set, others close their cursors themselves
+  foreach ( QgsPostgresFeatureIterator* it, mActiveIterators )
+    it->close();
+
+  if ( mBulkInsert )
+    endBulkInsert();
 
   disconnectDb();
 
@@ -320,6 +328,8 @@ static bool operator<( const QVariant &a, const QVariant &b )
 
 QgsFeatureId QgsPostgresProvider::lookupFid( const QVariant &v )
 {
+  QMutexLocker locker( &mIteratorsMutex );
+
   QMap<QVariant, QgsFeatureId>::const_iterator it = mKeyToFid.find( v );
 
   if ( it != mKeyToFid.constEnd() )
@@ -1141,6 +1151,34 @@ bool QgsPostgresProvider::uniqueData( QString query, QString colName )
   return unique.PQntuples() == 1 && unique.PQgetvalue( 0, 0 ).startsWith( "t" );
 }
 
+// Iterators read float8 values from binary cursors. Their text representation has only
+// 15 significant digits, so float8 values are selected as hex of their binary representation
+// to get values equal to the attributes of the features.
+static bool isFloat8( const QgsField &fld )
+{
+  return fld.typeName() == "float8";
+}
+
+static QString valueExpression( const QgsField &fld, const QString &expr )
+{
+  return isFloat8( fld ) ? QString( "encode(float8send(%1),'hex')" ).arg( expr ) : expr;
+}
+
+QVariant QgsPostgresProvider::resultValue( const QgsField &fld, QgsPostgresResult &res, int row, int col )
+{
+  if ( !isFloat8( fld ) )
+    return convertValue( fld.type(), res.PQgetvalue( row, col ) );
+
+  QByteArray data = QByteArray::fromHex( res.PQgetvalue( row, col ).toAscii() );
+  if ( res.PQgetisnull( row, col ) || data.size() != sizeof( double ) )
+    return QVariant( QString::null );
+
+  quint64 bits = qFromBigEndian<quint64>( reinterpret_cast<const uchar*>( data.constData() ) );
+  double d;
+  memcpy( &d, &bits, sizeof( d ) );
+  return QVariant( d );
+}
+
 // Returns the minimum value of an attribute
 QVariant QgsPostgresProvider::minimumValue( int index )
 {
@@ -1148,8 +1186,8 @@ QVariant QgsPostgresProvider::minimumValue( int index )
   {
     // get the field name
     const QgsField &fld = field( index );
-    QString sql = QString( "SELECT min(%1) FROM %2" )
-                  .arg( quotedIdentifier( fld.name() ) )
+    QString sql = QString( "SELECT %1 FROM %2" )
+                  .arg( valueExpression( fld, QString( "min(%1)" ).arg( quotedIdentifier( fld.name() ) ) ) )
                   .arg( mQuery );
 
     if ( !mSqlWhereClause.isEmpty() )
@@ -1158,7 +1196,7 @@ QVariant QgsPostgresProvider::minimumValue( int index )
     }
 
     QgsPostgresResult rmin = mConnectionRO->PQexec( sql );
-    return convertValue( fld.type(), rmin.PQgetvalue( 0, 0 ) );
+    return resultValue( fld, rmin, 0, 0 );
   }
   catch ( PGFieldNotFound )
   {
@@ -1175,8 +1213,9 @@ void QgsPostgresProvider::uniqueValues( int index, QList<QVariant> &uniqueValues
   {
     // get the field name
     const QgsField &fld = field( index );
-    QString sql = QString( "SELECT DISTINCT %1 FROM %2" )
+    QString sql = QString( "SELECT DISTINCT %1,%2 FROM %3" )
                   .arg( quotedIdentifier( fld.name() ) )
+                  .arg( valueExpression( fld, quotedIdentifier( fld.name() ) ) )
                   .arg( mQuery );
 
     if ( !mSqlWhereClause.isEmpty() )
@@ -1196,7 +1235,7 @@ void QgsPostgresProvider::uniqueValues( int index, QList<QVariant> &uniqueValues
     if ( res.PQresultStatus() == PGRES_TUPLES_OK )
     {
       for ( int i = 0; i < res.PQntuples(); i++ )
-        uniqueValues.append( convertValue( fld.type(), res.PQgetvalue( i, 0 ) ) );
+        uniqueValues.append( resultValue( fld, res, i, 1 ) );
     }
   }
   catch ( PGFieldNotFound )
@@ -1321,8 +1360,8 @@ QVariant QgsPostgresProvider::maximumValue( int index )
   {
     // get the field name
     const QgsField &fld = field( index );
-    QString sql = QString( "SELECT max(%1) FROM %2" )
-                  .arg( quotedIdentifier( fld.name() ) )
+    QString sql = QString( "SELECT %1 FROM %2" )
+                  .arg( valueExpression( fld, QString( "max(%1)" ).arg( quotedIdentifier( fld.name() ) ) ) )
                   .arg( mQuery );
 
     if ( !mSqlWhereClause.isEmpty() )
@@ -1331,7 +1370,7 @@ QVariant QgsPostgresProvider::maximumValue( int index )
     }
 
     QgsPostgresResult rmax = mConnectionRO->PQexec( sql );
-    return convertValue( fld.type(), rmax.PQgetvalue( 0, 0 ) );
+    return resultValue( fld, rmax, 0, 0 );
   }
   catch ( PGFieldNotFound )
   {
@@ -1449,38 +1488,41 @@ void QgsPostgresProvider::dropOrphanedTopoGeoms( )
   mConnectionRW->PQexecNR( sql );
 }
 
-QString QgsPostgresProvider::geomParam( int offset ) const
+bool QgsPostgresProvider::forceMultiGeometry() const
 {
-  QString geometry;
-
-  bool forceMulti = false;
+  if ( mSpatialColType == sctTopoGeometry )
+    return false;
 
-  if ( mSpatialColType != sctTopoGeometry )
+  switch ( geometryType() )
   {
-    switch ( geometryType() )
-    {
-      case QGis::WKBPoint:
-      case QGis::WKBLineString:
-      case QGis::WKBPolygon:
-      case QGis::WKBPoint25D:
-      case QGis::WKBLineString25D:
-      case QGis::WKBPolygon25D:
-      case QGis::WKBUnknown:
-      case QGis::WKBNoGeometry:
-        forceMulti = false;
-        break;
+    case QGis::WKBPoint:
+    case QGis::WKBLineString:
+    case QGis::WKBPolygon:
+    case QGis::WKBPoint25D:
+    case QGis::WKBLineString25D:
+    case QGis::WKBPolygon25D:
+    case QGis::WKBUnknown:
+    case QGis::WKBNoGeometry:
+      return false;
 
-      case QGis::WKBMultiPoint:
-      case QGis::WKBMultiLineString:
-      case QGis::WKBMultiPolygon:
-      case QGis::WKBMultiPoint25D:
-      case QGis::WKBMultiLineString25D:
-      case QGis::WKBMultiPolygon25D:
-        forceMulti = true;
-        break;
-    }
+    case QGis::WKBMultiPoint:
+    case QGis::WKBMultiLineString:
+    case QGis::WKBMultiPolygon:
+    case QGis::WKBMultiPoint25D:
+    case QGis::WKBMultiLineString25D:
+    case QGis::WKBMultiPolygon25D:
+      return true;
   }
 
+  return false;
+}
+
+QString QgsPostgresProvider::geomParam( int offset ) const
+{
+  QString geometry;
+
+  bool forceMulti = forceMultiGeometry();
+
   if ( mSpatialColType == sctTopoGeometry )
   {
     geometry += QString( "toTopoGeom(" );
@@ -1524,10 +1566,20 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist )
     return false;
 
   bool returnvalue = true;
+  bool prepared = false;
 
   try
   {
-    mConnectionRW->PQexecNR( "BEGIN" );
+    // in bulk insert mode the transaction is already running,
+    // a savepoint is used to add all or none of the features
+    mConnectionRW->PQexecNR( mBulkInsert ? "SAVEPOINT addfeatures" : "BEGIN" );
+
+    if ( mBulkInsert && copyFeatures( flist ) )
+    {
+      mConnectionRW->PQexecNR( "RELEASE SAVEPOINT addfeatures" );
+      mFeaturesCounted += flist.size();
+      return true;
+    }
 
     // Prepare the INSERT statement
     QString insert = QString( "INSERT INTO %1(" ).arg( mQuery );
@@ -1666,6 +1718,7 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist )
     QgsPostgresResult stmt = mConnectionRW->PQprepare( "addfeatures", insert, fieldId.size() + offset - 1, NULL );
     if ( stmt.PQresultStatus() != PGRES_COMMAND_OK )
       throw PGException( stmt );
+    prepared = true;
 
     for ( QgsFeatureList::iterator features = flist.begin(); features != flist.end(); features++ )
     {
@@ -1713,8 +1766,8 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist )
       }
     }
 
-    // update feature ids
-    if ( mPrimaryKeyType == pktInt || mPrimaryKeyType == pktFidMap )
+    // update feature ids (not needed when loading in bulk)
+    if ( !mBulkInsert && ( mPrimaryKeyType == pktInt || mPrimaryKeyType == pktFidMap ) )
     {
       for ( QgsFeatureList::iterator features = flist.begin(); features != flist.end(); features++ )
       {
@@ -1740,21 +1793,236 @@ bool QgsPostgresProvider::addFeatures( QgsFeatureList &flist )
     }
 
     mConnectionRW->PQexecNR( "DEALLOCATE addfeatures" );
-    mConnectionRW->PQexecNR( "COMMIT" );
+    mConnectionRW->PQexecNR( mBulkInsert ? "RELEASE SAVEPOINT addfeatures" : "COMMIT" );
 
     mFeaturesCounted += flist.size();
   }
   catch ( PGException &e )
   {
     pushError( tr( "PostGIS error while adding features: %1" ).arg( e.errorMessage() ) );
-    mConnectionRW->PQexecNR( "ROLLBACK" );
-    mConnectionRW->PQexecNR( "DEALLOCATE addfeatures" );
+    if ( mBulkInsert )
+    {
+      mConnectionRW->PQexecNR( "ROLLBACK TO SAVEPOINT addfeatures" );
+      mConnectionRW->PQexecNR( "RELEASE SAVEPOINT addfeatures" );
+    }
+    else
+    {
+      mConnectionRW->PQexecNR( "ROLLBACK" );
+    }
+    // a failing DEALLOCATE would roll back the running bulk insert transaction
+    if ( prepared )
+      mConnectionRW->PQexecNR( "DEALLOCATE addfeatures" );
     returnvalue = false;
   }
 
   return returnvalue;
 }
 
+bool QgsPostgresProvider::beginBulkInsert()
+{
+  if ( mIsQuery || mBulkInsert )
+    return false;
+
+  if ( !connectRW() )
+    return false;
+
+  mBulkInsert = mConnectionRW->PQexecNR( "BEGIN" );
+  return mBulkInsert;
+}
+
+bool QgsPostgresProvider::endBulkInsert()
+{
+  if ( !mBulkInsert )
+    return false;
+
+  mBulkInsert = false;
+
+  if ( !mConnectionRW->PQexecNR( "COMMIT" ) )
+  {
+    pushError( tr( "PostGIS error while committing added features" ) );
+    return false;
+  }
+
+  return true;
+}
+
+static QString copyValue( QString value )
+{
+  value.replace( "\\", "\\\\" );
+  value.replace( "\t", "\\t" );
+  value.replace( "\n", "\\n" );
+  value.replace( "\r", "\\r" );
+  return value;
+}
+
+bool QgsPostgresProvider::copyFeatures( QgsFeatureList &flist )
+{
+  // COPY takes plain values only, topology functions and evaluation of
+  // default expressions passed as values require the INSERT statement
+  if ( mSpatialColType == sctTopoGeometry || !mConnectionRW->useWkbHex() )
+    return false;
+
+  bool sridOk = true;
+  int srid = 0;
+  if ( !mGeometryColumn.isNull() )
+  {
+    srid = ( mRequestedSrid.isEmpty() ? mDetectedSrid : mRequestedSrid ).toInt( &sridOk );
+    if ( !sridOk )
+      return false;
+  }
+
+  QStringList columns;
+  QList<int> fieldId;
+
+  if ( !mGeometryColumn.isNull() )
+    columns << quotedIdentifier( mGeometryColumn );
+
+  for ( int idx = 0; idx < mAttributeFields.count(); ++idx )
+  {
+    QString fieldname = mAttributeFields[idx].name();
+    if ( fieldname.isEmpty() || fieldname == mGeometryColumn )
+      continue;
+
+    QString defVal = defaultValue( idx ).toString();
+
+    int validCount = 0;
+    for ( int i = 0; i < flist.size(); i++ )
+    {
+      const QgsAttributes &attrs = flist[i].attributes();
+      if ( idx >= attrs.count() || !attrs[idx].isValid() )
+        continue;
+
+      if ( !defVal.isNull() && attrs[idx].toString() == defVal )
+        return false;
+
+      validCount++;
+    }
+
+    // columns without values are left out, the database fills in the default values
+    if ( validCount == 0 )
+      continue;
+
+    // the INSERT statement handles columns with values only for some features
+    if ( validCount < flist.size() )
+      return false;
+
+    columns << quotedIdentifier( fieldname );
+    fieldId << idx;
+  }
+
+  if ( columns.isEmpty() )
+    return false;
+
+  QString copy = QString( "COPY %1(%2) FROM STDIN" ).arg( mQuery ).arg( columns.join( "," ) );
+  QgsDebugMsg( QString( "copy addfeatures: %1" ).arg( copy ) );
+
+  QgsPostgresResult result = mConnectionRW->PQexec( copy, false );
+  if ( result.PQresultStatus() != PGRES_COPY_IN )
+    throw PGException( result );
+
+  bool forceMulti = forceMultiGeometry();
+  bool sent = true;
+
+  QByteArray data;
+  for ( QgsFeatureList::iterator features = flist.begin(); sent && features != flist.end(); features++ )
+  {
+    const QgsAttributes &attrs = features->attributes();
+
+    const char *delim = "";
+    if ( !mGeometryColumn.isNull() )
+    {
+      appendCopyGeometry( features->geometry(), srid, forceMulti, data );
+      delim = "\t";
+    }
+
+    for ( int i = 0; i < fieldId.size(); i++ )
+    {
+      const QVariant &value = attrs[ fieldId[i] ];
+      QString v = value.toString();
+
+      data += delim;
+      if ( value.isNull() || v.isNull() )
+        data += "\\N";
+      else
+        data += copyValue( v ).toUtf8();
+
+      delim = "\t";
+    }
+
+    data += "\n";
+
+    // pass the data in chunks of about a megabyte
+    if ( data.size() >= 1024 * 1024 )
+    {
+      sent = mConnectionRW->PQputCopyData( data ) == 1;
+      data.resize( 0 );
+    }
+  }
+
+  if ( sent && !data.isEmpty() )
+    sent = mConnectionRW->PQputCopyData( data ) == 1;
+
+  mConnectionRW->PQputCopyEnd( sent ? QString::null : tr( "Sending of the features failed" ) );
+
+  result = mConnectionRW->PQgetResult();
+  ExecStatusType status = result.PQresultStatus();
+
+  // read remaining results to make the connection usable again
+  for ( PGresult *res = mConnectionRW->PQgetResult(); res; res = mConnectionRW->PQgetResult() )
+    ::PQclear( res );
+
+  if ( status != PGRES_COMMAND_OK )
+    throw PGException( result );
+
+  return true;
+}
+
+static void appendUInt32( QByteArray &data, quint32 value, bool littleEndian )
+{
+  uchar buf[4];
+  if ( littleEndian )
+    qToLittleEndian<quint32>( value, buf );
+  else
+    qToBigEndian<quint32>( value, buf );
+  data.append(( const char * ) buf, 4 );
+}
+
+void QgsPostgresProvider::appendCopyGeometry( QgsGeometry *geom, int srid, bool forceMulti, QByteArray &data ) const
+{
+  if ( !geom || geom->wkbSize() < 5 )
+  {
+    data += "\\N";
+    return;
+  }
+
+  const unsigned char *wkb = geom->asWkb();
+  bool littleEndian = wkb[0] == 1;
+  quint32 type = littleEndian ? qFromLittleEndian<quint32>( wkb + 1 ) : qFromBigEndian<quint32>( wkb + 1 );
+
+  // single point, line or polygon (in 2D or 25D) into a multi geometry column
+  quint32 baseType = type & 0x0fffffff;
+  bool wrap = forceMulti && baseType >= 1 && baseType <= 3;
+
+  // EWKB: header with the SRID flag and SRID followed by the WKB of the geometry
+  QByteArray ewkb;
+  ewkb.reserve( geom->wkbSize() + 13 );
+  ewkb.append(( char ) wkb[0] );
+  appendUInt32( ewkb, ( wrap ? type + 3 : type ) | 0x20000000, littleEndian );
+  appendUInt32( ewkb, srid, littleEndian );
+
+  if ( wrap )
+  {
+    appendUInt32( ewkb, 1, littleEndian );
+    ewkb.append(( const char * ) wkb, geom->wkbSize() );
+  }
+  else
+  {
+    ewkb.append(( const char * ) wkb + 5, geom->wkbSize() - 5 );
+  }
+
+  data += ewkb.toHex();
+}
+
 bool QgsPostgresProvider::deleteFeatures( const QgsFeatureIds & id )
 {
   bool returnvalue = true;
@@ -2246,7 +2514,8 @@ QgsAttributeList QgsPostgresProvider::attributeIndexes()
 
 int QgsPostgresProvider::capabilities() const
 {
-  return mEnabledCapabilities;
+  // iterators on other threads use their own connections
+  return mEnabledCapabilities | QgsVectorDataProvider::ThreadSafe;
 }
 
 bool QgsPostgresProvider::setSubsetString( QString theSQL, bool updateFeatureCount )
@@ -23,6 +23,8 @@
 #include "qgsvectorlayerimport.h"
 #include "qgspostgresconn.h"
 
+#include <QMutex>
+#include <QSet>
 
 class QgsFeature;
 class QgsField;
@@ -177,6 +179,15 @@ class QgsPostgresProvider : public QgsVectorDataProvider
       @return true in case of success and false in case of failure*/
     bool addFeatures( QgsFeatureList & flist );
 
+    /**Starts a transaction for all following addFeatures() calls,
+      the features are loaded with COPY when possible
+      @note added in 2.0 */
+    bool beginBulkInsert();
+
+    /**Commits the features added since beginBulkInsert()
+      @note added in 2.0 */
+    bool endBulkInsert();
+
     /**Deletes a list of features
       @param id list of feature ids
       @return true in case of success and false in case of failure*/
@@ -297,6 +308,21 @@ class QgsPostgresProvider : public QgsVectorDataProvider
                      const QgsAttributeList &fetchAttributes );
 
     QString geomParam( int offset ) const;
+
+    /** Value of a field selected by minimumValue(), maximumValue() or uniqueValues(),
+     *  float8 values are decoded from the hex of their binary representation */
+    QVariant resultValue( const QgsField &fld, QgsPostgresResult &res, int row, int col );
+
+    //! whether single geometries have to be converted to multi geometries of the layer's type
+    bool forceMultiGeometry() const;
+
+    /** Load the features with COPY (in bulk insert mode).
+     * @return false if COPY cannot be used for the features, throws PGException on errors
+     */
+    bool copyFeatures( QgsFeatureList &flist );
+
+    //! append geometry as hex encoded EWKB to data of COPY
+    void appendCopyGeometry( QgsGeometry *geom, int srid, bool forceMulti, QByteArray &data ) const;
     /** Get parametrized primary key clause
      * @param offset specifies offset to use for the pk value parameter
      * @param alias specifies an optional alias given to the subject table
@@ -471,7 +497,11 @@ class QgsPostgresProvider : public QgsVectorDataProvider
     QgsFeatureId lookupFid( const QVariant &v ); // lookup existing mapping or add a new one
 
     friend class QgsPostgresFeatureIterator;
-    QgsPostgresFeatureIterator* mActiveIterator; //!< pointer to currently active iterator (0 if none)
+    QSet<QgsPostgresFeatureIterator*> mActiveIterators; //!< iterators with open cursors on the connection of the provider
+    int mIteratorCounter; //!< id to make cursor names of iterators unique
+
+    bool mBulkInsert; //!< features are added within a transaction started by beginBulkInsert()
+    QMutex mIteratorsMutex; //!< protects iterator list and feature id map used by iterators in other threads
 };
 
 #endif
@@ -18,12 +18,14 @@
 
 #include "qgslogger.h"
 #include "qgsmessagelog.h"
+#include "qgssqlexpressioncompiler.h"
 
 
 // from provider:
 // isQuery
 // mPrimaryKey
 // mGeometryColumn
+// mSpatialiteVersionMajor
 // mVShapeBased
 // spatialIndexRTree
 // mIndexTable
@@ -37,6 +39,18 @@
 // quotedIdentifier()
 
 
+class QgsSpatiaLiteExpressionCompiler : public QgsSqlExpressionCompiler
+{
+  public:
+    // SQLite's LIKE ignores case of ASCII characters and there is no ILIKE
+    QgsSpatiaLiteExpressionCompiler( const QgsFields& fields )
+        : QgsSqlExpressionCompiler( fields, LikeIsCaseInsensitive | NoNativeILike ) {}
+
+  protected:
+    virtual QString quotedIdentifier( const QString& identifier ) { return QgsSpatiaLiteProvider::quotedIdentifier( identifier ); }
+};
+
+
 QgsSpatiaLiteFeatureIterator::QgsSpatiaLiteFeatureIterator( QgsSpatiaLiteProvider* p, const QgsFeatureRequest& request )
     : QgsAbstractFeatureIterator( request )
     , P( p )
@@ -60,6 +74,11 @@ QgsSpatiaLiteFeatureIterator::QgsSpatiaLiteFeatureIterator( QgsSpatiaLiteProvide
     whereClause += whereClauseFid();
   }
 
+  if ( request.filterType() == QgsFeatureRequest::FilterExpression )
+  {
+    whereClause += whereClauseExpression();
+  }
+
   if ( !P->mSubsetString.isEmpty() )
   {
     if ( !whereClause.isEmpty() )
@@ -100,8 +119,7 @@ bool QgsSpatiaLiteFeatureIterator::nextFeature( QgsFeature& feature )
 
   if ( !getFeature( sqliteStatement, feature ) )
   {
-    sqlite3_finalize( sqliteStatement );
-    sqliteStatement = NULL;
+    releaseStatement();
     close();
     return false;
   }
@@ -113,8 +131,11 @@ bool QgsSpatiaLiteFeatureIterator::nextFeature( QgsFeature& feature )
 
 bool QgsSpatiaLiteFeatureIterator::rewind()
 {
-  // TODO: implement. use sqlite3_reset
-  return false;
+  if ( mClosed || !sqliteStatement )
+    return false;
+
+  // bound values are kept by reset
+  return sqlite3_reset( sqliteStatement ) == SQLITE_OK;
 }
 
 bool QgsSpatiaLiteFeatureIterator::close()
@@ -122,11 +143,7 @@ bool QgsSpatiaLiteFeatureIterator::close()
   if ( mClosed )
     return false;
 
-  if ( sqliteStatement )
-  {
-    sqlite3_finalize( sqliteStatement );
-    sqliteStatement = NULL;
-  }
+  releaseStatement();
 
   // tell provider that this iterator is not active anymore
   P->mActiveIterator = 0;
@@ -169,7 +186,20 @@ bool QgsSpatiaLiteFeatureIterator::prepareStatement( QString whereClause )
 
     if ( !( mRequest.flags() & QgsFeatureRequest::NoGeometry ) )
     {
-      sql += QString( ", AsBinary(%1)" ).arg( P->quotedIdentifier( P->mGeometryColumn ) );
+      QString geom = P->quotedIdentifier( P->mGeometryColumn );
+
+      // reduce geometries to the requested resolution (SnapToGrid is available since SpatiaLite 4.0).
+      // Collapsed geometries are returned unchanged. The grid size is bound, so that the
+      // cached statement is reused at all scales
+      if ( mRequest.geometryResolution() > 0 && P->mGotSpatialiteVersion && P->mSpatialiteVersionMajor >= 4 &&
+           QGis::flatType( QGis::singleType( P->geometryType() ) ) != QGis::WKBPoint )
+      {
+        geom = QString( "IfNull(SnapToGrid(%1,?),%1)" ).arg( geom );
+        // the select list comes before the placeholders of the where clause
+        mBindValues.prepend( mRequest.geometryResolution() / 2 );
+      }
+
+      sql += QString( ", AsBinary(%1)" ).arg( geom );
       mGeomColIdx = colIdx;
     }
     sql += QString( " FROM %1" ).arg( P->mQuery );
@@ -177,11 +207,23 @@ bool QgsSpatiaLiteFeatureIterator::prepareStatement( QString whereClause )
     if ( !whereClause.isEmpty() )
       sql += QString( " WHERE %1" ).arg( whereClause );
 
-    if ( sqlite3_prepare_v2( P->sqliteHandle, sql.toUtf8().constData(), -1, &sqliteStatement, NULL ) != SQLITE_OK )
-    {
-      // some error occurred
-      QgsMessageLog::logMessage( QObject::tr( "SQLite error: %2\nSQL: %1" ).arg( sql ).arg( sqlite3_errmsg( P->sqliteHandle ) ), QObject::tr( "SpatiaLite" ) );
+    sqliteStatement = P->cachedStatement( sql );
+    if ( !sqliteStatement )
       return false;
+    mSql = sql;
+
+    for ( int i = 0; i < mBindValues.size(); ++i )
+    {
+      const QVariant& v = mBindValues[i];
+      int ret = v.type() == QVariant::Double
+                ? sqlite3_bind_double( sqliteStatement, i + 1, v.toDouble() )
+                : sqlite3_bind_int64( sqliteStatement, i + 1, v.toLongLong() );
+      if ( ret != SQLITE_OK )
+      {
+        QgsMessageLog::logMessage( QObject::tr( "SQLite error: %2\nSQL: %1" ).arg( sql ).arg( sqlite3_errmsg( P->sqliteHandle ) ), QObject::tr( "SpatiaLite" ) );
+        releaseStatement();
+        return false;
+      }
     }
   }
   catch ( QgsSpatiaLiteProvider::SLFieldNotFound )
@@ -193,6 +235,15 @@ bool QgsSpatiaLiteFeatureIterator::prepareStatement( QString whereClause )
   return true;
 }
 
+void QgsSpatiaLiteFeatureIterator::releaseStatement()
+{
+  if ( !sqliteStatement )
+    return;
+
+  P->releaseStatement( mSql, sqliteStatement );
+  sqliteStatement = NULL;
+}
+
 QString QgsSpatiaLiteFeatureIterator::quotedPrimaryKey()
 {
   return !P->isQuery ? "ROWID" : P->quotedIdentifier( P->mPrimaryKey );
@@ -200,7 +251,22 @@ QString QgsSpatiaLiteFeatureIterator::quotedPrimaryKey()
 
 QString QgsSpatiaLiteFeatureIterator::whereClauseFid()
 {
-  return QString( "%1=%2" ).arg( quotedPrimaryKey() ).arg( mRequest.filterFid() );
+  mBindValues << QVariant( qlonglong( mRequest.filterFid() ) );
+  return QString( "%1=?" ).arg( quotedPrimaryKey() );
+}
+
+QString QgsSpatiaLiteFeatureIterator::whereClauseExpression()
+{
+  // columns unknown to the provider are not translated,
+  // features not matched by a partially translated expression get filtered out by the caller
+  QgsExpression* exp = mRequest.filterExpression();
+  exp->prepare( P->attributeFields );
+
+  QgsSpatiaLiteExpressionCompiler compiler( P->attributeFields );
+  if ( compiler.compile( exp ) == QgsSqlExpressionCompiler::Fail )
+    return QString();
+
+  return compiler.result();
 }
 
 QString QgsSpatiaLiteFeatureIterator::whereClauseRect()
@@ -223,10 +289,8 @@ QString QgsSpatiaLiteFeatureIterator::whereClauseRect()
     if ( P->spatialIndexRTree )
     {
       // using the RTree spatial index
-      QString mbrFilter = QString( "xmin <= %1 AND " ).arg( QString::number( rect.xMaximum(), 'f', 6 ) );
-      mbrFilter += QString( "xmax >= %1 AND " ).arg( QString::number( rect.xMinimum(), 'f', 6 ) );
-      mbrFilter += QString( "ymin <= %1 AND " ).arg( QString::number( rect.yMaximum(), 'f', 6 ) );
-      mbrFilter += QString( "ymax >= %1" ).arg( QString::number( rect.yMinimum(), 'f', 6 ) );
+      QString mbrFilter = "xmin <= ? AND xmax >= ? AND ymin <= ? AND ymax >= ?";
+      mBindValues << rect.xMaximum() << rect.xMinimum() << rect.yMaximum() << rect.yMinimum();
       QString idxName = QString( "idx_%1_%2" ).arg( P->mIndexTable ).arg( P->mIndexGeometry );
       whereClause += QString( "%1 IN (SELECT pkid FROM %2 WHERE %3)" )
                      .arg( quotedPrimaryKey() )
@@ -254,11 +318,9 @@ QString QgsSpatiaLiteFeatureIterator::whereClauseRect()
 
 QString QgsSpatiaLiteFeatureIterator::mbr( const QgsRectangle& rect )
 {
-  return QString( "%1, %2, %3, %4" ).
-         arg( QString::number( rect.xMinimum(), 'f', 6 ) ).
-         arg( QString::number( rect.yMinimum(), 'f', 6 ) ).
-         arg( QString::number( rect.xMaximum(), 'f', 6 ) ).
-         arg( QString::number( rect.yMaximum(), 'f', 6 ) );
+  // coordinates are bound as parameters in the order of the placeholders
+  mBindValues << rect.xMinimum() << rect.yMinimum() << rect.xMaximum() << rect.yMaximum();
+  return "?, ?, ?, ?";
 }
 
 
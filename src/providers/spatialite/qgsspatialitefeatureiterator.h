@@ -45,9 +45,12 @@ class QgsSpatiaLiteFeatureIterator : public QgsAbstractFeatureIterator
     QgsSpatiaLiteProvider* P;
 
     QString whereClauseRect();
+    QString whereClauseExpression();
     QString whereClauseFid();
     QString mbr( const QgsRectangle& rect );
     bool prepareStatement( QString whereClause );
+    //! return the statement to the provider's cache
+    void releaseStatement();
     QString quotedPrimaryKey();
     bool getFeature( sqlite3_stmt *stmt, QgsFeature &feature );
     QString fieldName( const QgsField& fld );
@@ -59,6 +62,14 @@ class QgsSpatiaLiteFeatureIterator : public QgsAbstractFeatureIterator
      */
     sqlite3_stmt *sqliteStatement;
 
+    /** SQL of the statement (key of the provider's statement cache) */
+    QString mSql;
+
+    /** values bound to the parameters of the statement (filter rectangle or feature id),
+     * the SQL only depends on the kind of the request and can be reused
+     */
+    QList<QVariant> mBindValues;
+
     /** geometry column index used when fetching geometry */
     int mGeomColIdx;
 
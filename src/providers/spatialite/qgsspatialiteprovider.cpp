@@ -412,7 +412,10 @@ QgsSpatiaLiteProvider::QgsSpatiaLiteProvider( QString const &uri )
     , spatialIndexRTree( false )
     , spatialIndexMbrCache( false )
     , mGotSpatialiteVersion( false )
+    , mSpatialiteVersionMajor( 0 )
+    , mSpatialiteVersionMinor( 0 )
     , mActiveIterator( 0 )
+    , mBulkInsert( false )
 {
   nDims = GAIA_XY;
   QgsDataSourceURI anUri = QgsDataSourceURI( uri );
@@ -577,6 +580,9 @@ QgsSpatiaLiteProvider::~QgsSpatiaLiteProvider()
   if ( mActiveIterator )
     mActiveIterator->close();
 
+  if ( mBulkInsert )
+    endBulkInsert();
+
   closeDb();
 }
 
@@ -3493,7 +3499,9 @@ bool QgsSpatiaLiteProvider::addFeatures( QgsFeatureList & flist )
     return true;
   const QgsAttributes & attributevec = flist[0].attributes();
 
-  ret = sqlite3_exec( sqliteHandle, "BEGIN", NULL, NULL, &errMsg );
+  // in bulk insert mode the transaction is already running,
+  // a savepoint is used to add all or none of the features
+  ret = sqlite3_exec( sqliteHandle, mBulkInsert ? "SAVEPOINT addfeatures" : "BEGIN", NULL, NULL, &errMsg );
   if ( ret != SQLITE_OK )
   {
     // some error occurred
@@ -3639,7 +3647,7 @@ bool QgsSpatiaLiteProvider::addFeatures( QgsFeatureList & flist )
   }
   sqlite3_finalize( stmt );
 
-  ret = sqlite3_exec( sqliteHandle, "COMMIT", NULL, NULL, &errMsg );
+  ret = sqlite3_exec( sqliteHandle, mBulkInsert ? "RELEASE SAVEPOINT addfeatures" : "COMMIT", NULL, NULL, &errMsg );
   if ( ret != SQLITE_OK )
   {
     // some error occurred
@@ -3657,12 +3665,60 @@ abort:
   if ( toCommit )
   {
     // ROLLBACK after some previous error
-    sqlite3_exec( sqliteHandle, "ROLLBACK", NULL, NULL, NULL );
+    if ( mBulkInsert )
+    {
+      sqlite3_exec( sqliteHandle, "ROLLBACK TO SAVEPOINT addfeatures", NULL, NULL, NULL );
+      sqlite3_exec( sqliteHandle, "RELEASE SAVEPOINT addfeatures", NULL, NULL, NULL );
+    }
+    else
+    {
+      sqlite3_exec( sqliteHandle, "ROLLBACK", NULL, NULL, NULL );
+    }
   }
 
   return false;
 }
 
+bool QgsSpatiaLiteProvider::beginBulkInsert()
+{
+  if ( mBulkInsert || !sqliteHandle )
+    return false;
+
+  char *errMsg = NULL;
+  int ret = sqlite3_exec( sqliteHandle, "BEGIN", NULL, NULL, &errMsg );
+  if ( ret != SQLITE_OK )
+  {
+    QgsMessageLog::logMessage( tr( "SQLite error: %1" ).arg( errMsg ? errMsg : tr( "unknown cause" ) ), tr( "SpatiaLite" ) );
+    if ( errMsg )
+      sqlite3_free( errMsg );
+    return false;
+  }
+
+  mBulkInsert = true;
+  return true;
+}
+
+bool QgsSpatiaLiteProvider::endBulkInsert()
+{
+  if ( !mBulkInsert )
+    return false;
+
+  mBulkInsert = false;
+
+  char *errMsg = NULL;
+  int ret = sqlite3_exec( sqliteHandle, "COMMIT", NULL, NULL, &errMsg );
+  if ( ret != SQLITE_OK )
+  {
+    pushError( tr( "SQLite error: %1\nSQL: COMMIT" ).arg( errMsg ? errMsg : tr( "unknown cause" ) ) );
+    if ( errMsg )
+      sqlite3_free( errMsg );
+    sqlite3_exec( sqliteHandle, "ROLLBACK", NULL, NULL, NULL );
+    return false;
+  }
+
+  return true;
+}
+
 bool QgsSpatiaLiteProvider::deleteFeatures( const QgsFeatureIds &id )
 {
   sqlite3_stmt *stmt = NULL;
@@ -3998,6 +4054,8 @@ int QgsSpatiaLiteProvider::capabilities() const
 
 void QgsSpatiaLiteProvider::closeDb()
 {
+  clearStatementCache();
+
 // trying to close the SQLite DB
   if ( handle )
   {
@@ -4005,6 +4063,58 @@ void QgsSpatiaLiteProvider::closeDb()
   }
 }
 
+// number of prepared statements kept for reuse by iterators
+#define STATEMENT_CACHE_SIZE 10
+
+sqlite3_stmt *QgsSpatiaLiteProvider::cachedStatement( const QString &sql )
+{
+  sqlite3_stmt *stmt = mStatementCache.take( sql );
+  if ( stmt )
+  {
+    mStatementCacheOrder.removeOne( sql );
+    return stmt;
+  }
+
+  if ( sqlite3_prepare_v2( sqliteHandle, sql.toUtf8().constData(), -1, &stmt, NULL ) != SQLITE_OK )
+  {
+    // some error occurred
+    QgsMessageLog::logMessage( tr( "SQLite error: %2\nSQL: %1" ).arg( sql ).arg( sqlite3_errmsg( sqliteHandle ) ), tr( "SpatiaLite" ) );
+    return NULL;
+  }
+
+  return stmt;
+}
+
+void QgsSpatiaLiteProvider::releaseStatement( const QString &sql, sqlite3_stmt *stmt )
+{
+  if ( mStatementCache.contains( sql ) )
+  {
+    sqlite3_finalize( stmt );
+    return;
+  }
+
+  sqlite3_reset( stmt );
+  sqlite3_clear_bindings( stmt );
+
+  mStatementCache.insert( sql, stmt );
+  mStatementCacheOrder.append( sql );
+
+  while ( mStatementCacheOrder.size() > STATEMENT_CACHE_SIZE )
+  {
+    sqlite3_finalize( mStatementCache.take( mStatementCacheOrder.takeFirst() ) );
+  }
+}
+
+void QgsSpatiaLiteProvider::clearStatementCache()
+{
+  foreach ( sqlite3_stmt *stmt, mStatementCache )
+  {
+    sqlite3_finalize( stmt );
+  }
+  mStatementCache.clear();
+  mStatementCacheOrder.clear();
+}
+
 bool QgsSpatiaLiteProvider::SqliteHandles::checkMetadata( sqlite3 *handle )
 {
   int ret;
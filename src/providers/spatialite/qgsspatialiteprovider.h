@@ -37,6 +37,9 @@ class QgsSpatiaLiteFeatureIterator;
 
 #include "qgsdatasourceuri.h"
 
+#include <QHash>
+#include <QStringList>
+
 /**
   \class QgsSpatiaLiteProvider
   \brief Data provider for SQLite/SpatiaLite layers.
@@ -156,6 +159,14 @@ class QgsSpatiaLiteProvider: public QgsVectorDataProvider
       @return true in case of success and false in case of failure*/
     bool addFeatures( QgsFeatureList & flist );
 
+    /**Starts a transaction for all following addFeatures() calls
+      @note added in 2.0 */
+    bool beginBulkInsert();
+
+    /**Commits the features added since beginBulkInsert()
+      @note added in 2.0 */
+    bool endBulkInsert();
+
     /**Deletes a list of features
       @param id list of feature ids
       @return true in case of success and false in case of failure*/
@@ -380,6 +391,16 @@ class QgsSpatiaLiteProvider: public QgsVectorDataProvider
     */
     //void sqliteOpen();
     void closeDb();
+
+    /** Get a prepared statement for the SQL, reusing a statement of a previous iterator
+     * with the same SQL. The caller owns the statement until releaseStatement().
+     * @return NULL if the statement could not be prepared
+     */
+    sqlite3_stmt *cachedStatement( const QString &sql );
+    //! reset the statement and keep it for the next iterator with the same SQL
+    void releaseStatement( const QString &sql, sqlite3_stmt *stmt );
+    //! finalize all cached statements
+    void clearStatementCache();
     bool checkLayerType();
     bool getGeometryDetails();
     bool getTableGeometryDetails();
@@ -511,4 +532,12 @@ class QgsSpatiaLiteProvider: public QgsVectorDataProvider
 
     friend class QgsSpatiaLiteFeatureIterator;
     QgsSpatiaLiteFeatureIterator* mActiveIterator;
+
+    //! prepared statements of finished iterators (by SQL)
+    QHash<QString, sqlite3_stmt *> mStatementCache;
+    //! SQL of cached statements, least recently used first
+    QStringList mStatementCacheOrder;
+
+    //! features are added within a transaction started by beginBulkInsert()
+    bool mBulkInsert;
 };
@@ -13,11 +13,12 @@
  *                                                                         *
  ***************************************************************************/
 #include "qgswfsfeatureiterator.h"
+#include "qgsgeometry.h"
 #include "qgsspatialindex.h"
 #include "qgswfsprovider.h"
 
 QgsWFSFeatureIterator::QgsWFSFeatureIterator( QgsWFSProvider* provider, const QgsFeatureRequest& request ):
-    QgsAbstractFeatureIterator( request ), mProvider( provider )
+    QgsAbstractFeatureIterator( request ), mProvider( provider ), mFeatureIndex( 0 ), mLastFeatureId( -1 )
 {
   //select ids
   //get iterator
@@ -41,7 +42,11 @@ QgsWFSFeatureIterator::QgsWFSFeatureIterator( QgsWFSProvider* provider, const Qg
       }
       break;
     case QgsFeatureRequest::FilterFid:
-      mSelectedFeatures.push_back( request.filterFid() );
+      //if the feature has not arrived yet, it is selected when it does
+      if ( mProvider->mFeatures.contains( request.filterFid() ) )
+      {
+        mSelectedFeatures.push_back( request.filterFid() );
+      }
       break;
     case QgsFeatureRequest::FilterNone:
       mSelectedFeatures = mProvider->mFeatures.keys();
@@ -49,7 +54,39 @@ QgsWFSFeatureIterator::QgsWFSFeatureIterator( QgsWFSProvider* provider, const Qg
       mSelectedFeatures = mProvider->mFeatures.keys();
   }
 
-  mFeatureIterator = mSelectedFeatures.constBegin();
+  if ( !mProvider->mFeatures.isEmpty() )
+  {
+    mLastFeatureId = ( mProvider->mFeatures.constEnd() - 1 ).key();
+  }
+}
+
+void QgsWFSFeatureIterator::selectReceivedFeatures()
+{
+  QMap<QgsFeatureId, QgsFeature* >::const_iterator it = mProvider->mFeatures.upperBound( mLastFeatureId );
+  for ( ; it != mProvider->mFeatures.constEnd(); ++it )
+  {
+    mLastFeatureId = it.key();
+
+    switch ( mRequest.filterType() )
+    {
+      case QgsFeatureRequest::FilterRect:
+        //as the spatial index, compare bounding boxes
+        if ( !it.value()->geometry() || !it.value()->geometry()->boundingBox().intersects( mRequest.filterRect() ) )
+        {
+          continue;
+        }
+        break;
+      case QgsFeatureRequest::FilterFid:
+        if ( it.key() != mRequest.filterFid() )
+        {
+          continue;
+        }
+        break;
+      default:
+        break;
+    }
+    mSelectedFeatures.append( it.key() );
+  }
 }
 
 QgsWFSFeatureIterator::~QgsWFSFeatureIterator()
@@ -64,12 +101,27 @@ bool QgsWFSFeatureIterator::nextFeature( QgsFeature& f )
     return false;
   }
 
-  if ( mFeatureIterator == mSelectedFeatures.constEnd() )
+  //features of a running request are returned as they arrive
+  while ( mFeatureIndex >= mSelectedFeatures.size() )
   {
-    return false;
+    if ( mRequest.filterType() == QgsFeatureRequest::FilterFid && mFeatureIndex > 0 )
+    {
+      return false;
+    }
+    bool running = mProvider->readPendingFeatures();
+    if ( !mProvider )
+    {
+      //closed while events were processed
+      return false;
+    }
+    if ( !running && ( mProvider->mFeatures.isEmpty() || ( mProvider->mFeatures.constEnd() - 1 ).key() <= mLastFeatureId ) )
+    {
+      return false;
+    }
+    selectReceivedFeatures();
   }
 
-  QMap<QgsFeatureId, QgsFeature* >::iterator it = mProvider->mFeatures.find( *mFeatureIterator );
+  QMap<QgsFeatureId, QgsFeature* >::iterator it = mProvider->mFeatures.find( mSelectedFeatures[mFeatureIndex] );
   if ( it == mProvider->mFeatures.end() )
   {
     return false;
@@ -86,7 +138,7 @@ bool QgsWFSFeatureIterator::nextFeature( QgsFeature& f )
     attributes = mProvider->attributeIndexes();
   }
   mProvider->copyFeature( fet, f, !( mRequest.flags() & QgsFeatureRequest::NoGeometry ), attributes );
-  ++mFeatureIterator;
+  ++mFeatureIndex;
   return true;
 }
 
@@ -97,7 +149,7 @@ bool QgsWFSFeatureIterator::rewind()
     return false;
   }
 
-  mFeatureIterator = mSelectedFeatures.constBegin();
+  mFeatureIndex = 0;
 
   return true;
 }
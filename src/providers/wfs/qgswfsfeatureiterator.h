@@ -30,9 +30,15 @@ class QgsWFSFeatureIterator: public QgsAbstractFeatureIterator
     bool close();
 
   private:
+    /**Appends the features which arrived since the last call and match the request to mSelectedFeatures*/
+    void selectReceivedFeatures();
+
     QgsWFSProvider* mProvider;
     QList<QgsFeatureId> mSelectedFeatures;
-    QList<QgsFeatureId>::const_iterator mFeatureIterator;
+    int mFeatureIndex;
+    /**Highest feature id of the provider when the features were selected last, the ids of features
+      added by a running request are higher*/
+    QgsFeatureId mLastFeatureId;
 };
 
 #endif // QGSWFSFEATUREITERATOR_H
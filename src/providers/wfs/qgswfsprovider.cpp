@@ -16,6 +16,13 @@
  ***************************************************************************/
 
 #define WFS_THRESHOLD 200
+#define GML_CHUNK_SIZE 65536
+//GetRenderedOnly: maximum number of tiles fetched for a rendered extent, larger extents are fetched at once
+#define WFS_MAX_TILES 64
+//GetRenderedOnly: MAXFEATURES of a tile request and how many times a full tile is split into quarters,
+//a part still cut at the last level is fetched without MAXFEATURES
+#define WFS_TILE_MAX_FEATURES 1000
+#define WFS_TILE_MAX_LEVEL 3
 
 #include "qgis.h"
 #include "qgsapplication.h"
@@ -33,6 +40,7 @@
 #include <QDomDocument>
 #include <QMessageBox>
 #include <QDomNodeList>
+#include <QAbstractNetworkCache>
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QFile>
@@ -40,6 +48,7 @@
 #include <QWidget>
 #include <QPair>
 #include <cfloat>
+#include <cmath>
 
 static const QString TEXT_PROVIDER_KEY = "WFS";
 static const QString TEXT_PROVIDER_DESCRIPTION = "WFS data provider";
@@ -59,9 +68,16 @@ QgsWFSProvider::QgsWFSProvider( const QString& uri )
     mValid( true ),
     mLayer( 0 ),
     mGetRenderedOnly( false ),
-    mInitGro( false )
+    mInitGro( false ),
+    mTileWidth( 0 ),
+    mTileHeight( 0 ),
+    mRequestFeatureCount( 0 ),
+    mRequestFailed( false ),
+    mDataReader( 0 )
 {
   mSpatialIndex = 0;
+  mExtent.setMinimal();
+  mFetchedExtent.setMinimal();
   if ( uri.isEmpty() )
   {
     mValid = false;
@@ -106,6 +122,7 @@ QgsWFSProvider::QgsWFSProvider( const QString& uri )
     typeDetectionUri.addQueryItem( "MAXFEATURES", "1" );
     setDataSourceUri( typeDetectionUri.toString() );
     reloadData();
+    waitForPendingFeatures();
     setDataSourceUri( bkUri );
   }
 
@@ -136,16 +153,36 @@ void QgsWFSProvider::reloadData()
   delete mSpatialIndex;
   mSpatialIndex = new QgsSpatialIndex();
   mValid = !getFeature( dataSourceUri() );
+
+  //wait for the first features, a request which fails right away (e.g. with a HTTP error) makes the provider invalid
+  while ( mValid && mRequestFeatureCount == 0 && readPendingFeatures() )
+    ;
+  if ( mRequestFailed && mRequestFeatureCount == 0 )
+  {
+    QgsDebugMsg( QString( "GetFeature failed, URI=%1" ).arg( dataSourceUri() ) );
+    mValid = false;
+  }
 }
 
 void QgsWFSProvider::deleteData()
 {
-  mSelectedFeatures.clear();
-  for ( int i = 0; i < mFeatures.size(); i++ )
+  //abort the running request, it may be reading data in a nested event loop
+  if ( mDataReader )
   {
-    delete mFeatures[i];
+    mDataReader->disconnect( this );
+    mDataReader->deleteLater();
+    mDataReader = 0;
   }
+
+  mSelectedFeatures.clear();
+  qDeleteAll( mFeatures );
   mFeatures.clear();
+  mIdMap.clear();
+  mServerFeatureIds.clear();
+  mLoadedTiles.clear();
+  mFetchedExtent.setMinimal();
+  mFeatureCount = 0;
+  mExtent.setMinimal();
 }
 
 void QgsWFSProvider::copyFeature( QgsFeature* f, QgsFeature& feature, bool fetchGeometry, QgsAttributeList fetchAttributes )
@@ -194,6 +231,9 @@ bool QgsWFSProvider::featureAtId( QgsFeatureId featureId,
                                   bool fetchGeometry,
                                   QgsAttributeList fetchAttributes )
 {
+  while ( !mFeatures.contains( featureId ) && readPendingFeatures() )
+    ;
+
   QMap<QgsFeatureId, QgsFeature* >::iterator it = mFeatures.find( featureId );
   if ( it == mFeatures.end() )
   {
@@ -257,6 +297,8 @@ QGis::WkbType QgsWFSProvider::geometryType() const
 
 long QgsWFSProvider::featureCount() const
 {
+  //the count is known when all features were received
+  const_cast<QgsWFSProvider*>( this )->waitForPendingFeatures();
   return mFeatureCount;
 }
 
@@ -277,6 +319,9 @@ QgsCoordinateReferenceSystem QgsWFSProvider::crs()
 
 QgsRectangle QgsWFSProvider::extent()
 {
+  //the extent is known when the bounding box of the collection was received or else when all features were received
+  while ( mDataReader && mDataReader->extent().isEmpty() && readPendingFeatures() )
+    ;
   return mExtent;
 }
 
@@ -316,40 +361,14 @@ QgsFeatureIterator QgsWFSProvider::getFeatures( const QgsFeatureRequest& request
 
       if ( mGetRenderedOnly )
       { //"Cache Features" was not selected for this layer
-        //has rendered extent expanded beyond last-retrieved WFS extent?
-        //NB: "intersect" instead of "contains" tolerates rounding errors;
-        //    avoids unnecessary second fetch on zoom-in/zoom-out sequences
-        QgsRectangle olap( rect );
-        olap = olap.intersect( &mGetExtent );
-        if ( doubleNear( rect.width(), olap.width() ) && doubleNear( rect.height(), olap.height() ) )
-        { //difference between canvas and layer extents is within rounding error: do not re-fetch
-          QgsDebugMsg( QString( "Layer %1 GetRenderedOnly: no fetch required" ).arg( mLayer->name() ) );
+        //get the tiles of the rendered extent which were not visited yet, the others are in mFeatures
+        if ( fetchTiles( rect ) )
+        {
+          mLayer->updateExtents();
         }
         else
-        { //combined old and new extents might speed up local panning & zooming
-          mGetExtent.combineExtentWith( &rect );
-          //but see if the combination is useless or too big
-          double pArea = mGetExtent.width() * mGetExtent.height();
-          double cArea = rect.width() * rect.height();
-          if ( olap.isEmpty() || pArea > ( cArea * 4.0 ) )
-          { //new canvas extent does not overlap or combining old and new extents would
-            //fetch > 4 times the area to be rendered; get only what will be rendered
-            mGetExtent = rect;
-          }
-          QgsDebugMsg( QString( "Layer %1 GetRenderedOnly: fetching extent %2" )
-                       .arg( mLayer->name(), mGetExtent.asWktCoordinates() ) );
-          dsURI = dsURI.replace( QRegExp( "BBOX=[^&]*" ),
-                                 QString( "BBOX=%1,%2,%3,%4" )
-                                 .arg( mGetExtent.xMinimum(), 0, 'f' )
-                                 .arg( mGetExtent.yMinimum(), 0, 'f' )
-                                 .arg( mGetExtent.xMaximum(), 0, 'f' )
-                                 .arg( mGetExtent.yMaximum(), 0, 'f' ) );
-          //TODO: BBOX may not be combined with FILTER. WFS spec v. 1.1.0, sec. 14.7.3 ff.
-          //      if a FILTER is present, the BBOX must be merged into it, capabilities permitting.
-          //      Else one criterion must be abandoned and the user warned.  [WBC 111221]
-          setDataSourceUri( dsURI );
-          reloadData();
-          mLayer->updateExtents();
+        {
+          QgsDebugMsg( QString( "Layer %1 GetRenderedOnly: no fetch required" ).arg( mLayer->name() ) );
         }
       }
     }
@@ -372,6 +391,9 @@ int QgsWFSProvider::getFeature( const QString& uri )
 
 bool QgsWFSProvider::addFeatures( QgsFeatureList &flist )
 {
+  //edits apply to all features of the layer
+  waitForPendingFeatures();
+
   //create <Transaction> xml
   QDomDocument transactionDoc;
   QDomElement transactionElem = createTransactionElement( transactionDoc );
@@ -465,6 +487,9 @@ bool QgsWFSProvider::addFeatures( QgsFeatureList &flist )
 
 bool QgsWFSProvider::deleteFeatures( const QgsFeatureIds &id )
 {
+  //edits apply to all features of the layer
+  waitForPendingFeatures();
+
   if ( id.size() < 1 )
   {
     return true;
@@ -538,6 +563,9 @@ bool QgsWFSProvider::deleteFeatures( const QgsFeatureIds &id )
 
 bool QgsWFSProvider::changeGeometryValues( QgsGeometryMap & geometry_map )
 {
+  //edits apply to all features of the layer
+  waitForPendingFeatures();
+
   //find out typename from uri and strip namespace prefix
   QString tname = parameterFromUrl( "typename" );
   if ( tname.isNull() )
@@ -625,6 +653,9 @@ bool QgsWFSProvider::changeGeometryValues( QgsGeometryMap & geometry_map )
 
 bool QgsWFSProvider::changeAttributeValues( const QgsChangedAttributesMap &attr_map )
 {
+  //edits apply to all features of the layer
+  waitForPendingFeatures();
+
   //find out typename from uri and strip namespace prefix
   QString tname = parameterFromUrl( "typename" );
   if ( tname.isNull() )
@@ -743,8 +774,11 @@ int QgsWFSProvider::describeFeatureType( const QString& uri, QString& geometryAt
   return 1;
 }
 
-int QgsWFSProvider::getFeatureGET( const QString& uri, const QString& geometryAttribute )
+int QgsWFSProvider::getFeatureGET( const QString& uri, const QString& geometryAttribute, bool preferCache )
 {
+  //a running request is finished first, the features are added by one request at a time
+  waitForPendingFeatures();
+
   //the new and faster method with the expat SAX parser
 
   //allows fast searchings with attribute name. Also needed is attribute Index and type infos
@@ -756,10 +790,17 @@ int QgsWFSProvider::getFeatureGET( const QString& uri, const QString& geometryAt
 
   QString typeName = parameterFromUrl( "typename" );
   //QgsWFSData dataReader( uri, &mExtent, mFeatures, mIdMap, geometryAttribute, thematicAttributes, &mWKBType );
-  QgsGml dataReader( typeName, geometryAttribute, mFields );
+  mDataReader = new QgsGml( typeName, geometryAttribute, mFields );
   //dataReader.setFeatureType( typeName, geometryAttribute, mFields );
 
-  QObject::connect( &dataReader, SIGNAL( dataProgressAndSteps( int , int ) ), this, SLOT( handleWFSProgressMessage( int, int ) ) );
+  QObject::connect( mDataReader, SIGNAL( dataProgressAndSteps( int , int ) ), this, SLOT( handleWFSProgressMessage( int, int ) ) );
+  QObject::connect( mDataReader, SIGNAL( featuresParsed() ), this, SLOT( handleFeaturesParsed() ) );
+  if ( preferCache )
+  {
+    mDataReader->setCacheLoadControl( QNetworkRequest::PreferCache );
+  }
+  mRequestFeatureCount = 0;
+  mRequestFailed = false;
 
   //also connect to statusChanged signal of qgisapp (if it exists)
   QWidget* mainWindow = 0;
@@ -776,32 +817,60 @@ int QgsWFSProvider::getFeatureGET( const QString& uri, const QString& geometryAt
 
   if ( mainWindow )
   {
-    QObject::connect( this, SIGNAL( dataReadProgressMessage( QString ) ), mainWindow, SLOT( showStatusMessage( QString ) ) );
+    QObject::connect( this, SIGNAL( dataReadProgressMessage( QString ) ), mainWindow, SLOT( showStatusMessage( QString ) ), Qt::UniqueConnection );
   }
 
-  //if ( dataReader.getWFSData() != 0 )
-  if ( dataReader.getFeatures( uri, &mWKBType, &mExtent ) != 0 )
+  //the response is parsed by readPendingFeatures(), iterators get the features as they arrive
+  mDataReader->startGetFeatures( uri );
+  return 0;
+}
+
+bool QgsWFSProvider::readPendingFeatures()
+{
+  if ( !mDataReader )
   {
-    QgsDebugMsg( "getWFSData returned with error" );
-    return 1;
+    return false;
   }
-  mFeatures = dataReader.featuresMap();
-  mIdMap = dataReader.idsMap();
 
-  QgsDebugMsg( QString( "feature count after request is: %1" ).arg( mFeatures.size() ) );
-  QgsDebugMsg( QString( "mExtent after request is: %1" ).arg( mExtent.toString() ) );
+  //features are added to mFeatures and the spatial index while they are parsed
+  QgsGml* dataReader = mDataReader;
+  bool running = dataReader->readData( &mWKBType, 0, WFS_THRESHOLD );
 
-  if ( mWKBType != QGis::WKBNoGeometry )
+  if ( dataReader != mDataReader )
   {
-    for ( QMap<QgsFeatureId, QgsFeature*>::iterator it = mFeatures.begin(); it != mFeatures.end(); ++it )
-    {
-      QgsDebugMsg( "feature " + FID_TO_STRING(( *it )->id() ) );
-      mSpatialIndex->insertFeature( *( it.value() ) );
-    }
+    //the request was aborted while events were processed
+    return mDataReader != 0;
   }
-  mFeatureCount = mFeatures.size();
 
-  return 0;
+  //the bounding box of the collection precedes its features
+  QgsRectangle collectionExtent = mDataReader->extent();
+  if ( !collectionExtent.isEmpty() )
+  {
+    mExtent.combineExtentWith( &collectionExtent );
+  }
+
+  if ( running )
+  {
+    return true;
+  }
+
+  if ( mDataReader->hasError() )
+  {
+    QgsDebugMsg( "GetFeature request failed" );
+    mRequestFailed = true;
+  }
+  QgsDebugMsg( QString( "feature count after request is: %1" ).arg( mFeatures.size() ) );
+  QgsDebugMsg( QString( "extent after request is: %1" ).arg( mExtent.toString() ) );
+
+  mDataReader->deleteLater();
+  mDataReader = 0;
+  return false;
+}
+
+void QgsWFSProvider::waitForPendingFeatures()
+{
+  while ( readPendingFeatures() )
+    ;
 }
 
 int QgsWFSProvider::getFeatureFILE( const QString& uri, const QString& geometryAttribute )
@@ -813,30 +882,73 @@ int QgsWFSProvider::getFeatureFILE( const QString& uri, const QString& geometryA
     return 1;
   }
 
-  QDomDocument gmlDoc;
-  QString errorMsg;
-  int errorLine, errorColumn;
-  if ( !gmlDoc.setContent( &gmlFile, true, &errorMsg, &errorLine, &errorColumn ) )
+  //read the file in chunks, the type name is taken from the first feature member
+  QgsGml dataReader( QString(), geometryAttribute, mFields );
+  QObject::connect( &dataReader, SIGNAL( featuresParsed() ), this, SLOT( handleFeaturesParsed() ) );
+
+  bool atEnd = false;
+  while ( !atEnd )
   {
-    mValid = false;
-    return 2;
+    QByteArray data = gmlFile.read( GML_CHUNK_SIZE );
+    atEnd = data.isEmpty() || gmlFile.atEnd();
+    if ( dataReader.processData( data, atEnd, &mWKBType, &mExtent ) != 0 )
+    {
+      mValid = false;
+      return 2;
+    }
   }
 
-  QDomElement featureCollectionElement = gmlDoc.documentElement();
-  //get and set Extent
-  if ( mWKBType != QGis::WKBNoGeometry && getExtentFromGML2( &mExtent, featureCollectionElement ) != 0 )
+  if ( dataReader.epsg() > 0 )
   {
-    return 3;
+    mSourceCRS.createFromOgcWmsCrs( QString( "EPSG:%1" ).arg( dataReader.epsg() ) );
   }
 
-  setCRSFromGML2( featureCollectionElement );
+  return 0;
+}
 
-  if ( getFeaturesFromGML2( featureCollectionElement, geometryAttribute ) != 0 )
+void QgsWFSProvider::handleFeaturesParsed()
+{
+  QgsGml* dataReader = qobject_cast<QgsGml*>( sender() );
+  if ( !dataReader )
   {
-    return 4;
+    return;
   }
 
-  return 0;
+  //take over the features as they arrive, they are not kept by the reader until the end of the document
+  QMap<QgsFeatureId, QgsFeature*> features = dataReader->takeFeatures();
+  QMap<QgsFeatureId, QString> serverIds = dataReader->idsMap();
+  for ( QMap<QgsFeatureId, QgsFeature*>::const_iterator it = features.constBegin(); it != features.constEnd(); ++it )
+  {
+    QgsFeature* f = it.value();
+    QString serverId = serverIds.value( it.key() );
+    ++mRequestFeatureCount;
+
+    if ( !serverId.isEmpty() && mServerFeatureIds.contains( serverId ) )
+    {
+      //already received with a neighbouring tile
+      delete f;
+      continue;
+    }
+
+    //reader ids start at 0 in each request
+    QgsFeatureId id = findNewKey();
+    f->setFeatureId( id );
+    mFeatures.insert( id, f );
+    if ( !serverId.isEmpty() )
+    {
+      mIdMap.insert( id, serverId );
+      mServerFeatureIds.insert( serverId );
+    }
+    if ( f->geometry() )
+    {
+      mSpatialIndex->insertFeature( *f );
+
+      //the extent grows with the received features
+      QgsRectangle bbox = f->geometry()->boundingBox();
+      mExtent.combineExtentWith( &bbox );
+    }
+  }
+  mFeatureCount = mFeatures.size();
 }
 
 int QgsWFSProvider::describeFeatureTypeGET( const QString& uri, QString& geometryAttribute, QgsFields& fields, QGis::WkbType& geomType )
@@ -1104,250 +1216,6 @@ int QgsWFSProvider::guessAttributesFromFile( const QString& uri, QString& geomet
   return 0;
 }
 
-int QgsWFSProvider::getExtentFromGML2( QgsRectangle* extent, const QDomElement& wfsCollectionElement ) const
-{
-  QDomNodeList boundedByList = wfsCollectionElement.elementsByTagNameNS( GML_NAMESPACE, "boundedBy" );
-  if ( boundedByList.length() < 1 )
-  {
-    return 1;
-  }
-  QDomElement boundedByElement = boundedByList.at( 0 ).toElement();
-  QDomNode childNode = boundedByElement.firstChild();
-  if ( childNode.isNull() )
-  {
-    return 2;
-  }
-
-  //support <gml:Box>, <gml:coordinates> and <gml:Envelope>,<gml::lowerCorner>,<gml::upperCorner>. What
-  //about <gml:Envelope>, <gml:pos>?
-  QString bboxName = childNode.localName();
-  if ( bboxName != "Box" )
-  {
-    return 3;
-  }
-
-  QDomNode coordinatesNode = childNode.firstChild();
-  if ( coordinatesNode.localName() == "coordinates" )
-  {
-    std::list<QgsPoint> boundingPoints;
-    if ( readGML2Coordinates( boundingPoints, coordinatesNode.toElement() ) != 0 )
-    {
-      return 5;
-    }
-
-    if ( boundingPoints.size() != 2 )
-    {
-      return 6;
-    }
-
-    std::list<QgsPoint>::const_iterator it = boundingPoints.begin();
-    extent->setXMinimum( it->x() );
-    extent->setYMinimum( it->y() );
-    ++it;
-    extent->setXMaximum( it->x() );
-    extent->setYMaximum( it->y() );
-    return 0;
-  }
-  else if ( coordinatesNode.localName() == "coord" )
-  {
-    //first <coord> element
-    QDomElement xElement, yElement;
-    bool conversion1, conversion2; //string->double conversion success
-    xElement = coordinatesNode.firstChild().toElement();
-    yElement = xElement.nextSibling().toElement();
-    if ( xElement.isNull() || yElement.isNull() )
-    {
-      return 7;
-    }
-    double x1 = xElement.text().toDouble( &conversion1 );
-    double y1 = yElement.text().toDouble( &conversion2 );
-    if ( !conversion1 || !conversion2 )
-    {
-      return 8;
-    }
-
-    //second <coord> element
-    coordinatesNode = coordinatesNode.nextSibling();
-    xElement = coordinatesNode.firstChild().toElement();
-    yElement = xElement.nextSibling().toElement();
-    if ( xElement.isNull() || yElement.isNull() )
-    {
-      return 9;
-    }
-    double x2 = xElement.text().toDouble( &conversion1 );
-    double y2 = yElement.text().toDouble( &conversion2 );
-    if ( !conversion1 || !conversion2 )
-    {
-      return 10;
-    }
-    extent->setXMinimum( x1 );
-    extent->setYMinimum( y1 );
-    extent->setXMaximum( x2 );
-    extent->setYMaximum( y2 );
-    return 0;
-  }
-  else
-  {
-    return 11; //no valid tag for the bounding box
-  }
-}
-
-int QgsWFSProvider::setCRSFromGML2( const QDomElement& wfsCollectionElement )
-{
-  QgsDebugMsg( "entering." );
-  //search <gml:boundedBy>
-  QDomNodeList boundedByList = wfsCollectionElement.elementsByTagNameNS( GML_NAMESPACE, "boundedBy" );
-  if ( boundedByList.size() < 1 )
-  {
-    QgsDebugMsg( "Error, could not find boundedBy element" );
-    return 1;
-  }
-  //search <gml:Envelope>
-  QDomElement boundedByElem = boundedByList.at( 0 ).toElement();
-  QDomNodeList boxList = boundedByElem.elementsByTagNameNS( GML_NAMESPACE, "Box" );
-  if ( boxList.size() < 1 )
-  {
-    QgsDebugMsg( "Error, could not find Envelope element" );
-    return 2;
-  }
-  QDomElement boxElem = boxList.at( 0 ).toElement();
-  //getAttribute 'srsName'
-  QString srsName = boxElem.attribute( "srsName" );
-  if ( srsName.isEmpty() )
-  {
-    QgsDebugMsg( "Error, srsName is empty" );
-    return 3;
-  }
-  QgsDebugMsg( "srsName is: " + srsName );
-
-
-  //extract the EpsgCrsId id
-  bool conversionSuccess;
-  if ( srsName.contains( "#" ) )//geoserver has "http://www.opengis.net/gml/srs/epsg.xml#4326"
-  {
-    int epsgId = srsName.section( "#", 1, 1 ).toInt( &conversionSuccess );
-    if ( !conversionSuccess )
-    {
-      return 4;
-    }
-    srsName = QString( "EPSG:%1" ).arg( epsgId );
-  }
-  else if ( !srsName.contains( ":" ) ) //mapserver has "EPSG:4326"
-    srsName = GEO_EPSG_CRS_AUTHID;
-
-  if ( !mSourceCRS.createFromOgcWmsCrs( srsName ) )
-  {
-    QgsDebugMsg( "Error, creation of QgsCoordinateReferenceSystem failed" );
-    return 6;
-  }
-  return 0;
-}
-
-int QgsWFSProvider::getFeaturesFromGML2( const QDomElement& wfsCollectionElement, const QString& geometryAttribute )
-{
-  QDomNodeList featureTypeNodeList = wfsCollectionElement.elementsByTagNameNS( GML_NAMESPACE, "featureMember" );
-  QDomElement currentFeatureMemberElem;
-  QDomElement layerNameElem;
-  QDomNode currentAttributeChild;
-  QDomElement currentAttributeElement;
-  QgsFeature* f = 0;
-  unsigned char* wkb = 0;
-  int wkbSize = 0;
-  mFeatureCount = 0;
-
-  for ( int i = 0; i < featureTypeNodeList.size(); ++i )
-  {
-    f = new QgsFeature( mFeatureCount );
-    currentFeatureMemberElem = featureTypeNodeList.at( i ).toElement();
-    //the first child element is always <namespace:layer>
-    layerNameElem = currentFeatureMemberElem.firstChild().toElement();
-    //the children are the attributes
-    currentAttributeChild = layerNameElem.firstChild();
-    int attr = 0;
-    bool numeric = false;
-
-    while ( !currentAttributeChild.isNull() )
-    {
-      currentAttributeElement = currentAttributeChild.toElement();
-
-      if ( currentAttributeElement.localName() != "boundedBy" )
-      {
-        currentAttributeElement.text().toDouble( &numeric );
-        if (( currentAttributeElement.localName() ) != geometryAttribute ) //a normal attribute
-        {
-          if ( numeric )
-          {
-            f->setAttribute( attr++, QVariant( currentAttributeElement.text().toDouble() ) );
-          }
-          else
-          {
-            f->setAttribute( attr++, QVariant( currentAttributeElement.text() ) );
-          }
-        }
-        else //a geometry attribute
-        {
-          f->setGeometry( QgsGeometry::fromGML2( currentAttributeElement ) );
-        }
-      }
-      currentAttributeChild = currentAttributeChild.nextSibling();
-    }
-    if ( wkb && wkbSize > 0 )
-    {
-      //insert bbox and pointer to feature into search tree
-      mSpatialIndex->insertFeature( *f );
-    }
-
-    mFeatures.insert( f->id(), f );
-    ++mFeatureCount;
-  }
-  return 0;
-}
-
-int QgsWFSProvider::readGML2Coordinates( std::list<QgsPoint>& coords, const QDomElement elem ) const
-{
-  QString coordSeparator = ",";
-  QString tupelSeparator = " ";
-  //"decimal" has to be "."
-
-  coords.clear();
-
-  if ( elem.hasAttribute( "cs" ) )
-  {
-    coordSeparator = elem.attribute( "cs" );
-  }
-  if ( elem.hasAttribute( "ts" ) )
-  {
-    tupelSeparator = elem.attribute( "ts" );
-  }
-
-  QStringList tupels = elem.text().split( tupelSeparator, QString::SkipEmptyParts );
-  QStringList tupel_coords;
-  double x, y;
-  bool conversionSuccess;
-
-  QStringList::const_iterator it;
-  for ( it = tupels.constBegin(); it != tupels.constEnd(); ++it )
-  {
-    tupel_coords = ( *it ).split( coordSeparator, QString::SkipEmptyParts );
-    if ( tupel_coords.size() < 2 )
-    {
-      continue;
-    }
-    x = tupel_coords.at( 0 ).toDouble( &conversionSuccess );
-    if ( !conversionSuccess )
-    {
-      return 1;
-    }
-    y = tupel_coords.at( 1 ).toDouble( &conversionSuccess );
-    if ( !conversionSuccess )
-    {
-      return 1;
-    }
-    coords.push_back( QgsPoint( x, y ) );
-  }
-  return 0;
-}
-
 void QgsWFSProvider::handleWFSProgressMessage( int done, int total )
 {
   QString totalString;
@@ -1443,6 +1311,16 @@ bool QgsWFSProvider::sendTransactionDocument( const QDomDocument& doc, QDomDocum
   typeDetectionUri.removeQueryItem( "OUTPUTFORMAT" );
   QString serverUrl = typeDetectionUri.toString();
 
+  //the cached tiles may be outdated by the transaction
+  QAbstractNetworkCache* cache = QgsNetworkAccessManager::instance()->cache();
+  if ( cache )
+  {
+    foreach ( QString tileUri, mTileRequests )
+    {
+      cache->remove( QUrl( tileUri ) );
+    }
+  }
+
   QNetworkRequest request( serverUrl );
   request.setHeader( QNetworkRequest::ContentTypeHeader, "text/xml" );
   QNetworkReply* reply = QgsNetworkAccessManager::instance()->post( request, doc.toByteArray( -1 ) );
@@ -1676,6 +1554,129 @@ bool QgsWFSProvider::initGetRenderedOnly( const QgsRectangle rect )
   return true;
 }
 
+bool QgsWFSProvider::fetchTiles( const QgsRectangle& rect )
+{
+  if ( mTileWidth <= 0 || mTileHeight <= 0 )
+  {
+    //the grid is derived from the BBOX of the layer source (the extent when the layer was added),
+    //so that the tile requests and their entries in the network cache are the same in each session
+    QStringList bbox = parameterFromUrl( "BBOX" ).split( "," );
+    QgsRectangle gridExtent;
+    if ( bbox.size() == 4 )
+    {
+      gridExtent = QgsRectangle( bbox[0].toDouble(), bbox[1].toDouble(), bbox[2].toDouble(), bbox[3].toDouble() );
+    }
+    if ( gridExtent.isEmpty() )
+    {
+      gridExtent = rect;
+    }
+    mTileOrigin = QgsPoint( gridExtent.xMinimum(), gridExtent.yMinimum() );
+    mTileWidth = gridExtent.width() / 2;
+    mTileHeight = gridExtent.height() / 2;
+
+    if ( !mSpatialIndex )
+    {
+      mSpatialIndex = new QgsSpatialIndex();
+    }
+  }
+
+  double minCol = floor(( rect.xMinimum() - mTileOrigin.x() ) / mTileWidth );
+  double maxCol = floor(( rect.xMaximum() - mTileOrigin.x() ) / mTileWidth );
+  double minRow = floor(( rect.yMinimum() - mTileOrigin.y() ) / mTileHeight );
+  double maxRow = floor(( rect.yMaximum() - mTileOrigin.y() ) / mTileHeight );
+  if (( maxCol - minCol + 1 ) * ( maxRow - minRow + 1 ) > WFS_MAX_TILES )
+  {
+    //zoomed out far beyond the grid: get the extent at once, the features are kept but the tiles are not marked
+    if ( mFetchedExtent.contains( rect ) )
+    {
+      return false;
+    }
+    QgsDebugMsg( QString( "Layer %1 GetRenderedOnly: fetching extent %2" ).arg( mLayer->name(), rect.asWktCoordinates() ) );
+    if ( fetchTile( rect, WFS_TILE_MAX_LEVEL + 1 ) )
+    {
+      mFetchedExtent = rect;
+    }
+    return true;
+  }
+
+  bool fetched = false;
+  for ( int row = ( int ) minRow; row <= ( int ) maxRow; ++row )
+  {
+    for ( int col = ( int ) minCol; col <= ( int ) maxCol; ++col )
+    {
+      QPair<int, int> tile( col, row );
+      if ( mLoadedTiles.contains( tile ) )
+      {
+        continue;
+      }
+
+      QgsRectangle tileRect( mTileOrigin.x() + col * mTileWidth, mTileOrigin.y() + row * mTileHeight,
+                             mTileOrigin.x() + ( col + 1 ) * mTileWidth, mTileOrigin.y() + ( row + 1 ) * mTileHeight );
+      QgsDebugMsg( QString( "Layer %1 GetRenderedOnly: fetching tile %2 %3" ).arg( mLayer->name() ).arg( col ).arg( row ) );
+      //a tile with a failed request is fetched again with the next rendered extent
+      if ( fetchTile( tileRect, 0 ) )
+      {
+        mLoadedTiles.insert( tile );
+      }
+      fetched = true;
+    }
+  }
+  return fetched;
+}
+
+bool QgsWFSProvider::fetchTile( const QgsRectangle& rect, int level )
+{
+  //TODO: BBOX may not be combined with FILTER. WFS spec v. 1.1.0, sec. 14.7.3 ff.
+  //      if a FILTER is present, the BBOX must be merged into it, capabilities permitting.
+  //      Else one criterion must be abandoned and the user warned.  [WBC 111221]
+  QString tileUri = dataSourceUri();
+  tileUri.replace( QRegExp( "BBOX=[^&]*" ),
+                   QString( "BBOX=%1,%2,%3,%4" )
+                   .arg( rect.xMinimum(), 0, 'f' )
+                   .arg( rect.yMinimum(), 0, 'f' )
+                   .arg( rect.xMaximum(), 0, 'f' )
+                   .arg( rect.yMaximum(), 0, 'f' ) );
+
+  //MAXFEATURES of the layer source is kept, the tiles are then limited like the whole layer would be.
+  //Beyond the last level of subdivision the request is not limited, so that no features are missing.
+  bool limited = parameterFromUrl( "MAXFEATURES" ).isEmpty() && level <= WFS_TILE_MAX_LEVEL;
+  if ( limited )
+  {
+    tileUri += QString( "&MAXFEATURES=%1" ).arg( WFS_TILE_MAX_FEATURES );
+  }
+  mTileRequests.insert( tileUri );
+
+  if ( getFeatureGET( tileUri, mGeometryAttribute, true ) != 0 )
+  {
+    return false;
+  }
+  waitForPendingFeatures();
+  if ( mRequestFailed )
+  {
+    return false;
+  }
+
+  if ( !limited || mRequestFeatureCount < WFS_TILE_MAX_FEATURES )
+  {
+    return true;
+  }
+
+  if ( level == WFS_TILE_MAX_LEVEL )
+  {
+    //still cut at the last level, the features are dense here: get the whole rectangle
+    QgsDebugMsg( QString( "Layer %1 GetRenderedOnly: fetching %2 without MAXFEATURES" ).arg( mLayer->name(), rect.asWktCoordinates() ) );
+    return fetchTile( rect, level + 1 );
+  }
+
+  //the response was cut at MAXFEATURES (there is no paging in WFS 1.0), get the rest by quarters
+  QgsPoint center = rect.center();
+  bool success = fetchTile( QgsRectangle( rect.xMinimum(), rect.yMinimum(), center.x(), center.y() ), level + 1 );
+  success = fetchTile( QgsRectangle( center.x(), rect.yMinimum(), rect.xMaximum(), center.y() ), level + 1 ) && success;
+  success = fetchTile( QgsRectangle( rect.xMinimum(), center.y(), center.x(), rect.yMaximum() ), level + 1 ) && success;
+  success = fetchTile( QgsRectangle( center.x(), center.y(), rect.xMaximum(), rect.yMaximum() ), level + 1 ) && success;
+  return success;
+}
+
 QGis::WkbType QgsWFSProvider::geomTypeFromPropertyType( QString attName, QString propType )
 {
   Q_UNUSED( attName );
@@ -19,6 +19,7 @@
 #define QGSWFSPROVIDER_H
 
 #include <QDomElement>
+#include <QSet>
 #include "qgis.h"
 #include "qgsrectangle.h"
 #include "qgscoordinatereferencesystem.h"
@@ -27,6 +28,7 @@
 #include "qgsvectorlayer.h"
 #include "qgswfsfeatureiterator.h"
 
+class QgsGml;
 class QgsRectangle;
 class QgsSpatialIndex;
 
@@ -148,6 +150,9 @@ class QgsWFSProvider: public QgsVectorDataProvider
     /**Sets mNetworkRequestFinished flag to true*/
     void networkRequestFinished();
 
+    /**Takes the features parsed so far from the sending QgsGml and adds them to mFeatures and the spatial index*/
+    void handleFeaturesParsed();
+
   private:
     bool mNetworkRequestFinished;
     friend class QgsWFSFeatureIterator;
@@ -193,11 +198,31 @@ class QgsWFSProvider: public QgsVectorDataProvider
     bool mGetRenderedOnly;
     /**GetRenderedOnly initializaiton flat*/
     bool mInitGro;
-    /**if GetRenderedOnly, extent specified in WFS getFeatures; else empty (no constraint)*/
-    QgsRectangle mGetExtent;
+    /**GetRenderedOnly: origin of the grid of tiles in which the features are fetched*/
+    QgsPoint mTileOrigin;
+    /**GetRenderedOnly: tile size, 0 until the grid is set up with the first rendered extent*/
+    double mTileWidth;
+    double mTileHeight;
+    /**GetRenderedOnly: column and row of the tiles whose features are in mFeatures*/
+    QSet< QPair<int, int> > mLoadedTiles;
+    /**GetRenderedOnly: URLs of the tile requests, their entries in the network cache are removed by transactions*/
+    QSet<QString> mTileRequests;
+    /**WFS server ids of the features in mFeatures, features received with another tile again are skipped*/
+    QSet<QString> mServerFeatureIds;
+    /**GetRenderedOnly: extent fetched at once when zoomed out beyond the tiles, empty if none*/
+    QgsRectangle mFetchedExtent;
+    /**Number of features received in the running GetFeature request (including skipped ones)*/
+    int mRequestFeatureCount;
+    /**True if the last GetFeature request failed*/
+    bool mRequestFailed;
+    /**Reader of the running GetFeature request, 0 if no request is running*/
+    QgsGml* mDataReader;
 
     //encoding specific methods of getFeature
-    int getFeatureGET( const QString& uri, const QString& geometryAttribute );
+    /**Starts a request of features from the server, they are added to mFeatures by readPendingFeatures()
+      while the response arrives. A request running before is finished first.
+      @param preferCache load the response from the network cache if available and save it there*/
+    int getFeatureGET( const QString& uri, const QString& geometryAttribute, bool preferCache = false );
     int getFeaturePOST( const QString& uri, const QString& geometryAttribute );
     int getFeatureSOAP( const QString& uri, const QString& geometryAttribute );
     int getFeatureFILE( const QString& uri, const QString& geometryAttribute );
@@ -212,21 +237,15 @@ class QgsWFSProvider: public QgsVectorDataProvider
     /**This method tries to guess the geometry attribute and the other attribute names from the .gml file if no schema is present. Returns 0 in case of success*/
     int guessAttributesFromFile( const QString& uri, QString& geometryAttribute, std::list<QString>& thematicAttributes, QGis::WkbType& geomType ) const;
 
+    /**Adds the features of the running request which arrived so far to mFeatures
+      @return true while the request is running*/
+    bool readPendingFeatures();
+    /**Reads the running request to its end*/
+    void waitForPendingFeatures();
+
     /**Copies feature attributes / geometry from f to feature*/
     void copyFeature( QgsFeature* f, QgsFeature& feature, bool fetchGeometry, QgsAttributeList fetchAttributes );
 
-    //GML2 specific methods
-    int getExtentFromGML2( QgsRectangle* extent, const QDomElement& wfsCollectionElement ) const;
-
-    int getFeaturesFromGML2( const QDomElement& wfsCollectionElement, const QString& geometryAttribute );
-    /**Reads the <gml:coordinates> element and extracts the coordinates as points
-       @param coords list where the found coordinates are appended
-       @param elem the <gml:coordinates> element
-       @return 0 in case of success*/
-    int readGML2Coordinates( std::list<QgsPoint>& coords, const QDomElement elem ) const;
-    /**Tries to create a QgsCoordinateReferenceSystem object and assign it to mSourceCRS. Returns 0 in case of success*/
-    int setCRSFromGML2( const QDomElement& wfsCollectionElement );
-
     //helper methods for WFS-T
 
     /**Returns HTTP parameter value from url (or empty string if it does not exist)*/
@@ -259,6 +278,14 @@ class QgsWFSProvider: public QgsVectorDataProvider
     void handleException( const QDomDocument& serverResponse ) const;
     /**Initializes "Cache Features" inactive processing*/
     bool initGetRenderedOnly( QgsRectangle );
+    /**GetRenderedOnly: fetches the tiles covering the rectangle that were not fetched yet
+      @return true if features were requested*/
+    bool fetchTiles( const QgsRectangle& rect );
+    /**GetRenderedOnly: fetches the features of a tile. If the server cuts the response at the
+      maximum number of features, the quarters of the tile are fetched (up to a level of subdivision,
+      beyond it the tile is requested without maximum). MAXFEATURES of the layer source is respected.
+      @return true if all requests succeeded*/
+    bool fetchTile( const QgsRectangle& rect, int level );
     /**Converts DescribeFeatureType schema geometry property type to WKBType*/
     QGis::WkbType geomTypeFromPropertyType( QString attName, QString propType );
 
@@ -23,6 +23,12 @@
 
 // time to wait for an answer without emitting dataChanged()
 #define WMS_THRESHOLD 200
+// maximum number of running tile requests of a provider
+#define WMS_MAX_TILE_REQUESTS 6
+// size of the memory cache of decoded tiles in KiB
+#define WMS_TILE_CACHE_SIZE 65536
+// number of coarser tile matrices whose cached tiles are shown while tiles are loading
+#define WMS_FALLBACK_LEVELS 2
 
 #include "qgslogger.h"
 #include "qgswmsprovider.h"
@@ -54,6 +60,9 @@
 #endif
 
 #include <QUrl>
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QIcon>
 #include <QImage>
 #include <QImageReader>
@@ -73,6 +82,10 @@
 #define ERR(message) QGS_ERROR_MESSAGE(message,"WMS provider")
 #define SRVERR(message) QGS_ERROR_MESSAGE(message,"WMS server")
 
+// decoded tiles shared by all WMS providers, see QgsWmsProvider::tileKey()
+static QCache<QString, QImage> sTileCache( WMS_TILE_CACHE_SIZE );
+static QMutex sTileCacheMutex;
+
 static QString WMS_KEY = "wms";
 static QString WMS_DESCRIPTION = "OGC Web Map Service version 1.3 data provider";
 
@@ -255,6 +268,7 @@ QgsWmsProvider::~QgsWmsProvider()
     mCacheReply = 0;
   }
 
+  mTileRequestQueue.clear();
   while ( !mTileReplies.isEmpty() )
   {
     mTileReplies.takeFirst()->deleteLater();
@@ -264,6 +278,7 @@ QgsWmsProvider::~QgsWmsProvider()
 QgsRasterInterface * QgsWmsProvider::clone() const
 {
   QgsWmsProvider * provider = new QgsWmsProvider( dataSourceUri() );
+  provider->copyBaseSettings( *this );
   return provider;
 }
 
@@ -688,6 +703,10 @@ QImage *QgsWmsProvider::draw( QgsRectangle  const &viewExtent, int pixelWidth, i
   {
     mTileReqNo++;
 
+    // requests of the previous view that were not started yet are cancelled,
+    // the running ones are taken over by this view or aborted below
+    mTileRequestQueue.clear();
+
     double vres = viewExtent.width() / pixelWidth;
     double tres = vres;
 
@@ -800,6 +819,41 @@ QImage *QgsWmsProvider::draw( QgsRectangle  const &viewExtent, int pixelWidth, i
     }
 #endif
 
+    if ( mTiled )
+    {
+      // show the cached tiles of coarser matrices until the tiles of this resolution arrive
+      const QMap<double, QgsWmtsTileMatrix> &m = mTileMatrixSet->tileMatrices;
+      QList<double> coarserResolutions;
+      QMap<double, QgsWmtsTileMatrix>::const_iterator it = m.find( tres );
+      for ( ++it; it != m.constEnd() && coarserResolutions.size() < WMS_FALLBACK_LEVELS; ++it )
+      {
+        coarserResolutions.prepend( it.key() );
+      }
+
+      foreach ( double res, coarserResolutions )
+      {
+        const QgsWmtsTileMatrix &ctm = m[ res ];
+        double ctw = ctm.tileWidth * res;
+        double cth = ctm.tileHeight * res;
+        int ccol0 = qBound( 0, ( int ) floor(( viewExtent.xMinimum() - ctm.topLeft.x() ) / ctw ), ctm.matrixWidth - 1 );
+        int crow0 = qBound( 0, ( int ) floor(( ctm.topLeft.y() - viewExtent.yMaximum() ) / cth ), ctm.matrixHeight - 1 );
+        int ccol1 = qBound( 0, ( int ) floor(( viewExtent.xMaximum() - ctm.topLeft.x() ) / ctw ), ctm.matrixWidth - 1 );
+        int crow1 = qBound( 0, ( int ) floor(( ctm.topLeft.y() - viewExtent.yMinimum() ) / cth ), ctm.matrixHeight - 1 );
+
+        for ( int row = crow0; row <= crow1; row++ )
+        {
+          for ( int col = ccol0; col <= ccol1; col++ )
+          {
+            QImage image = cachedTile( tileKey( &ctm, res, row, col ) );
+            if ( !image.isNull() )
+            {
+              drawTile( QRectF( ctm.topLeft.x() + col * ctw, ctm.topLeft.y() - ( row + 1 ) * cth, ctw, cth ), image, false );
+            }
+          }
+        }
+      }
+    }
+
     switch ( tileMode )
     {
       case WMSC:
@@ -847,20 +901,9 @@ QImage *QgsWmsProvider::draw( QgsRectangle  const &viewExtent, int pixelWidth, i
                     .arg( tm->topLeft.x() + ( col + 1 ) * twMap /* - twMap * 0.001 */, 0, 'f', 16 )
                     .arg( tm->topLeft.y() -         row * thMap /* + thMap * 0.001 */, 0, 'f', 16 );
 
-            QNetworkRequest request( turl );
-            setAuthorization( request );
             QgsDebugMsg( QString( "tileRequest %1 %2/%3 (%4,%5): %6" ).arg( mTileReqNo ).arg( i++ ).arg( n ).arg( row ).arg( col ).arg( turl ) );
-            request.setAttribute( QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache );
-            request.setAttribute( QNetworkRequest::CacheSaveControlAttribute, true );
-            request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 0 ), mTileReqNo );
-            request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 1 ), i );
-            request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 2 ),
-                                  QRectF( tm->topLeft.x() + col * twMap, tm->topLeft.y() - ( row + 1 ) * thMap, twMap, thMap ) );
-
-            QgsDebugMsg( QString( "gettile: %1" ).arg( turl ) );
-            QNetworkReply *reply = QgsNetworkAccessManager::instance()->get( request );
-            mTileReplies << reply;
-            connect( reply, SIGNAL( finished() ), this, SLOT( tileReplyFinished() ) );
+            addTileRequest( turl, tileKey( tm, tres, row, col ),
+                            QRectF( tm->topLeft.x() + col * twMap, tm->topLeft.y() - ( row + 1 ) * thMap, twMap, thMap ), i );
           }
         }
       }
@@ -900,20 +943,9 @@ QImage *QgsWmsProvider::draw( QgsRectangle  const &viewExtent, int pixelWidth, i
               turl += url.toString();
               turl += QString( "&TILEROW=%1&TILECOL=%2" ).arg( row ).arg( col );
 
-              QNetworkRequest request( turl );
-              setAuthorization( request );
               QgsDebugMsg( QString( "tileRequest %1 %2/%3 (%4,%5): %6" ).arg( mTileReqNo ).arg( i++ ).arg( n ).arg( row ).arg( col ).arg( turl ) );
-              request.setAttribute( QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache );
-              request.setAttribute( QNetworkRequest::CacheSaveControlAttribute, true );
-              request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 0 ), mTileReqNo );
-              request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 1 ), i );
-              request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 2 ),
-                                    QRectF( tm->topLeft.x() + col * twMap, tm->topLeft.y() - ( row + 1 ) * thMap, twMap, thMap ) );
-
-              QgsDebugMsg( QString( "gettile: %1" ).arg( turl ) );
-              QNetworkReply *reply = QgsNetworkAccessManager::instance()->get( request );
-              mTileReplies << reply;
-              connect( reply, SIGNAL( finished() ), this, SLOT( tileReplyFinished() ) );
+              addTileRequest( turl, tileKey( tm, tres, row, col ),
+                              QRectF( tm->topLeft.x() + col * twMap, tm->topLeft.y() - ( row + 1 ) * thMap, twMap, thMap ), i );
             }
           }
         }
@@ -940,20 +972,9 @@ QImage *QgsWmsProvider::draw( QgsRectangle  const &viewExtent, int pixelWidth, i
               turl.replace( "{tilerow}", QString::number( row ), Qt::CaseInsensitive );
               turl.replace( "{tilecol}", QString::number( col ), Qt::CaseInsensitive );
 
-              QNetworkRequest request( turl );
-              setAuthorization( request );
               QgsDebugMsg( QString( "tileRequest %1 %2/%3 (%4,%5): %6" ).arg( mTileReqNo ).arg( i++ ).arg( n ).arg( row ).arg( col ).arg( turl ) );
-              request.setAttribute( QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache );
-              request.setAttribute( QNetworkRequest::CacheSaveControlAttribute, true );
-              request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 0 ), mTileReqNo );
-              request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 1 ), i );
-              request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 2 ),
-                                    QRectF( tm->topLeft.x() + col * twMap, tm->topLeft.y() - ( row + 1 ) * thMap, twMap, thMap ) );
-
-              QgsDebugMsg( QString( "gettile: %1" ).arg( turl ) );
-              QNetworkReply *reply = QgsNetworkAccessManager::instance()->get( request );
-              mTileReplies << reply;
-              connect( reply, SIGNAL( finished() ), this, SLOT( tileReplyFinished() ) );
+              addTileRequest( turl, tileKey( tm, tres, row, col ),
+                              QRectF( tm->topLeft.x() + col * twMap, tm->topLeft.y() - ( row + 1 ) * thMap, twMap, thMap ), i );
             }
           }
         }
@@ -966,6 +987,22 @@ QImage *QgsWmsProvider::draw( QgsRectangle  const &viewExtent, int pixelWidth, i
         break;
     }
 
+    // running requests of previous views whose tiles are not in this view are aborted,
+    // so that the tiles of this view get all request slots
+    foreach ( QNetworkReply *reply, mTileReplies )
+    {
+      if ( reply->property( "tileReqNo" ).toInt() == mTileReqNo )
+        continue;
+
+      QgsDebugMsg( QString( "abort tile request: %1" ).arg( reply->url().toString() ) );
+      disconnect( reply, SIGNAL( finished() ), this, SLOT( tileReplyFinished() ) );
+      mTileReplies.removeOne( reply );
+      reply->abort();
+      reply->deleteLater();
+    }
+
+    dispatchTileRequests();
+
     emit statusChanged( tr( "Getting tiles." ) );
 
     mWaiting = true;
@@ -1046,28 +1083,35 @@ void QgsWmsProvider::tileReplyFinished()
   }
 #endif
 
-  QNetworkCacheMetaData cmd = QgsNetworkAccessManager::instance()->cache()->metaData( reply->request().url() );
-
-  QNetworkCacheMetaData::RawHeaderList hl;
-  foreach ( const QNetworkCacheMetaData::RawHeader &h, cmd.rawHeaders() )
+  // there is no network cache if none was set up by the application
+  QAbstractNetworkCache *cache = QgsNetworkAccessManager::instance()->cache();
+  if ( cache )
   {
-    if ( h.first != "Cache-Control" )
-      hl.append( h );
-  }
-  cmd.setRawHeaders( hl );
+    QNetworkCacheMetaData cmd = cache->metaData( reply->request().url() );
 
-  QgsDebugMsg( QString( "expirationDate:%1" ).arg( cmd.expirationDate().toString() ) );
-  if ( cmd.expirationDate().isNull() )
-  {
-    QSettings s;
-    cmd.setExpirationDate( QDateTime::currentDateTime().addSecs( s.value( "/qgis/defaultTileExpiry", "24" ).toInt() * 60 * 60 ) );
-  }
+    QNetworkCacheMetaData::RawHeaderList hl;
+    foreach ( const QNetworkCacheMetaData::RawHeader &h, cmd.rawHeaders() )
+    {
+      if ( h.first != "Cache-Control" )
+        hl.append( h );
+    }
+    cmd.setRawHeaders( hl );
+
+    QgsDebugMsg( QString( "expirationDate:%1" ).arg( cmd.expirationDate().toString() ) );
+    if ( cmd.expirationDate().isNull() )
+    {
+      QSettings s;
+      cmd.setExpirationDate( QDateTime::currentDateTime().addSecs( s.value( "/qgis/defaultTileExpiry", "24" ).toInt() * 60 * 60 ) );
+    }
 
-  QgsNetworkAccessManager::instance()->cache()->updateMetaData( cmd );
+    cache->updateMetaData( cmd );
+  }
 
-  int tileReqNo = reply->request().attribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 0 ) ).toInt();
+  // the request number of the view, a request may be taken over by a later view, see addTileRequest()
+  int tileReqNo = reply->property( "tileReqNo" ).toInt();
   int tileNo = reply->request().attribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 1 ) ).toInt();
   QRectF r = reply->request().attribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 2 ) ).toRectF();
+  QString key = reply->request().attribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 3 ) ).toString();
 
 #if QT_VERSION >= 0x40500
   QgsDebugMsg( QString( "tile reply %1 (%2) tile:%3 rect:%4,%5 %6,%7) fromcache:%8 error:%9 url:%10" )
@@ -1098,12 +1142,14 @@ void QgsWmsProvider::tileReplyFinished()
       request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 0 ), tileReqNo );
       request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 1 ), tileNo );
       request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 2 ), r );
+      request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 3 ), key );
 
       mTileReplies.removeOne( reply );
       reply->deleteLater();
 
       QgsDebugMsg( QString( "redirected gettile: %1" ).arg( redirect.toString() ) );
       reply = QgsNetworkAccessManager::instance()->get( request );
+      reply->setProperty( "tileReqNo", tileReqNo );
       mTileReplies << reply;
 
       connect( reply, SIGNAL( finished() ), this, SLOT( tileReplyFinished() ) );
@@ -1120,6 +1166,7 @@ void QgsWmsProvider::tileReplyFinished()
 
       mTileReplies.removeOne( reply );
       reply->deleteLater();
+      dispatchTileRequests();
 
       return;
     }
@@ -1154,37 +1201,28 @@ void QgsWmsProvider::tileReplyFinished()
 
       mTileReplies.removeOne( reply );
       reply->deleteLater();
+      dispatchTileRequests();
 
       return;
     }
 
-    // only take results from current request number
-    if ( mTileReqNo == tileReqNo )
-    {
-      double cr = mCachedViewExtent.width() / mCachedViewWidth;
-
-      QRectF dst(( r.left() - mCachedViewExtent.xMinimum() ) / cr,
-                 ( mCachedViewExtent.yMaximum() - r.bottom() ) / cr,
-                 r.width() / cr,
-                 r.height() / cr );
+    QgsDebugMsg( QString( "tile reply: length %1" ).arg( reply->bytesAvailable() ) );
 
-      QgsDebugMsg( QString( "tile reply: length %1" ).arg( reply->bytesAvailable() ) );
+    QImage myLocalImage = QImage::fromData( reply->readAll() );
 
-      QImage myLocalImage = QImage::fromData( reply->readAll() );
+    // late replies are not drawn but kept for the next views
+    if ( !myLocalImage.isNull() && !key.isEmpty() )
+    {
+      QMutexLocker locker( &sTileCacheMutex );
+      sTileCache.insert( key, new QImage( myLocalImage ), myLocalImage.byteCount() / 1024 + 1 );
+    }
 
+    // only take results from current request number
+    if ( mTileReqNo == tileReqNo )
+    {
       if ( !myLocalImage.isNull() )
       {
-        QPainter p( mCachedImage );
-        p.drawImage( dst, myLocalImage );
-#if 0
-        myLocalImage.save( QString( "%1/%2-tile-%3.png" ).arg( QDir::tempPath() ).arg( mTileReqNo ).arg( tileNo ) );
-        p.drawRect( dst ); // show tile bounds
-        p.drawText( dst, Qt::AlignCenter, QString( "(%1)\n%2,%3\n%4,%5\n%6x%7" )
-                    .arg( tileNo )
-                    .arg( r.left() ).arg( r.bottom() )
-                    .arg( r.right() ).arg( r.top() )
-                    .arg( r.width() ).arg( r.height() ) );
-#endif
+        drawTile( r, myLocalImage, true );
       }
       else
       {
@@ -1221,6 +1259,8 @@ void QgsWmsProvider::tileReplyFinished()
     reply->deleteLater();
   }
 
+  dispatchTileRequests();
+
 #ifdef QGISDEBUG
   emit statusChanged( tr( "%n tile requests in background", "tile request count", mTileReplies.count() )
                       + tr( ", %n cache hits", "tile cache hits", mCacheHits )
@@ -1230,6 +1270,131 @@ void QgsWmsProvider::tileReplyFinished()
 #endif
 }
 
+QString QgsWmsProvider::tileKey( const QgsWmtsTileMatrix *tm, double tres, int row, int col ) const
+{
+  QStringList dimensions;
+  for ( QHash<QString, QString>::const_iterator it = mTileDimensionValues.constBegin(); it != mTileDimensionValues.constEnd(); ++it )
+  {
+    dimensions << it.key() + "=" + it.value();
+  }
+  dimensions.sort();
+
+  return QStringList()
+         << mBaseUrl
+         << mActiveSubLayers.join( "," )
+         << mActiveSubStyles.join( "," )
+         << mImageMimeType
+         << mImageCrs
+         << QString::number( mDpi )
+         << ( mTileMatrixSet ? mTileMatrixSet->identifier : QString() )
+         << dimensions.join( "&" )
+         << tm->identifier
+         << QString::number( tres, 'g', 17 )
+         << QString( "%1,%2" ).arg( col ).arg( row )
+         ).join( "|" );
+}
+
+QImage QgsWmsProvider::cachedTile( const QString &key, const QString &url ) const
+{
+  {
+    QMutexLocker locker( &sTileCacheMutex );
+    QImage *image = sTileCache.object( key );
+    if ( image )
+    {
+      return *image;
+    }
+  }
+
+  // a tile of a previous session or evicted from memory
+  QAbstractNetworkCache *cache = QgsNetworkAccessManager::instance()->cache();
+  if ( url.isEmpty() || !cache )
+  {
+    return QImage();
+  }
+
+  QNetworkCacheMetaData cmd = cache->metaData( QUrl( url ) );
+  if ( !cmd.isValid() || ( !cmd.expirationDate().isNull() && cmd.expirationDate() < QDateTime::currentDateTime() ) )
+  {
+    return QImage();
+  }
+
+  QIODevice *data = cache->data( QUrl( url ) );
+  if ( !data )
+  {
+    return QImage();
+  }
+  QImage image = QImage::fromData( data->readAll() );
+  delete data;
+
+  if ( !image.isNull() )
+  {
+    QMutexLocker locker( &sTileCacheMutex );
+    sTileCache.insert( key, new QImage( image ), image.byteCount() / 1024 + 1 );
+  }
+  return image;
+}
+
+void QgsWmsProvider::drawTile( const QRectF &r, const QImage &image, bool replace )
+{
+  double cr = mCachedViewExtent.width() / mCachedViewWidth;
+
+  QRectF dst(( r.left() - mCachedViewExtent.xMinimum() ) / cr,
+             ( mCachedViewExtent.yMaximum() - r.bottom() ) / cr,
+             r.width() / cr,
+             r.height() / cr );
+
+  QPainter p( mCachedImage );
+  if ( replace )
+  {
+    // replace a tile of a coarser matrix drawn there before
+    p.setCompositionMode( QPainter::CompositionMode_Source );
+  }
+  p.drawImage( dst, image );
+}
+
+void QgsWmsProvider::addTileRequest( const QString &url, const QString &key, const QRectF &r, int tileNo )
+{
+  QImage image = cachedTile( key, url );
+  if ( !image.isNull() )
+  {
+    drawTile( r, image, true );
+    return;
+  }
+
+  // the tile was already requested by a previous view
+  foreach ( QNetworkReply *reply, mTileReplies )
+  {
+    if ( reply->request().attribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 3 ) ).toString() == key )
+    {
+      reply->setProperty( "tileReqNo", mTileReqNo );
+      return;
+    }
+  }
+
+  QNetworkRequest request( url );
+  setAuthorization( request );
+  request.setAttribute( QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache );
+  request.setAttribute( QNetworkRequest::CacheSaveControlAttribute, true );
+  request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 0 ), mTileReqNo );
+  request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 1 ), tileNo );
+  request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 2 ), r );
+  request.setAttribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 3 ), key );
+  mTileRequestQueue << request;
+}
+
+void QgsWmsProvider::dispatchTileRequests()
+{
+  while ( !mTileRequestQueue.isEmpty() && mTileReplies.size() < WMS_MAX_TILE_REQUESTS )
+  {
+    QNetworkRequest request = mTileRequestQueue.takeFirst();
+    QgsDebugMsg( QString( "gettile: %1" ).arg( request.url().toString() ) );
+    QNetworkReply *reply = QgsNetworkAccessManager::instance()->get( request );
+    reply->setProperty( "tileReqNo", request.attribute( static_cast<QNetworkRequest::Attribute>( QNetworkRequest::User + 0 ) ) );
+    mTileReplies << reply;
+    connect( reply, SIGNAL( finished() ), this, SLOT( tileReplyFinished() ) );
+  }
+}
+
 void QgsWmsProvider::cacheReplyFinished()
 {
   if ( mCacheReply->error() == QNetworkReply::NoError )
@@ -4206,6 +4371,7 @@ QMap<int, QVariant> QgsWmsProvider::identify( const QgsPoint & thePoint, Identif
 
           featureStore.features().append( QgsFeature( *feature ) );
         }
+        qDeleteAll( features );
         featureStoreList.append( featureStore );
       }
       results.insert( count, qVariantFromValue( featureStoreList ) );
@@ -31,11 +31,11 @@
 #include <QMap>
 #include <QVector>
 #include <QUrl>
+#include <QNetworkRequest>
 
 class QgsCoordinateTransform;
 class QNetworkAccessManager;
 class QNetworkReply;
-class QNetworkRequest;
 
 /*
  * The following structs reflect the WMS XML schema,
@@ -740,6 +740,22 @@ class QgsWmsProvider : public QgsRasterDataProvider
   private:
     void showMessageBox( const QString& title, const QString& text );
 
+    //! key of a tile in the tile cache: layers, styles, format, CRS, matrix set, dimensions, matrix and tile index
+    QString tileKey( const QgsWmtsTileMatrix *tm, double tres, int row, int col ) const;
+
+    /** Returns a decoded tile from the memory cache or (if url is given) from the network disk cache.
+     *  Returns a null image if the tile is not cached */
+    QImage cachedTile( const QString &key, const QString &url = QString() ) const;
+
+    //! draw a tile covering rectangle r (in map units) into the cached image
+    void drawTile( const QRectF &r, const QImage &image, bool replace );
+
+    //! draw the tile from the cache, take over a running request of a previous view or queue its request
+    void addTileRequest( const QString &url, const QString &key, const QRectF &r, int tileNo );
+
+    //! start queued tile requests up to the maximum of parallel requests
+    void dispatchTileRequests();
+
     // case insensitive attribute value lookup
     static QString nodeAttribute( const QDomElement &e, QString name, QString defValue = QString::null );
 
@@ -987,6 +1003,11 @@ class QgsWmsProvider : public QgsRasterDataProvider
      */
     QList<QNetworkReply*> mTileReplies;
 
+    /**
+     * Tile requests of the current view waiting for a free slot
+     */
+    QList<QNetworkRequest> mTileRequestQueue;
+
     /**
      * The reply to the capabilities request
      */
@@ -0,0 +1,108 @@
+/***************************************************************************
+     testqgscategorizedsymbolrendererv2.cpp
+     --------------------------------------
+    Date                 : November 2012
+    Copyright            : (C) 2012 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+//header for class being tested
+#include <qgscategorizedsymbolrendererv2.h>
+
+#include <qgsapplication.h>
+#include <qgsrendercontext.h>
+#include <qgssymbolv2.h>
+#include <qgsvectorlayer.h>
+
+class TestQgsCategorizedSymbolRendererV2: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+
+    void symbolForValue_data();
+    void symbolForValue();
+
+  private:
+    QgsVectorLayer* mLayer;
+};
+
+void TestQgsCategorizedSymbolRendererV2::initTestCase()
+{
+  // we need memory provider, so make sure to load providers
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  mLayer = new QgsVectorLayer( "point?field=fld:string", "x", "memory" );
+  QVERIFY( mLayer->isValid() );
+}
+
+void TestQgsCategorizedSymbolRendererV2::cleanupTestCase()
+{
+  delete mLayer;
+}
+
+void TestQgsCategorizedSymbolRendererV2::symbolForValue_data()
+{
+  QTest::addColumn<QVariant>( "value" );
+  QTest::addColumn<int>( "dense" );  // category index with dense integer categories (-1 = none)
+  QTest::addColumn<int>( "sparse" ); // category index with sparse integer categories (-1 = none)
+
+  // categories are matched using string representation of the value
+  QTest::newRow( "int" ) << QVariant( 1 ) << 0 << 0;
+  QTest::newRow( "int from string category" ) << QVariant( 2 ) << 1 << 1;
+  QTest::newRow( "int not found" ) << QVariant( 5 ) << -1 << -1;
+  QTest::newRow( "int leading zeros" ) << QVariant( 7 ) << -1 << -1;
+  QTest::newRow( "longlong" ) << QVariant( qlonglong( 2 ) ) << 1 << 1;
+  QTest::newRow( "sparse int" ) << QVariant( 1000000 ) << -1 << 5;
+  QTest::newRow( "double whole" ) << QVariant( 2.0 ) << 1 << 1;
+  QTest::newRow( "double" ) << QVariant( 3.5 ) << 3 << 3;
+  QTest::newRow( "string" ) << QVariant( "abc" ) << 2 << 2;
+  QTest::newRow( "string number" ) << QVariant( "2" ) << 1 << 1;
+  QTest::newRow( "string leading zeros" ) << QVariant( "007" ) << 4 << 4;
+}
+
+void TestQgsCategorizedSymbolRendererV2::symbolForValue()
+{
+  QFETCH( QVariant, value );
+  QFETCH( int, dense );
+  QFETCH( int, sparse );
+
+  QList<QVariant> values;
+  values << QVariant( 1 ) << QVariant( "2" ) << QVariant( "abc" ) << QVariant( 3.5 ) << QVariant( "007" );
+
+  for ( int pass = 0; pass < 2; ++pass )
+  {
+    QgsCategoryList categories;
+    foreach ( QVariant v, values )
+      categories << QgsRendererCategoryV2( v, QgsSymbolV2::defaultSymbol( QGis::Point ), v.toString() );
+    if ( pass == 1 )
+      categories << QgsRendererCategoryV2( QVariant( 1000000 ), QgsSymbolV2::defaultSymbol( QGis::Point ), "big" );
+
+    QgsCategorizedSymbolRendererV2 r( "fld", categories );
+
+    QgsFeature f;
+    f.initAttributes( 1 );
+    f.setAttribute( 0, value );
+
+    QgsRenderContext ctx; // dummy render context
+    r.startRender( ctx, mLayer );
+    QgsSymbolV2* symbol = r.symbolForFeature( f );
+    r.stopRender( ctx );
+
+    int expected = pass == 0 ? dense : sparse;
+    QgsSymbolV2* expectedSymbol = expected >= 0 ? r.categories()[expected].symbol() : 0;
+    QCOMPARE( symbol, expectedSymbol );
+  }
+}
+
+QTEST_MAIN( TestQgsCategorizedSymbolRendererV2 )
+#include "moc_testqgscategorizedsymbolrendererv2.cxx"
@@ -0,0 +1,221 @@
+/***************************************************************************
+     testqgscoordinatetransform.cpp
+     --------------------------------------
+    Date                 : October 2012
+    Copyright            : (C) 2012 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QPolygonF>
+#include <QVector>
+#include <QtConcurrentRun>
+
+//qgis includes...
+#include <qgsapplication.h>
+#include <qgscoordinatereferencesystem.h>
+#include <qgscrscache.h>
+#include <qgsgeometry.h>
+#include <qgsrasterprojector.h>
+//header for class being tested
+#include <qgscoordinatetransform.h>
+
+class TestQgsCoordinateTransform: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void transformArrays();
+    void transformInterleaved();
+    void transformPolygon();
+    void transformGeometry();
+    void cachePerThread();
+    void geometryOutsideDomain();
+    void rasterProjectorOutsideDomain();
+  private:
+    QgsCoordinateReferenceSystem orthoCrs();
+    bool compare( double a, double b ) { return qAbs( a - b ) < 0.0001; }
+    QgsCoordinateTransform* mTransform;
+    QList<QgsPoint> mPoints;
+};
+
+void TestQgsCoordinateTransform::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  QgsCoordinateReferenceSystem srcCrs;
+  srcCrs.createFromSrid( 4326 );
+  QgsCoordinateReferenceSystem destCrs;
+  destCrs.createFromSrid( 32633 );
+  mTransform = new QgsCoordinateTransform( srcCrs, destCrs );
+
+  mPoints << QgsPoint( 15.0, 45.0 ) << QgsPoint( 14.5, 46.1 ) << QgsPoint( 16.2, 47.3 ) << QgsPoint( 15.7, 44.2 );
+}
+
+void TestQgsCoordinateTransform::cleanupTestCase()
+{
+  delete mTransform;
+}
+
+void TestQgsCoordinateTransform::transformArrays()
+{
+  QVector<double> x, y;
+  foreach ( const QgsPoint& pt, mPoints )
+  {
+    x << pt.x();
+    y << pt.y();
+  }
+
+  mTransform->transformInPlace( x.data(), y.data(), 0, x.size() );
+
+  for ( int i = 0; i < mPoints.size(); ++i )
+  {
+    QgsPoint expected = mTransform->transform( mPoints[i] );
+    QVERIFY( compare( x[i], expected.x() ) );
+    QVERIFY( compare( y[i], expected.y() ) );
+  }
+}
+
+void TestQgsCoordinateTransform::transformInterleaved()
+{
+  // x, y, z triples - z must stay untouched
+  QVector<double> coords;
+  foreach ( const QgsPoint& pt, mPoints )
+  {
+    coords << pt.x() << pt.y() << 123.0;
+  }
+
+  mTransform->transformInPlace( coords.data(), coords.data() + 1, 0, mPoints.size(), 3 );
+
+  for ( int i = 0; i < mPoints.size(); ++i )
+  {
+    QgsPoint expected = mTransform->transform( mPoints[i] );
+    QVERIFY( compare( coords[3 * i], expected.x() ) );
+    QVERIFY( compare( coords[3 * i + 1], expected.y() ) );
+    QCOMPARE( coords[3 * i + 2], 123.0 );
+  }
+}
+
+void TestQgsCoordinateTransform::transformPolygon()
+{
+  QPolygonF poly;
+  foreach ( const QgsPoint& pt, mPoints )
+  {
+    poly << QPointF( pt.x(), pt.y() );
+  }
+
+  mTransform->transformPolygon( poly );
+
+  for ( int i = 0; i < mPoints.size(); ++i )
+  {
+    QgsPoint expected = mTransform->transform( mPoints[i] );
+    QVERIFY( compare( poly[i].x(), expected.x() ) );
+    QVERIFY( compare( poly[i].y(), expected.y() ) );
+  }
+}
+
+void TestQgsCoordinateTransform::transformGeometry()
+{
+  QgsPolyline line;
+  foreach ( const QgsPoint& pt, mPoints )
+  {
+    line << pt;
+  }
+
+  QgsGeometry* geom = QgsGeometry::fromPolyline( line );
+  QCOMPARE( geom->transform( *mTransform ), 0 );
+
+  QgsPolyline transformed = geom->asPolyline();
+  QCOMPARE( transformed.size(), mPoints.size() );
+  for ( int i = 0; i < mPoints.size(); ++i )
+  {
+    QgsPoint expected = mTransform->transform( mPoints[i] );
+    QVERIFY( compare( transformed[i].x(), expected.x() ) );
+    QVERIFY( compare( transformed[i].y(), expected.y() ) );
+  }
+  delete geom;
+}
+
+static const QgsCoordinateTransform* cachedTransform()
+{
+  return QgsCoordinateTransformCache::instance()->transform( "EPSG:4326", "EPSG:32633" );
+}
+
+void TestQgsCoordinateTransform::cachePerThread()
+{
+  const QgsCoordinateTransform* ct = cachedTransform();
+  QVERIFY( ct );
+  QVERIFY( ct->isInitialised() );
+  QCOMPARE( cachedTransform(), ct );
+
+  // another thread must get its own instance
+  const QgsCoordinateTransform* otherCt = QtConcurrent::run( cachedTransform ).result();
+  QVERIFY( otherCt );
+  QVERIFY( otherCt != ct );
+}
+
+QgsCoordinateReferenceSystem TestQgsCoordinateTransform::orthoCrs()
+{
+  // only the hemisphere facing lon 0 / lat 0 can be projected
+  QgsCoordinateReferenceSystem crs;
+  crs.createFromProj4( "+proj=ortho +lat_0=0 +lon_0=0 +ellps=WGS84 +units=m +no_defs" );
+  return crs;
+}
+
+void TestQgsCoordinateTransform::geometryOutsideDomain()
+{
+  QgsCoordinateReferenceSystem srcCrs;
+  srcCrs.createFromSrid( 4326 );
+  QgsCoordinateTransform ct( srcCrs, orthoCrs() );
+
+  // the line runs across the far side of the globe, a batch transform must
+  // not silently write HUGE_VAL vertices
+  QgsPolyline line;
+  for ( int lon = -150; lon <= 150; lon += 30 )
+  {
+    line << QgsPoint( lon, 0 );
+  }
+
+  QgsGeometry* geom = QgsGeometry::fromPolyline( line );
+  bool failed = false;
+  try
+  {
+    geom->transform( ct );
+  }
+  catch ( QgsCsException &e )
+  {
+    Q_UNUSED( e );
+    failed = true;
+  }
+  QVERIFY( failed );
+  delete geom;
+}
+
+void TestQgsCoordinateTransform::rasterProjectorOutsideDomain()
+{
+  QgsCoordinateReferenceSystem srcCrs;
+  srcCrs.createFromSrid( 4326 );
+
+  // the destination extent goes past the edge of the globe, points there
+  // cannot be transformed back to lat/lon and must not enter the source extent
+  QgsRectangle destExtent( -10000000, -10000000, 10000000, 10000000 );
+  QgsRasterProjector projector( srcCrs, orthoCrs(), destExtent, 200, 200, 0, 0, QgsRectangle( -180, -90, 180, 90 ) );
+
+  QgsRectangle srcExtent = projector.srcExtent();
+  QVERIFY( qIsFinite( srcExtent.xMinimum() ) && qIsFinite( srcExtent.xMaximum() ) );
+  QVERIFY( qIsFinite( srcExtent.yMinimum() ) && qIsFinite( srcExtent.yMaximum() ) );
+  QVERIFY( srcExtent.xMinimum() >= -90.001 && srcExtent.xMaximum() <= 90.001 );
+  QVERIFY( srcExtent.yMinimum() >= -90.001 && srcExtent.yMaximum() <= 90.001 );
+  QVERIFY( srcExtent.width() > 90 );
+}
+
+QTEST_MAIN( TestQgsCoordinateTransform )
+#include "moc_testqgscoordinatetransform.cxx"
@@ -16,6 +16,8 @@
 #include <QObject>
 #include <QString>
 #include <QObject>
+#include <QDomDocument>
+#include <QTextStream>
 #include <qgsapplication.h>
 //header for class being tested
 #include <qgsexpression.h>
@@ -378,6 +380,124 @@ class TestQgsExpression: public QObject
         default:
           Q_ASSERT( false ); // should never happen
       }
+
+      // prepared expression (with constant parts folded) must give the same result
+      QgsExpression exp2( string );
+      exp2.prepare( QgsFields() );
+      QVariant res2 = exp2.evaluate();
+      QCOMPARE( exp2.hasEvalError(), evalError );
+      QCOMPARE( res2.type(), res.type() );
+      QCOMPARE( res2.toString(), res.toString() );
+    }
+
+    void eval_prepared()
+    {
+      QgsFields fields;
+      fields.append( QgsField( "x", QVariant::Int ) );
+      fields.append( QgsField( "s", QVariant::String ) );
+
+      QgsFeature f;
+      f.initAttributes( 2 );
+
+      QgsExpression expIn( "x IN (1, 2 + 1, '5', 'a')" );
+      QCOMPARE( expIn.prepare( fields ), true );
+      QgsExpression expNotIn( "s NOT IN ('abc', 1, NULL)" );
+      QCOMPARE( expNotIn.prepare( fields ), true );
+      QgsExpression expLike( "s LIKE 'a' || '%'" );
+      QCOMPARE( expLike.prepare( fields ), true );
+      QgsExpression expILike( "s ILIKE 'A_C'" );
+      QCOMPARE( expILike.prepare( fields ), true );
+      QgsExpression expRegexp( "s ~ '^b+$'" );
+      QCOMPARE( expRegexp.prepare( fields ), true );
+
+      f.setAttribute( 0, 3 );
+      f.setAttribute( 1, "abc" );
+      QCOMPARE( expIn.evaluate( &f ).toInt(), 1 );
+      QCOMPARE( expNotIn.evaluate( &f ).toInt(), 0 );
+      QCOMPARE( expLike.evaluate( &f ).toInt(), 1 );
+      QCOMPARE( expILike.evaluate( &f ).toInt(), 1 );
+      QCOMPARE( expRegexp.evaluate( &f ).toInt(), 0 );
+
+      f.setAttribute( 0, 4 );
+      f.setAttribute( 1, "bbb" );
+      QCOMPARE( expIn.evaluate( &f ).toInt(), 0 );
+      QVERIFY( expNotIn.evaluate( &f ).isNull() ); // NULL in the list
+      QCOMPARE( expLike.evaluate( &f ).toInt(), 0 );
+      QCOMPARE( expILike.evaluate( &f ).toInt(), 0 );
+      QCOMPARE( expRegexp.evaluate( &f ).toInt(), 1 );
+
+      f.setAttribute( 0, 5 );
+      QCOMPARE( expIn.evaluate( &f ).toInt(), 1 );
+
+      // parts depending on the context must not be folded
+      QgsExpression expRowNum( "$rownum * ( 1 + 1 )" );
+      QCOMPARE( expRowNum.prepare( fields ), true );
+      expRowNum.setCurrentRowNumber( 10 );
+      QCOMPARE( expRowNum.evaluate( &f ).toInt(), 20 );
+      expRowNum.setCurrentRowNumber( 20 );
+      QCOMPARE( expRowNum.evaluate( &f ).toInt(), 40 );
+    }
+
+    void dump_prepared_data()
+    {
+      QTest::addColumn<QString>( "string" );
+
+      QTest::addColumn<bool>( "reparse" );
+
+      QTest::newRow( "arithmetics" ) << "x + (1 + 2) * 3" << true;
+      QTest::newRow( "date" ) << "todate('2012-06-28') = x" << true;
+      QTest::newRow( "geometry" ) << "geomToWKT(geomFromWKT('POINT(1 2)')) = s" << true;
+      QTest::newRow( "boolean" ) << "1 = 1 and x > 0" << true;
+      QTest::newRow( "in" ) << "x IN (1, 2 + 1, 'a' || 'b')" << true;
+      QTest::newRow( "like" ) << "s LIKE 'a' || '%'" << true;
+      // the dump of conditions is not an expression
+      QTest::newRow( "condition" ) << "case when 1 < 2 then x else 0 end" << false;
+    }
+
+    void dump_prepared()
+    {
+      QFETCH( QString, string );
+      QFETCH( bool, reparse );
+
+      QgsFields fields;
+      fields.append( QgsField( "x", QVariant::Int ) );
+      fields.append( QgsField( "s", QVariant::String ) );
+
+      QgsFeature f;
+      f.initAttributes( 2 );
+      f.setAttribute( 0, 3 );
+      f.setAttribute( 1, "ab" );
+
+      QgsExpression exp( string );
+      QVERIFY( !exp.hasParserError() );
+      QString dump = exp.dump();
+
+      QDomDocument doc;
+      QDomElement filter = doc.createElement( "Filter" );
+      exp.toOgcFilter( doc, filter );
+      QString ogc;
+      QTextStream( &ogc ) << filter;
+
+      // folding of the constant parts must not change the expression as written
+      QVERIFY( exp.prepare( fields ) );
+      QCOMPARE( exp.dump(), dump );
+
+      QDomElement filter2 = doc.createElement( "Filter" );
+      exp.toOgcFilter( doc, filter2 );
+      QString ogc2;
+      QTextStream( &ogc2 ) << filter2;
+      QCOMPARE( ogc2, ogc );
+
+      if ( !reparse )
+        return;
+
+      // and the dump can be parsed again to the same expression
+      QgsExpression exp2( dump );
+      QVERIFY( !exp2.hasParserError() );
+      QCOMPARE( exp2.dump(), dump );
+      QVERIFY( exp2.prepare( fields ) );
+      QCOMPARE( exp2.evaluate( &f ), exp.evaluate( &f ) );
+      QVERIFY( !exp.hasEvalError() );
     }
 
     void eval_columns()
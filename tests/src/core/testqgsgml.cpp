@@ -0,0 +1,155 @@
+/***************************************************************************
+     testqgsgml.cpp
+     --------------------------------------
+    Date                 : May 2013
+    Copyright            : (C) 2013 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QSignalSpy>
+#include <QString>
+
+//qgis includes...
+#include <qgsapplication.h>
+#include <qgsfield.h>
+#include <qgsgeometry.h>
+//header for class being tested
+#include <qgsgml.h>
+
+static const char GML_DATA[] =
+  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+  "<wfs:FeatureCollection xmlns:wfs=\"http://www.opengis.net/wfs\" xmlns:gml=\"http://www.opengis.net/gml\" xmlns:qgs=\"http://qgis.org/gml\">"
+  "<gml:boundedBy><gml:Box srsName=\"EPSG:4326\"><gml:coordinates cs=\",\" ts=\" \">1,2 5,6</gml:coordinates></gml:Box></gml:boundedBy>"
+  "<gml:featureMember><qgs:points fid=\"points.1\">"
+  "<qgs:geometry><gml:Point><gml:coordinates cs=\",\" ts=\" \">1,2</gml:coordinates></gml:Point></qgs:geometry>"
+  "<qgs:name>first</qgs:name><qgs:value>10</qgs:value>"
+  "</qgs:points></gml:featureMember>"
+  "<gml:featureMember><qgs:points fid=\"points.2\">"
+  "<qgs:geometry><gml:Point><gml:coordinates cs=\",\" ts=\" \">3,4</gml:coordinates></gml:Point></qgs:geometry>"
+  "<qgs:name>second</qgs:name><qgs:value>20</qgs:value>"
+  "</qgs:points></gml:featureMember>"
+  "<gml:featureMember><qgs:points fid=\"points.3\">"
+  "<qgs:geometry><gml:Point><gml:coordinates cs=\",\" ts=\" \">5,6</gml:coordinates></gml:Point></qgs:geometry>"
+  "<qgs:name>third</qgs:name><qgs:value>30</qgs:value>"
+  "</qgs:points></gml:featureMember>"
+  "</wfs:FeatureCollection>";
+
+class TestQgsGml: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+
+    void processData_data();
+    void processData();
+    void getFeatures();
+
+  private:
+    QgsFields mFields;
+};
+
+void TestQgsGml::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  mFields.append( QgsField( "name", QVariant::String ) );
+  mFields.append( QgsField( "value", QVariant::Int ) );
+}
+
+void TestQgsGml::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void TestQgsGml::processData_data()
+{
+  QTest::addColumn<int>( "chunkSize" );
+
+  QTest::newRow( "byte by byte" ) << 1;
+  QTest::newRow( "7 bytes" ) << 7;
+  QTest::newRow( "100 bytes" ) << 100;
+  QTest::newRow( "whole document" ) << ( int ) sizeof( GML_DATA );
+}
+
+void TestQgsGml::processData()
+{
+  QFETCH( int, chunkSize );
+
+  QgsGml gml( "points", "geometry", mFields );
+  QSignalSpy spy( &gml, SIGNAL( featuresParsed() ) );
+
+  QByteArray data( GML_DATA );
+  QGis::WkbType wkbType = QGis::WKBUnknown;
+  QgsRectangle extent;
+  QMap<QgsFeatureId, QgsFeature*> features;
+  QMap<QgsFeatureId, QString> ids;
+  int featuresBeforeEnd = 0;
+
+  for ( int pos = 0; pos < data.size(); pos += chunkSize )
+  {
+    bool atEnd = pos + chunkSize >= data.size();
+    QCOMPARE( gml.processData( data.mid( pos, chunkSize ), atEnd, &wkbType, &extent ), 0 );
+
+    // features are handed over while the data is read
+    QMap<QgsFeatureId, QgsFeature*> taken = gml.takeFeatures();
+    QVERIFY( gml.featuresMap().isEmpty() );
+    features.unite( taken );
+    if ( !atEnd )
+      featuresBeforeEnd = features.size();
+  }
+  ids = gml.idsMap();
+
+  QCOMPARE( features.size(), 3 );
+  QCOMPARE( wkbType, QGis::WKBPoint );
+  QCOMPARE( extent, QgsRectangle( 1, 2, 5, 6 ) );
+  QCOMPARE( gml.epsg(), 4326 );
+  if ( chunkSize < ( int ) sizeof( GML_DATA ) / 2 )
+  {
+    QVERIFY( featuresBeforeEnd > 0 );
+    QVERIFY( spy.count() > 1 );
+  }
+  else
+  {
+    QVERIFY( spy.count() >= 1 );
+  }
+
+  QStringList names;
+  QList<int> values;
+  foreach ( QgsFeature* f, features )
+  {
+    names << f->attributes()[0].toString();
+    values << f->attributes()[1].toInt();
+    QVERIFY( f->geometry() );
+    QCOMPARE( f->geometry()->asPoint(), QgsPoint( 1 + 2 * f->id(), 2 + 2 * f->id() ) );
+    QCOMPARE( ids.value( f->id() ), QString( "points.%1" ).arg( f->id() + 1 ) );
+  }
+  QCOMPARE( names, QStringList() << "first" << "second" << "third" );
+  QCOMPARE( values, QList<int>() << 10 << 20 << 30 );
+
+  qDeleteAll( features );
+}
+
+void TestQgsGml::getFeatures()
+{
+  QgsGml gml( "points", "geometry", mFields );
+  QGis::WkbType wkbType = QGis::WKBUnknown;
+  QgsRectangle extent;
+  QCOMPARE( gml.getFeatures( QByteArray( GML_DATA ), &wkbType, &extent ), 0 );
+
+  QMap<QgsFeatureId, QgsFeature*> features = gml.featuresMap();
+  QCOMPARE( features.size(), 3 );
+  QCOMPARE( extent, QgsRectangle( 1, 2, 5, 6 ) );
+  qDeleteAll( features );
+}
+
+QTEST_MAIN( TestQgsGml )
+#include "moc_testqgsgml.cxx"
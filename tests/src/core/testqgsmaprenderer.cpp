@@ -18,7 +18,11 @@
 #include <QStringList>
 #include <QObject>
 #include <QPainter>
+#include <QSemaphore>
+#include <QSettings>
+#include <QThread>
 #include <QTime>
+#include <algorithm>
 #include <iostream>
 
 #include <QApplication>
@@ -40,10 +44,53 @@
 #include <qgsapplication.h>
 #include <qgsproviderregistry.h>
 #include <qgsmaplayerregistry.h>
+#include <qgsvectordataprovider.h>
+#include <qgsrasterlayer.h>
+#include <qgsrasterrenderer.h>
+#include <qgssinglesymbolrendererv2.h>
+#include <qgssymbolv2.h>
 
 //qgs unit test utility class
 #include "qgsrenderchecker.h"
 
+/** \ingroup UnitTests
+ * Renderer recording the thread its layer is drawn on. Layers drawn on the main
+ * thread wait until the given number of layers started drawing on other threads.
+ */
+class TestThreadRenderer : public QgsSingleSymbolRendererV2
+{
+  public:
+    TestThreadRenderer( QgsSymbolV2* symbol, QSemaphore* workersStarted, int workers )
+        : QgsSingleSymbolRendererV2( symbol )
+        , thread( 0 )
+        , workersStartedMeanwhile( false )
+        , mWorkersStarted( workersStarted )
+        , mWorkers( workers )
+    {}
+
+    virtual void startRender( QgsRenderContext& context, const QgsVectorLayer *vlayer )
+    {
+      thread = QThread::currentThread();
+      if ( thread == qApp->thread() )
+      {
+        // only possible if the workers draw while this layer is drawn
+        workersStartedMeanwhile = mWorkersStarted->tryAcquire( mWorkers, 10000 );
+      }
+      else
+      {
+        mWorkersStarted->release();
+      }
+      QgsSingleSymbolRendererV2::startRender( context, vlayer );
+    }
+
+    QThread* thread;
+    bool workersStartedMeanwhile;
+
+  private:
+    QSemaphore* mWorkersStarted;
+    int mWorkers;
+};
+
 /** \ingroup UnitTests
  * This is a unit test for the QgsMapRenderer class.
  * It will do some performance testing too
@@ -60,8 +107,21 @@ class TestQgsMapRenderer: public QObject
 
     /** This method tests render perfomance */
     void performanceTest();
+    /** Renders with parallel rendering enabled, the result must match the sequential render */
+    void parallelRenderTest();
+    /** Renders several layers, some of them drawn on the main thread, the parallel
+     * render must be identical to the sequential one (layers composited in order) */
+    void parallelRenderLayerOrderTest();
+    /** Renders layers of thread safe providers on the thread pool while a layer of
+     *  a provider which is not thread safe is drawn on the main thread */
+    void parallelRenderThreadsTest();
+    /** Renders a raster layer read in parallel, the result must match the sequential
+     *  render, also after a change of the renderer between draws */
+    void parallelRasterRenderTest();
 
   private:
+    QImage renderImage( const QStringList& layers, const QgsRectangle& extent, bool parallel );
+
     QString mEncoding;
     QgsVectorFileWriter::WriterError mError;
     QgsCoordinateReferenceSystem mCRS;
@@ -194,6 +254,175 @@ void TestQgsMapRenderer::performanceTest()
   QVERIFY( myResultFlag );
 }
 
+void TestQgsMapRenderer::parallelRenderTest()
+{
+  QSettings mySettings;
+  bool myParallel = mySettings.value( "/qgis/parallel_rendering", false ).toBool();
+  mySettings.setValue( "/qgis/parallel_rendering", true );
+
+  QgsMapRenderer myRenderer;
+  myRenderer.setLayerSet( QStringList( mpPolysLayer->id() ) );
+  myRenderer.setExtent( mpPolysLayer->extent() );
+  QgsRenderChecker myChecker;
+  myChecker.setControlName( "expected_maprender" );
+  myChecker.setMapRenderer( &myRenderer );
+  bool myResultFlag = myChecker.runTest( "maprender_parallel" );
+  mReport += myChecker.report();
+
+  mySettings.setValue( "/qgis/parallel_rendering", myParallel );
+  QVERIFY( myResultFlag );
+}
+
+QImage TestQgsMapRenderer::renderImage( const QStringList& layers, const QgsRectangle& extent, bool parallel )
+{
+  QSettings mySettings;
+  bool myParallel = mySettings.value( "/qgis/parallel_rendering", false ).toBool();
+  mySettings.setValue( "/qgis/parallel_rendering", parallel );
+
+  QImage myImage( 400, 300, QImage::Format_ARGB32_Premultiplied );
+  myImage.fill( qRgb( 255, 255, 255 ) );
+  QgsMapRenderer myRenderer;
+  myRenderer.setLayerSet( layers );
+  myRenderer.setOutputSize( myImage.size(), myImage.logicalDpiX() );
+  myRenderer.setExtent( extent );
+  QPainter myPainter( &myImage );
+  myRenderer.render( &myPainter );
+  myPainter.end();
+
+  mySettings.setValue( "/qgis/parallel_rendering", myParallel );
+  return myImage;
+}
+
+void TestQgsMapRenderer::parallelRenderLayerOrderTest()
+{
+  QString myTestDataDir = QString( TEST_DATA_DIR ) + QDir::separator();
+  QList<QgsMapLayer *> myLayers;
+  QStringList myLayerIds;
+  // top to bottom, lines and points overlap the polygons
+  foreach ( QString myName, QStringList() << "points" << "lines" << "polys" )
+  {
+    QgsVectorLayer* myLayer = new QgsVectorLayer( myTestDataDir + myName + ".shp", myName, "ogr" );
+    QVERIFY( myLayer->isValid() );
+    myLayers << myLayer;
+    myLayerIds << myLayer->id();
+  }
+
+  // memory provider is not thread safe, drawn on the main thread in the middle of the stack
+  QgsVectorLayer* myMemoryLayer = new QgsVectorLayer( "Polygon?crs=epsg:4326", "memory", "memory" );
+  QVERIFY( myMemoryLayer->isValid() );
+  QVERIFY( !( myMemoryLayer->dataProvider()->capabilities() & QgsVectorDataProvider::ThreadSafe ) );
+  QgsFeature myFeature;
+  myFeature.setGeometry( QgsGeometry::fromRect( myLayers.last()->extent() ) );
+  QgsFeatureList myFeatures;
+  myFeatures << myFeature;
+  QVERIFY( myMemoryLayer->dataProvider()->addFeatures( myFeatures ) );
+  myMemoryLayer->updateExtents();
+  myLayers << myMemoryLayer;
+  myLayerIds.insert( 2, myMemoryLayer->id() );
+
+  QgsMapLayerRegistry::instance()->addMapLayers( myLayers );
+
+  QgsRectangle myExtent = myLayers.first()->extent();
+  QgsRectangle myPolysExtent = myLayers.at( 2 )->extent();
+  myExtent.combineExtentWith( &myPolysExtent );
+  QImage mySequential = renderImage( myLayerIds, myExtent, false );
+  QImage myParallel = renderImage( myLayerIds, myExtent, true );
+
+  // reversed order must give a different image, otherwise the test proves nothing
+  QStringList myReversedIds = myLayerIds;
+  std::reverse( myReversedIds.begin(), myReversedIds.end() );
+  QImage myReversed = renderImage( myReversedIds, myExtent, true );
+
+  QgsMapLayerRegistry::instance()->removeMapLayers( myLayerIds );
+
+  QVERIFY( mySequential == myParallel );
+  QVERIFY( mySequential != myReversed );
+}
+
+void TestQgsMapRenderer::parallelRenderThreadsTest()
+{
+  QString myTestDataDir = QString( TEST_DATA_DIR ) + QDir::separator();
+  QSemaphore myWorkersStarted;
+  QList<QgsVectorLayer *> myLayers;
+  QList<TestThreadRenderer *> myRenderers;
+  QStringList myLayerIds;
+  foreach ( QString myName, QStringList() << "points" << "lines" << "polys" )
+  {
+    QgsVectorLayer* myLayer = new QgsVectorLayer( myTestDataDir + myName + ".shp", myName, "ogr" );
+    QVERIFY( myLayer->isValid() );
+    QVERIFY( myLayer->dataProvider()->capabilities() & QgsVectorDataProvider::ThreadSafe );
+    myLayers << myLayer;
+  }
+  QgsVectorLayer* myMemoryLayer = new QgsVectorLayer( "Polygon?crs=epsg:4326", "memory", "memory" );
+  QVERIFY( myMemoryLayer->isValid() );
+  QgsFeature myFeature;
+  myFeature.setGeometry( QgsGeometry::fromRect( myLayers.last()->extent() ) );
+  QgsFeatureList myFeatures;
+  myFeatures << myFeature;
+  QVERIFY( myMemoryLayer->dataProvider()->addFeatures( myFeatures ) );
+  myMemoryLayer->updateExtents();
+  myLayers << myMemoryLayer;
+
+  foreach ( QgsVectorLayer* myLayer, myLayers )
+  {
+    TestThreadRenderer* myRenderer = new TestThreadRenderer( QgsSymbolV2::defaultSymbol( myLayer->geometryType() ), &myWorkersStarted, 3 );
+    myLayer->setRendererV2( myRenderer );
+    myRenderers << myRenderer;
+    myLayerIds << myLayer->id();
+  }
+  QgsMapLayerRegistry::instance()->addMapLayers( QList<QgsMapLayer *>() << myLayers[0] << myLayers[1] << myLayers[2] << myMemoryLayer );
+
+  QgsRectangle myExtent = myLayers.first()->extent();
+  QgsRectangle myPolysExtent = myLayers.at( 2 )->extent();
+  myExtent.combineExtentWith( &myPolysExtent );
+  renderImage( myLayerIds, myExtent, true );
+
+  QThread* myMainThread = qApp->thread();
+  QList<QThread *> myThreads;
+  QList<bool> myStartedMeanwhile;
+  foreach ( TestThreadRenderer* myRenderer, myRenderers )
+  {
+    myThreads << myRenderer->thread;
+    myStartedMeanwhile << myRenderer->workersStartedMeanwhile;
+  }
+
+  QgsMapLayerRegistry::instance()->removeMapLayers( myLayerIds );
+
+  // the ogr layers were drawn by the workers while the memory layer was drawn here
+  for ( int i = 0; i < 3; i++ )
+  {
+    QVERIFY( myThreads[i] );
+    QVERIFY( myThreads[i] != myMainThread );
+  }
+  QVERIFY( myThreads[3] == myMainThread );
+  QVERIFY( myStartedMeanwhile[3] );
+}
+
+void TestQgsMapRenderer::parallelRasterRenderTest()
+{
+  QString myTestDataDir = QString( TEST_DATA_DIR ) + QDir::separator();
+  QgsRasterLayer* myLayer = new QgsRasterLayer( myTestDataDir + "landsat.tif", "landsat" );
+  QVERIFY( myLayer->isValid() );
+  QgsMapLayerRegistry::instance()->addMapLayers( QList<QgsMapLayer *>() << myLayer );
+  QStringList myLayerIds( myLayer->id() );
+
+  QgsRectangle myExtent = myLayer->extent();
+  QImage mySequential = renderImage( myLayerIds, myExtent, false );
+  QImage myParallel = renderImage( myLayerIds, myExtent, true );
+
+  // the clones of the pipe kept from the previous draw must follow the change
+  QVERIFY( myLayer->renderer() );
+  myLayer->renderer()->setOpacity( 0.5 );
+  QImage mySequentialChanged = renderImage( myLayerIds, myExtent, false );
+  QImage myParallelChanged = renderImage( myLayerIds, myExtent, true );
+
+  QgsMapLayerRegistry::instance()->removeMapLayers( myLayerIds );
+
+  QVERIFY( mySequential == myParallel );
+  QVERIFY( mySequentialChanged == myParallelChanged );
+  QVERIFY( mySequential != mySequentialChanged );
+}
+
 QTEST_MAIN( TestQgsMapRenderer )
 #include "moc_testqgsmaprenderer.cxx"
 
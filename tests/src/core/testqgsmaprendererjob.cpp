@@ -0,0 +1,228 @@
+/***************************************************************************
+     testqgsmaprendererjob.cpp
+     --------------------------------------
+    Date                 : May 2013
+    Copyright            : (C) 2013 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QImage>
+#include <QPainter>
+
+//qgis includes...
+#include <qgsapplication.h>
+#include <qgsmaplayerregistry.h>
+#include <qgsmaprenderer.h>
+#include <qgsvectorlayer.h>
+//header for class being tested
+#include <qgsmaprendererjob.h>
+
+/** \ingroup UnitTests
+ * This is a unit test for background rendering with QgsMapRendererJob
+ */
+class TestQgsMapRendererJob: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void init();// will be called before each testfunction is executed.
+    void cleanup();// will be called after every testfunction.
+
+    /** The job renders the same image as the renderer */
+    void renderTest();
+    /** Layers removed from the registry while the job runs do not affect the job */
+    void removeLayerTest();
+    /** Stopping a job does not wait for the thread */
+    void stopTest();
+    /** Memory and edited layers are not rendered in background */
+    void canRenderInBackgroundTest();
+    /** Selected features are highlighted, also after the selection changed */
+    void selectionTest();
+    /** Clones of the layers are reused by the next job until the layer changes */
+    void cloneCacheTest();
+
+  private:
+    QgsVectorLayer* addLayer( const QString& fileName );
+    QImage renderImage();
+    QImage renderJobImage();
+
+    QgsMapRenderer* mpMapRenderer;
+    QString mTestDataDir;
+};
+
+void TestQgsMapRendererJob::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+  mTestDataDir = QString( TEST_DATA_DIR ) + QDir::separator(); //defined in CmakeLists.txt
+}
+
+void TestQgsMapRendererJob::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void TestQgsMapRendererJob::init()
+{
+  QStringList layers;
+  layers << addLayer( "polys.shp" )->id() << addLayer( "lines.shp" )->id() << addLayer( "points.shp" )->id();
+
+  mpMapRenderer = new QgsMapRenderer();
+  mpMapRenderer->setOutputSize( QSize( 400, 300 ), 96 );
+  mpMapRenderer->setLayerSet( layers );
+  mpMapRenderer->setExtent( mpMapRenderer->fullExtent() );
+}
+
+void TestQgsMapRendererJob::cleanup()
+{
+  delete mpMapRenderer;
+  QgsMapLayerRegistry::instance()->removeAllMapLayers();
+}
+
+QgsVectorLayer* TestQgsMapRendererJob::addLayer( const QString& fileName )
+{
+  QFileInfo myFileInfo( mTestDataDir + fileName );
+  QgsVectorLayer* layer = new QgsVectorLayer( myFileInfo.filePath(), myFileInfo.completeBaseName(), "ogr" );
+  Q_ASSERT( layer->isValid() );
+  QgsMapLayerRegistry::instance()->addMapLayers( QList<QgsMapLayer *>() << layer );
+  return layer;
+}
+
+QImage TestQgsMapRendererJob::renderImage()
+{
+  QImage image( mpMapRenderer->outputSize(), QImage::Format_ARGB32_Premultiplied );
+  image.fill( QColor( Qt::white ).rgba() );
+  QPainter painter( &image );
+  mpMapRenderer->render( &painter );
+  painter.end();
+  return image;
+}
+
+QImage TestQgsMapRendererJob::renderJobImage()
+{
+  QgsMapRendererJob job( mpMapRenderer, Qt::white, false );
+  job.start();
+  if ( !job.wait( 60000 ) )
+    return QImage();
+  return job.renderedImage();
+}
+
+void TestQgsMapRendererJob::renderTest()
+{
+  QImage expected = renderImage();
+
+  QgsMapRendererJob job( mpMapRenderer, Qt::white, false );
+  job.start();
+  QVERIFY( job.wait( 60000 ) );
+  QVERIFY( !job.isCancelled() );
+  QCOMPARE( job.renderedImage(), expected );
+}
+
+void TestQgsMapRendererJob::removeLayerTest()
+{
+  QImage expected = renderImage();
+
+  QgsMapRendererJob job( mpMapRenderer, Qt::white, false );
+  job.start();
+  // the layers and the labeling engine of the renderer are deleted while the job runs
+  QgsMapLayerRegistry::instance()->removeAllMapLayers();
+  delete mpMapRenderer;
+  mpMapRenderer = 0;
+
+  QVERIFY( job.wait( 60000 ) );
+  QCOMPARE( job.renderedImage(), expected );
+}
+
+void TestQgsMapRendererJob::stopTest()
+{
+  QgsMapRendererJob* job = new QgsMapRendererJob( mpMapRenderer, Qt::white, false );
+  QImage background = job->renderedImage();
+  QCOMPARE( background.size(), mpMapRenderer->outputSize() );
+
+  job->start();
+  job->stop();
+  QVERIFY( job->isCancelled() );
+  // the partial image can still be fetched
+  QCOMPARE( job->renderedImage().size(), background.size() );
+
+  QVERIFY( job->wait( 60000 ) );
+  delete job;
+}
+
+void TestQgsMapRendererJob::canRenderInBackgroundTest()
+{
+  QVERIFY( QgsMapRendererJob::canRenderInBackground( mpMapRenderer ) );
+
+  QgsVectorLayer* memoryLayer = new QgsVectorLayer( "Point", "memory", "memory" );
+  QgsMapLayerRegistry::instance()->addMapLayers( QList<QgsMapLayer *>() << memoryLayer );
+  QStringList layers = mpMapRenderer->layerSet();
+  mpMapRenderer->setLayerSet( layers + QStringList( memoryLayer->id() ) );
+  QVERIFY( !QgsMapRendererJob::canRenderInBackground( mpMapRenderer ) );
+
+  QgsVectorLayer* layer = qobject_cast<QgsVectorLayer*>( QgsMapLayerRegistry::instance()->mapLayer( layers.first() ) );
+  mpMapRenderer->setLayerSet( layers );
+  QVERIFY( layer->startEditing() );
+  QVERIFY( !QgsMapRendererJob::canRenderInBackground( mpMapRenderer ) );
+  layer->rollBack();
+  QVERIFY( QgsMapRendererJob::canRenderInBackground( mpMapRenderer ) );
+}
+
+void TestQgsMapRendererJob::selectionTest()
+{
+  QImage unselected = renderJobImage();
+
+  QgsVectorLayer* layer = qobject_cast<QgsVectorLayer*>( QgsMapLayerRegistry::instance()->mapLayer( mpMapRenderer->layerSet().first() ) );
+  QVERIFY( layer );
+  layer->invertSelection();
+  QVERIFY( layer->selectedFeatureCount() > 0 );
+
+  QImage expected = renderImage();
+  QVERIFY( expected != unselected );
+  QCOMPARE( renderJobImage(), expected );
+
+  layer->removeSelection();
+  QCOMPARE( renderJobImage(), unselected );
+}
+
+void TestQgsMapRendererJob::cloneCacheTest()
+{
+  QgsVectorLayer* layer = qobject_cast<QgsVectorLayer*>( QgsMapLayerRegistry::instance()->mapLayer( mpMapRenderer->layerSet().first() ) );
+  QVERIFY( layer );
+  QgsMapLayerCloneCache* cache = QgsMapLayerCloneCache::instance();
+
+  QgsMapLayer* clone = cache->acquire( layer );
+  QVERIFY( clone );
+  QVERIFY( clone != layer );
+  QCOMPARE( clone->id(), layer->id() );
+
+  // a clone in use is not handed out again
+  QgsMapLayer* clone2 = cache->acquire( layer );
+  QVERIFY( clone2 );
+  QVERIFY( clone2 != clone );
+  cache->release( clone2 );
+
+  // released clones are reused
+  cache->release( clone );
+  QgsMapLayer* reused = cache->acquire( layer );
+  QVERIFY( reused == clone || reused == clone2 );
+
+  // a changed layer gets a new clone, the old one is deleted on release
+  QSignalSpy destroyedSpy( reused, SIGNAL( destroyed() ) );
+  layer->triggerRepaint();
+  QCOMPARE( destroyedSpy.count(), 0 );
+  cache->release( reused );
+  QCOMPARE( destroyedSpy.count(), 1 );
+}
+
+QTEST_MAIN( TestQgsMapRendererJob )
+#include "moc_testqgsmaprendererjob.cxx"
@@ -0,0 +1,132 @@
+/***************************************************************************
+     testqgsrasterblockcache.cpp
+     --------------------------------------
+    Date                 : May 2013
+    Copyright            : (C) 2013 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+
+//header for class being tested
+#include <qgsrasterblockcache.h>
+
+class TestQgsRasterBlockCache: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void init();// will be called before each testfunction is executed.
+
+    void block();
+    void leastRecentlyUsed();
+    void remove();
+
+  private:
+    //! block of 1 kB filled with value
+    QByteArray createBlock( char value );
+    //! whether block at xBlock of source is in the cache
+    bool contains( const QString &source, int xBlock );
+
+    int mMaxSize;
+};
+
+void TestQgsRasterBlockCache::initTestCase()
+{
+  mMaxSize = QgsRasterBlockCache::instance()->maxSize();
+}
+
+void TestQgsRasterBlockCache::cleanupTestCase()
+{
+  QgsRasterBlockCache::instance()->setMaxSize( mMaxSize );
+}
+
+void TestQgsRasterBlockCache::init()
+{
+  // empty the cache
+  QgsRasterBlockCache::instance()->setMaxSize( 0 );
+  QgsRasterBlockCache::instance()->setMaxSize( 3 );
+}
+
+QByteArray TestQgsRasterBlockCache::createBlock( char value )
+{
+  return QByteArray( 1024, value );
+}
+
+bool TestQgsRasterBlockCache::contains( const QString &source, int xBlock )
+{
+  QByteArray data;
+  return QgsRasterBlockCache::instance()->block( source, 1, 1, 0, xBlock, 0, data );
+}
+
+void TestQgsRasterBlockCache::block()
+{
+  QgsRasterBlockCache *cache = QgsRasterBlockCache::instance();
+  cache->insert( "block.tif", 1, 1, 0, 2, 3, createBlock( 'a' ) );
+
+  QByteArray data;
+  QVERIFY( cache->block( "block.tif", 1, 1, 0, 2, 3, data ) );
+  QCOMPARE( data, createBlock( 'a' ) );
+
+  // other band, data type, level, position or source
+  QVERIFY( !cache->block( "block.tif", 2, 1, 0, 2, 3, data ) );
+  QVERIFY( !cache->block( "block.tif", 1, 2, 0, 2, 3, data ) );
+  QVERIFY( !cache->block( "block.tif", 1, 1, 1, 2, 3, data ) );
+  QVERIFY( !cache->block( "block.tif", 1, 1, 0, 3, 2, data ) );
+  QVERIFY( !cache->block( "other.tif", 1, 1, 0, 2, 3, data ) );
+}
+
+void TestQgsRasterBlockCache::leastRecentlyUsed()
+{
+  QgsRasterBlockCache *cache = QgsRasterBlockCache::instance();
+  cache->insert( "lru.tif", 1, 1, 0, 0, 0, createBlock( 'a' ) );
+  cache->insert( "lru.tif", 1, 1, 0, 1, 0, createBlock( 'b' ) );
+  cache->insert( "lru.tif", 1, 1, 0, 2, 0, createBlock( 'c' ) );
+
+  // block 0 is used again, block 1 is now the least recently used one
+  QVERIFY( contains( "lru.tif", 0 ) );
+  cache->insert( "lru.tif", 1, 1, 0, 3, 0, createBlock( 'd' ) );
+
+  QVERIFY( contains( "lru.tif", 0 ) );
+  QVERIFY( !contains( "lru.tif", 1 ) );
+  QVERIFY( contains( "lru.tif", 2 ) );
+  QVERIFY( contains( "lru.tif", 3 ) );
+
+  // blocks larger than the cache are not kept
+  cache->insert( "lru.tif", 1, 1, 0, 4, 0, QByteArray( 4096, 'e' ) );
+  QVERIFY( !contains( "lru.tif", 4 ) );
+  QVERIFY( contains( "lru.tif", 3 ) );
+}
+
+void TestQgsRasterBlockCache::remove()
+{
+  // the separator of the key in the source
+  QgsRasterBlockCache *cache = QgsRasterBlockCache::instance();
+  cache->insert( "C:/data/a.tif:1368000000", 1, 1, 0, 0, 0, createBlock( 'a' ) );
+  cache->insert( "C:/data/a.tif:1368000000", 1, 1, 0, 1, 0, createBlock( 'b' ) );
+  cache->insert( "C:/data/b.tif:1368000000", 1, 1, 0, 0, 0, createBlock( 'c' ) );
+
+  cache->remove( "C:/data/a.tif:1368000000" );
+  QVERIFY( !contains( "C:/data/a.tif:1368000000", 0 ) );
+  QVERIFY( !contains( "C:/data/a.tif:1368000000", 1 ) );
+  QVERIFY( contains( "C:/data/b.tif:1368000000", 0 ) );
+
+  // only whole sources are removed, not those starting or ending the same
+  cache->insert( "C:/data/a.tif", 1, 1, 0, 0, 0, createBlock( 'a' ) );
+  cache->remove( "data/b.tif:1368000000" );
+  cache->remove( "C:/data/b.tif" );
+  QVERIFY( contains( "C:/data/b.tif:1368000000", 0 ) );
+  QVERIFY( contains( "C:/data/a.tif", 0 ) );
+}
+
+QTEST_MAIN( TestQgsRasterBlockCache )
+#include "moc_testqgsrasterblockcache.cxx"
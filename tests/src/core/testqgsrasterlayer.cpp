@@ -30,6 +30,7 @@
 #include <qgsrasterlayer.h>
 #include <qgsrasterpyramid.h>
 #include <qgsrasterbandstats.h>
+#include <qgsrasterblockcache.h>
 #include <qgsrasterpyramid.h>
 #include <qgsmaplayerregistry.h>
 #include <qgsapplication.h>
@@ -67,6 +68,7 @@ class TestQgsRasterLayer: public QObject
     void checkDimensions();
     void checkStats();
     void buildExternalOverviews();
+    void blockCache();
     void registry();
     void transparency();
   private:
@@ -387,6 +389,87 @@ void TestQgsRasterLayer::buildExternalOverviews()
 }
 
 
+void TestQgsRasterLayer::blockCache()
+{
+  // reads through the block cache select the overview and sample the cells
+  // themselves, they must give the same blocks as reads by GDAL
+  QString myTempPath = QDir::tempPath() + QDir::separator();
+  QFile::remove( myTempPath + "landsat_blockcache.tif.ovr" );
+  QFile::remove( myTempPath + "landsat_blockcache.tif" );
+  QVERIFY( QFile::copy( mTestDataDir + "landsat.tif", myTempPath + "landsat_blockcache.tif" ) );
+  QFileInfo myRasterFileInfo( myTempPath + "landsat_blockcache.tif" );
+  QgsRasterLayer * mypLayer = new QgsRasterLayer( myRasterFileInfo.filePath(),
+      myRasterFileInfo.completeBaseName() );
+  QVERIFY( mypLayer->isValid() );
+
+  QgsRasterDataProvider *myProvider = mypLayer->dataProvider();
+  QList< QgsRasterPyramid > myPyramidList = myProvider->buildPyramidList();
+  QVERIFY( myPyramidList.count() > 1 );
+  for ( int myCounterInt = 0; myCounterInt < myPyramidList.count(); myCounterInt++ )
+  {
+    myPyramidList[myCounterInt].build = true;
+  }
+  myProvider->buildPyramids( myPyramidList, "NEAREST", QgsRasterDataProvider::PyramidsGTiff );
+  myPyramidList = myProvider->buildPyramidList();
+  for ( int myCounterInt = 0; myCounterInt < myPyramidList.count(); myCounterInt++ )
+  {
+    QVERIFY( myPyramidList.at( myCounterInt ).exists );
+  }
+
+  int myXSize = myProvider->xSize();
+  int myYSize = myProvider->ySize();
+  QgsRectangle myExtent = myProvider->extent();
+  QgsRectangle mySubExtent( myExtent.xMinimum() + myExtent.width() * 0.23, myExtent.yMinimum() + myExtent.height() * 0.31,
+                            myExtent.xMinimum() + myExtent.width() * 0.71, myExtent.yMinimum() + myExtent.height() * 0.87 );
+
+  // full resolution, decimated to both overview levels and between them, a sub window
+  // decimated and one read at a higher resolution than the file
+  QList< QPair<QgsRectangle, QSize> > myWindows;
+  myWindows << qMakePair( myExtent, QSize( myXSize, myYSize ) );
+  myWindows << qMakePair( myExtent, QSize( myXSize / 2, myYSize / 2 ) );
+  myWindows << qMakePair( myExtent, QSize( myXSize / 3, myYSize / 3 ) );
+  myWindows << qMakePair( myExtent, QSize( myXSize / 4, myYSize / 5 ) );
+  myWindows << qMakePair( myExtent, QSize( myXSize / 7, myYSize / 7 ) );
+  myWindows << qMakePair( mySubExtent, QSize( 37, 29 ) );
+  myWindows << qMakePair( mySubExtent, QSize( myXSize, myYSize ) );
+
+  QgsRasterBlockCache *myCache = QgsRasterBlockCache::instance();
+  int myMaxSize = myCache->maxSize();
+  for ( int myBandNo = 1; myBandNo <= myProvider->bandCount(); myBandNo++ )
+  {
+    for ( int myWindowInt = 0; myWindowInt < myWindows.count(); myWindowInt++ )
+    {
+      const QgsRectangle &myWindowExtent = myWindows.at( myWindowInt ).first;
+      int myWidth = myWindows.at( myWindowInt ).second.width();
+      int myHeight = myWindows.at( myWindowInt ).second.height();
+
+      myCache->setMaxSize( 0 );
+      QgsRasterBlock *myDirectBlock = myProvider->block( myBandNo, myWindowExtent, myWidth, myHeight );
+      // the first read fills the cache, the second one takes the blocks from it
+      myCache->setMaxSize( 64 * 1024 );
+      QgsRasterBlock *myFilledBlock = myProvider->block( myBandNo, myWindowExtent, myWidth, myHeight );
+      QgsRasterBlock *myCachedBlock = myProvider->block( myBandNo, myWindowExtent, myWidth, myHeight );
+
+      QVERIFY( myDirectBlock && !myDirectBlock->isEmpty() );
+      QVERIFY( myFilledBlock && !myFilledBlock->isEmpty() );
+      QVERIFY( myCachedBlock && !myCachedBlock->isEmpty() );
+      for ( size_t i = 0; i < ( size_t )myWidth * myHeight; i++ )
+      {
+        QCOMPARE( myFilledBlock->value( i ), myDirectBlock->value( i ) );
+        QCOMPARE( myCachedBlock->value( i ), myDirectBlock->value( i ) );
+      }
+      delete myDirectBlock;
+      delete myFilledBlock;
+      delete myCachedBlock;
+    }
+  }
+  myCache->setMaxSize( myMaxSize );
+
+  delete mypLayer;
+  mReport += "<h2>Check block cache</h2>\n";
+  mReport += "<p>Passed</p>";
+}
+
 void TestQgsRasterLayer::registry()
 {
   QString myTempPath = QDir::tempPath() + QDir::separator();
@@ -0,0 +1,228 @@
+/***************************************************************************
+     testqgsrasterprojector.cpp
+     --------------------------------------
+    Date                 : October 2013
+    Copyright            : (C) 2013 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QString>
+
+#include <cmath>
+
+//qgis includes...
+#include <qgsapplication.h>
+#include <qgscoordinatereferencesystem.h>
+#include <qgscoordinatetransform.h>
+#include <qgsrasterblock.h>
+#include <qgsrasterinterface.h>
+//header for class being tested
+#include <qgsrasterprojector.h>
+
+/** Input whose pixel values are their index in the requested block,
+ *  negative in the second band */
+class TestIndexInput : public QgsRasterInterface
+{
+  public:
+    TestIndexInput() : QgsRasterInterface( 0 ), mWidth( 0 ), mHeight( 0 ) {}
+
+    QgsRasterInterface *clone() const { return new TestIndexInput(); }
+    QGis::DataType dataType( int bandNo ) const { Q_UNUSED( bandNo ); return QGis::Float64; }
+    int bandCount() const { return 2; }
+
+    QgsRasterBlock *block( int bandNo, const QgsRectangle &extent, int width, int height )
+    {
+      mExtent = extent;
+      mWidth = width;
+      mHeight = height;
+      QgsRasterBlock *block = new QgsRasterBlock( QGis::Float64, width, height );
+      double sign = bandNo == 1 ? 1 : -1;
+      for ( size_t i = 0; i < ( size_t )width * height; i++ )
+      {
+        block->setValue( i, sign * i );
+      }
+      return block;
+    }
+
+    QgsRectangle mExtent;
+    int mWidth;
+    int mHeight;
+};
+
+class TestQgsRasterProjector: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+
+    void approximateBlock();
+    void preciseBlock();
+    void multibandReuse();
+
+  private:
+    /** Checks the source pixels used for all pixels of the block against single point
+     *  transformations, rows and columns may differ by tolerance.
+     *  @return number of pixels outside of the domain of the transformation */
+    int checkBlock( QgsRasterBlock *block, const TestIndexInput &input,
+                    const QgsCoordinateReferenceSystem &srcCrs, const QgsCoordinateReferenceSystem &destCrs,
+                    const QgsRectangle &destExtent, int width, int height, int tolerance );
+
+    QgsCoordinateReferenceSystem mWgs84;
+    QgsCoordinateReferenceSystem mUtm;
+    QgsCoordinateReferenceSystem mOrtho;
+};
+
+void TestQgsRasterProjector::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  mWgs84.createFromSrid( 4326 );
+  mUtm.createFromSrid( 32633 );
+  // only the hemisphere facing lon 0 / lat 0 can be projected
+  mOrtho.createFromProj4( "+proj=ortho +lat_0=0 +lon_0=0 +ellps=WGS84 +units=m +no_defs" );
+}
+
+void TestQgsRasterProjector::cleanupTestCase()
+{
+}
+
+int TestQgsRasterProjector::checkBlock( QgsRasterBlock *block, const TestIndexInput &input,
+                                        const QgsCoordinateReferenceSystem &srcCrs, const QgsCoordinateReferenceSystem &destCrs,
+                                        const QgsRectangle &destExtent, int width, int height, int tolerance )
+{
+  QgsCoordinateTransform ct( destCrs, srcCrs );
+  double destXRes = destExtent.width() / width;
+  double destYRes = destExtent.height() / height;
+  double srcXRes = input.mExtent.width() / input.mWidth;
+  double srcYRes = input.mExtent.height() / input.mHeight;
+
+  int outside = 0;
+  for ( int row = 0; row < height; row++ )
+  {
+    for ( int col = 0; col < width; col++ )
+    {
+      double x = destExtent.xMinimum() + ( col + 0.5 ) * destXRes;
+      double y = destExtent.yMaximum() - ( row + 0.5 ) * destYRes;
+      double z = 0;
+      bool ok = true;
+      try
+      {
+        ct.transformInPlace( x, y, z );
+      }
+      catch ( QgsCsException &e )
+      {
+        Q_UNUSED( e );
+        ok = false;
+      }
+
+      double value = block->value( row, col );
+      if ( !ok || !qIsFinite( x ) || !qIsFinite( y ) )
+      {
+        // no source pixel
+        if ( !qIsNaN( value ) )
+          return -1;
+        outside++;
+        continue;
+      }
+
+      int srcRow = qBound( 0, ( int ) floor(( input.mExtent.yMaximum() - y ) / srcYRes ), input.mHeight - 1 );
+      int srcCol = qBound( 0, ( int ) floor(( x - input.mExtent.xMinimum() ) / srcXRes ), input.mWidth - 1 );
+
+      if ( qIsNaN( value ) )
+        return -1;
+      int index = ( int ) value;
+      if ( qAbs( index / input.mWidth - srcRow ) > tolerance || qAbs( index % input.mWidth - srcCol ) > tolerance )
+        return -1;
+    }
+  }
+  return outside;
+}
+
+void TestQgsRasterProjector::approximateBlock()
+{
+  // a small UTM extent is nearly linear in lat/lon, the control point matrix approximates it
+  TestIndexInput input;
+  QgsRasterProjector projector( mWgs84, mUtm, 0, 0, QgsRectangle( 0, 0, 30, 60 ) );
+  projector.setInput( &input );
+
+  QgsRectangle destExtent( 450000, 5000000, 550000, 5100000 );
+  QgsRasterBlock *block = projector.block( 1, destExtent, 100, 100 );
+  QVERIFY( block && !block->isEmpty() );
+
+  // the approximation may pick a neighbouring source pixel
+  QCOMPARE( checkBlock( block, input, mWgs84, mUtm, destExtent, 100, 100, 1 ), 0 );
+  delete block;
+}
+
+void TestQgsRasterProjector::preciseBlock()
+{
+  // the destination extent goes past the edge of the globe, no approximation is possible
+  // and every pixel is transformed
+  TestIndexInput input;
+  QgsRasterProjector projector( mWgs84, mOrtho, 0, 0, QgsRectangle( -180, -90, 180, 90 ) );
+  projector.setInput( &input );
+
+  QgsRectangle destExtent( -10000000, -10000000, 10000000, 10000000 );
+  QgsRasterBlock *block = projector.block( 1, destExtent, 100, 100 );
+  QVERIFY( block && !block->isEmpty() );
+
+  // pixels outside of the globe are no data, the others use exactly the transformed source pixel
+  int outside = checkBlock( block, input, mWgs84, mOrtho, destExtent, 100, 100, 0 );
+  QVERIFY( outside > 0 );
+  QVERIFY( outside < 100 * 100 );
+  delete block;
+}
+
+void TestQgsRasterProjector::multibandReuse()
+{
+  TestIndexInput input;
+  QgsRasterProjector projector( mWgs84, mUtm, 0, 0, QgsRectangle( 0, 0, 30, 60 ) );
+  projector.setInput( &input );
+
+  QgsRectangle destExtent( 450000, 5000000, 550000, 5100000 );
+  QgsRectangle otherExtent( 500000, 5050000, 600000, 5150000 );
+
+  QgsRasterBlock *block1 = projector.block( 1, destExtent, 100, 80 );
+  QgsRasterBlock *block2 = projector.block( 2, destExtent, 100, 80 );
+  QVERIFY( block1 && !block1->isEmpty() );
+  QVERIFY( block2 && !block2->isEmpty() );
+
+  // the second band uses the same source pixels
+  for ( size_t i = 0; i < 100 * 80; i++ )
+  {
+    QCOMPARE( block2->value( i ), -block1->value( i ) );
+  }
+
+  // another extent must not use the source pixels of the previous one
+  QgsRasterBlock *other = projector.block( 2, otherExtent, 100, 80 );
+  QVERIFY( other && !other->isEmpty() );
+  for ( size_t i = 0; i < 100 * 80; i++ )
+  {
+    other->setValue( i, -other->value( i ) );
+  }
+  QCOMPARE( checkBlock( other, input, mWgs84, mUtm, otherExtent, 100, 80, 1 ), 0 );
+
+  // and going back gives the first block again
+  QgsRasterBlock *again = projector.block( 1, destExtent, 100, 80 );
+  for ( size_t i = 0; i < 100 * 80; i++ )
+  {
+    QCOMPARE( again->value( i ), block1->value( i ) );
+  }
+
+  delete block1;
+  delete block2;
+  delete other;
+  delete again;
+}
+
+QTEST_MAIN( TestQgsRasterProjector )
+#include "moc_testqgsrasterprojector.cxx"
@@ -0,0 +1,358 @@
+/***************************************************************************
+     testqgsrasterrenderers.cpp
+     --------------------------------------
+    Date                 : October 2013
+    Copyright            : (C) 2013 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QString>
+
+//qgis includes...
+#include <qgsapplication.h>
+#include <qgscontrastenhancement.h>
+#include <qgsrasterblock.h>
+#include <qgsrasterinterface.h>
+#include <qgsrastertransparency.h>
+//header for classes being tested
+#include <qgsmultibandcolorrenderer.h>
+#include <qgssinglebandgrayrenderer.h>
+
+// representable in all tested data types
+static const double NoDataValue = 200;
+
+// every value from 0 to 255 appears in each run of 256 pixels, including the no data value
+static double patternValue( int bandNo, size_t index )
+{
+  return ( index * ( 2 * bandNo + 1 ) + bandNo * 17 ) % 256;
+}
+
+/** Input with 4 bands of the same values in any data type */
+class TestPatternInput : public QgsRasterInterface
+{
+  public:
+    TestPatternInput( QGis::DataType dataType ) : QgsRasterInterface( 0 ), mDataType( dataType ) {}
+
+    QgsRasterInterface *clone() const { return new TestPatternInput( mDataType ); }
+    QGis::DataType dataType( int bandNo ) const { Q_UNUSED( bandNo ); return mDataType; }
+    int bandCount() const { return 4; }
+
+    QgsRasterBlock *block( int bandNo, const QgsRectangle &extent, int width, int height )
+    {
+      Q_UNUSED( extent );
+      QgsRasterBlock *block = new QgsRasterBlock( mDataType, width, height, NoDataValue );
+      for ( size_t i = 0; i < ( size_t )width * height; i++ )
+      {
+        block->setValue( i, patternValue( bandNo, i ) );
+      }
+      return block;
+    }
+
+  private:
+    QGis::DataType mDataType;
+};
+
+/** \ingroup UnitTests
+ * Renders the same values stored in different data types. The renderers convert rows
+ * with loops specialized for the data type and use lookup tables for large blocks of
+ * 8 and 16 bit types, the result must not depend on it.
+ */
+class TestQgsRasterRenderers: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+
+    void grayRenderer_data();
+    void grayRenderer();
+    void multiBandColorRenderer_data();
+    void multiBandColorRenderer();
+
+  private:
+    void addRows();
+
+    /** Returns enhancement for the data type, 0 if algorithm is negative */
+    static QgsContrastEnhancement *enhancement( QGis::DataType dataType, int algorithm );
+
+    /** Color component of value as computed pixel by pixel by the renderers before
+     *  rows were converted, -1 for no data */
+    static int referenceComponent( double value, QgsContrastEnhancement *enhancement );
+
+    static QRgb referenceColor( int red, int green, int blue, double opacity );
+
+    QList<QGis::DataType> mDataTypes;
+    QgsRectangle mExtent;
+};
+
+void TestQgsRasterRenderers::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  // the last one is the reference for the others
+  mDataTypes << QGis::Byte << QGis::UInt16 << QGis::Int16 << QGis::Float32 << QGis::Float64;
+  mExtent = QgsRectangle( 0, 0, 100, 100 );
+}
+
+void TestQgsRasterRenderers::cleanupTestCase()
+{
+}
+
+void TestQgsRasterRenderers::addRows()
+{
+  QTest::addColumn<int>( "algorithm" );
+  QTest::addColumn<int>( "width" );
+  QTest::addColumn<int>( "height" );
+  QTest::addColumn<bool>( "transparency" );
+  QTest::addColumn<double>( "opacity" );
+  QTest::addColumn<bool>( "alphaBand" );
+  // clipping without stretch scales values of other types than Byte to the range of the type
+  QTest::addColumn<bool>( "sameForAllTypes" );
+
+  // 256 pixels do not use the lookup table, 300 x 300 are more than a 16 bit table
+  QTest::newRow( "no enhancement" ) << -1 << 300 << 300 << false << 1.0 << false << true;
+  QTest::newRow( "stretch" ) << ( int ) QgsContrastEnhancement::StretchToMinimumMaximum << 16 << 16 << false << 1.0 << false << true;
+  QTest::newRow( "stretch large block" ) << ( int ) QgsContrastEnhancement::StretchToMinimumMaximum << 300 << 300 << false << 1.0 << false << true;
+  QTest::newRow( "stretch and clip" ) << ( int ) QgsContrastEnhancement::StretchAndClipToMinimumMaximum << 16 << 16 << false << 1.0 << false << true;
+  QTest::newRow( "stretch and clip large block" ) << ( int ) QgsContrastEnhancement::StretchAndClipToMinimumMaximum << 300 << 300 << false << 1.0 << false << true;
+  QTest::newRow( "clip large block" ) << ( int ) QgsContrastEnhancement::ClipToMinimumMaximum << 300 << 300 << false << 1.0 << false << false;
+  QTest::newRow( "transparency" ) << ( int ) QgsContrastEnhancement::StretchToMinimumMaximum << 300 << 300 << true << 1.0 << false << true;
+  QTest::newRow( "opacity" ) << ( int ) QgsContrastEnhancement::StretchToMinimumMaximum << 300 << 300 << false << 0.5 << false << true;
+  QTest::newRow( "alpha band" ) << ( int ) QgsContrastEnhancement::StretchToMinimumMaximum << 300 << 300 << false << 1.0 << true << true;
+  QTest::newRow( "alpha band small block" ) << ( int ) QgsContrastEnhancement::StretchToMinimumMaximum << 16 << 16 << true << 0.7 << true << true;
+}
+
+QgsContrastEnhancement *TestQgsRasterRenderers::enhancement( QGis::DataType dataType, int algorithm )
+{
+  if ( algorithm < 0 )
+  {
+    return 0;
+  }
+  // values below 20 and above 180 are out of range
+  QgsContrastEnhancement *ce = new QgsContrastEnhancement(( QgsContrastEnhancement::QgsRasterDataType ) dataType );
+  ce->setContrastEnhancementAlgorithm(( QgsContrastEnhancement::ContrastEnhancementAlgorithm ) algorithm, false );
+  ce->setMinimumValue( 20, false );
+  ce->setMaximumValue( 180 );
+  return ce;
+}
+
+int TestQgsRasterRenderers::referenceComponent( double value, QgsContrastEnhancement *enhancement )
+{
+  if ( QgsRasterBlock::isNoDataValue( value, NoDataValue ) )
+  {
+    return -1;
+  }
+  if ( !enhancement )
+  {
+    return ( int ) value;
+  }
+  if ( !enhancement->isValueInDisplayableRange( value ) )
+  {
+    return -1;
+  }
+  return enhancement->enhanceContrast( value );
+}
+
+QRgb TestQgsRasterRenderers::referenceColor( int red, int green, int blue, double opacity )
+{
+  if ( red < 0 || green < 0 || blue < 0 )
+  {
+    return QgsRasterRenderer::NODATA_COLOR;
+  }
+  if ( doubleNear( opacity, 1.0 ) )
+  {
+    return qRgba( red, green, blue, 255 );
+  }
+  return qRgba( opacity * red, opacity * green, opacity * blue, opacity * 255 );
+}
+
+void TestQgsRasterRenderers::grayRenderer_data()
+{
+  addRows();
+}
+
+void TestQgsRasterRenderers::grayRenderer()
+{
+  QFETCH( int, algorithm );
+  QFETCH( int, width );
+  QFETCH( int, height );
+  QFETCH( bool, transparency );
+  QFETCH( double, opacity );
+  QFETCH( bool, alphaBand );
+  QFETCH( bool, sameForAllTypes );
+
+  size_t size = ( size_t )width * height;
+  QVector<QRgb> referenceData;
+
+  for ( int i = mDataTypes.size() - 1; i >= 0; i-- )
+  {
+    QGis::DataType dataType = mDataTypes.at( i );
+    TestPatternInput input( dataType );
+    QgsSingleBandGrayRenderer renderer( &input, 1 );
+    renderer.setContrastEnhancement( enhancement( dataType, algorithm ) );
+    renderer.setOpacity( opacity );
+    if ( alphaBand )
+    {
+      renderer.setAlphaBand( 2 );
+    }
+    if ( transparency )
+    {
+      QList<QgsRasterTransparency::TransparentSingleValuePixel> pixels;
+      QgsRasterTransparency::TransparentSingleValuePixel pixel;
+      pixel.min = 50;
+      pixel.max = 60;
+      pixel.percentTransparent = 100;
+      pixels << pixel;
+      pixel.min = 170;
+      pixel.max = 170;
+      pixel.percentTransparent = 50;
+      pixels << pixel;
+      QgsRasterTransparency *rasterTransparency = new QgsRasterTransparency();
+      rasterTransparency->setTransparentSingleValuePixelList( pixels );
+      renderer.setRasterTransparency( rasterTransparency );
+    }
+
+    QgsRasterBlock *block = renderer.block( 1, mExtent, width, height );
+    QVERIFY( block && !block->isEmpty() );
+
+    QgsContrastEnhancement *ce = enhancement( dataType, algorithm );
+    for ( size_t j = 0; j < size; j++ )
+    {
+      double value = patternValue( 1, j );
+      int gray = referenceComponent( value, ce );
+      double alpha = opacity;
+      if ( transparency )
+      {
+        alpha = renderer.rasterTransparency()->alphaValue( value, opacity * 255 ) / 255.0;
+      }
+      if ( alphaBand )
+      {
+        alpha *= patternValue( 2, j ) / 255.0;
+      }
+      QCOMPARE( block->color( j ), referenceColor( gray, gray, gray, alpha ) );
+    }
+    delete ce;
+
+    if ( dataType == QGis::Float64 )
+    {
+      for ( size_t j = 0; j < size; j++ )
+      {
+        referenceData << block->color( j );
+      }
+    }
+    else if ( sameForAllTypes )
+    {
+      for ( size_t j = 0; j < size; j++ )
+      {
+        QCOMPARE( block->color( j ), referenceData.at( j ) );
+      }
+    }
+    delete block;
+  }
+
+  // no data and out of range values must have been rendered
+  QVERIFY( referenceData.contains( QgsRasterRenderer::NODATA_COLOR ) );
+}
+
+void TestQgsRasterRenderers::multiBandColorRenderer_data()
+{
+  addRows();
+}
+
+void TestQgsRasterRenderers::multiBandColorRenderer()
+{
+  QFETCH( int, algorithm );
+  QFETCH( int, width );
+  QFETCH( int, height );
+  QFETCH( bool, transparency );
+  QFETCH( double, opacity );
+  QFETCH( bool, alphaBand );
+  QFETCH( bool, sameForAllTypes );
+
+  size_t size = ( size_t )width * height;
+  QVector<QRgb> referenceData;
+
+  for ( int i = mDataTypes.size() - 1; i >= 0; i-- )
+  {
+    QGis::DataType dataType = mDataTypes.at( i );
+    TestPatternInput input( dataType );
+    QgsMultiBandColorRenderer renderer( &input, 1, 2, 3, enhancement( dataType, algorithm ),
+                                        enhancement( dataType, algorithm ), enhancement( dataType, algorithm ) );
+    renderer.setOpacity( opacity );
+    if ( alphaBand )
+    {
+      renderer.setAlphaBand( 4 );
+    }
+
+    QgsContrastEnhancement *ce = enhancement( dataType, algorithm );
+    if ( transparency )
+    {
+      // transparent colors are compared with enhanced values, take them from pixels of the block
+      QList<QgsRasterTransparency::TransparentThreeValuePixel> pixels;
+      QgsRasterTransparency::TransparentThreeValuePixel pixel;
+      pixel.red = referenceComponent( patternValue( 1, 10 ), ce );
+      pixel.green = referenceComponent( patternValue( 2, 10 ), ce );
+      pixel.blue = referenceComponent( patternValue( 3, 10 ), ce );
+      pixel.percentTransparent = 100;
+      pixels << pixel;
+      pixel.red = referenceComponent( patternValue( 1, 11 ), ce );
+      pixel.green = referenceComponent( patternValue( 2, 11 ), ce );
+      pixel.blue = referenceComponent( patternValue( 3, 11 ), ce );
+      pixel.percentTransparent = 50;
+      pixels << pixel;
+      QgsRasterTransparency *rasterTransparency = new QgsRasterTransparency();
+      rasterTransparency->setTransparentThreeValuePixelList( pixels );
+      renderer.setRasterTransparency( rasterTransparency );
+    }
+
+    QgsRasterBlock *block = renderer.block( 1, mExtent, width, height );
+    QVERIFY( block && !block->isEmpty() );
+
+    for ( size_t j = 0; j < size; j++ )
+    {
+      int red = referenceComponent( patternValue( 1, j ), ce );
+      int green = referenceComponent( patternValue( 2, j ), ce );
+      int blue = referenceComponent( patternValue( 3, j ), ce );
+      double alpha = opacity;
+      if ( transparency )
+      {
+        alpha = renderer.rasterTransparency()->alphaValue( red, green, blue, opacity * 255 ) / 255.0;
+      }
+      if ( alphaBand )
+      {
+        alpha *= patternValue( 4, j ) / 255.0;
+      }
+      QCOMPARE( block->color( j ), referenceColor( red, green, blue, alpha ) );
+    }
+    delete ce;
+
+    if ( dataType == QGis::Float64 )
+    {
+      for ( size_t j = 0; j < size; j++ )
+      {
+        referenceData << block->color( j );
+      }
+    }
+    else if ( sameForAllTypes )
+    {
+      for ( size_t j = 0; j < size; j++ )
+      {
+        QCOMPARE( block->color( j ), referenceData.at( j ) );
+      }
+    }
+    delete block;
+  }
+
+  QVERIFY( referenceData.contains( QgsRasterRenderer::NODATA_COLOR ) );
+}
+
+QTEST_MAIN( TestQgsRasterRenderers )
+#include "moc_testqgsrasterrenderers.cxx"
@@ -0,0 +1,244 @@
+/***************************************************************************
+     testqgsrasterstatisticscache.cpp
+     --------------------------------------
+    Date                 : May 2013
+    Copyright            : (C) 2013 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QDir>
+#include <QFile>
+#include <QString>
+
+//qgis includes...
+#include <qgsrasterbandstats.h>
+#include <qgsrasterhistogram.h>
+#include <qgsrectangle.h>
+//header for class being tested
+#include <qgsrasterstatisticscache.h>
+
+class TestQgsRasterStatisticsCache: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+
+    void statistics();
+    void histogram();
+    void remove();
+    void noData();
+    void replace();
+    void evict();
+
+  private:
+    QgsRasterBandStats createStatistics( int statsGathered );
+    QgsRasterHistogram createHistogram();
+
+    QString mDbPath;
+    int mMaxEntries;
+};
+
+void TestQgsRasterStatisticsCache::initTestCase()
+{
+  mDbPath = QDir::tempPath() + QDir::separator() + "qgis_test_rasterstatistics.db";
+  QFile::remove( mDbPath );
+  QgsRasterStatisticsCache::setDatabasePath( mDbPath );
+  mMaxEntries = QgsRasterStatisticsCache::maxEntries();
+}
+
+void TestQgsRasterStatisticsCache::cleanupTestCase()
+{
+  QgsRasterStatisticsCache::setMaxEntries( mMaxEntries );
+  QFile::remove( mDbPath );
+}
+
+QgsRasterBandStats TestQgsRasterStatisticsCache::createStatistics( int statsGathered )
+{
+  QgsRasterBandStats stats;
+  stats.bandNumber = 1;
+  stats.extent = QgsRectangle( 0.1, 0.2, 100.3, 200.4 );
+  stats.width = 1000;
+  stats.height = 2000;
+  stats.statsGathered = statsGathered;
+  return stats;
+}
+
+QgsRasterHistogram TestQgsRasterStatisticsCache::createHistogram()
+{
+  QgsRasterHistogram histogram;
+  histogram.bandNumber = 2;
+  histogram.binCount = 4;
+  histogram.minimum = -0.5;
+  histogram.maximum = 255.5;
+  histogram.extent = QgsRectangle( 0.1, 0.2, 100.3, 200.4 );
+  histogram.width = 100;
+  histogram.height = 200;
+  return histogram;
+}
+
+void TestQgsRasterStatisticsCache::statistics()
+{
+  QgsRasterBandStats stats = createStatistics( QgsRasterBandStats::Min | QgsRasterBandStats::Max );
+  QVERIFY( !QgsRasterStatisticsCache::statistics( "statistics.tif", "", stats ) );
+
+  stats.minimumValue = -10.5;
+  stats.maximumValue = 1234.25;
+  stats.elementCount = 2000000000;
+  QgsRasterStatisticsCache::insertStatistics( "statistics.tif", "", stats );
+
+  QgsRasterBandStats found = createStatistics( QgsRasterBandStats::Min );
+  QVERIFY( QgsRasterStatisticsCache::statistics( "statistics.tif", "", found ) );
+  QCOMPARE( found.statsGathered, stats.statsGathered );
+  QCOMPARE( found.minimumValue, stats.minimumValue );
+  QCOMPARE( found.maximumValue, stats.maximumValue );
+  QCOMPARE( found.elementCount, stats.elementCount );
+
+  // statistics not collected, different extent, sample size or source
+  found = createStatistics( QgsRasterBandStats::Min | QgsRasterBandStats::Mean );
+  QVERIFY( !QgsRasterStatisticsCache::statistics( "statistics.tif", "", found ) );
+  found = createStatistics( QgsRasterBandStats::Min );
+  found.extent = QgsRectangle( 0, 0, 100, 200 );
+  QVERIFY( !QgsRasterStatisticsCache::statistics( "statistics.tif", "", found ) );
+  found = createStatistics( QgsRasterBandStats::Min );
+  found.width = 100;
+  QVERIFY( !QgsRasterStatisticsCache::statistics( "statistics.tif", "", found ) );
+  found = createStatistics( QgsRasterBandStats::Min );
+  QVERIFY( !QgsRasterStatisticsCache::statistics( "other.tif", "", found ) );
+}
+
+void TestQgsRasterStatisticsCache::histogram()
+{
+  QgsRasterHistogram histogram = createHistogram();
+  QVERIFY( !QgsRasterStatisticsCache::histogram( "histogram.tif", "", histogram ) );
+
+  // invalid histograms are not stored
+  QgsRasterStatisticsCache::insertHistogram( "histogram.tif", "", histogram );
+  QVERIFY( !QgsRasterStatisticsCache::histogram( "histogram.tif", "", histogram ) );
+
+  histogram.histogramVector << 1 << 2 << 3 << 4;
+  histogram.nonNullCount = 10;
+  histogram.valid = true;
+  QgsRasterStatisticsCache::insertHistogram( "histogram.tif", "", histogram );
+
+  QgsRasterHistogram found = createHistogram();
+  QVERIFY( QgsRasterStatisticsCache::histogram( "histogram.tif", "", found ) );
+  QVERIFY( found.valid );
+  QCOMPARE( found.nonNullCount, 10 );
+  QCOMPARE( found.histogramVector, histogram.histogramVector );
+
+  found = createHistogram();
+  found.includeOutOfRange = true;
+  QVERIFY( !QgsRasterStatisticsCache::histogram( "histogram.tif", "", found ) );
+}
+
+void TestQgsRasterStatisticsCache::remove()
+{
+  QgsRasterBandStats stats = createStatistics( QgsRasterBandStats::Min );
+  QgsRasterStatisticsCache::insertStatistics( "remove.tif", "", stats );
+  QVERIFY( QgsRasterStatisticsCache::statistics( "remove.tif", "", stats ) );
+
+  QgsRasterStatisticsCache::remove( "remove.tif" );
+  QVERIFY( !QgsRasterStatisticsCache::statistics( "remove.tif", "", stats ) );
+}
+
+void TestQgsRasterStatisticsCache::noData()
+{
+  QgsRasterBandStats stats = createStatistics( QgsRasterBandStats::Min );
+  stats.minimumValue = 1;
+  QgsRasterStatisticsCache::insertStatistics( "nodata.tif", "-9999", stats );
+  QgsRasterHistogram histogram = createHistogram();
+  histogram.histogramVector << 1 << 2 << 3 << 4;
+  histogram.valid = true;
+  QgsRasterStatisticsCache::insertHistogram( "nodata.tif", "-9999", histogram );
+
+  // other no-data settings, e.g. source no-data value not used or user no-data ranges
+  QgsRasterBandStats found = createStatistics( QgsRasterBandStats::Min );
+  QVERIFY( !QgsRasterStatisticsCache::statistics( "nodata.tif", "", found ) );
+  QVERIFY( !QgsRasterStatisticsCache::statistics( "nodata.tif", "-9999;0:10", found ) );
+  QgsRasterHistogram foundHistogram = createHistogram();
+  QVERIFY( !QgsRasterStatisticsCache::histogram( "nodata.tif", "", foundHistogram ) );
+
+  // both may be stored
+  stats.minimumValue = -9999;
+  QgsRasterStatisticsCache::insertStatistics( "nodata.tif", "", stats );
+  QVERIFY( QgsRasterStatisticsCache::statistics( "nodata.tif", "", found ) );
+  QCOMPARE( found.minimumValue, -9999. );
+  found = createStatistics( QgsRasterBandStats::Min );
+  QVERIFY( QgsRasterStatisticsCache::statistics( "nodata.tif", "-9999", found ) );
+  QCOMPARE( found.minimumValue, 1. );
+  QVERIFY( QgsRasterStatisticsCache::histogram( "nodata.tif", "-9999", foundHistogram ) );
+}
+
+void TestQgsRasterStatisticsCache::replace()
+{
+  QgsRasterBandStats stats = createStatistics( QgsRasterBandStats::Min | QgsRasterBandStats::Max );
+  stats.minimumValue = 1;
+  QgsRasterStatisticsCache::insertStatistics( "replace.tif", "", stats );
+
+  // statistics included in the stored ones do not replace them
+  QgsRasterBandStats fewer = createStatistics( QgsRasterBandStats::Min );
+  fewer.minimumValue = 2;
+  QgsRasterStatisticsCache::insertStatistics( "replace.tif", "", fewer );
+  QgsRasterBandStats found = createStatistics( QgsRasterBandStats::Min | QgsRasterBandStats::Max );
+  QVERIFY( QgsRasterStatisticsCache::statistics( "replace.tif", "", found ) );
+  QCOMPARE( found.minimumValue, 1. );
+
+  // the same or more statistics do
+  QgsRasterBandStats more = createStatistics( QgsRasterBandStats::Min | QgsRasterBandStats::Max | QgsRasterBandStats::Mean );
+  more.minimumValue = 3;
+  QgsRasterStatisticsCache::insertStatistics( "replace.tif", "", more );
+  found = createStatistics( QgsRasterBandStats::Min );
+  QVERIFY( QgsRasterStatisticsCache::statistics( "replace.tif", "", found ) );
+  QCOMPARE( found.statsGathered, more.statsGathered );
+  QCOMPARE( found.minimumValue, 3. );
+
+  // only one histogram is kept for the same parameters
+  QgsRasterHistogram histogram = createHistogram();
+  histogram.histogramVector << 1 << 2 << 3 << 4;
+  histogram.valid = true;
+  QgsRasterStatisticsCache::insertHistogram( "replace.tif", "", histogram );
+  histogram.histogramVector[0] = 5;
+  QgsRasterStatisticsCache::insertHistogram( "replace.tif", "", histogram );
+  QgsRasterHistogram foundHistogram = createHistogram();
+  QVERIFY( QgsRasterStatisticsCache::histogram( "replace.tif", "", foundHistogram ) );
+  QCOMPARE( foundHistogram.histogramVector, histogram.histogramVector );
+}
+
+void TestQgsRasterStatisticsCache::evict()
+{
+  QgsRasterStatisticsCache::setMaxEntries( 2 );
+
+  QgsRasterBandStats stats = createStatistics( QgsRasterBandStats::Min );
+  QgsRasterStatisticsCache::insertStatistics( "evict1.tif", "", stats );
+  QgsRasterStatisticsCache::insertStatistics( "evict2.tif", "", stats );
+
+  // evict1.tif is used again, evict2.tif is the least recently used one
+  QVERIFY( QgsRasterStatisticsCache::statistics( "evict1.tif", "", stats ) );
+  QgsRasterStatisticsCache::insertStatistics( "evict3.tif", "", stats );
+
+  QVERIFY( QgsRasterStatisticsCache::statistics( "evict1.tif", "", stats ) );
+  QVERIFY( !QgsRasterStatisticsCache::statistics( "evict2.tif", "", stats ) );
+  QVERIFY( QgsRasterStatisticsCache::statistics( "evict3.tif", "", stats ) );
+
+  QgsRasterHistogram histogram = createHistogram();
+  histogram.histogramVector << 1 << 2 << 3 << 4;
+  histogram.valid = true;
+  QgsRasterStatisticsCache::insertHistogram( "evict1.tif", "", histogram );
+  QgsRasterStatisticsCache::insertHistogram( "evict2.tif", "", histogram );
+  QgsRasterStatisticsCache::insertHistogram( "evict3.tif", "", histogram );
+  QVERIFY( !QgsRasterStatisticsCache::histogram( "evict1.tif", "", histogram ) );
+  QVERIFY( QgsRasterStatisticsCache::histogram( "evict3.tif", "", histogram ) );
+
+  QgsRasterStatisticsCache::setMaxEntries( mMaxEntries );
+}
+
+QTEST_MAIN( TestQgsRasterStatisticsCache )
+#include "moc_testqgsrasterstatisticscache.cxx"
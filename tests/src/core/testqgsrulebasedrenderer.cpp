@@ -19,8 +19,12 @@
 #include <qgsrulebasedrendererv2.h>
 
 #include <qgsapplication.h>
+#include <qgsgeometry.h>
+#include <qgsrendercontext.h>
 #include <qgssymbolv2.h>
 #include <qgsvectorlayer.h>
+#include <QImage>
+#include <QPainter>
 
 #if QT_VERSION < 0x40701
 // See http://hub.qgis.org/issues/4284
@@ -104,6 +108,129 @@ class TestQgsRuleBasedRenderer: public QObject
       delete layer;
     }
 
+    void test_lookup_hitCount()
+    {
+      // prepare features
+      QgsVectorLayer* layer = new QgsVectorLayer( "point?field=cls:string&field=num:int", "x", "memory" );
+      int idxCls = layer->fieldNameIndex( "cls" );
+      int idxNum = layer->fieldNameIndex( "num" );
+      QVERIFY( idxCls != -1 && idxNum != -1 );
+
+      QList<QgsFeature> features;
+      QList<QVariant> classes, nums;
+      classes << "a" << "b" << "b" << "c" << "10.0" << QVariant( QVariant::String ) << "d";
+      nums << 1 << 6 << 2 << 0 << 0 << 1 << 7;
+      for ( int i = 0; i < classes.count(); ++i )
+      {
+        QgsFeature f( i );
+        f.initAttributes( 2 );
+        f.setAttribute( idxCls, classes[i] );
+        f.setAttribute( idxNum, nums[i] );
+        f.setGeometry( QgsGeometry::fromPoint( QgsPoint( i, i ) ) );
+        features << f;
+      }
+
+      // prepare renderer: rules testing "cls" are evaluated using a lookup
+      RRule* rootRule = new RRule( NULL );
+      rootRule->appendChild( new RRule( QgsSymbolV2::defaultSymbol( QGis::Point ), 0, 0, "cls = 'a'" ) );
+      rootRule->appendChild( new RRule( QgsSymbolV2::defaultSymbol( QGis::Point ), 0, 0, "cls IN ('b','c')" ) );
+      rootRule->appendChild( new RRule( QgsSymbolV2::defaultSymbol( QGis::Point ), 0, 0, "num > 5" ) );
+      rootRule->appendChild( new RRule( QgsSymbolV2::defaultSymbol( QGis::Point ), 0, 0, "'b' = cls AND num < 5" ) );
+      rootRule->appendChild( new RRule( QgsSymbolV2::defaultSymbol( QGis::Point ), 0, 0, "cls = 10" ) );
+      QgsRuleBasedRendererV2 r( rootRule );
+
+      QImage img( 100, 100, QImage::Format_ARGB32_Premultiplied );
+      QPainter p( &img );
+      QgsRenderContext ctx;
+      ctx.setPainter( &p );
+
+      // expected hit counts by evaluating every rule's filter
+      QMap<RRule*, int> expected;
+      r.startRender( ctx, layer );
+      foreach ( QgsFeature f, features )
+      {
+        foreach ( RRule* rule, r.rootRule()->rulesForFeature( f ) )
+          expected[rule]++;
+      }
+      r.stopRender( ctx );
+
+      r.startRender( ctx, layer );
+      foreach ( QgsFeature f, features )
+      {
+        QCOMPARE( r.renderFeature( f, ctx ), f.id() != 5 );
+      }
+      r.stopRender( ctx );
+
+      QCOMPARE( r.rootRule()->hitCount(), features.count() );
+      QList<int> hits;
+      foreach ( RRule* rule, r.rootRule()->children() )
+      {
+        QCOMPARE( rule->hitCount(), expected.value( rule ) );
+        hits << rule->hitCount();
+      }
+      QCOMPARE( hits, QList<int>() << 1 << 3 << 2 << 1 << 1 );
+
+      delete layer;
+    }
+
+    void test_lookup_longlong()
+    {
+      // 64 bit integer values are compared as strings by QgsExpression
+      QgsVectorLayer* layer = new QgsVectorLayer( "point?field=num:int", "x", "memory" );
+      int idxNum = layer->fieldNameIndex( "num" );
+      QVERIFY( idxNum != -1 );
+
+      QList<QgsFeature> features;
+      QList<qlonglong> nums;
+      nums << 1 << 2 << 6 << 7 << 10 << 3;
+      for ( int i = 0; i < nums.count(); ++i )
+      {
+        QgsFeature f( i );
+        f.initAttributes( 1 );
+        f.setAttribute( idxNum, QVariant( nums[i] ) );
+        f.setGeometry( QgsGeometry::fromPoint( QgsPoint( i, i ) ) );
+        features << f;
+      }
+
+      RRule* rootRule = new RRule( NULL );
+      rootRule->appendChild( new RRule( QgsSymbolV2::defaultSymbol( QGis::Point ), 0, 0, "num = 1" ) );
+      rootRule->appendChild( new RRule( QgsSymbolV2::defaultSymbol( QGis::Point ), 0, 0, "num IN (2, 6)" ) );
+      rootRule->appendChild( new RRule( QgsSymbolV2::defaultSymbol( QGis::Point ), 0, 0, "num = '7'" ) );
+      rootRule->appendChild( new RRule( QgsSymbolV2::defaultSymbol( QGis::Point ), 0, 0, "num = 10.0" ) );
+      QgsRuleBasedRendererV2 r( rootRule );
+
+      QImage img( 100, 100, QImage::Format_ARGB32_Premultiplied );
+      QPainter p( &img );
+      QgsRenderContext ctx;
+      ctx.setPainter( &p );
+
+      QMap<RRule*, int> expected;
+      r.startRender( ctx, layer );
+      foreach ( QgsFeature f, features )
+      {
+        foreach ( RRule* rule, r.rootRule()->rulesForFeature( f ) )
+          expected[rule]++;
+      }
+      r.stopRender( ctx );
+
+      r.startRender( ctx, layer );
+      foreach ( QgsFeature f, features )
+      {
+        QCOMPARE( r.renderFeature( f, ctx ), f.id() != 5 );
+      }
+      r.stopRender( ctx );
+
+      QList<int> hits;
+      foreach ( RRule* rule, r.rootRule()->children() )
+      {
+        QCOMPARE( rule->hitCount(), expected.value( rule ) );
+        hits << rule->hitCount();
+      }
+      QCOMPARE( hits, QList<int>() << 1 << 2 << 1 << 1 );
+
+      delete layer;
+    }
+
   private:
     void xml2domElement( QString testFile, QDomDocument& doc )
     {
@@ -0,0 +1,207 @@
+/***************************************************************************
+     testqgssqlexpressioncompiler.cpp
+     --------------------------------------
+    Date                 : November 2012
+    Copyright            : (C) 2012 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QString>
+
+//qgis includes...
+#include <qgsexpression.h>
+#include <qgsfield.h>
+//header for class being tested
+#include <qgssqlexpressioncompiler.h>
+
+Q_DECLARE_METATYPE( QgsSqlExpressionCompiler::Result )
+
+//! compiler of a database which reads timestamps as strings
+class TestTypeNameCompiler : public QgsSqlExpressionCompiler
+{
+  public:
+    TestTypeNameCompiler( const QgsFields& fields ) : QgsSqlExpressionCompiler( fields ) {}
+
+  protected:
+    virtual bool isStringField( int fieldIdx ) const
+    {
+      return mFields[fieldIdx].type() == QVariant::String && mFields[fieldIdx].typeName() == "text";
+    }
+};
+
+class TestQgsSqlExpressionCompiler: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+
+    void compile_data();
+    void compile();
+
+    void compileFlags_data();
+    void compileFlags();
+
+    void compileNonStringTypes_data();
+    void compileNonStringTypes();
+
+  private:
+    QgsSqlExpressionCompiler::Result compileExpression( const QString& expression, QgsSqlExpressionCompiler::Flags flags, QString& sql );
+
+    QgsFields mFields;
+};
+
+void TestQgsSqlExpressionCompiler::initTestCase()
+{
+  mFields.append( QgsField( "id", QVariant::Int ) );
+  mFields.append( QgsField( "name", QVariant::String ) );
+  mFields.append( QgsField( "value", QVariant::Double ) );
+}
+
+QgsSqlExpressionCompiler::Result TestQgsSqlExpressionCompiler::compileExpression( const QString& expression, QgsSqlExpressionCompiler::Flags flags, QString& sql )
+{
+  QgsExpression exp( expression );
+  if ( exp.hasParserError() )
+    qDebug( "Parser error: %s", exp.parserErrorString().toLocal8Bit().constData() );
+  exp.prepare( mFields );
+
+  QgsSqlExpressionCompiler compiler( mFields, flags );
+  QgsSqlExpressionCompiler::Result res = compiler.compile( &exp );
+  sql = compiler.result();
+  return res;
+}
+
+void TestQgsSqlExpressionCompiler::compile_data()
+{
+  QTest::addColumn<QString>( "expression" );
+  QTest::addColumn<QgsSqlExpressionCompiler::Result>( "result" );
+  QTest::addColumn<QString>( "sql" );
+
+  // comparisons
+  QTest::newRow( "numeric" ) << "\"id\" > 5" << QgsSqlExpressionCompiler::Complete << "\"id\" > 5";
+  QTest::newRow( "literal left" ) << "5 < \"id\"" << QgsSqlExpressionCompiler::Complete << "\"id\" > 5";
+  QTest::newRow( "negative" ) << "\"id\" >= -5" << QgsSqlExpressionCompiler::Complete << "\"id\" >= -5";
+  QTest::newRow( "double" ) << "\"value\" <= 2.5" << QgsSqlExpressionCompiler::Complete << "\"value\" <= 2.5";
+  QTest::newRow( "column case" ) << "\"ID\" = 1" << QgsSqlExpressionCompiler::Complete << "\"id\" = 1";
+  QTest::newRow( "string" ) << "\"name\" = 'abc'" << QgsSqlExpressionCompiler::Complete << "\"name\" = 'abc'";
+  QTest::newRow( "string quote" ) << "\"name\" <> 'it''s'" << QgsSqlExpressionCompiler::Complete << "\"name\" <> 'it''s'";
+  QTest::newRow( "string numeric" ) << "\"name\" = '10'" << QgsSqlExpressionCompiler::Fail << "";
+  QTest::newRow( "string empty" ) << "\"name\" = ''" << QgsSqlExpressionCompiler::Fail << "";
+  QTest::newRow( "string order" ) << "\"name\" > 'abc'" << QgsSqlExpressionCompiler::Fail << "";
+  QTest::newRow( "type mismatch" ) << "\"id\" = 'abc'" << QgsSqlExpressionCompiler::Fail << "";
+  QTest::newRow( "unknown column" ) << "\"unknown\" = 1" << QgsSqlExpressionCompiler::Fail << "";
+  QTest::newRow( "function" ) << "upper(\"name\") = 'X'" << QgsSqlExpressionCompiler::Fail << "";
+
+  // null
+  QTest::newRow( "is null" ) << "\"name\" IS NULL" << QgsSqlExpressionCompiler::Complete << "\"name\" IS NULL";
+  QTest::newRow( "is not null" ) << "\"id\" IS NOT NULL" << QgsSqlExpressionCompiler::Complete << "\"id\" IS NOT NULL";
+  QTest::newRow( "is value" ) << "\"id\" IS 5" << QgsSqlExpressionCompiler::Fail << "";
+
+  // like
+  QTest::newRow( "like" ) << "\"name\" LIKE 'a%'" << QgsSqlExpressionCompiler::Complete << "\"name\" LIKE 'a%'";
+  QTest::newRow( "not like" ) << "\"name\" NOT LIKE 'a_c'" << QgsSqlExpressionCompiler::Complete << "\"name\" NOT LIKE 'a_c'";
+  QTest::newRow( "ilike" ) << "\"name\" ILIKE 'a%'" << QgsSqlExpressionCompiler::Complete << "\"name\" ILIKE 'a%'";
+  QTest::newRow( "like regexp chars" ) << "\"name\" LIKE 'a.b%'" << QgsSqlExpressionCompiler::Fail << "";
+  QTest::newRow( "like numeric" ) << "\"id\" LIKE '1%'" << QgsSqlExpressionCompiler::Fail << "";
+  QTest::newRow( "regexp" ) << "\"name\" ~ 'abc'" << QgsSqlExpressionCompiler::Fail << "";
+
+  // in
+  QTest::newRow( "in" ) << "\"id\" IN (1,2,3)" << QgsSqlExpressionCompiler::Complete << "\"id\" IN (1,2,3)";
+  QTest::newRow( "not in" ) << "\"name\" NOT IN ('a','b')" << QgsSqlExpressionCompiler::Complete << "\"name\" NOT IN ('a','b')";
+  QTest::newRow( "in null" ) << "\"id\" IN (1,NULL)" << QgsSqlExpressionCompiler::Fail << "";
+
+  // logical operators
+  QTest::newRow( "and" ) << "\"id\" > 5 AND \"name\" = 'abc'" << QgsSqlExpressionCompiler::Complete << "(\"id\" > 5) AND (\"name\" = 'abc')";
+  QTest::newRow( "or" ) << "\"id\" > 5 OR \"value\" <= 2.5" << QgsSqlExpressionCompiler::Complete << "(\"id\" > 5) OR (\"value\" <= 2.5)";
+  QTest::newRow( "not" ) << "NOT (\"id\" > 5)" << QgsSqlExpressionCompiler::Complete << "NOT (\"id\" > 5)";
+  QTest::newRow( "and partial" ) << "\"id\" > 5 AND upper(\"name\") = 'X'" << QgsSqlExpressionCompiler::Partial << "\"id\" > 5";
+  QTest::newRow( "or partial" ) << "\"id\" > 5 OR upper(\"name\") = 'X'" << QgsSqlExpressionCompiler::Fail << "";
+  QTest::newRow( "not partial" ) << "NOT (\"id\" > 5 AND upper(\"name\") = 'X')" << QgsSqlExpressionCompiler::Fail << "";
+  QTest::newRow( "or of partial" ) << "(\"id\" > 5 AND upper(\"name\") = 'X') OR \"id\" < 2" << QgsSqlExpressionCompiler::Partial << "(\"id\" > 5) OR (\"id\" < 2)";
+}
+
+void TestQgsSqlExpressionCompiler::compile()
+{
+  QFETCH( QString, expression );
+  QFETCH( QgsSqlExpressionCompiler::Result, result );
+  QFETCH( QString, sql );
+
+  QString res;
+  QCOMPARE( compileExpression( expression, 0, res ), result );
+  QCOMPARE( res, sql );
+}
+
+void TestQgsSqlExpressionCompiler::compileFlags_data()
+{
+  QTest::addColumn<QString>( "expression" );
+  QTest::addColumn<int>( "flags" );
+  QTest::addColumn<QgsSqlExpressionCompiler::Result>( "result" );
+  QTest::addColumn<QString>( "sql" );
+
+  int noILike = QgsSqlExpressionCompiler::NoNativeILike;
+  int ciLike = QgsSqlExpressionCompiler::LikeIsCaseInsensitive | QgsSqlExpressionCompiler::NoNativeILike;
+  int ciMatch = QgsSqlExpressionCompiler::CaseInsensitiveStringMatch;
+
+  QTest::newRow( "ilike upper" ) << "\"name\" ILIKE 'a%'" << noILike << QgsSqlExpressionCompiler::Partial << "UPPER(\"name\") LIKE UPPER('a%')";
+  QTest::newRow( "not ilike upper" ) << "\"name\" NOT ILIKE 'a%'" << noILike << QgsSqlExpressionCompiler::Fail << "";
+  QTest::newRow( "ci like" ) << "\"name\" LIKE 'a%'" << ciLike << QgsSqlExpressionCompiler::Partial << "\"name\" LIKE 'a%'";
+  QTest::newRow( "ci not like" ) << "\"name\" NOT LIKE 'a%'" << ciLike << QgsSqlExpressionCompiler::Fail << "";
+  QTest::newRow( "ci ilike" ) << "\"name\" ILIKE 'a%'" << ciLike << QgsSqlExpressionCompiler::Partial << "\"name\" LIKE 'a%'";
+  QTest::newRow( "ci equal" ) << "\"name\" = 'abc'" << ciMatch << QgsSqlExpressionCompiler::Partial << "\"name\" = 'abc'";
+  QTest::newRow( "ci not equal" ) << "\"name\" <> 'abc'" << ciMatch << QgsSqlExpressionCompiler::Fail << "";
+  QTest::newRow( "ci in" ) << "\"name\" IN ('a','b')" << ciMatch << QgsSqlExpressionCompiler::Partial << "\"name\" IN ('a','b')";
+  QTest::newRow( "ci not in" ) << "\"name\" NOT IN ('a','b')" << ciMatch << QgsSqlExpressionCompiler::Fail << "";
+  QTest::newRow( "ci numeric" ) << "\"id\" <> 5" << ciMatch << QgsSqlExpressionCompiler::Complete << "\"id\" <> 5";
+}
+
+void TestQgsSqlExpressionCompiler::compileFlags()
+{
+  QFETCH( QString, expression );
+  QFETCH( int, flags );
+  QFETCH( QgsSqlExpressionCompiler::Result, result );
+  QFETCH( QString, sql );
+
+  QString res;
+  QCOMPARE( compileExpression( expression, QgsSqlExpressionCompiler::Flags( flags ), res ), result );
+  QCOMPARE( res, sql );
+}
+
+void TestQgsSqlExpressionCompiler::compileNonStringTypes_data()
+{
+  QTest::addColumn<QString>( "expression" );
+  QTest::addColumn<QgsSqlExpressionCompiler::Result>( "result" );
+  QTest::addColumn<QString>( "sql" );
+
+  QTest::newRow( "text" ) << "\"name\" = 'abc'" << QgsSqlExpressionCompiler::Complete << "\"name\" = 'abc'";
+  QTest::newRow( "timestamp equal" ) << "\"created\" = '2013-05-01 10:00'" << QgsSqlExpressionCompiler::Fail << "";
+  QTest::newRow( "timestamp like" ) << "\"created\" LIKE '2013%'" << QgsSqlExpressionCompiler::Fail << "";
+  QTest::newRow( "timestamp in" ) << "\"created\" IN ('2013-05-01','2013-05-02')" << QgsSqlExpressionCompiler::Fail << "";
+  QTest::newRow( "timestamp null" ) << "\"created\" IS NULL" << QgsSqlExpressionCompiler::Complete << "\"created\" IS NULL";
+}
+
+void TestQgsSqlExpressionCompiler::compileNonStringTypes()
+{
+  QFETCH( QString, expression );
+  QFETCH( QgsSqlExpressionCompiler::Result, result );
+  QFETCH( QString, sql );
+
+  QgsFields fields;
+  fields.append( QgsField( "name", QVariant::String, "text" ) );
+  fields.append( QgsField( "created", QVariant::String, "timestamp" ) );
+
+  QgsExpression exp( expression );
+  exp.prepare( fields );
+
+  TestTypeNameCompiler compiler( fields );
+  QCOMPARE( compiler.compile( &exp ), result );
+  QCOMPARE( compiler.result(), sql );
+}
+
+QTEST_MAIN( TestQgsSqlExpressionCompiler )
+#include "moc_testqgssqlexpressioncompiler.cxx"
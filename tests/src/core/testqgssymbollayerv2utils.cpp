@@ -0,0 +1,86 @@
+/***************************************************************************
+     testqgssymbollayerv2utils.cpp
+     --------------------------------------
+    Date                 : May 2013
+    Copyright            : (C) 2013 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QPolygonF>
+
+//header for class being tested
+#include <qgssymbollayerv2utils.h>
+
+class TestQgsSymbolLayerV2Utils: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void simplifyPolylineNoTolerance();
+    void simplifyPolyline();
+    void simplifyPolylineKeepsEnds();
+    void simplifyPolylineMinPoints();
+};
+
+void TestQgsSymbolLayerV2Utils::simplifyPolylineNoTolerance()
+{
+  QPolygonF line;
+  line << QPointF( 0, 0 ) << QPointF( 0.1, 0 ) << QPointF( 0.2, 0 ) << QPointF( 10, 0 );
+  QPolygonF result = line;
+  QgsSymbolLayerV2Utils::simplifyPolyline( result, 0 );
+  QCOMPARE( result, line );
+}
+
+void TestQgsSymbolLayerV2Utils::simplifyPolyline()
+{
+  QPolygonF line;
+  line << QPointF( 0, 0 ) << QPointF( 0.4, 0 ) << QPointF( 0.8, 0.2 ) << QPointF( 1.2, 0 )
+  << QPointF( 5, 5 ) << QPointF( 5.5, 5 ) << QPointF( 10, 0 );
+  QgsSymbolLayerV2Utils::simplifyPolyline( line, 1.0 );
+
+  // vertices closer than the tolerance to the previously kept vertex are dropped
+  QPolygonF expected;
+  expected << QPointF( 0, 0 ) << QPointF( 1.2, 0 ) << QPointF( 5, 5 ) << QPointF( 10, 0 );
+  QCOMPARE( line, expected );
+}
+
+void TestQgsSymbolLayerV2Utils::simplifyPolylineKeepsEnds()
+{
+  // closed ring, the last vertex is kept even if it is close to the previous one
+  QPolygonF ring;
+  ring << QPointF( 0, 0 ) << QPointF( 10, 0 ) << QPointF( 10, 10 ) << QPointF( 10, 10.5 )
+  << QPointF( 0, 10 ) << QPointF( 0, 0.5 ) << QPointF( 0, 0 );
+  QgsSymbolLayerV2Utils::simplifyPolyline( ring, 1.0, 4 );
+
+  QPolygonF expected;
+  expected << QPointF( 0, 0 ) << QPointF( 10, 0 ) << QPointF( 10, 10 ) << QPointF( 0, 10 )
+  << QPointF( 0, 0.5 ) << QPointF( 0, 0 );
+  QCOMPARE( ring, expected );
+  QCOMPARE( ring.first(), ring.last() );
+}
+
+void TestQgsSymbolLayerV2Utils::simplifyPolylineMinPoints()
+{
+  // the ring would collapse to less than minPoints vertices, it is left untouched
+  QPolygonF ring;
+  ring << QPointF( 0, 0 ) << QPointF( 0.2, 0 ) << QPointF( 0.2, 0.2 ) << QPointF( 0, 0.2 ) << QPointF( 0, 0 );
+  QPolygonF result = ring;
+  QgsSymbolLayerV2Utils::simplifyPolyline( result, 1.0, 4 );
+  QCOMPARE( result, ring );
+
+  // short lines are left untouched
+  QPolygonF line;
+  line << QPointF( 0, 0 ) << QPointF( 0.1, 0 );
+  result = line;
+  QgsSymbolLayerV2Utils::simplifyPolyline( result, 1.0 );
+  QCOMPARE( result, line );
+}
+
+QTEST_MAIN( TestQgsSymbolLayerV2Utils )
+#include "moc_testqgssymbollayerv2utils.cxx"
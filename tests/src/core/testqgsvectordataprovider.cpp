@@ -18,6 +18,8 @@
 #include <QObject>
 
 #include <qgsapplication.h>
+#include <qgsexpression.h>
+#include <qgsfeatureblock.h>
 #include <qgsgeometry.h>
 #include <qgsfeaturerequest.h>
 #include <qgsvectordataprovider.h>
@@ -48,6 +50,12 @@ class TestQgsVectorDataProvider : public QObject
 
     void featureAtId();
 
+    void filterExpression();
+
+    void featureBlock();
+
+    void concurrentIterators();
+
   private:
 
     QgsVectorLayer* vlayerPoints;
@@ -226,6 +234,148 @@ void TestQgsVectorDataProvider::featureAtId()
   QVERIFY( !feature.isValid() );
 }
 
+void TestQgsVectorDataProvider::filterExpression()
+{
+  QString filter = "\"Heading\" > 100 AND \"Class\" = 'Jet'";
+
+  // count the matching features by evaluating the expression on all features
+  QgsExpression exp( filter );
+  QVERIFY( exp.prepare( vlayerPoints->pendingFields() ) );
+
+  int expected = 0;
+  QgsFeature f;
+  QgsFeatureIterator fi = vlayerPoints->getFeatures();
+  while ( fi.nextFeature( f ) )
+  {
+    if ( exp.evaluate( &f ).toInt() != 0 )
+      expected++;
+  }
+  QCOMPARE( expected, 3 );
+
+  QgsFeatureRequest request;
+  request.setFilterExpression( filter );
+  QVERIFY( request.filterType() == QgsFeatureRequest::FilterExpression );
+  QCOMPARE( request.filterExpression()->expression(), filter );
+
+  // copies of the request have their own expression
+  QgsFeatureRequest copy( request );
+  QVERIFY( copy.filterExpression() != request.filterExpression() );
+  QVERIFY( copy.filterExpression()->rootNode() != request.filterExpression()->rootNode() );
+  QCOMPARE( copy.filterExpression()->expression(), filter );
+  QCOMPARE( copy.filterExpression()->dump(), request.filterExpression()->dump() );
+
+  // attribute needed by the filter is fetched even if not requested
+  copy.setSubsetOfAttributes( QgsAttributeList() << vlayerPoints->fieldNameIndex( "Importance" ) );
+
+  int count = 0;
+  fi = vlayerPoints->getFeatures( copy );
+  while ( fi.nextFeature( f ) )
+  {
+    QVERIFY( exp.evaluate( &f ).toInt() != 0 );
+    count++;
+  }
+  QCOMPARE( count, expected );
+
+  request.setFilterExpression( QString() );
+  QVERIFY( request.filterType() == QgsFeatureRequest::FilterNone );
+  QVERIFY( !request.filterExpression() );
+}
+
+void TestQgsVectorDataProvider::featureBlock()
+{
+  QgsVectorDataProvider* pr = vlayerPoints->dataProvider();
+  QgsAttributeList attrs;
+  attrs << 0 << 1 << 3; // Class, Heading, Pilots
+
+  // reference features
+  QList<QgsFeature> features;
+  QgsFeature f;
+  QgsFeatureIterator fi = pr->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( attrs ) );
+  while ( fi.nextFeature( f ) )
+    features << f;
+  QCOMPARE( features.count(), 17 );
+
+  QgsFeatureBlock block;
+  block.setColumns( pr->fields(), attrs );
+  QCOMPARE( block.columnCount(), 3 );
+  QCOMPARE( block.columnType( 0 ), QgsFeatureBlock::StringColumn );
+  QCOMPARE( block.columnType( 2 ), QgsFeatureBlock::IntColumn );
+  QCOMPARE( block.columnForAttribute( 3 ), 2 );
+  QCOMPARE( block.columnForAttribute( 2 ), -1 );
+
+  // blocks of the provider and of the layer (which passes through provider's blocks)
+  for ( int pass = 0; pass < 2; ++pass )
+  {
+    QgsFeatureRequest request = QgsFeatureRequest().setSubsetOfAttributes( attrs );
+    fi = pass == 0 ? pr->getFeatures( request ) : vlayerPoints->getFeatures( request );
+
+    int row = 0;
+    int blocks = 0;
+    while ( fi.nextFeatureBlock( block, 5 ) > 0 )
+    {
+      QVERIFY( block.count() <= 5 );
+      blocks++;
+      for ( int i = 0; i < block.count(); ++i, ++row )
+      {
+        const QgsFeature& ref = features[row];
+        QCOMPARE( block.id( i ), ref.id() );
+        QCOMPARE( block.stringValues( 0 )[i], ref.attribute( 0 ).toString() );
+        QCOMPARE( block.value( 1, i ), ref.attribute( 1 ) );
+        QCOMPARE( block.intValues( 2 )[i], ( qlonglong ) ref.attribute( 3 ).toInt() );
+        QCOMPARE( block.wkbSize( i ), ( int ) ref.geometry()->wkbSize() );
+        QVERIFY( memcmp( block.wkb( i ), ref.geometry()->asWkb(), block.wkbSize( i ) ) == 0 );
+
+        block.feature( i, f );
+        QCOMPARE( f.id(), ref.id() );
+        QCOMPARE( f.geometry()->exportToWkt(), ref.geometry()->exportToWkt() );
+      }
+    }
+    QCOMPARE( row, 17 );
+    QCOMPARE( blocks, 4 );
+    QVERIFY( fi.isClosed() );
+  }
+}
+
+void TestQgsVectorDataProvider::concurrentIterators()
+{
+  QgsVectorDataProvider* pr = vlayerPoints->dataProvider();
+
+  // interleaved iteration: opening the second iterator must not restart or close the first one
+  QgsFeatureIterator fi1 = pr->getFeatures();
+  QgsFeature f1, f2;
+  QVERIFY( fi1.nextFeature( f1 ) );
+
+  QgsFeatureIterator fi2 = pr->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() << 0 ) );
+  int count1 = 1, count2 = 0;
+  while ( fi2.nextFeature( f2 ) )
+  {
+    count2++;
+    QVERIFY( f2.geometry() );
+    if ( fi1.nextFeature( f1 ) )
+    {
+      count1++;
+      QCOMPARE( f1.id(), f2.id() + 1 ); // the first iterator is one feature ahead
+      QCOMPARE( f1.attributes().count(), 6 );
+      QVERIFY( !f1.attribute( 1 ).isNull() );
+    }
+  }
+  QCOMPARE( count2, 17 );
+  QCOMPARE( count1, 17 );
+  QVERIFY( !fi1.nextFeature( f1 ) );
+
+  // nested iteration with a new iterator for each feature
+  int nested = 0;
+  fi1 = pr->getFeatures();
+  while ( fi1.nextFeature( f1 ) )
+  {
+    QgsFeatureIterator fi3 = pr->getFeatures( QgsFeatureRequest().setFilterFid( f1.id() ) );
+    QVERIFY( fi3.nextFeature( f2 ) );
+    QCOMPARE( f2.id(), f1.id() );
+    nested++;
+  }
+  QCOMPARE( nested, 17 );
+}
+
 
 QTEST_MAIN( TestQgsVectorDataProvider )
 
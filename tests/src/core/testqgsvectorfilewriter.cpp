@@ -70,6 +70,8 @@ class TestQgsVectorFileWriter: public QObject
     void polygonGridTest();
     /** As above but using a projected CRS*/
     void projectedPlygonGridTest();
+    /** This method tests writing a batch of features in several transactions */
+    void featureBatch();
 
   private:
     // a little util fn used by all tests
@@ -389,6 +391,53 @@ void TestQgsVectorFileWriter::projectedPlygonGridTest()
   }
 }
 
+void TestQgsVectorFileWriter::featureBatch()
+{
+  QString myFileName = "/testbatch.shp";
+  myFileName = QDir::tempPath() + myFileName;
+  QVERIFY( QgsVectorFileWriter::deleteShapeFile( myFileName ) );
+  {
+    QgsVectorFileWriter myWriter( myFileName,
+                                  mEncoding,
+                                  mFields,
+                                  QGis::WKBPoint,
+                                  &mCRS );
+    myWriter.setTransactionSize( 2 );
+
+    // third feature without attribute, fourth without geometry
+    QgsFeatureList myFeatures;
+    for ( int i = 0; i < 5; i++ )
+    {
+      QgsFeature myFeature;
+      if ( i != 3 )
+        myFeature.setGeometry( QgsGeometry::fromPoint( QgsPoint( i, i ) ) );
+      myFeature.initAttributes( 1 );
+      if ( i != 2 )
+        myFeature.setAttribute( 0, QString( "f%1" ).arg( i ) );
+      myFeatures << myFeature;
+    }
+    QVERIFY( myWriter.addFeatures( myFeatures ) );
+    QVERIFY( myWriter.hasError() == QgsVectorFileWriter::NoError );
+  }
+
+  // the OGR feature reused by the writer must not keep values of the previous feature
+  OGRDataSourceH myDS = OGROpen( myFileName.toLocal8Bit().constData(), false, NULL );
+  QVERIFY( myDS );
+  OGRLayerH myLayer = OGR_DS_GetLayer( myDS, 0 );
+  QCOMPARE( OGR_L_GetFeatureCount( myLayer, true ), 5 );
+  for ( int i = 0; i < 5; i++ )
+  {
+    OGRFeatureH myFeature = OGR_L_GetNextFeature( myLayer );
+    QVERIFY( myFeature );
+    QCOMPARE( OGR_F_IsFieldSet( myFeature, 0 ) != 0, i != 2 );
+    if ( i != 2 )
+      QCOMPARE( QString( OGR_F_GetFieldAsString( myFeature, 0 ) ), QString( "f%1" ).arg( i ) );
+    QCOMPARE( OGR_F_GetGeometryRef( myFeature ) != 0, i != 3 );
+    OGR_F_Destroy( myFeature );
+  }
+  OGR_DS_Destroy( myDS );
+}
+
 QTEST_MAIN( TestQgsVectorFileWriter )
 #include "moc_testqgsvectorfilewriter.cxx"
 
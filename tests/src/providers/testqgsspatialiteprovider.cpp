@@ -0,0 +1,140 @@
+/***************************************************************************
+     testqgsspatialiteprovider.cpp
+     --------------------------------------
+    Date                 : May 2013
+    Copyright            : (C) 2013 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QString>
+#include <QDir>
+#include <QFile>
+
+#include <qgsapplication.h>
+#include <qgsfeature.h>
+#include <qgsfeatureiterator.h>
+#include <qgsfeaturerequest.h>
+#include <qgsgeometry.h>
+#include <qgsvectorfilewriter.h>
+#include <qgsvectorlayer.h>
+
+/** \ingroup UnitTests
+ * This is a unit test for reading features with the SpatiaLite provider.
+ */
+class TestQgsSpatiaLiteProvider: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+
+    /** Geometries reduced to a resolution are never lost */
+    void geometryResolution();
+    /** The cached statement is used with different resolutions */
+    void geometryResolutionReused();
+
+  private:
+    //! number of vertices of the features, number of features with polygon geometry
+    int vertexCount( double resolution, int& polygons );
+
+    QString mDbPath;
+    QgsVectorLayer* mLayer;
+};
+
+void TestQgsSpatiaLiteProvider::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  mLayer = 0;
+  mDbPath = QDir::tempPath() + QDir::separator() + "qgis_test_spatialite_polys.sqlite";
+  QFile::remove( mDbPath );
+
+  QString shpPath = QString( TEST_DATA_DIR ) + QDir::separator() + "polys.shp";
+  QgsVectorLayer shpLayer( shpPath, "polys", "ogr" );
+  QVERIFY( shpLayer.isValid() );
+
+  QString errorMessage;
+  QgsVectorFileWriter::WriterError error = QgsVectorFileWriter::writeAsVectorFormat(
+        &shpLayer, mDbPath, "UTF-8", &shpLayer.crs(), "SQLite", false, &errorMessage, QStringList( "SPATIALITE=YES" ) );
+  if ( error != QgsVectorFileWriter::NoError )
+  {
+    QSKIP( QString( "SpatiaLite database could not be created: %1" ).arg( errorMessage ).toLocal8Bit().constData(), SkipAll );
+  }
+
+  // the table is named after the file
+  mLayer = new QgsVectorLayer( QString( "dbname='%1' table=\"qgis_test_spatialite_polys\" (GEOMETRY) sql=" ).arg( mDbPath ), "polys", "spatialite" );
+  QVERIFY( mLayer->isValid() );
+}
+
+void TestQgsSpatiaLiteProvider::cleanupTestCase()
+{
+  delete mLayer;
+  QFile::remove( mDbPath );
+}
+
+int TestQgsSpatiaLiteProvider::vertexCount( double resolution, int& polygons )
+{
+  int vertices = 0;
+  polygons = 0;
+
+  QgsFeatureIterator fit = mLayer->getFeatures( QgsFeatureRequest().setGeometryResolution( resolution ) );
+  QgsFeature f;
+  while ( fit.nextFeature( f ) )
+  {
+    QgsGeometry* geom = f.geometry();
+    if ( !geom || geom->type() != QGis::Polygon )
+      continue;
+
+    polygons++;
+    QgsMultiPolygon multiPolygon = geom->isMultipart() ? geom->asMultiPolygon() : QgsMultiPolygon() << geom->asPolygon();
+    foreach ( const QgsPolygon& polygon, multiPolygon )
+    {
+      foreach ( const QgsPolyline& ring, polygon )
+        vertices += ring.size();
+    }
+  }
+  return vertices;
+}
+
+void TestQgsSpatiaLiteProvider::geometryResolution()
+{
+  int featureCount = mLayer->featureCount();
+  QVERIFY( featureCount > 0 );
+
+  int polygons;
+  int fullVertices = vertexCount( 0, polygons );
+  QCOMPARE( polygons, featureCount );
+
+  // tiny resolution keeps all vertices
+  QCOMPARE( vertexCount( 1e-12, polygons ), fullVertices );
+  QCOMPARE( polygons, featureCount );
+
+  // features collapsing at a coarse resolution keep their geometry
+  double coarse = mLayer->extent().width();
+  QVERIFY( vertexCount( coarse, polygons ) <= fullVertices );
+  QCOMPARE( polygons, featureCount );
+}
+
+void TestQgsSpatiaLiteProvider::geometryResolutionReused()
+{
+  int polygons;
+  int fullVertices = vertexCount( 0, polygons );
+  double resolution = mLayer->extent().width() / 20;
+  int reducedVertices = vertexCount( resolution, polygons );
+  QVERIFY( reducedVertices <= fullVertices );
+
+  // the same statement with other values bound gives the same results
+  QCOMPARE( vertexCount( 1e-12, polygons ), fullVertices );
+  QCOMPARE( vertexCount( resolution, polygons ), reducedVertices );
+}
+
+QTEST_MAIN( TestQgsSpatiaLiteProvider )
+#include "moc_testqgsspatialiteprovider.cxx"
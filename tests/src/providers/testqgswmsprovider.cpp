@@ -0,0 +1,246 @@
+/***************************************************************************
+     testqgswmsprovider.cpp
+     --------------------------------------
+    Date                 : May 2013
+    Copyright            : (C) 2013 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest>
+#include <QObject>
+#include <QBuffer>
+#include <QColor>
+#include <QImage>
+#include <QMap>
+#include <QSettings>
+#include <QString>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include <qgsapplication.h>
+#include <qgsdatasourceuri.h>
+#include <qgsproviderregistry.h>
+#include <qgsrasterblock.h>
+#include <qgsrasterdataprovider.h>
+#include <qgsrectangle.h>
+
+/** \ingroup UnitTests
+ * Stand-in WMTS server: a tile matrix set with 2x2 tiles of 1000 m/pixel (matrix "0")
+ * and 4x4 tiles of 500 m/pixel (matrix "1"). Tiles of a matrix are filled with its color,
+ * matrices without color do not exist (404).
+ */
+class TestTileServer : public QObject
+{
+    Q_OBJECT
+  public:
+    TestTileServer()
+    {
+      connect( &mServer, SIGNAL( newConnection() ), this, SLOT( newConnection() ) );
+      mServer.listen( QHostAddress::LocalHost );
+    }
+
+    QString url() const { return QString( "http://127.0.0.1:%1" ).arg( mServer.serverPort() ); }
+
+    //! paths of the received tile requests
+    QStringList tileRequests;
+    //! color of the tiles of each matrix
+    QMap<QString, QColor> matrixColors;
+
+  private slots:
+    void newConnection()
+    {
+      while ( mServer.hasPendingConnections() )
+      {
+        QTcpSocket *socket = mServer.nextPendingConnection();
+        connect( socket, SIGNAL( readyRead() ), this, SLOT( readRequest() ) );
+        connect( socket, SIGNAL( disconnected() ), socket, SLOT( deleteLater() ) );
+      }
+    }
+
+    void readRequest()
+    {
+      QTcpSocket *socket = qobject_cast<QTcpSocket*>( sender() );
+      QByteArray request = socket->property( "request" ).toByteArray() + socket->readAll();
+      socket->setProperty( "request", request );
+      if ( !request.contains( "\r\n\r\n" ) )
+        return;
+
+      QString path = QString( request ).section( ' ', 1, 1 );
+      QRegExp tileRx( "/tiles/(\\w+)/(\\d+)/(\\d+)\\.png$" );
+      if ( path.endsWith( "/WMTSCapabilities.xml" ) )
+      {
+        reply( socket, "200 OK", "text/xml", capabilities() );
+      }
+      else if ( tileRx.indexIn( path ) >= 0 )
+      {
+        tileRequests << path;
+        if ( matrixColors.contains( tileRx.cap( 1 ) ) )
+        {
+          QImage image( 256, 256, QImage::Format_ARGB32 );
+          image.fill( matrixColors[ tileRx.cap( 1 )].rgba() );
+          QBuffer buffer;
+          buffer.open( QIODevice::WriteOnly );
+          image.save( &buffer, "PNG" );
+          reply( socket, "200 OK", "image/png", buffer.data() );
+        }
+        else
+        {
+          reply( socket, "404 Not Found", "text/plain", "no such tile" );
+        }
+      }
+      else
+      {
+        reply( socket, "404 Not Found", "text/plain", "unknown request" );
+      }
+    }
+
+  private:
+    void reply( QTcpSocket *socket, const QString &status, const QString &contentType, const QByteArray &body )
+    {
+      // not stored in the network cache, tiles found again are from the tile cache of the provider
+      socket->write( QString( "HTTP/1.0 %1\r\nContent-Type: %2\r\nContent-Length: %3\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n" )
+                     .arg( status ).arg( contentType ).arg( body.size() ).toAscii() );
+      socket->write( body );
+      socket->disconnectFromHost();
+    }
+
+    QByteArray capabilities() const
+    {
+      QString matrix( "<TileMatrix><ows:Identifier>%1</ows:Identifier><ScaleDenominator>%2</ScaleDenominator>"
+                      "<TopLeftCorner>0 512000</TopLeftCorner><TileWidth>256</TileWidth><TileHeight>256</TileHeight>"
+                      "<MatrixWidth>%3</MatrixWidth><MatrixHeight>%3</MatrixHeight></TileMatrix>" );
+
+      return QString( "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                      "<Capabilities xmlns=\"http://www.opengis.net/wmts/1.0\" xmlns:ows=\"http://www.opengis.net/ows/1.1\" version=\"1.0.0\">"
+                      "<Contents>"
+                      "<Layer><ows:Title>test</ows:Title><ows:Identifier>test</ows:Identifier>"
+                      "<ows:WGS84BoundingBox><ows:LowerCorner>-10 -10</ows:LowerCorner><ows:UpperCorner>10 10</ows:UpperCorner></ows:WGS84BoundingBox>"
+                      "<Style isDefault=\"true\"><ows:Identifier>default</ows:Identifier></Style>"
+                      "<Format>image/png</Format>"
+                      "<TileMatrixSetLink><TileMatrixSet>grid</TileMatrixSet></TileMatrixSetLink>"
+                      "<ResourceURL format=\"image/png\" resourceType=\"tile\" template=\"%1/tiles/{TileMatrix}/{TileRow}/{TileCol}.png\"/>"
+                      "</Layer>"
+                      "<TileMatrixSet><ows:Identifier>grid</ows:Identifier><ows:SupportedCRS>EPSG:3857</ows:SupportedCRS>%2%3</TileMatrixSet>"
+                      "</Contents>"
+                      "</Capabilities>" )
+             .arg( url() )
+             .arg( matrix.arg( "0" ).arg( 1000 / 0.00028, 0, 'f', 10 ).arg( 2 ) )
+             .arg( matrix.arg( "1" ).arg( 500 / 0.00028, 0, 'f', 10 ).arg( 4 ) )
+             .toUtf8();
+    }
+
+    QTcpServer mServer;
+};
+
+/** \ingroup UnitTests
+ * This is a unit test for the tile cache of the WMS provider.
+ */
+class TestQgsWmsProvider: public QObject
+{
+    Q_OBJECT;
+  private slots:
+    void initTestCase();// will be called before the first testfunction is executed.
+    void cleanupTestCase();// will be called after the last testfunction was executed.
+    void init() {};// will be called before each testfunction is executed.
+    void cleanup() {};// will be called after every testfunction.
+
+    void tileCache();
+    void coarserTiles();
+
+  private:
+    //! color of the pixel of a drawn extent
+    QColor pixel( const QgsRectangle &extent, int row, int col );
+
+    TestTileServer *mServer;
+    QgsRasterDataProvider *mProvider;
+    bool mRenderCaching;
+};
+
+//runs before all tests
+void TestQgsWmsProvider::initTestCase()
+{
+  // init QGIS's paths - true means that all path will be inited from prefix
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  // draw() waits for all tiles
+  QSettings settings;
+  mRenderCaching = settings.value( "/qgis/enable_render_caching", false ).toBool();
+  settings.setValue( "/qgis/enable_render_caching", false );
+
+  mServer = new TestTileServer();
+
+  QgsDataSourceURI uri;
+  uri.setParam( "url", mServer->url() + "/1.0.0/WMTSCapabilities.xml" );
+  uri.setParam( "layers", "test" );
+  uri.setParam( "styles", "default" );
+  uri.setParam( "format", "image/png" );
+  uri.setParam( "crs", "EPSG:3857" );
+  uri.setParam( "tileMatrixSet", "grid" );
+
+  mProvider = dynamic_cast<QgsRasterDataProvider*>( QgsProviderRegistry::instance()->provider( "wms", uri.encodedUri() ) );
+  QVERIFY( mProvider );
+  QVERIFY( mProvider->isValid() );
+}
+
+//runs after all tests
+void TestQgsWmsProvider::cleanupTestCase()
+{
+  delete mProvider;
+  delete mServer;
+
+  QSettings settings;
+  settings.setValue( "/qgis/enable_render_caching", mRenderCaching );
+}
+
+QColor TestQgsWmsProvider::pixel( const QgsRectangle &extent, int row, int col )
+{
+  QgsRasterBlock *block = mProvider->block( 1, extent, 512, 512 );
+  QColor color = QColor::fromRgba( block->color( row, col ) );
+  delete block;
+  return color;
+}
+
+void TestQgsWmsProvider::tileCache()
+{
+  // 2x2 tiles of matrix 0
+  QgsRectangle extent( 0, 0, 512000, 512000 );
+  mServer->matrixColors.insert( "0", Qt::red );
+
+  QCOMPARE( pixel( extent, 100, 400 ), QColor( Qt::red ) );
+  QCOMPARE( mServer->tileRequests.size(), 4 );
+
+  // drawn again from the memory cache, without requests
+  mServer->tileRequests.clear();
+  QCOMPARE( pixel( extent, 400, 100 ), QColor( Qt::red ) );
+  QCOMPARE( mServer->tileRequests.size(), 0 );
+}
+
+void TestQgsWmsProvider::coarserTiles()
+{
+  // 2x2 tiles of matrix 1 in the lower left tile of matrix 0, which is in the cache
+  QgsRectangle extent( 0, 0, 256000, 256000 );
+  mServer->tileRequests.clear();
+
+  // the tiles of matrix 1 are missing, the cached tile of matrix 0 is shown instead
+  QCOMPARE( pixel( extent, 100, 400 ), QColor( Qt::red ) );
+  QCOMPARE( mServer->tileRequests.size(), 4 );
+  foreach ( QString path, mServer->tileRequests )
+  {
+    QVERIFY( path.contains( "/tiles/1/" ) );
+  }
+
+  // the arriving tiles replace it
+  mServer->matrixColors.insert( "1", Qt::blue );
+  QCOMPARE( pixel( extent, 100, 400 ), QColor( Qt::blue ) );
+  QCOMPARE( pixel( extent, 400, 100 ), QColor( Qt::blue ) );
+}
+
+QTEST_MAIN( TestQgsWmsProvider )
+#include "moc_testqgswmsprovider.cxx"
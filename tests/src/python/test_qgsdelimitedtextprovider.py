@@ -0,0 +1,107 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for QgsDelimitedTextProvider.
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+"""
+__author__ = 'the QGIS project'
+__date__ = '20/05/2013'
+__copyright__ = 'Copyright 2013, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import os
+import shutil
+import tempfile
+
+from PyQt4.QtCore import QUrl
+
+from qgis.core import (QgsVectorLayer,
+                       QgsFeature,
+                       QgsFeatureRequest,
+                       QgsRectangle)
+
+from utilities import (getQgisTestApp,
+                       TestCase,
+                       unittest
+                       )
+QGISAPP, CANVAS, IFACE, PARENT = getQgisTestApp()
+
+TEXT = (u'id,name,x,y\r\n'
+        u'1,Zürich,8.5,47.4\r\n'
+        u'2,København,12.6,55.7\r\n'
+        u'\r\n'
+        u'3,Москва,37.6,55.8\r\n')
+
+EXPECTED = {1: u'Zürich', 2: u'København', 3: u'Москва'}
+
+
+class TestQgsDelimitedTextProvider(TestCase):
+
+    def setUp(self):
+        self.tempDir = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.tempDir, True)
+
+    def createLayer(self, encoding, data):
+        path = os.path.join(self.tempDir, '%s.csv' % encoding)
+        f = open(path, 'wb')
+        f.write(data)
+        f.close()
+
+        url = QUrl.fromLocalFile(path)
+        url.addQueryItem('delimiter', ',')
+        url.addQueryItem('xField', 'x')
+        url.addQueryItem('yField', 'y')
+        layer = QgsVectorLayer(str(url.toEncoded()), encoding, 'delimitedtext')
+        myMessage = 'Failed to create layer from %s file' % encoding
+        assert layer.isValid(), myMessage
+        return layer
+
+    def names(self, layer, request=QgsFeatureRequest()):
+        idx = layer.fieldNameIndex('name')
+        myMessage = 'Field name not found in %s' % [unicode(f.name()) for f in layer.pendingFields()]
+        assert idx >= 0, myMessage
+
+        names = {}
+        f = QgsFeature()
+        fit = layer.getFeatures(request)
+        while fit.nextFeature(f):
+            ident = int(f.attributes()[layer.fieldNameIndex('id')].toString())
+            names[ident] = unicode(f.attributes()[idx].toString())
+        return names
+
+    def checkEncoding(self, encoding, data=None):
+        if data is None:
+            data = TEXT.encode(encoding)
+        layer = self.createLayer(encoding, data)
+        myMessage = 'Expected: %s features\nGot: %s\n' % (len(EXPECTED), layer.featureCount())
+        assert layer.featureCount() == len(EXPECTED), myMessage
+
+        names = self.names(layer)
+        myMessage = 'Expected: %r\nGot: %r\n' % (EXPECTED, names)
+        assert names == EXPECTED, myMessage
+
+        # records read at their offsets
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(12, 55, 13, 56))
+        names = self.names(layer, request)
+        myMessage = 'Expected: %r\nGot: %r\n' % ({2: EXPECTED[2]}, names)
+        assert names == {2: EXPECTED[2]}, myMessage
+
+    def testUtf8Bom(self):
+        self.checkEncoding('utf-8-sig')
+
+    def testUtf16LittleEndianBom(self):
+        self.checkEncoding('utf-16-le', '\xff\xfe' + TEXT.encode('utf-16-le'))
+
+    def testUtf16BigEndianBom(self):
+        self.checkEncoding('utf-16-be', '\xfe\xff' + TEXT.encode('utf-16-be'))
+
+    def testUtf32Bom(self):
+        self.checkEncoding('utf-32')
+
+if __name__ == '__main__':
+    unittest.main()
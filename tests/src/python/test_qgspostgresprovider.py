@@ -0,0 +1,80 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for QgsPostgresProvider.
+
+The tests need a PostgreSQL database, its connection string (e.g. "dbname='qgis_test'")
+is read from QGIS_PGTEST_DB environment variable, they are skipped if it is not set.
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+"""
+__author__ = 'the QGIS project'
+__date__ = '13/05/2013'
+__copyright__ = 'Copyright 2013, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import os
+
+from qgis.core import (QgsVectorLayer,
+                       QgsFeature,
+                       QgsFeatureRequest,
+                       QgsDataSourceURI)
+
+from utilities import (getQgisTestApp,
+                       TestCase,
+                       unittest
+                       )
+QGISAPP, CANVAS, IFACE, PARENT = getQgisTestApp()
+
+DB_CONNECTION = os.environ.get('QGIS_PGTEST_DB')
+
+# values whose text representation with 15 significant digits differs from the value
+FLOAT8_QUERY = ('(SELECT 1 AS id, 0.1::float8 + 0.2::float8 AS value '
+                'UNION ALL SELECT 2, 1::float8 / 3 '
+                'UNION ALL SELECT 3, 2::float8 / 3)')
+
+
+@unittest.skipIf(DB_CONNECTION is None, 'QGIS_PGTEST_DB is not set')
+class TestQgsPostgresProvider(TestCase):
+
+    def createLayer(self):
+        uri = QgsDataSourceURI(DB_CONNECTION)
+        uri.setDataSource('', FLOAT8_QUERY, None, '', 'id')
+        layer = QgsVectorLayer(uri.uri(), 'float8', 'postgres')
+        assert layer.isValid(), 'Failed to create postgres layer'
+        return layer
+
+    def featureValues(self, layer):
+        idx = layer.fieldNameIndex('value')
+        values = []
+        f = QgsFeature()
+        fit = layer.getFeatures(QgsFeatureRequest())
+        while fit.nextFeature(f):
+            values.append(f.attributes()[idx].toDouble()[0])
+        return sorted(values)
+
+    def testFloat8UniqueValues(self):
+        layer = self.createLayer()
+        provider = layer.dataProvider()
+        idx = layer.fieldNameIndex('value')
+        unique = [v.toDouble()[0] for v in provider.uniqueValues(idx)]
+        expected = self.featureValues(layer)
+        myMessage = 'Expected: %r\nGot: %r\n' % (expected, unique)
+        assert sorted(unique) == expected, myMessage
+
+    def testFloat8MinMax(self):
+        layer = self.createLayer()
+        provider = layer.dataProvider()
+        idx = layer.fieldNameIndex('value')
+        values = self.featureValues(layer)
+        minimum = provider.minimumValue(idx).toDouble()[0]
+        maximum = provider.maximumValue(idx).toDouble()[0]
+        myMessage = 'Expected: %r\nGot: %r\n' % (values[0], minimum)
+        assert minimum == values[0], myMessage
+        myMessage = 'Expected: %r\nGot: %r\n' % (values[-1], maximum)
+        assert maximum == values[-1], myMessage
+
+if __name__ == '__main__':
+    unittest.main()
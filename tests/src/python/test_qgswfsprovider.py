@@ -0,0 +1,242 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for QgsWFSProvider.
+
+The features are fetched from a local stand-in WFS 1.0 server, which cuts
+its responses at MAXFEATURES like the real servers do.
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+"""
+__author__ = 'the QGIS project'
+__date__ = '20/05/2013'
+__copyright__ = 'Copyright 2013, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import subprocess
+import sys
+import urllib2
+
+from qgis.core import (QgsVectorLayer,
+                       QgsMapLayerRegistry,
+                       QgsFeatureRequest,
+                       QgsRectangle)
+
+from utilities import (getQgisTestApp,
+                       TestCase,
+                       unittest
+                       )
+QGISAPP, CANVAS, IFACE, PARENT = getQgisTestApp()
+
+# The server runs in another process, the provider blocks the interpreter
+# while it waits for the responses. It prints its port when it is ready.
+SERVER = r'''
+import BaseHTTPServer
+import sys
+import urlparse
+
+# a dense cluster, more features than MAXFEATURES of a tile at the last
+# level of subdivision, and features spread over the whole extent
+POINTS = [(0.1 + (i % 40 + 0.37) / 4000.0, 0.1 + (i / 40 + 0.37) / 4000.0) for i in range(1200)]
+POINTS += [((i * 7919 % 9973 + 0.37) / 1000.0, (i * 104729 % 9967 + 0.37) / 1000.0) for i in range(300)]
+
+XSD = ('<?xml version="1.0" encoding="UTF-8"?>'
+       '<schema xmlns="http://www.w3.org/2001/XMLSchema" xmlns:qgs="http://qgis.org/gml" '
+       'xmlns:gml="http://www.opengis.net/gml" targetNamespace="http://qgis.org/gml" elementFormDefault="qualified">'
+       '<element name="points" type="qgs:pointsType" substitutionGroup="gml:_Feature"/>'
+       '<complexType name="pointsType"><complexContent><extension base="gml:AbstractFeatureType"><sequence>'
+       '<element name="geometry" type="gml:PointPropertyType"/>'
+       '<element name="name" type="string"/>'
+       '<element name="value" type="int"/>'
+       '</sequence></extension></complexContent></complexType>'
+       '</schema>')
+
+CAPABILITIES = ('<?xml version="1.0" encoding="UTF-8"?>'
+                '<WFS_Capabilities xmlns="http://www.opengis.net/wfs" version="1.0.0"/>')
+
+
+class Handler(BaseHTTPServer.BaseHTTPRequestHandler):
+
+    # number of GetFeature requests received, reported at /count
+    getFeatureCount = 0
+
+    def do_GET(self):
+        url = urlparse.urlparse(self.path)
+        if url.path == '/count':
+            self.reply(str(Handler.getFeatureCount))
+            return
+        query = dict((k.upper(), v) for k, v in urlparse.parse_qsl(url.query))
+        request = query.get('REQUEST', '')
+        if request == 'GetFeature':
+            Handler.getFeatureCount += 1
+        if request == 'DescribeFeatureType':
+            self.reply(XSD)
+        elif request == 'GetCapabilities':
+            self.reply(CAPABILITIES)
+        elif request == 'GetFeature' and 'FAIL' in query:
+            self.send_error(500)
+        elif request == 'GetFeature':
+            self.reply(self.features(query))
+        else:
+            self.send_error(400)
+
+    def features(self, query):
+        bbox = [float(c) for c in query['BBOX'].split(',')] if 'BBOX' in query else None
+        maxFeatures = int(query['MAXFEATURES']) if 'MAXFEATURES' in query else len(POINTS)
+        members = []
+        xs = []
+        ys = []
+        for fid, (x, y) in enumerate(POINTS):
+            if bbox and not (bbox[0] <= x <= bbox[2] and bbox[1] <= y <= bbox[3]):
+                continue
+            if len(members) == maxFeatures:
+                break
+            xs.append(x)
+            ys.append(y)
+            members.append('<gml:featureMember><qgs:points fid="points.%d">'
+                           '<qgs:geometry><gml:Point><gml:coordinates cs="," ts=" ">%r,%r</gml:coordinates></gml:Point></qgs:geometry>'
+                           '<qgs:name>point %d</qgs:name><qgs:value>%d</qgs:value>'
+                           '</qgs:points></gml:featureMember>' % (fid, x, y, fid, fid))
+        # the bounding box of the collection comes before its members
+        boundedBy = ''
+        if members:
+            boundedBy = ('<gml:boundedBy><gml:Box srsName="EPSG:4326"><gml:coordinates cs="," ts=" ">'
+                         '%r,%r %r,%r</gml:coordinates></gml:Box></gml:boundedBy>' % (min(xs), min(ys), max(xs), max(ys)))
+        return ('<?xml version="1.0" encoding="UTF-8"?>'
+                '<wfs:FeatureCollection xmlns:wfs="http://www.opengis.net/wfs" '
+                'xmlns:gml="http://www.opengis.net/gml" xmlns:qgs="http://qgis.org/gml">'
+                + boundedBy + ''.join(members) + '</wfs:FeatureCollection>')
+
+    def reply(self, body):
+        self.send_response(200)
+        self.send_header('Content-Type', 'text/xml')
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_message(self, *args):
+        pass
+
+server = BaseHTTPServer.HTTPServer(('127.0.0.1', 0), Handler)
+sys.stdout.write('%d\n' % server.server_port)
+sys.stdout.flush()
+server.serve_forever()
+'''
+
+# number of features of the server
+FEATURE_COUNT = 1500
+
+
+class TestQgsWFSProvider(TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.server = subprocess.Popen([sys.executable, '-c', SERVER], stdout=subprocess.PIPE)
+        cls.port = int(cls.server.stdout.readline())
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.server.terminate()
+        cls.server.wait()
+
+    def layerUri(self, extraParameters=''):
+        return ('http://127.0.0.1:%d/wfs?SERVICE=WFS&VERSION=1.0.0&REQUEST=GetFeature'
+                '&TYPENAME=points&SRSNAME=EPSG:4326%s' % (self.port, extraParameters))
+
+    def createLayer(self, extraParameters=''):
+        # a layer with BBOX fetches the features of the rendered tiles only
+        uri = self.layerUri('&BBOX=0,0,10,10' + extraParameters)
+        layer = QgsVectorLayer(uri, 'points', 'WFS')
+        myMessage = 'Failed to create layer from %s' % uri
+        assert layer.isValid(), myMessage
+        QgsMapLayerRegistry.instance().addMapLayers([layer])
+        return layer
+
+    def getFeatureCount(self):
+        return int(urllib2.urlopen('http://127.0.0.1:%d/count' % self.port).read())
+
+    def fetchValues(self, layer, rect):
+        idx = layer.fieldNameIndex('value')
+        values = set()
+        request = QgsFeatureRequest().setFilterRect(rect)
+        for f in layer.getFeatures(request):
+            values.add(f[idx])
+        return values
+
+    def testTruncatedTiles(self):
+        layer = self.createLayer()
+        try:
+            values = self.fetchValues(layer, QgsRectangle(0, 0, 10, 10))
+            myMessage = ('Expected: %d features\nGot: %d features\n' %
+                         (FEATURE_COUNT, len(values)))
+            assert values == set(range(FEATURE_COUNT)), myMessage
+
+            # the tiles are loaded, nothing is lost when rendering a part of them
+            values = self.fetchValues(layer, QgsRectangle(0, 0, 1, 1))
+            myMessage = 'Expected: cluster of 1200 features\nGot: %d features\n' % len(values)
+            assert set(range(1200)).issubset(values), myMessage
+        finally:
+            QgsMapLayerRegistry.instance().removeMapLayers([layer.id()])
+
+    def testVisitedTiles(self):
+        layer = self.createLayer()
+        try:
+            values = self.fetchValues(layer, QgsRectangle(2, 2, 4, 4))
+            count = self.getFeatureCount()
+
+            # the tiles are kept, going back to them does not request them again
+            self.fetchValues(layer, QgsRectangle(6, 6, 8, 8))
+            assert self.getFeatureCount() > count, 'Expected GetFeature requests for new tiles'
+            count = self.getFeatureCount()
+            assert self.fetchValues(layer, QgsRectangle(2, 2, 4, 4)) == values
+            myMessage = 'Expected: %d GetFeature requests\nGot: %d\n' % (count, self.getFeatureCount())
+            assert self.getFeatureCount() == count, myMessage
+        finally:
+            QgsMapLayerRegistry.instance().removeMapLayers([layer.id()])
+
+    def testZoomedOut(self):
+        layer = self.createLayer()
+        try:
+            # far more tiles than fetched one by one, the extent is requested at once
+            values = self.fetchValues(layer, QgsRectangle(-100, -100, 100, 100))
+            myMessage = ('Expected: %d features\nGot: %d features\n' %
+                         (FEATURE_COUNT, len(values)))
+            assert values == set(range(FEATURE_COUNT)), myMessage
+        finally:
+            QgsMapLayerRegistry.instance().removeMapLayers([layer.id()])
+
+    def testUserMaxFeatures(self):
+        layer = self.createLayer('&MAXFEATURES=10')
+        try:
+            # the features are in the lower left 2x2 tiles, each of them is cut at 10 features
+            values = self.fetchValues(layer, QgsRectangle(0, 0, 10, 10))
+            myMessage = 'Expected: 40 features\nGot: %d features\n' % len(values)
+            assert len(values) == 40, myMessage
+        finally:
+            QgsMapLayerRegistry.instance().removeMapLayers([layer.id()])
+
+    def testFailedRequest(self):
+        # without BBOX all the features are requested when the layer is created
+        layer = QgsVectorLayer(self.layerUri('&FAIL=1'), 'points', 'WFS')
+        assert not layer.isValid(), 'Expected an invalid layer when GetFeature fails'
+
+    def testExtent(self):
+        layer = QgsVectorLayer(self.layerUri(), 'points', 'WFS')
+        assert layer.isValid(), 'Failed to create layer from %s' % self.layerUri()
+
+        # the extent is complete before all the features were received
+        extent = layer.dataProvider().extent()
+
+        featuresExtent = QgsRectangle()
+        featuresExtent.setMinimal()
+        for f in layer.getFeatures():
+            featuresExtent.combineExtentWith(f.geometry().boundingBox())
+
+        myMessage = 'Expected: extent %s\nGot: %s\n' % (featuresExtent.toString(), extent.toString())
+        assert extent.contains(featuresExtent), myMessage
+
+
+if __name__ == '__main__':
+    unittest.main()